@@ -0,0 +1,777 @@
+/*
+ * JT/T 1078 Asynchronous Transmit Loop
+ * io_uring(原始系统调用, 不依赖 liburing)与 epoll 后端实现
+ */
+
+#define _GNU_SOURCE
+#include "jtt1078_aio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// 旧工具链没有 <linux/io_uring.h>(5.1+), 或缺少 FAST_POLL(5.7+) 时只编译 epoll 后端
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_FAST_POLL)
+#define AIO_HAVE_URING 1
+#endif
+
+#define AIO_MIN_BUFFER      (64 * 1024)     // 缓冲区初始大小
+#define AIO_UD_TIMEOUT      1ULL            // user_data 低位: 链接超时
+#define AIO_UD_WAIT         (~0ULL)         // 等待超时(jtt1078_aio_run)
+#define AIO_UD_CANCEL       (~1ULL)         // 取消请求
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool stream_has_data(const jtt1078_aio_stream_t *s) {
+    return s->pend.len > 0 || s->out.off < s->out.len;
+}
+
+static void update_backlog(jtt1078_aio_stream_t *s) {
+    JTT1078_STAT_STORE(s->stats.backlog, s->pend.len + (s->out.len - s->out.off));
+}
+
+// 发送区写完后换入待发送区
+static void swap_buffers(jtt1078_aio_stream_t *s) {
+    jtt1078_aio_buf_t tmp = s->out;
+    s->out = s->pend;
+    s->out.off = 0;
+    s->pend = tmp;
+    s->pend.len = 0;
+    s->pend.off = 0;
+}
+
+// 流失败: 丢弃未发出的数据, 之后的帧被拒绝
+static void stream_fail(jtt1078_aio_stream_t *s, int err) {
+    if (!s->stats.failed) {
+        fprintf(stderr, "[JTT1078] AIO stream %d failed: %s\n", s->index, strerror(err));
+    }
+    JTT1078_STAT_STORE(s->stats.error, err);
+    JTT1078_STAT_STORE(s->stats.failed, true);
+    s->pend.len = 0;
+    s->out.len = s->out.off = 0;
+    update_backlog(s);
+}
+
+/*
+ * io_uring 后端
+ */
+
+#ifdef AIO_HAVE_URING
+
+struct jtt1078_aio_uring {
+    int fd;
+    unsigned sq_entries;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    unsigned tail;              // 本地SQ尾(uring_enter 时发布)
+    unsigned to_submit;         // 已写入SQ尚未提交的SQE数
+    bool wait_armed;            // 等待超时SQE未完成
+    struct __kernel_timespec link_ts;
+    struct __kernel_timespec wait_ts;
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_close(struct jtt1078_aio_uring *r) {
+    if (r->sqes) {
+        munmap(r->sqes, r->sqes_size);
+    }
+    if (r->cq_ptr && r->cq_ptr != r->sq_ptr) {
+        munmap(r->cq_ptr, r->cq_size);
+    }
+    if (r->sq_ptr) {
+        munmap(r->sq_ptr, r->sq_size);
+    }
+    if (r->fd >= 0) {
+        close(r->fd);
+    }
+    free(r);
+}
+
+// 内核是否支持所需的操作(IORING_REGISTER_PROBE, 5.6+)
+static bool uring_probe(int fd) {
+    static const uint8_t ops[] = {
+        IORING_OP_SEND, IORING_OP_LINK_TIMEOUT, IORING_OP_TIMEOUT, IORING_OP_ASYNC_CANCEL,
+    };
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    if (!probe) {
+        return false;
+    }
+
+    bool ok = sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+    for (size_t i = 0; ok && i < sizeof(ops); i++) {
+        ok = ops[i] <= probe->last_op && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+static struct jtt1078_aio_uring *uring_open(unsigned entries) {
+    struct jtt1078_aio_uring *r = calloc(1, sizeof(*r));
+    if (!r) {
+        return NULL;
+    }
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = sys_io_uring_setup(entries, &p);
+    if (r->fd < 0) {
+        free(r);
+        return NULL;
+    }
+    // FAST_POLL: socket 未就绪时由内核轮询重试, 不占用 io-wq 工作线程
+    if (!(p.features & IORING_FEAT_FAST_POLL) || !uring_probe(r->fd)) {
+        uring_close(r);
+        return NULL;
+    }
+
+    r->sq_entries = p.sq_entries;
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_size > r->sq_size) {
+            r->sq_size = r->cq_size;
+        }
+        r->cq_size = r->sq_size;
+    }
+
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        r->sq_ptr = NULL;
+        uring_close(r);
+        return NULL;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            r->cq_ptr = NULL;
+            uring_close(r);
+            return NULL;
+        }
+    }
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        uring_close(r);
+        return NULL;
+    }
+
+    uint8_t *sq = r->sq_ptr;
+    uint8_t *cq = r->cq_ptr;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->tail = *r->sq_tail;
+    return r;
+}
+
+// 取一个空闲SQE(调用方保证空间足够), 在 uring_enter 时一并提交
+static struct io_uring_sqe *uring_get_sqe(struct jtt1078_aio_uring *r) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (r->tail - head >= r->sq_entries) {
+        return NULL;
+    }
+    unsigned index = r->tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[index] = index;
+    r->tail++;
+    r->to_submit++;
+    return sqe;
+}
+
+static unsigned uring_space(struct jtt1078_aio_uring *r) {
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    return r->sq_entries - (r->tail - head);
+}
+
+static int uring_enter(jtt1078_aio_t *aio, unsigned min_complete) {
+    struct jtt1078_aio_uring *r = aio->ring;
+    // 发布新SQE
+    __atomic_store_n(r->sq_tail, r->tail, __ATOMIC_RELEASE);
+
+    for (;;) {
+        int ret = sys_io_uring_enter(r->fd, r->to_submit, min_complete,
+                                     min_complete ? IORING_ENTER_GETEVENTS : 0);
+        JTT1078_STAT_ADD(aio->stats.syscalls, 1);
+        if (ret >= 0) {
+            JTT1078_STAT_ADD(aio->stats.submitted, ret);
+            r->to_submit -= (unsigned)ret < r->to_submit ? (unsigned)ret : r->to_submit;
+            return 0;
+        }
+        if (errno == EINTR) {
+            // 提交已完成, 只是等待被信号打断
+            continue;
+        }
+        // EBUSY/EAGAIN: CQ 积压, 收割后下一轮重试
+        return errno == EBUSY || errno == EAGAIN ? 0 : -1;
+    }
+}
+
+// 提交一个流的发送, 链接超时
+static bool uring_submit_stream(jtt1078_aio_t *aio, jtt1078_aio_stream_t *s) {
+    struct jtt1078_aio_uring *r = aio->ring;
+    if (uring_space(r) < 2) {
+        return false;
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = s->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(s->out.data + s->out.off);
+    sqe->len = s->out.len - s->out.off;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = (uint64_t)s->index << 1;
+
+    sqe = uring_get_sqe(r);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&r->link_ts;
+    sqe->len = 1;
+    sqe->user_data = ((uint64_t)s->index << 1) | AIO_UD_TIMEOUT;
+
+    s->busy = true;
+    aio->inflight++;
+    JTT1078_STAT_ADD(s->stats.sends, 1);
+    return true;
+}
+
+static void uring_complete_send(jtt1078_aio_t *aio, jtt1078_aio_stream_t *s, int res) {
+    s->busy = false;
+    aio->inflight--;
+    if (s->fd < 0) {
+        return;         // 已移除(取消)
+    }
+
+    if (res > 0) {
+        s->out.off += (uint32_t)res;
+        JTT1078_STAT_ADD(s->stats.bytes_sent, res);
+        if (s->out.off < s->out.len) {
+            JTT1078_STAT_ADD(s->stats.partial, 1);
+        }
+        update_backlog(s);
+    } else if (res == -ECANCELED) {
+        // 链接超时先到期
+        JTT1078_STAT_ADD(aio->stats.timeouts, 1);
+        stream_fail(s, ETIMEDOUT);
+    } else if (res == 0) {
+        stream_fail(s, ECONNRESET);
+    } else if (res != -EINTR && res != -EAGAIN) {
+        stream_fail(s, -res);
+    }
+}
+
+// 批量收割CQ, 返回收割数
+static unsigned uring_reap(jtt1078_aio_t *aio) {
+    struct jtt1078_aio_uring *r = aio->ring;
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n = tail - head;
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        uint64_t ud = cqe->user_data;
+        if (ud == AIO_UD_WAIT) {
+            r->wait_armed = false;
+        } else if (ud == AIO_UD_CANCEL || (ud & AIO_UD_TIMEOUT)) {
+            // 取消结果/链接超时(到期时发送以 -ECANCELED 完成)
+        } else if ((ud >> 1) < (uint64_t)aio->max_streams) {
+            uring_complete_send(aio, &aio->streams[ud >> 1], cqe->res);
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+    if (n > 0) {
+        JTT1078_STAT_ADD(aio->stats.completions, n);
+        JTT1078_STAT_MAX(aio->stats.max_batch, n);
+    }
+    return n;
+}
+
+static int uring_run(jtt1078_aio_t *aio, int timeout_ms) {
+    struct jtt1078_aio_uring *r = aio->ring;
+    unsigned reaped = uring_reap(aio);
+
+    for (int i = 0; i < aio->max_streams; i++) {
+        jtt1078_aio_stream_t *s = &aio->streams[i];
+        if (s->fd < 0 || s->busy || s->stats.failed) {
+            continue;
+        }
+        if (s->out.off == s->out.len) {
+            swap_buffers(s);
+        }
+        if (s->out.off < s->out.len && !uring_submit_stream(aio, s)) {
+            break;      // SQ 满, 下一轮提交
+        }
+    }
+
+    // 提交与等待合并为一次 io_uring_enter; 已有完成时不等待
+    unsigned min_complete = 0;
+    if (aio->inflight > 0 && reaped == 0 && timeout_ms != 0) {
+        min_complete = 1;
+        if (timeout_ms > 0 && !r->wait_armed && uring_space(r) > 0) {
+            struct io_uring_sqe *sqe = uring_get_sqe(r);
+            r->wait_ts.tv_sec = timeout_ms / 1000;
+            r->wait_ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = (uint64_t)(uintptr_t)&r->wait_ts;
+            sqe->len = 1;
+            sqe->off = 1;           // 任一完成即结束
+            sqe->user_data = AIO_UD_WAIT;
+            r->wait_armed = true;
+        }
+    }
+    if ((r->to_submit > 0 || min_complete > 0) && uring_enter(aio, min_complete) < 0) {
+        return -1;
+    }
+    uring_reap(aio);
+    return 0;
+}
+
+// 取消流的未完成发送并等待其完成
+static void uring_cancel(jtt1078_aio_t *aio, jtt1078_aio_stream_t *s) {
+    struct jtt1078_aio_uring *r = aio->ring;
+    struct io_uring_sqe *sqe = uring_get_sqe(r);
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t)s->index << 1;
+        sqe->user_data = AIO_UD_CANCEL;
+    }
+    while (s->busy) {
+        if (uring_enter(aio, 1) < 0) {
+            break;
+        }
+        uring_reap(aio);
+    }
+}
+
+#else
+
+struct jtt1078_aio_uring {
+    int fd;
+};
+
+#endif // AIO_HAVE_URING
+
+/*
+ * epoll 后端
+ */
+
+static void epoll_arm(jtt1078_aio_t *aio, jtt1078_aio_stream_t *s, uint32_t events) {
+    struct epoll_event ev = { .events = events | EPOLLONESHOT, .data.ptr = s };
+    epoll_ctl(aio->epfd, EPOLL_CTL_MOD, s->fd, &ev);
+    JTT1078_STAT_ADD(aio->stats.syscalls, 1);
+}
+
+// 写到发送区与待发送区都空或 EAGAIN
+static void epoll_flush(jtt1078_aio_t *aio, jtt1078_aio_stream_t *s) {
+    while (!s->stats.failed) {
+        if (s->out.off == s->out.len) {
+            if (s->pend.len == 0) {
+                break;
+            }
+            swap_buffers(s);
+        }
+
+        ssize_t n = send(s->fd, s->out.data + s->out.off, s->out.len - s->out.off,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        JTT1078_STAT_ADD(aio->stats.syscalls, 1);
+        JTT1078_STAT_ADD(s->stats.sends, 1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                s->busy = true;
+                s->busy_since_us = monotonic_us();
+                aio->inflight++;
+                epoll_arm(aio, s, EPOLLOUT);
+            } else {
+                stream_fail(s, errno);
+            }
+            break;
+        }
+        s->out.off += (uint32_t)n;
+        JTT1078_STAT_ADD(s->stats.bytes_sent, n);
+        if (s->out.off < s->out.len) {
+            JTT1078_STAT_ADD(s->stats.partial, 1);
+        }
+    }
+    update_backlog(s);
+}
+
+static void epoll_unbusy(jtt1078_aio_t *aio, jtt1078_aio_stream_t *s) {
+    if (s->busy) {
+        s->busy = false;
+        aio->inflight--;
+    }
+}
+
+static int epoll_run(jtt1078_aio_t *aio, int timeout_ms) {
+    for (int i = 0; i < aio->max_streams; i++) {
+        jtt1078_aio_stream_t *s = &aio->streams[i];
+        if (s->fd >= 0 && !s->busy && !s->stats.failed && stream_has_data(s)) {
+            epoll_flush(aio, s);
+        }
+    }
+    if (aio->inflight == 0) {
+        return 0;
+    }
+
+    // 等待时间不超过最早的发送超时
+    uint64_t now = monotonic_us();
+    uint64_t earliest = UINT64_MAX;
+    for (int i = 0; i < aio->max_streams; i++) {
+        jtt1078_aio_stream_t *s = &aio->streams[i];
+        if (s->fd >= 0 && s->busy) {
+            uint64_t deadline = s->busy_since_us + (uint64_t)aio->timeout_ms * 1000;
+            if (deadline < earliest) {
+                earliest = deadline;
+            }
+        }
+    }
+    int wait = timeout_ms;
+    if (earliest != UINT64_MAX) {
+        int until = earliest > now ? (int)((earliest - now + 999) / 1000) : 0;
+        if (wait < 0 || until < wait) {
+            wait = until;
+        }
+    }
+
+    struct epoll_event events[64];
+    int n = epoll_wait(aio->epfd, events, 64, wait);
+    JTT1078_STAT_ADD(aio->stats.syscalls, 1);
+    if (n < 0 && errno != EINTR) {
+        return -1;
+    }
+    if (n > 0) {
+        JTT1078_STAT_ADD(aio->stats.completions, n);
+        JTT1078_STAT_MAX(aio->stats.max_batch, (uint32_t)n);
+    }
+    for (int i = 0; i < n; i++) {
+        jtt1078_aio_stream_t *s = (jtt1078_aio_stream_t *)events[i].data.ptr;
+        if (s->fd < 0) {
+            continue;
+        }
+        epoll_unbusy(aio, s);
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            stream_fail(s, err ? err : ECONNRESET);
+        } else {
+            epoll_flush(aio, s);
+        }
+    }
+
+    // 发送超时
+    now = monotonic_us();
+    for (int i = 0; i < aio->max_streams; i++) {
+        jtt1078_aio_stream_t *s = &aio->streams[i];
+        if (s->fd >= 0 && s->busy && now - s->busy_since_us >= (uint64_t)aio->timeout_ms * 1000) {
+            epoll_unbusy(aio, s);
+            JTT1078_STAT_ADD(aio->stats.timeouts, 1);
+            stream_fail(s, ETIMEDOUT);
+        }
+    }
+    return 0;
+}
+
+/*
+ * 公共接口
+ */
+
+int jtt1078_aio_init(jtt1078_aio_t *aio, int max_streams, int timeout_ms, int flags) {
+    if (!aio || max_streams <= 0 || max_streams > JTT1078_AIO_MAX_STREAMS) {
+        return -1;
+    }
+
+    memset(aio, 0, sizeof(jtt1078_aio_t));
+    aio->epfd = -1;
+    aio->max_streams = max_streams;
+    aio->timeout_ms = timeout_ms > 0 ? timeout_ms : JTT1078_AIO_DEFAULT_TIMEOUT;
+    aio->streams = calloc(max_streams, sizeof(jtt1078_aio_stream_t));
+    if (!aio->streams) {
+        return -1;
+    }
+    for (int i = 0; i < max_streams; i++) {
+        aio->streams[i].aio = aio;
+        aio->streams[i].fd = -1;
+        aio->streams[i].index = i;
+    }
+
+#ifdef AIO_HAVE_URING
+    if (!(flags & JTT1078_AIO_FORCE_EPOLL)) {
+        // 每流一个发送和一个链接超时, 另加等待超时与取消
+        aio->ring = uring_open((unsigned)max_streams * 2 + 2);
+        if (aio->ring) {
+            aio->ring->link_ts.tv_sec = aio->timeout_ms / 1000;
+            aio->ring->link_ts.tv_nsec = (long long)(aio->timeout_ms % 1000) * 1000000;
+            aio->backend = JTT1078_AIO_URING;
+            return 0;
+        }
+    }
+#else
+    (void)flags;
+#endif
+
+    aio->backend = JTT1078_AIO_EPOLL;
+    aio->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (aio->epfd < 0) {
+        free(aio->streams);
+        aio->streams = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+jtt1078_aio_stream_t *jtt1078_aio_add(jtt1078_aio_t *aio, int fd, uint32_t max_backlog) {
+    if (!aio || !aio->streams || fd < 0) {
+        return NULL;
+    }
+
+    jtt1078_aio_stream_t *s = NULL;
+    for (int i = 0; i < aio->max_streams; i++) {
+        if (aio->streams[i].fd < 0) {
+            s = &aio->streams[i];
+            break;
+        }
+    }
+    if (!s) {
+        return NULL;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (aio->backend == JTT1078_AIO_EPOLL) {
+        // 只登记 ERR/HUP(ONESHOT), 写到 EAGAIN 时再等待 EPOLLOUT
+        struct epoll_event ev = { .events = EPOLLONESHOT, .data.ptr = s };
+        if (epoll_ctl(aio->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            return NULL;
+        }
+    }
+
+    s->fd = fd;
+    s->busy = false;
+    s->pend.len = s->pend.off = 0;
+    s->out.len = s->out.off = 0;
+    s->max_backlog = max_backlog ? max_backlog : JTT1078_AIO_DEFAULT_BACKLOG;
+    memset(&s->stats, 0, sizeof(s->stats));
+    return s;
+}
+
+void jtt1078_aio_remove(jtt1078_aio_stream_t *stream) {
+    if (!stream || stream->fd < 0) {
+        return;
+    }
+    jtt1078_aio_t *aio = stream->aio;
+
+#ifdef AIO_HAVE_URING
+    if (aio->backend == JTT1078_AIO_URING && stream->busy) {
+        stream->fd = -1;    // 完成时不再处理
+        uring_cancel(aio, stream);
+    }
+#endif
+    if (aio->backend == JTT1078_AIO_EPOLL) {
+        epoll_unbusy(aio, stream);
+        epoll_ctl(aio->epfd, EPOLL_CTL_DEL, stream->fd, NULL);
+    }
+
+    stream->fd = -1;
+    stream->pend.len = 0;
+    stream->out.len = stream->out.off = 0;
+    update_backlog(stream);
+}
+
+int jtt1078_aio_sendv(const struct iovec *iov, int iovcnt, void *user_data) {
+    jtt1078_aio_stream_t *s = (jtt1078_aio_stream_t *)user_data;
+    if (!s || s->fd < 0 || s->stats.failed) {
+        if (s) {
+            JTT1078_STAT_ADD(s->stats.frames_rejected, 1);
+        }
+        return -1;
+    }
+
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].iov_len;
+    }
+    uint32_t backlog = s->pend.len + (s->out.len - s->out.off);
+    if (backlog + len > s->max_backlog) {
+        JTT1078_STAT_ADD(s->stats.frames_rejected, 1);
+        return -1;
+    }
+
+    if (s->pend.len + len > s->pend.capacity) {
+        uint32_t cap = s->pend.capacity ? s->pend.capacity : AIO_MIN_BUFFER;
+        while (cap < s->pend.len + len) {
+            cap *= 2;
+        }
+        uint8_t *buf = realloc(s->pend.data, cap);
+        if (!buf) {
+            JTT1078_STAT_ADD(s->stats.frames_rejected, 1);
+            return -1;
+        }
+        s->pend.data = buf;
+        s->pend.capacity = cap;
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(s->pend.data + s->pend.len, iov[i].iov_base, iov[i].iov_len);
+        s->pend.len += (uint32_t)iov[i].iov_len;
+    }
+
+    JTT1078_STAT_ADD(s->stats.frames, 1);
+    JTT1078_STAT_ADD(s->stats.bytes_queued, len);
+    JTT1078_STAT_MAX(s->stats.max_backlog, backlog + (uint32_t)len);
+    update_backlog(s);
+    return 0;
+}
+
+int jtt1078_aio_run(jtt1078_aio_t *aio, int timeout_ms) {
+    if (!aio || !aio->streams) {
+        return -1;
+    }
+    JTT1078_STAT_ADD(aio->stats.rounds, 1);
+
+    int ret;
+#ifdef AIO_HAVE_URING
+    if (aio->backend == JTT1078_AIO_URING) {
+        ret = uring_run(aio, timeout_ms);
+    } else
+#endif
+    {
+        ret = epoll_run(aio, timeout_ms);
+    }
+    if (ret < 0) {
+        return -1;
+    }
+
+    int pending = 0;
+    for (int i = 0; i < aio->max_streams; i++) {
+        jtt1078_aio_stream_t *s = &aio->streams[i];
+        if (s->fd >= 0 && !s->stats.failed && stream_has_data(s)) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+int jtt1078_aio_flush(jtt1078_aio_t *aio, int timeout_ms) {
+    uint64_t deadline = monotonic_us() + (uint64_t)timeout_ms * 1000;
+    for (;;) {
+        uint64_t now = monotonic_us();
+        int wait = now < deadline ? (int)((deadline - now + 999) / 1000) : 0;
+        int pending = jtt1078_aio_run(aio, wait);
+        if (pending <= 0) {
+            return pending;
+        }
+        if (now >= deadline) {
+            return -1;
+        }
+    }
+}
+
+void jtt1078_aio_get_stats(const jtt1078_aio_t *aio, jtt1078_aio_stats_t *out) {
+    out->syscalls = JTT1078_STAT_LOAD(aio->stats.syscalls);
+    out->rounds = JTT1078_STAT_LOAD(aio->stats.rounds);
+    out->submitted = JTT1078_STAT_LOAD(aio->stats.submitted);
+    out->completions = JTT1078_STAT_LOAD(aio->stats.completions);
+    out->max_batch = JTT1078_STAT_LOAD(aio->stats.max_batch);
+    out->timeouts = JTT1078_STAT_LOAD(aio->stats.timeouts);
+}
+
+void jtt1078_aio_get_stream_stats(const jtt1078_aio_stream_t *stream,
+                                  jtt1078_aio_stream_stats_t *out) {
+    out->frames = JTT1078_STAT_LOAD(stream->stats.frames);
+    out->frames_rejected = JTT1078_STAT_LOAD(stream->stats.frames_rejected);
+    out->bytes_queued = JTT1078_STAT_LOAD(stream->stats.bytes_queued);
+    out->bytes_sent = JTT1078_STAT_LOAD(stream->stats.bytes_sent);
+    out->sends = JTT1078_STAT_LOAD(stream->stats.sends);
+    out->partial = JTT1078_STAT_LOAD(stream->stats.partial);
+    out->backlog = JTT1078_STAT_LOAD(stream->stats.backlog);
+    out->max_backlog = JTT1078_STAT_LOAD(stream->stats.max_backlog);
+    out->failed = JTT1078_STAT_LOAD(stream->stats.failed);
+    out->error = JTT1078_STAT_LOAD(stream->stats.error);
+}
+
+const char *jtt1078_aio_backend_name(const jtt1078_aio_t *aio) {
+    return aio->backend == JTT1078_AIO_URING ? "io_uring" : "epoll";
+}
+
+void jtt1078_aio_deinit(jtt1078_aio_t *aio) {
+    if (!aio || !aio->streams) {
+        return;
+    }
+
+    for (int i = 0; i < aio->max_streams; i++) {
+        jtt1078_aio_remove(&aio->streams[i]);
+        free(aio->streams[i].pend.data);
+        free(aio->streams[i].out.data);
+    }
+#ifdef AIO_HAVE_URING
+    if (aio->ring) {
+        uring_close(aio->ring);
+    }
+#endif
+    if (aio->epfd >= 0) {
+        close(aio->epfd);
+    }
+    free(aio->streams);
+    aio->streams = NULL;
+    aio->ring = NULL;
+    aio->epfd = -1;
+}
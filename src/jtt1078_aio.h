@@ -0,0 +1,163 @@
+/*
+ * JT/T 1078 Asynchronous Transmit Loop
+ * 一个事件循环为多路编码器(多通道 × 多平台)发送, 编码器回调不再阻塞
+ *
+ * 每路流(一个已连接的TCP socket)有两个缓冲区: 编码器的 iovec 回调把整帧
+ * 追加到待发送区后立即返回; jtt1078_aio_run 把空闲流的待发送区换成发送区
+ * 并异步写出。两种后端:
+ *   - io_uring(Linux 5.7+, 需 IORING_FEAT_FAST_POLL): 一次 io_uring_enter
+ *     提交所有流的 IORING_OP_SEND 并批量收割完成; 每个发送带链接超时
+ *     (IORING_OP_LINK_TIMEOUT), 超时未完成即取消, 该流标记为失败
+ *   - epoll + send: 内核不支持 io_uring、被禁用(kernel.io_uring_disabled、
+ *     seccomp)或编译时没有 <linux/io_uring.h> 时使用; 写到 EAGAIN 后等待
+ *     EPOLLOUT, 阻塞超过超时同样标记失败
+ * 系统调用数: io_uring 每轮一次(提交与等待合并), epoll 每流每轮至少一次 send。
+ *
+ * 编码器须以 jtt1078_aio_sendv 为 iovec 回调、流为 user_data 初始化, 并启用
+ * 整帧批量发送(jtt1078_encoder_enable_batch), 使一次回调是一整帧: 待发送区
+ * 超过 max_backlog 时整帧拒绝(回调返回-1), 不会留下半帧。
+ *
+ * 循环、编码器回调都在同一线程中使用(不加锁), 因此编码器不能有其他线程的
+ * 生产者(如单独的音频线程): 编码器只保证回调之间互斥, 不与 jtt1078_aio_run
+ * 互斥。统计以原子操作更新, jtt1078_aio_get_stats 可在任意线程调用。
+ * 失败的流不再发送, 由调用方 jtt1078_aio_remove 后重连再添加。
+ */
+
+#ifndef JTT1078_AIO_H
+#define JTT1078_AIO_H
+
+#include "jtt1078_protocol.h"
+#include <sys/uio.h>
+
+#define JTT1078_AIO_MAX_STREAMS     256         // 单个循环的最大流数
+#define JTT1078_AIO_DEFAULT_BACKLOG (4 * 1024 * 1024)   // 默认每流待发送上限(字节)
+#define JTT1078_AIO_DEFAULT_TIMEOUT 2000        // 默认发送超时(毫秒)
+
+// 后端
+#define JTT1078_AIO_EPOLL           0
+#define JTT1078_AIO_URING           1
+
+// jtt1078_aio_init 的 flags
+#define JTT1078_AIO_FORCE_EPOLL     0x01        // 不尝试 io_uring
+
+// 流统计
+typedef struct {
+    uint64_t frames;            // 接受的回调(整帧)数
+    uint64_t frames_rejected;   // 待发送区已满或流已失败而拒绝的帧数
+    uint64_t bytes_queued;
+    uint64_t bytes_sent;
+    uint64_t sends;             // 提交的发送数(io_uring SQE / send 调用)
+    uint64_t partial;           // 部分写入后续传的次数
+    uint32_t backlog;           // 当前待发送字节数(两个缓冲区合计)
+    uint32_t max_backlog;
+    bool     failed;
+    int      error;             // 失败原因(errno, 超时为 ETIMEDOUT)
+} jtt1078_aio_stream_stats_t;
+
+// 循环统计
+typedef struct {
+    uint64_t syscalls;          // io_uring_enter / epoll_wait / send 调用数
+    uint64_t rounds;            // jtt1078_aio_run 调用数
+    uint64_t submitted;         // 提交的 SQE 数(含链接超时)
+    uint64_t completions;       // 收割的 CQE 数
+    uint32_t max_batch;         // 单次收割的最大 CQE 数
+    uint64_t timeouts;          // 超时而失败的发送数
+} jtt1078_aio_stats_t;
+
+// 发送缓冲区
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t off;               // 已写出位置(发送区)
+    uint32_t capacity;
+} jtt1078_aio_buf_t;
+
+struct jtt1078_aio;
+
+// 流
+typedef struct {
+    struct jtt1078_aio *aio;
+    int      fd;                // <0 未使用
+    int      index;
+    jtt1078_aio_buf_t pend;     // 编码器追加
+    jtt1078_aio_buf_t out;      // 正在写出
+    bool     busy;              // io_uring: 发送已提交未完成; epoll: 等待 EPOLLOUT
+    uint64_t busy_since_us;     // epoll: 开始等待可写的时刻
+    uint32_t max_backlog;
+    jtt1078_aio_stream_stats_t stats;
+} jtt1078_aio_stream_t;
+
+struct jtt1078_aio_uring;
+
+// 循环
+typedef struct jtt1078_aio {
+    int      backend;           // JTT1078_AIO_*
+    int      timeout_ms;        // 单次发送的超时
+    jtt1078_aio_stream_t *streams;
+    int      max_streams;
+    int      inflight;          // io_uring: 未完成的发送数; epoll: 等待可写的流数
+
+    int      epfd;
+    struct jtt1078_aio_uring *ring;     // io_uring 映射(后端为 io_uring 时)
+
+    jtt1078_aio_stats_t stats;
+} jtt1078_aio_t;
+
+/**
+ * 初始化循环, 优先使用 io_uring, 不可用时退回 epoll
+ * @param max_streams 最大流数(不超过 JTT1078_AIO_MAX_STREAMS)
+ * @param timeout_ms 发送超时, 0使用 JTT1078_AIO_DEFAULT_TIMEOUT
+ * @param flags JTT1078_AIO_FORCE_EPOLL 等
+ * @return 0成功, -1失败
+ */
+int jtt1078_aio_init(jtt1078_aio_t *aio, int max_streams, int timeout_ms, int flags);
+
+/**
+ * 添加已连接的TCP socket(设为非阻塞), 循环不负责关闭
+ * @param max_backlog 待发送上限(字节), 0使用 JTT1078_AIO_DEFAULT_BACKLOG
+ * @return 流(作为编码器回调的 user_data), NULL已满或参数错误
+ */
+jtt1078_aio_stream_t *jtt1078_aio_add(jtt1078_aio_t *aio, int fd, uint32_t max_backlog);
+
+/**
+ * 移除流, 丢弃未发出的数据; io_uring 下先取消并等待未完成的发送
+ */
+void jtt1078_aio_remove(jtt1078_aio_stream_t *stream);
+
+/**
+ * 编码器 iovec 回调: 把数据追加到流的待发送区(不发送)
+ * @param user_data jtt1078_aio_stream_t*
+ * @return 0成功, -1流已失败或待发送区已满
+ */
+int jtt1078_aio_sendv(const struct iovec *iov, int iovcnt, void *user_data);
+
+/**
+ * 运行一轮: 提交所有有数据的空闲流, 收割完成; 有未完成的发送时最长等待 timeout_ms
+ * @return 仍有待发送数据的流数, -1失败
+ */
+int jtt1078_aio_run(jtt1078_aio_t *aio, int timeout_ms);
+
+/**
+ * 运行直到全部数据发出(或流失败), 最长 timeout_ms
+ * @return 0全部发出, -1超时
+ */
+int jtt1078_aio_flush(jtt1078_aio_t *aio, int timeout_ms);
+
+/**
+ * 获取统计(线程安全)
+ */
+void jtt1078_aio_get_stats(const jtt1078_aio_t *aio, jtt1078_aio_stats_t *out);
+void jtt1078_aio_get_stream_stats(const jtt1078_aio_stream_t *stream,
+                                  jtt1078_aio_stream_stats_t *out);
+
+/**
+ * 后端名称("io_uring"/"epoll")
+ */
+const char *jtt1078_aio_backend_name(const jtt1078_aio_t *aio);
+
+/**
+ * 释放资源(取消未完成的发送, 不关闭各流的socket)
+ */
+void jtt1078_aio_deinit(jtt1078_aio_t *aio);
+
+#endif // JTT1078_AIO_H
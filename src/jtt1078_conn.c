@@ -0,0 +1,448 @@
+/*
+ * JT/T 1078 Reconnecting Transport
+ * 自动重连TCP传输实现
+ */
+
+#include "jtt1078_conn.h"
+#include "jtt1078_transport.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+void jtt1078_conn_default_config(jtt1078_conn_config_t *cfg) {
+    memset(cfg, 0, sizeof(jtt1078_conn_config_t));
+    cfg->connect_timeout_ms = 5000;
+    cfg->backoff_min_ms = 500;
+    cfg->backoff_max_ms = 30000;
+    cfg->stable_ms = 10000;
+    cfg->send_timeout_ms = 5000;
+    cfg->sndbuf = 256 * 1024;
+    cfg->keepalive_idle_s = 10;
+    cfg->keepalive_intvl_s = 5;
+    cfg->keepalive_cnt = 3;
+    cfg->user_timeout_ms = 15000;
+}
+
+int jtt1078_conn_init(jtt1078_conn_t *conn, const char *host, uint16_t port,
+                      const jtt1078_conn_config_t *cfg) {
+    if (!conn || !host || strlen(host) >= sizeof(conn->host) || port == 0) {
+        return -1;
+    }
+
+    memset(conn, 0, sizeof(jtt1078_conn_t));
+    strcpy(conn->host, host);
+    conn->port = port;
+    if (cfg) {
+        conn->cfg = *cfg;
+    } else {
+        jtt1078_conn_default_config(&conn->cfg);
+    }
+    if (conn->cfg.backoff_min_ms == 0) {
+        conn->cfg.backoff_min_ms = 1;
+    }
+    if (conn->cfg.backoff_max_ms < conn->cfg.backoff_min_ms) {
+        conn->cfg.backoff_max_ms = conn->cfg.backoff_min_ms;
+    }
+
+    conn->fd = -1;
+    conn->state = JTT1078_CONN_DISCONNECTED;
+    conn->backoff_ms = conn->cfg.backoff_min_ms;
+    conn->rng = (uint32_t)jtt1078_get_monotonic_ms() ^ ((uint32_t)getpid() << 16) ^ port;
+    if (conn->rng == 0) {
+        conn->rng = 1;
+    }
+    pthread_mutex_init(&conn->stats_mutex, NULL);
+    return 0;
+}
+
+// 关闭socket; 有未完成的零拷贝帧时复位连接, 内核丢弃仍引用帧缓冲区的数据
+static void close_socket(jtt1078_conn_t *conn) {
+    if (conn->fd >= 0) {
+        if (conn->zc && conn->zc->count > 0) {
+            struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+            setsockopt(conn->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        }
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    if (conn->zc) {
+        jtt1078_zc_detach(conn->zc);
+    }
+}
+
+void jtt1078_conn_deinit(jtt1078_conn_t *conn) {
+    if (!conn) {
+        return;
+    }
+
+    close_socket(conn);
+    if (conn->zc) {
+        jtt1078_zc_deinit(conn->zc);
+        free(conn->zc);
+        conn->zc = NULL;
+    }
+    conn->state = JTT1078_CONN_DISCONNECTED;
+    pthread_mutex_destroy(&conn->stats_mutex);
+}
+
+// 状态以 release 写入, 其他生产者线程在 jtt1078_conn_sendv 中 acquire 读取:
+// 看到 CONNECTED 时 fd 与零拷贝绑定已就绪, 看到断开时 socket 已关闭
+static void set_state(jtt1078_conn_t *conn, uint8_t state) {
+    pthread_mutex_lock(&conn->stats_mutex);
+    conn->stats.state = state;
+    pthread_mutex_unlock(&conn->stats_mutex);
+    __atomic_store_n(&conn->state, state, __ATOMIC_RELEASE);
+}
+
+static inline uint8_t get_state(const jtt1078_conn_t *conn) {
+    return __atomic_load_n(&conn->state, __ATOMIC_ACQUIRE);
+}
+
+// 下次重连时刻: 退避上限内随机取 [backoff/2, backoff], 退避上限翻倍
+static void schedule_retry(jtt1078_conn_t *conn, uint64_t now) {
+    uint32_t x = conn->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    conn->rng = x;
+
+    uint32_t half = conn->backoff_ms / 2;
+    conn->next_attempt_ms = now + half + x % (conn->backoff_ms - half + 1);
+
+    uint32_t next = conn->backoff_ms * 2;
+    conn->backoff_ms = next > conn->cfg.backoff_max_ms ? conn->cfg.backoff_max_ms : next;
+}
+
+// 关闭socket; was_connected 表示这是一次断线(开始计黑屏时间)
+static void drop(jtt1078_conn_t *conn, bool was_connected) {
+    uint64_t now = jtt1078_get_monotonic_ms();
+
+    close_socket(conn);
+
+    pthread_mutex_lock(&conn->stats_mutex);
+    if (was_connected) {
+        conn->stats.disconnects++;
+    } else {
+        conn->stats.connect_failures++;
+    }
+    pthread_mutex_unlock(&conn->stats_mutex);
+
+    if (was_connected && !conn->dark) {
+        conn->dark = true;
+        conn->down_since_ms = now;
+    }
+    // 连接已稳定一段时间才算恢复, 退避回到下限; 否则继续翻倍
+    if (was_connected && now - conn->connected_ms >= conn->cfg.stable_ms) {
+        conn->backoff_ms = conn->cfg.backoff_min_ms;
+    }
+    schedule_retry(conn, now);
+
+    // 最后置为断开: 发送线程据此重连时, 退避时刻等已经更新
+    set_state(conn, JTT1078_CONN_DISCONNECTED);
+}
+
+static void tune_socket(jtt1078_conn_t *conn, int fd) {
+    const jtt1078_conn_config_t *cfg = &conn->cfg;
+    int flag = 1;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    if (cfg->sndbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &cfg->sndbuf, sizeof(cfg->sndbuf));
+    }
+
+    if (cfg->keepalive_idle_s > 0) {
+        int idle = cfg->keepalive_idle_s;
+        int intvl = cfg->keepalive_intvl_s;
+        int cnt = cfg->keepalive_cnt;
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &flag, sizeof(flag));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt));
+    }
+
+#ifdef TCP_USER_TIMEOUT
+    if (cfg->user_timeout_ms > 0) {
+        unsigned int timeout = cfg->user_timeout_ms;
+        setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, sizeof(timeout));
+    }
+#endif
+}
+
+static int resolve(const char *host, uint16_t port, struct sockaddr_in *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr->sin_addr) == 1) {
+        return 0;
+    }
+
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) {
+        return -1;
+    }
+    addr->sin_addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static void established(jtt1078_conn_t *conn) {
+    uint32_t handshake = (uint32_t)(jtt1078_get_monotonic_ms() - conn->connect_start_ms);
+
+    conn->connected_ms = jtt1078_get_monotonic_ms();
+    if (conn->zc) {
+        jtt1078_zc_attach(conn->zc, conn->fd);
+    }
+    set_state(conn, JTT1078_CONN_CONNECTED);
+
+    pthread_mutex_lock(&conn->stats_mutex);
+    conn->stats.connects++;
+    conn->stats.last_connect_ms = handshake;
+    pthread_mutex_unlock(&conn->stats_mutex);
+
+    printf("[JTT1078] Connected to %s:%u (%u ms)\n", conn->host, conn->port, handshake);
+}
+
+// 发起非阻塞连接
+static void start_connect(jtt1078_conn_t *conn) {
+    struct sockaddr_in addr;
+
+    conn->connect_start_ms = jtt1078_get_monotonic_ms();
+    if (resolve(conn->host, conn->port, &addr) < 0) {
+        fprintf(stderr, "[JTT1078] Cannot resolve %s\n", conn->host);
+        drop(conn, false);
+        return;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[JTT1078] socket: %s\n", strerror(errno));
+        drop(conn, false);
+        return;
+    }
+    tune_socket(conn, fd);
+    conn->fd = fd;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        established(conn);
+    } else if (errno == EINPROGRESS) {
+        set_state(conn, JTT1078_CONN_CONNECTING);
+    } else {
+        fprintf(stderr, "[JTT1078] Connect to %s:%u failed: %s\n",
+                conn->host, conn->port, strerror(errno));
+        drop(conn, false);
+    }
+}
+
+int jtt1078_conn_poll(jtt1078_conn_t *conn, int timeout_ms) {
+    if (!conn) {
+        return -1;
+    }
+
+    uint64_t deadline = jtt1078_get_monotonic_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+
+    for (;;) {
+        uint64_t now = jtt1078_get_monotonic_ms();
+        int wait = now < deadline ? (int)(deadline - now) : 0;
+
+        uint8_t state = get_state(conn);
+        if (state == JTT1078_CONN_CONNECTED) {
+            return 1;
+        }
+
+        if (state == JTT1078_CONN_DISCONNECTED) {
+            if (now < conn->next_attempt_ms) {
+                // 退避中
+                if (wait == 0) {
+                    return 0;
+                }
+                uint64_t left = conn->next_attempt_ms - now;
+                poll(NULL, 0, left < (uint64_t)wait ? (int)left : wait);
+                continue;
+            }
+            start_connect(conn);
+            continue;
+        }
+
+        // 握手中: 等待可写或连接超时
+        uint64_t expire = conn->connect_start_ms + conn->cfg.connect_timeout_ms;
+        if (now >= expire) {
+            fprintf(stderr, "[JTT1078] Connect to %s:%u timed out\n", conn->host, conn->port);
+            drop(conn, false);
+            continue;
+        }
+        int left = (int)(expire - now);
+        struct pollfd pfd = { .fd = conn->fd, .events = POLLOUT };
+        int ret = poll(&pfd, 1, left < wait ? left : wait);
+        if (ret < 0) {
+            if (errno != EINTR) {
+                drop(conn, false);
+            }
+            continue;
+        }
+        if (ret == 0) {
+            if (left <= wait) {
+                continue;       // 连接超时, 下一轮处理
+            }
+            return 0;           // 握手未完成, 调用方等待时间已用完
+        }
+
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            fprintf(stderr, "[JTT1078] Connect to %s:%u failed: %s\n",
+                    conn->host, conn->port, strerror(err));
+            drop(conn, false);
+            continue;
+        }
+        established(conn);
+    }
+}
+
+int jtt1078_conn_sendv(const struct iovec *iov, int iovcnt, void *user_data) {
+    jtt1078_conn_t *conn = (jtt1078_conn_t *)user_data;
+
+    if (!conn || get_state(conn) != JTT1078_CONN_CONNECTED) {
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    ssize_t n = conn->zc ? jtt1078_zc_sendv(conn->zc, iov, iovcnt, conn->cfg.send_timeout_ms) :
+                           jtt1078_sock_sendv(conn->fd, iov, iovcnt, conn->cfg.send_timeout_ms);
+    if (n < 0) {
+        fprintf(stderr, "[JTT1078] Send failed: %s, reconnecting\n", strerror(errno));
+        drop(conn, true);
+        return -1;
+    }
+    conn->bytes_sent += (uint64_t)n;
+    pthread_mutex_lock(&conn->stats_mutex);
+    conn->stats.bytes_sent = conn->bytes_sent;
+    pthread_mutex_unlock(&conn->stats_mutex);
+    return 0;
+}
+
+static void count_skipped(jtt1078_conn_t *conn) {
+    pthread_mutex_lock(&conn->stats_mutex);
+    conn->stats.frames_skipped++;
+    pthread_mutex_unlock(&conn->stats_mutex);
+}
+
+// 关键帧已发出: 结束本次黑屏计时
+static void recovered(jtt1078_conn_t *conn) {
+    if (!conn->dark) {
+        return;
+    }
+    conn->dark = false;
+
+    uint32_t dark_ms = (uint32_t)(jtt1078_get_monotonic_ms() - conn->down_since_ms);
+    pthread_mutex_lock(&conn->stats_mutex);
+    conn->stats.recoveries++;
+    conn->stats.last_dark_ms = dark_ms;
+    if (dark_ms > conn->stats.max_dark_ms) {
+        conn->stats.max_dark_ms = dark_ms;
+    }
+    conn->stats.total_dark_ms += dark_ms;
+    pthread_mutex_unlock(&conn->stats_mutex);
+
+    printf("[JTT1078] Video restored after %u ms\n", dark_ms);
+}
+
+int jtt1078_conn_send_video(jtt1078_conn_t *conn, jtt1078_encoder_t *encoder,
+                            const video_frame_t *frame) {
+    if (!conn || !encoder || !frame) {
+        return -1;
+    }
+
+    if (get_state(conn) != JTT1078_CONN_CONNECTED) {
+        if (jtt1078_conn_poll(conn, 0) <= 0) {
+            jtt1078_encoder_skip_video_frame(encoder, frame);
+            count_skipped(conn);
+            return 0;
+        }
+        // 新连接: 节奏控制改用新socket(TCP时为内核pacing)
+        if (encoder->pacer) {
+            jtt1078_encoder_set_pacing_socket(encoder, conn->fd);
+        }
+        // 回放当前GOP, 无缓存时编码器丢弃P/B帧直到下一个关键帧
+        if (jtt1078_encoder_resync(encoder) < 0) {
+            count_skipped(conn);
+            return 0;
+        }
+        if (!encoder->resync) {
+            recovered(conn);
+        }
+    }
+
+    int ret = jtt1078_encode_video_frame(encoder, frame);
+    if (ret < 0) {
+        return -1;
+    }
+    if (ret == 0) {
+        // 等待关键帧
+        count_skipped(conn);
+        return 0;
+    }
+    if (!encoder->resync) {
+        recovered(conn);
+    }
+    return ret;
+}
+
+int jtt1078_conn_enable_zerocopy(jtt1078_conn_t *conn, uint32_t min_bytes,
+                                 void (*release)(void *user_data, void *buf), void *user_data) {
+    if (!conn || !release || conn->zc) {
+        return -1;
+    }
+
+    jtt1078_zc_t *zc = malloc(sizeof(jtt1078_zc_t));
+    if (!zc || jtt1078_zc_init(zc, min_bytes, release, user_data) < 0) {
+        free(zc);
+        return -1;
+    }
+    conn->zc = zc;
+    if (conn->state == JTT1078_CONN_CONNECTED) {
+        jtt1078_zc_attach(zc, conn->fd);
+    }
+    return 0;
+}
+
+int jtt1078_conn_send_video_zc(jtt1078_conn_t *conn, jtt1078_encoder_t *encoder,
+                               const video_frame_t *frame, void *buf) {
+    if (!conn || !conn->zc || !frame) {
+        return jtt1078_conn_send_video(conn, encoder, frame);
+    }
+
+    jtt1078_zc_begin(conn->zc, frame->data, frame->size, buf, conn->cfg.send_timeout_ms);
+    int ret = jtt1078_conn_send_video(conn, encoder, frame);
+    jtt1078_zc_end(conn->zc);
+    return ret;
+}
+
+int jtt1078_conn_reap(jtt1078_conn_t *conn, int timeout_ms) {
+    if (!conn || !conn->zc) {
+        return 0;
+    }
+    return jtt1078_zc_reap(conn->zc, timeout_ms);
+}
+
+void jtt1078_conn_close(jtt1078_conn_t *conn) {
+    if (!conn || conn->state == JTT1078_CONN_DISCONNECTED) {
+        return;
+    }
+    drop(conn, conn->state == JTT1078_CONN_CONNECTED);
+}
+
+void jtt1078_conn_get_stats(jtt1078_conn_t *conn, jtt1078_conn_stats_t *out) {
+    pthread_mutex_lock(&conn->stats_mutex);
+    *out = conn->stats;
+    pthread_mutex_unlock(&conn->stats_mutex);
+}
@@ -0,0 +1,166 @@
+/*
+ * JT/T 1078 Reconnecting Transport
+ * 自动重连的TCP传输: 车载链路频繁中断, 断线后按退避策略重连, 不退出推流
+ *
+ *   - 非阻塞 connect, 带超时
+ *   - 指数退避 + 随机抖动, 避免大量终端同时重连; 连接保持 stable_ms 以上
+ *     才回到退避下限, 接受后立即断开的平台不会被反复快速重连
+ *   - TCP keepalive / TCP_USER_TIMEOUT, 尽快发现半开连接
+ *   - 断线期间不发送任何帧; 重连后经 jtt1078_encoder_resync 回放GOP或
+ *     等待下一个关键帧, 保证平台收到的第一帧可解码
+ *   - 统计每次断线到关键帧重新发出的时间(黑屏时长)
+ *   - 可选 MSG_ZEROCOPY 发送(jtt1078_conn_enable_zerocopy), 大帧负载不拷入
+ *     socket缓冲区, 帧缓冲区在完成通知后经回调释放; 断线时复位连接并释放全部帧
+ *
+ * 连接、重连(jtt1078_conn_poll/send_video)只由视频发送线程推进; 音频等其他
+ * 生产者线程可经同一编码器以 jtt1078_conn_sendv 为回调发送(编码器保证回调
+ * 不并发), 发送失败时关闭连接, 由视频线程重连。零拷贝发送只用于单一生产者。
+ * jtt1078_conn_get_stats 可在任意线程调用。
+ */
+
+#ifndef JTT1078_CONN_H
+#define JTT1078_CONN_H
+
+#include "jtt1078_protocol.h"
+#include "jtt1078_zerocopy.h"
+#include <pthread.h>
+
+// 连接状态
+#define JTT1078_CONN_DISCONNECTED   0
+#define JTT1078_CONN_CONNECTING     1
+#define JTT1078_CONN_CONNECTED      2
+
+// 连接参数
+typedef struct {
+    uint32_t connect_timeout_ms;    // 非阻塞连接超时(默认5000)
+    uint32_t backoff_min_ms;        // 重连退避下限(默认500)
+    uint32_t backoff_max_ms;        // 重连退避上限(默认30000)
+    uint32_t stable_ms;             // 连接保持多久后断线才重置退避(默认10000)
+    int      send_timeout_ms;       // 单次发送等待可写的上限, 超时视为断线(默认5000)
+    int      sndbuf;                // SO_SNDBUF, 0表示系统默认(默认256KB)
+    uint16_t keepalive_idle_s;      // TCP保活: 空闲多久开始探测(默认10), 0不启用
+    uint16_t keepalive_intvl_s;     // 探测间隔(默认5)
+    uint16_t keepalive_cnt;         // 探测失败次数(默认3)
+    uint32_t user_timeout_ms;       // TCP_USER_TIMEOUT: 数据未被确认的最长时间(默认15000), 0不设置
+} jtt1078_conn_config_t;
+
+// 连接统计
+typedef struct {
+    uint8_t  state;                 // JTT1078_CONN_*
+    uint64_t connects;              // 建立连接次数
+    uint64_t connect_failures;      // 连接失败次数(拒绝/超时/解析失败)
+    uint64_t disconnects;           // 已建立连接的断开次数
+    uint64_t recoveries;            // 断线后恢复出图次数
+    uint64_t frames_skipped;        // 断线或等待关键帧期间跳过的帧数
+    uint64_t bytes_sent;            // 累计写入socket的字节数
+    uint32_t last_connect_ms;       // 最近一次握手耗时
+    uint32_t last_dark_ms;          // 最近一次断线到关键帧重新发出的时间
+    uint32_t max_dark_ms;           // 最长黑屏时间
+    uint64_t total_dark_ms;         // 累计黑屏时间
+} jtt1078_conn_stats_t;
+
+typedef struct {
+    char host[64];
+    uint16_t port;
+    jtt1078_conn_config_t cfg;
+
+    int fd;
+    uint8_t state;
+    uint64_t connect_start_ms;      // 本次连接发起时刻
+    uint64_t next_attempt_ms;       // 下次允许发起连接的时刻
+    uint32_t backoff_ms;            // 当前退避上限
+    uint64_t connected_ms;          // 本次连接建立时刻
+    uint32_t rng;                   // 抖动随机数状态
+
+    uint64_t bytes_sent;            // 累计写入socket的字节数(发送线程读取, 供码率控制采样)
+
+    bool dark;                      // 断线后尚未恢复出图
+    uint64_t down_since_ms;         // 断线时刻
+
+    jtt1078_zc_t *zc;               // 零拷贝发送, NULL为拷贝发送
+
+    pthread_mutex_t stats_mutex;
+    jtt1078_conn_stats_t stats;
+} jtt1078_conn_t;
+
+/**
+ * 填充默认连接参数
+ */
+void jtt1078_conn_default_config(jtt1078_conn_config_t *cfg);
+
+/**
+ * 初始化连接对象(不立即连接)
+ * @param host 服务器地址(IPv4地址或主机名, 每次重连重新解析)
+ * @param port 服务器端口
+ * @param cfg 连接参数, NULL使用默认值
+ * @return 0成功, -1失败
+ */
+int jtt1078_conn_init(jtt1078_conn_t *conn, const char *host, uint16_t port,
+                      const jtt1078_conn_config_t *cfg);
+
+/**
+ * 推进连接状态机: 退避到期后发起连接, 等待握手完成或超时
+ * @param timeout_ms 最长等待时间(毫秒), 0只做一次非阻塞检查
+ * @return 1已连接, 0未连接, -1参数错误
+ */
+int jtt1078_conn_poll(jtt1078_conn_t *conn, int timeout_ms);
+
+/**
+ * 编码器 iovec 发送回调(user_data 为 jtt1078_conn_t*)
+ * 未连接时直接失败; 发送失败或超时则关闭连接并开始退避重连
+ * @return 0成功, -1失败
+ */
+int jtt1078_conn_sendv(const struct iovec *iov, int iovcnt, void *user_data);
+
+/**
+ * 发送一帧视频, 断线期间跳过
+ * 新连接建立时调用 jtt1078_encoder_resync(回放GOP或等待关键帧),
+ * 关键帧发出后记录本次黑屏时长。
+ * @param encoder 以 jtt1078_conn_sendv 为回调、conn 为 user_data 初始化的编码器
+ * @return 发送的包数, 0帧被跳过(未连接/等待关键帧), -1发送失败(连接已关闭)
+ */
+int jtt1078_conn_send_video(jtt1078_conn_t *conn, jtt1078_encoder_t *encoder,
+                            const video_frame_t *frame);
+
+/**
+ * 启用 MSG_ZEROCOPY 发送(每个新连接设置 SO_ZEROCOPY, 内核不支持时仍拷贝发送)
+ * 只影响经 jtt1078_conn_send_video_zc 发送的帧
+ * @param min_bytes 帧长不小于该值时零拷贝, 0使用 JTT1078_ZC_DEFAULT_MIN
+ * @param release 帧缓冲区可以复用时回调(发送线程), buf 为 send_video_zc 传入的标识
+ * @return 0成功, -1失败
+ */
+int jtt1078_conn_enable_zerocopy(jtt1078_conn_t *conn, uint32_t min_bytes,
+                                 void (*release)(void *user_data, void *buf), void *user_data);
+
+/**
+ * 发送一帧视频, 负载零拷贝引用 frame->data
+ * frame->data 在 release(user_data, buf) 回调之前不可修改或释放; 小帧、跳过的帧
+ * 在返回前回调。未启用零拷贝时等同于 jtt1078_conn_send_video, 不回调。
+ * @return 同 jtt1078_conn_send_video
+ */
+int jtt1078_conn_send_video_zc(jtt1078_conn_t *conn, jtt1078_encoder_t *encoder,
+                               const video_frame_t *frame, void *buf);
+
+/**
+ * 收割零拷贝完成通知, 释放已完成的帧缓冲区(发送线程空闲时调用)
+ * @param timeout_ms 没有可释放的帧时最长等待(毫秒), 0不等待
+ * @return 释放的帧数
+ */
+int jtt1078_conn_reap(jtt1078_conn_t *conn, int timeout_ms);
+
+/**
+ * 主动断开(如平台下发停止指令), 之后按退避策略重连
+ */
+void jtt1078_conn_close(jtt1078_conn_t *conn);
+
+/**
+ * 获取连接统计(线程安全)
+ */
+void jtt1078_conn_get_stats(jtt1078_conn_t *conn, jtt1078_conn_stats_t *out);
+
+/**
+ * 关闭连接并释放资源
+ */
+void jtt1078_conn_deinit(jtt1078_conn_t *conn);
+
+#endif // JTT1078_CONN_H
@@ -0,0 +1,337 @@
+/*
+ * JT/T 1078 Depacketizer
+ * 接收端增量解析与分包重组实现
+ */
+
+#include "jtt1078_depack.h"
+#include "jtt1078_fec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t header_flag[4] = { 0x30, 0x31, 0x63, 0x64 };  // "01cd"
+
+int jtt1078_depack_init(jtt1078_depack_t *d,
+                        uint32_t max_frame_size,
+                        void (*on_frame)(const jtt1078_frame_t *frame, void *user_data),
+                        void *user_data) {
+    if (!d || !on_frame) {
+        return -1;
+    }
+
+    memset(d, 0, sizeof(jtt1078_depack_t));
+    d->max_frame_size = max_frame_size ? max_frame_size : JTT1078_DEPACK_MAX_FRAME;
+    d->on_frame = on_frame;
+    d->user_data = user_data;
+    return 0;
+}
+
+void jtt1078_depack_reset(jtt1078_depack_t *d) {
+    if (!d) {
+        return;
+    }
+
+    d->hdr_len = 0;
+    d->payload_left = 0;
+    d->target = NULL;
+    d->cur_channel = NULL;
+    d->lost_sync = false;
+    for (int i = 0; i < d->nchannels; i++) {
+        d->channels[i].have_seq = false;
+        for (int s = 0; s < JTT1078_DEPACK_STREAMS; s++) {
+            d->channels[i].streams[s].active = false;
+        }
+    }
+}
+
+void jtt1078_depack_deinit(jtt1078_depack_t *d) {
+    if (!d) {
+        return;
+    }
+
+    for (int i = 0; i < d->nchannels; i++) {
+        for (int s = 0; s < JTT1078_DEPACK_STREAMS; s++) {
+            free(d->channels[i].streams[s].data);
+            d->channels[i].streams[s].data = NULL;
+            d->channels[i].streams[s].capacity = 0;
+        }
+    }
+    d->nchannels = 0;
+}
+
+// 丢弃包头缓冲区前 n 个字节
+static void skip_hdr(jtt1078_depack_t *d, uint32_t n) {
+    memmove(d->hdr, d->hdr + n, d->hdr_len - n);
+    d->hdr_len -= n;
+    d->stats.bytes_skipped += n;
+}
+
+// 保证包头缓冲区以固定头标识(或其前缀)开始
+static void header_sync(jtt1078_depack_t *d) {
+    uint32_t k = 0;
+
+    for (;;) {
+        uint32_t n = d->hdr_len - k;
+        if (n > sizeof(header_flag)) {
+            n = sizeof(header_flag);
+        }
+        if (memcmp(d->hdr + k, header_flag, n) == 0) {
+            break;
+        }
+        k++;
+    }
+
+    if (k > 0) {
+        // 连续跳过的字节只计一次重新同步
+        if (!d->lost_sync) {
+            d->lost_sync = true;
+            d->stats.resyncs++;
+        }
+        skip_hdr(d, k);
+    }
+}
+
+static jtt1078_depack_channel_t *find_channel(jtt1078_depack_t *d, uint8_t channel) {
+    for (int i = 0; i < d->nchannels; i++) {
+        if (d->channels[i].stats.channel == channel) {
+            return &d->channels[i];
+        }
+    }
+    if (d->nchannels >= JTT1078_DEPACK_MAX_CHANNELS) {
+        return NULL;
+    }
+
+    jtt1078_depack_channel_t *ch = &d->channels[d->nchannels++];
+    memset(ch, 0, sizeof(jtt1078_depack_channel_t));
+    ch->stats.channel = channel;
+    return ch;
+}
+
+static inline int stream_index(uint8_t data_type) {
+    if (data_type <= JTT1078_DATA_TYPE_VIDEO_B) {
+        return JTT1078_DEPACK_STREAM_VIDEO;
+    } else if (data_type == JTT1078_DATA_TYPE_AUDIO) {
+        return JTT1078_DEPACK_STREAM_AUDIO;
+    }
+    return JTT1078_DEPACK_STREAM_TRANS;
+}
+
+// 丢弃通道内所有正在重组的帧
+static void abort_streams(jtt1078_depack_channel_t *ch) {
+    for (int s = 0; s < JTT1078_DEPACK_STREAMS; s++) {
+        if (ch->streams[s].active) {
+            ch->streams[s].active = false;
+            ch->stats.frames_dropped++;
+        }
+    }
+}
+
+// 保证重组缓冲区可再容纳 len 字节
+static int asm_reserve(jtt1078_depack_t *d, jtt1078_depack_asm_t *a, uint32_t len) {
+    uint32_t need = a->size + len;
+    if (need <= a->capacity) {
+        return 0;
+    }
+    if (need > d->max_frame_size) {
+        return -1;
+    }
+
+    uint32_t cap = a->capacity ? a->capacity * 2 : 64 * 1024;
+    if (cap < need) cap = need;
+    if (cap > d->max_frame_size) cap = d->max_frame_size;
+
+    uint8_t *buf = realloc(a->data, cap);
+    if (!buf) {
+        fprintf(stderr, "[JTT1078] Depack: out of memory (%u bytes)\n", cap);
+        return -1;
+    }
+    a->data = buf;
+    a->capacity = cap;
+    return 0;
+}
+
+// 包头收齐: 校验字段, 确定负载去向
+// 返回0继续接收负载, -1包头非法(已跳过1字节, 重新同步)
+static int begin_packet(jtt1078_depack_t *d) {
+    jtt1078_header_t *h = &d->cur;
+
+    if (jtt1078_parse_header(d->hdr, d->hdr_len, h) < 0 || h->v != 2 ||
+        h->data_type > JTT1078_DATA_TYPE_TRANS || h->subpackage > JTT1078_PKT_MIDDLE) {
+        d->stats.bad_headers++;
+        if (!d->lost_sync) {
+            d->lost_sync = true;
+            d->stats.resyncs++;
+        }
+        skip_hdr(d, 1);
+        header_sync(d);
+        return -1;
+    }
+
+    d->lost_sync = false;
+    d->stats.packets++;
+    d->payload_left = h->data_length;
+    d->target = NULL;
+    d->cur_channel = NULL;
+
+    // 校验包不占用包序号, 字节流中直接跳过(恢复见 jtt1078_fec_decoder)
+    if (h->pt == JTT1078_FEC_PT) {
+        d->stats.fec_packets++;
+        return 0;
+    }
+
+    jtt1078_depack_channel_t *ch = find_channel(d, h->channel);
+    d->cur_channel = ch;
+    if (!ch) {
+        d->stats.untracked_packets++;
+        return 0;
+    }
+
+    ch->stats.packets++;
+    ch->stats.payload_bytes += h->data_length;
+
+    // 包序号连续性(每个通道一个序号空间, 视频/音频/透传共用)
+    if (ch->have_seq && h->packet_seq != ch->next_seq) {
+        ch->stats.seq_gaps++;
+        ch->stats.packets_lost += (uint16_t)(h->packet_seq - ch->next_seq);
+        abort_streams(ch);
+    }
+    ch->next_seq = (uint16_t)(h->packet_seq + 1);
+    ch->have_seq = true;
+
+    jtt1078_depack_asm_t *a = &ch->streams[stream_index(h->data_type)];
+
+    if (h->subpackage == JTT1078_PKT_ATOMIC || h->subpackage == JTT1078_PKT_FIRST) {
+        if (a->active) {
+            // 上一帧缺少尾包
+            ch->stats.frames_dropped++;
+        }
+        a->active = true;
+        a->size = 0;
+        a->packets = 0;
+        a->first = *h;
+    } else if (!a->active) {
+        // 首包丢失, 丢弃到下一个首包
+        ch->stats.packets_discarded++;
+        return 0;
+    }
+
+    if (asm_reserve(d, a, h->data_length) < 0) {
+        d->stats.oversize_frames++;
+        ch->stats.frames_dropped++;
+        a->active = false;
+        return 0;
+    }
+
+    a->packets++;
+    d->target = a;
+    return 0;
+}
+
+// 包负载收齐, 返回交付的帧数
+static int end_packet(jtt1078_depack_t *d) {
+    jtt1078_depack_asm_t *a = d->target;
+    uint8_t sub = d->cur.subpackage;
+
+    d->hdr_len = 0;
+    d->target = NULL;
+
+    if (!a || (sub != JTT1078_PKT_ATOMIC && sub != JTT1078_PKT_LAST)) {
+        return 0;
+    }
+
+    jtt1078_depack_channel_t *ch = d->cur_channel;
+    jtt1078_frame_t frame = {
+        .header = a->first,
+        .data = a->data,
+        .size = a->size,
+        .packets = a->packets,
+    };
+    a->active = false;
+
+    ch->stats.frames++;
+    if (a->first.data_type == JTT1078_DATA_TYPE_VIDEO) {
+        ch->stats.keyframes++;
+    } else if (a->first.data_type == JTT1078_DATA_TYPE_AUDIO) {
+        ch->stats.audio_frames++;
+    }
+    if (frame.size > ch->stats.max_frame_size) {
+        ch->stats.max_frame_size = frame.size;
+    }
+    ch->stats.last_timestamp = a->first.timestamp;
+    d->stats.frames++;
+
+    d->on_frame(&frame, d->user_data);
+    return 1;
+}
+
+int jtt1078_depack_feed(jtt1078_depack_t *d, const uint8_t *data, size_t len) {
+    if (!d || (!data && len > 0)) {
+        return -1;
+    }
+
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    int frames = 0;
+
+    d->stats.bytes += len;
+
+    while (p < end) {
+        if (d->hdr_len < JTT1078_HEADER_SIZE) {
+            // 包头: 先收进包头缓冲区(最多30字节)
+            size_t n = JTT1078_HEADER_SIZE - d->hdr_len;
+            if (n > (size_t)(end - p)) {
+                n = end - p;
+            }
+            memcpy(d->hdr + d->hdr_len, p, n);
+            p += n;
+
+            bool check_flag = d->hdr_len < sizeof(header_flag);
+            d->hdr_len += n;
+            if (check_flag) {
+                header_sync(d);
+            }
+            if (d->hdr_len < JTT1078_HEADER_SIZE) {
+                continue;
+            }
+            if (begin_packet(d) < 0) {
+                continue;
+            }
+            if (d->payload_left == 0) {
+                frames += end_packet(d);
+            }
+            continue;
+        }
+
+        // 负载: 直接拷入重组缓冲区
+        size_t n = d->payload_left;
+        if (n > (size_t)(end - p)) {
+            n = end - p;
+        }
+        if (d->target) {
+            memcpy(d->target->data + d->target->size, p, n);
+            d->target->size += n;
+        }
+        p += n;
+        d->payload_left -= n;
+
+        if (d->payload_left == 0) {
+            frames += end_packet(d);
+        }
+    }
+
+    return frames;
+}
+
+void jtt1078_depack_get_stats(const jtt1078_depack_t *d, jtt1078_depack_stats_t *out) {
+    *out = d->stats;
+}
+
+int jtt1078_depack_get_channel_stats(const jtt1078_depack_t *d, int index,
+                                     jtt1078_depack_channel_stats_t *out) {
+    if (!d || !out || index < 0 || index >= d->nchannels) {
+        return -1;
+    }
+
+    *out = d->channels[index].stats;
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * JT/T 1078 Depacketizer
+ * 接收端: 增量解析字节流, 按通道重组分包为完整帧
+ *
+ * 输入可以是任意切分的字节流(每次 recv 的结果直接喂入), 解析器只保存
+ * 未完成的包头(最多30字节), 负载直接拷入所属通道的帧缓冲区(一次拷贝)。
+ * 帧缓冲区按通道/媒体类型复用, 只在帧变大时扩容, 稳态下无逐包分配。
+ *
+ * 校验与容错:
+ *   - 固定头标识 0x30316364 不匹配时逐字节搜索下一个标识(重新同步)
+ *   - 包序号按通道连续检查, 出现间隔时丢弃正在重组的帧
+ *   - 缺少首包的中间包/尾包被丢弃, 直到下一个首包或原子包
+ *   - FEC校验包(负载类型 JTT1078_FEC_PT)不计入包序号, 直接跳过
+ */
+
+#ifndef JTT1078_DEPACK_H
+#define JTT1078_DEPACK_H
+
+#include "jtt1078_protocol.h"
+
+#define JTT1078_DEPACK_MAX_CHANNELS     16          // 单连接最多跟踪的通道数
+#define JTT1078_DEPACK_MAX_FRAME        (4 * 1024 * 1024)   // 默认最大帧长
+
+// 重组完成的帧
+typedef struct {
+    jtt1078_header_t header;    // 首包包头(时间戳/间隔/数据类型等)
+    const uint8_t *data;        // 帧数据, 仅在回调期间有效
+    uint32_t size;
+    uint16_t packets;           // 分包数
+} jtt1078_frame_t;
+
+// 通道统计
+typedef struct {
+    uint8_t  channel;           // 逻辑通道号
+    uint64_t packets;           // 收到的包数
+    uint64_t payload_bytes;     // 收到的负载字节数
+    uint64_t frames;            // 交付的完整帧数
+    uint64_t keyframes;         // 其中I帧数
+    uint64_t audio_frames;      // 其中音频帧数
+    uint64_t frames_dropped;    // 因丢包/超长丢弃的帧数
+    uint64_t packets_discarded; // 无法归属到帧而丢弃的包数
+    uint64_t seq_gaps;          // 包序号不连续次数
+    uint64_t packets_lost;      // 按序号间隔估算的丢包数
+    uint32_t max_frame_size;    // 最大帧长
+    uint64_t last_timestamp;    // 最近一帧时间戳
+} jtt1078_depack_channel_stats_t;
+
+// 连接级统计
+typedef struct {
+    uint64_t bytes;             // 输入字节数
+    uint64_t packets;           // 解析出的包数
+    uint64_t frames;            // 交付的帧数
+    uint64_t bytes_skipped;     // 重新同步时跳过的字节数
+    uint64_t resyncs;           // 重新同步次数
+    uint64_t bad_headers;       // 标识正确但字段非法的包头数
+    uint64_t oversize_frames;   // 超过最大帧长而丢弃的帧数
+    uint64_t untracked_packets; // 超出通道表容量而丢弃的包数
+    uint64_t fec_packets;       // 跳过的FEC校验包数
+} jtt1078_depack_stats_t;
+
+// 单个媒体流的重组状态
+typedef struct {
+    uint8_t *data;              // 帧缓冲区(复用)
+    uint32_t size;              // 已重组字节数
+    uint32_t capacity;
+    bool     active;            // 正在重组(已收到首包)
+    jtt1078_header_t first;     // 首包包头
+    uint16_t packets;
+} jtt1078_depack_asm_t;
+
+#define JTT1078_DEPACK_STREAM_VIDEO     0
+#define JTT1078_DEPACK_STREAM_AUDIO     1
+#define JTT1078_DEPACK_STREAM_TRANS     2
+#define JTT1078_DEPACK_STREAMS          3
+
+typedef struct {
+    bool     have_seq;
+    uint16_t next_seq;          // 期望的下一个包序号
+    jtt1078_depack_asm_t streams[JTT1078_DEPACK_STREAMS];   // 视频/音频/透传分别重组
+    jtt1078_depack_channel_stats_t stats;
+} jtt1078_depack_channel_t;
+
+// 解析器
+typedef struct {
+    // 包头解析状态
+    uint8_t  hdr[JTT1078_HEADER_SIZE];
+    uint32_t hdr_len;           // 已收到的包头字节数
+    jtt1078_header_t cur;       // 当前包包头(hdr_len 满后有效)
+    uint32_t payload_left;      // 当前包剩余负载字节数
+    jtt1078_depack_asm_t *target;   // 当前包负载写入的重组缓冲区, NULL表示丢弃
+    jtt1078_depack_channel_t *cur_channel;
+    bool     lost_sync;         // 正在搜索固定头标识
+
+    jtt1078_depack_channel_t channels[JTT1078_DEPACK_MAX_CHANNELS];
+    int nchannels;
+
+    uint32_t max_frame_size;
+
+    void (*on_frame)(const jtt1078_frame_t *frame, void *user_data);
+    void *user_data;
+
+    jtt1078_depack_stats_t stats;
+} jtt1078_depack_t;
+
+/**
+ * 初始化解析器
+ * @param max_frame_size 最大帧长, 0表示使用 JTT1078_DEPACK_MAX_FRAME
+ * @param on_frame 完整帧回调(在 jtt1078_depack_feed 内调用)
+ * @param user_data 回调用户数据
+ * @return 0成功, -1失败
+ */
+int jtt1078_depack_init(jtt1078_depack_t *d,
+                        uint32_t max_frame_size,
+                        void (*on_frame)(const jtt1078_frame_t *frame, void *user_data),
+                        void *user_data);
+
+/**
+ * 输入一段字节流
+ * @param data 数据(可在任意位置切分)
+ * @param len 数据长度
+ * @return 本次交付的完整帧数, -1参数错误
+ */
+int jtt1078_depack_feed(jtt1078_depack_t *d, const uint8_t *data, size_t len);
+
+/**
+ * 清除解析和重组状态(新连接), 保留缓冲区和统计
+ */
+void jtt1078_depack_reset(jtt1078_depack_t *d);
+
+/**
+ * 获取连接级统计
+ */
+void jtt1078_depack_get_stats(const jtt1078_depack_t *d, jtt1078_depack_stats_t *out);
+
+/**
+ * 获取通道统计
+ * @param index 通道索引(按首次出现顺序, 0 ~ d->nchannels-1)
+ * @return 0成功, -1索引无效
+ */
+int jtt1078_depack_get_channel_stats(const jtt1078_depack_t *d, int index,
+                                     jtt1078_depack_channel_stats_t *out);
+
+/**
+ * 释放解析器资源
+ */
+void jtt1078_depack_deinit(jtt1078_depack_t *d);
+
+#endif // JTT1078_DEPACK_H
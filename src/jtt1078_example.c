@@ -4,130 +4,15 @@
  */
 
 #include "jtt1078_protocol.h"
+#include "jtt1078_conn.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <pthread.h>
-#include <errno.h>
 
-// TCP连接上下文
-typedef struct {
-    int sockfd;
-    struct sockaddr_in server_addr;
-    bool connected;
-    pthread_mutex_t send_mutex;
-} tcp_context_t;
-
-// 全局TCP上下文
-static tcp_context_t g_tcp_ctx = {
-    .sockfd = -1,
-    .connected = false,
-};
-
-/**
- * TCP发送回调函数
- * JT/T 1078协议通过此函数发送RTP/TCP数据包
- */
-int jtt1078_tcp_send_callback(const uint8_t *data, size_t len, void *user_data) {
-    tcp_context_t *ctx = (tcp_context_t *)user_data;
-    
-    if (!ctx || ctx->sockfd < 0 || !ctx->connected) {
-        fprintf(stderr, "[TCP] Not connected\n");
-        return -1;
-    }
-    
-    pthread_mutex_lock(&ctx->send_mutex);
-    
-    ssize_t sent = send(ctx->sockfd, data, len, 0);
-    
-    pthread_mutex_unlock(&ctx->send_mutex);
-    
-    if (sent < 0) {
-        fprintf(stderr, "[TCP] Send failed: %s\n", strerror(errno));
-        return -1;
-    }
-    
-    if ((size_t)sent != len) {
-        fprintf(stderr, "[TCP] Partial send: %zd/%zu bytes\n", sent, len);
-        return -1;
-    }
-    
-    return 0;
-}
-
-/**
- * 连接到JT/T 1078服务器
- */
-int jtt1078_tcp_connect(const char *server_ip, uint16_t port) {
-    if (g_tcp_ctx.connected) {
-        printf("[TCP] Already connected\n");
-        return 0;
-    }
-    
-    // 创建socket
-    g_tcp_ctx.sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (g_tcp_ctx.sockfd < 0) {
-        fprintf(stderr, "[TCP] Failed to create socket: %s\n", strerror(errno));
-        return -1;
-    }
-    
-    // 设置socket选项
-    int opt = 1;
-    setsockopt(g_tcp_ctx.sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
-    // 设置发送缓冲区
-    int sendbuf = 256 * 1024; // 256KB
-    setsockopt(g_tcp_ctx.sockfd, SOL_SOCKET, SO_SNDBUF, &sendbuf, sizeof(sendbuf));
-    
-    // 配置服务器地址
-    memset(&g_tcp_ctx.server_addr, 0, sizeof(g_tcp_ctx.server_addr));
-    g_tcp_ctx.server_addr.sin_family = AF_INET;
-    g_tcp_ctx.server_addr.sin_port = htons(port);
-    
-    if (inet_pton(AF_INET, server_ip, &g_tcp_ctx.server_addr.sin_addr) <= 0) {
-        fprintf(stderr, "[TCP] Invalid server IP: %s\n", server_ip);
-        close(g_tcp_ctx.sockfd);
-        g_tcp_ctx.sockfd = -1;
-        return -1;
-    }
-    
-    // 连接服务器
-    printf("[TCP] Connecting to %s:%d...\n", server_ip, port);
-    
-    if (connect(g_tcp_ctx.sockfd, 
-                (struct sockaddr *)&g_tcp_ctx.server_addr, 
-                sizeof(g_tcp_ctx.server_addr)) < 0) {
-        fprintf(stderr, "[TCP] Connection failed: %s\n", strerror(errno));
-        close(g_tcp_ctx.sockfd);
-        g_tcp_ctx.sockfd = -1;
-        return -1;
-    }
-    
-    pthread_mutex_init(&g_tcp_ctx.send_mutex, NULL);
-    g_tcp_ctx.connected = true;
-    
-    printf("[TCP] Connected to %s:%d\n", server_ip, port);
-    return 0;
-}
-
-/**
- * 断开TCP连接
- */
-void jtt1078_tcp_disconnect(void) {
-    if (g_tcp_ctx.sockfd >= 0) {
-        close(g_tcp_ctx.sockfd);
-        g_tcp_ctx.sockfd = -1;
-    }
-    
-    g_tcp_ctx.connected = false;
-    pthread_mutex_destroy(&g_tcp_ctx.send_mutex);
-    
-    printf("[TCP] Disconnected\n");
-}
+// 自动重连的TCP连接
+static jtt1078_conn_t g_conn;
 
 /**
  * 示例：从rkipc获取H.265视频流并通过JT/T 1078发送
@@ -158,16 +43,12 @@ void *jtt1078_streaming_thread(void *arg) {
         video_frame_t frame;
         frame.data = sample_frame;
         frame.size = sizeof(sample_frame);
-        frame.frame_type = JTT1078_DATA_TYPE_VIDEO; // I帧
-        frame.pts = jtt1078_get_timestamp_ms();
-        frame.is_keyframe = true;
+        frame.frame_type = JTT1078_FRAME_TYPE_AUTO; // 由NAL头判断(VPS -> I帧)
+        frame.pts = jtt1078_get_monotonic_ms();
+        frame.is_keyframe = false;
         
-        // 发送视频帧
-        int ret = jtt1078_encode_video_frame(encoder, &frame);
-        if (ret < 0) {
-            fprintf(stderr, "[Streaming] Failed to send frame\n");
-            break;
-        }
+        // 发送视频帧; 断线期间跳过, 重连后从关键帧恢复, 不退出
+        jtt1078_conn_send_video(&g_conn, encoder, &frame);
         
         // 模拟帧率 (实际应根据编码器输出)
         usleep(40000); // ~25fps
@@ -177,6 +58,30 @@ void *jtt1078_streaming_thread(void *arg) {
     return NULL;
 }
 
+/**
+ * 示例：音频线程与视频线程共用同一个编码器
+ * 编码器按帧分配包序号并整帧依次回调, 两个线程无需额外的发送锁
+ */
+void *jtt1078_audio_thread(void *arg) {
+    jtt1078_encoder_t *encoder = (jtt1078_encoder_t *)arg;
+    
+    // 40ms 8kHz单声道PCM (实际应从 RK_MPI_AENC / AI 获取)
+    int16_t pcm[320];
+    memset(pcm, 0, sizeof(pcm));
+    
+    printf("[Audio] Thread started\n");
+    
+    while (1) {
+        // 断线期间发送失败, 丢弃本帧; 重连由视频线程负责
+        jtt1078_encode_audio_pcm(encoder, pcm, sizeof(pcm) / sizeof(pcm[0]),
+                                 jtt1078_get_monotonic_ms());
+        usleep(40000);
+    }
+    
+    printf("[Audio] Thread stopped\n");
+    return NULL;
+}
+
 /**
  * 主函数示例
  */
@@ -198,35 +103,45 @@ int main(int argc, char *argv[]) {
     printf("Channel: %d\n", channel);
     printf("===================================\n\n");
     
-    // 1. 连接服务器
-    if (jtt1078_tcp_connect(server_ip, port) < 0) {
-        fprintf(stderr, "Failed to connect to server\n");
+    // 1. 连接对象(非阻塞连接, 断线自动重连)
+    if (jtt1078_conn_init(&g_conn, server_ip, port, NULL) < 0) {
+        fprintf(stderr, "Invalid server address: %s\n", server_ip);
         return 1;
     }
+    jtt1078_conn_poll(&g_conn, 5000);
     
     // 2. 初始化JT/T 1078编码器
     jtt1078_encoder_t encoder;
-    if (jtt1078_encoder_init(&encoder,
-                             sim_number,
-                             channel,
-                             JTT1078_VIDEO_H265,
-                             jtt1078_tcp_send_callback,
-                             &g_tcp_ctx) < 0) {
+    if (jtt1078_encoder_init_iov(&encoder,
+                                 sim_number,
+                                 channel,
+                                 JTT1078_VIDEO_H265,
+                                 jtt1078_conn_sendv,
+                                 &g_conn) < 0) {
         fprintf(stderr, "Failed to initialize encoder\n");
-        jtt1078_tcp_disconnect();
+        jtt1078_conn_deinit(&g_conn);
         return 1;
     }
     
-    // 3. 启动流媒体线程
-    pthread_t streaming_tid;
+    // 时间戳取自帧PTS(单调时钟)
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    
+    // 整帧批量发送: 每帧一次sendmsg
+    jtt1078_encoder_enable_batch(&encoder, 256 * 1024);
+    
+    // 3. 启动视频与音频线程(同一编码器, 配置须在此之前完成)
+    pthread_t streaming_tid, audio_tid;
     pthread_create(&streaming_tid, NULL, jtt1078_streaming_thread, &encoder);
+    pthread_create(&audio_tid, NULL, jtt1078_audio_thread, &encoder);
     
     // 4. 等待用户中断
     printf("\nPress Ctrl+C to stop...\n\n");
     pthread_join(streaming_tid, NULL);
+    pthread_join(audio_tid, NULL);
     
     // 5. 清理
-    jtt1078_tcp_disconnect();
+    jtt1078_encoder_deinit(&encoder);
+    jtt1078_conn_deinit(&g_conn);
     
     printf("Program terminated\n");
     return 0;
@@ -237,6 +152,16 @@ int main(int argc, char *argv[]) {
  * arm-rockchip830-linux-uclibcgnueabihf-gcc \
  *     -o jtt1078_example \
  *     jtt1078_protocol.c \
+ *     jtt1078_transport.c \
+ *     jtt1078_conn.c \
+ *     jtt1078_nal.c \
+ *     jtt1078_fec.c \
+ *     jtt1078_g711.c \
+ *     jtt1078_pace.c \
+ *     jtt1078_playback.c \
+ *     jtt1078_fanout.c \
+ *     jtt1078_zerocopy.c \
+ *     jtt1078_aio.c \
  *     jtt1078_example.c \
  *     -lpthread -I.
  * 
@@ -247,14 +172,15 @@ int main(int argc, char *argv[]) {
  *    - 提取 VENC_PACK_S 结构中的数据
  * 
  * 2. 判断帧类型:
- *    - pstPack->DataType.enH265EType 判断NAL类型
- *    - IDR/I帧、P帧、B帧分类
+ *    - jtt1078_nal_frame_type() 扫描码流NAL头, IDR/CRA/VPS/SPS/PPS 为关键帧
+ *    - 或直接设置 frame_type = JTT1078_FRAME_TYPE_AUTO 由编码器判断
  * 
  * 3. 封装为 video_frame_t:
  *    frame.data = pstPack->pu8Addr;
  *    frame.size = pstPack->u32Len;
- *    frame.is_keyframe = (NAL类型为IDR/VPS/SPS/PPS);
- *    frame.pts = pstStream->pstPack[i].u64PTS;
+ *    frame.frame_type = jtt1078_nal_frame_type(frame.data, frame.size,
+ *                                              JTT1078_VIDEO_H265, &frame.is_keyframe);
+ *    frame.pts = pstStream->pstPack[i].u64PTS / 1000;
  * 
  * 4. 发送:
  *    jtt1078_encode_video_frame(&g_encoder, &frame);
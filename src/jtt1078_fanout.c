@@ -0,0 +1,511 @@
+/*
+ * JT/T 1078 Fan-out
+ * 引用计数帧缓冲区与多目的地发送实现
+ */
+
+#include "jtt1078_fanout.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FANOUT_RECONNECT_POLL_MS    100         // 断线期间推进重连状态机的间隔
+
+static inline uint16_t get_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void put_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 条件变量等待 ms 毫秒后的绝对时刻(CLOCK_REALTIME, 与默认条件变量一致)
+static void deadline_after(struct timespec *ts, uint32_t ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/*
+ * 帧缓冲区
+ */
+
+static jtt1078_fanout_buf_t *buf_get(jtt1078_fanout_t *fo) {
+    pthread_mutex_lock(&fo->pool_mutex);
+    jtt1078_fanout_buf_t *buf = fo->free_list;
+    if (buf) {
+        fo->free_list = buf->next;
+        fo->pool_free--;
+    }
+    pthread_mutex_unlock(&fo->pool_mutex);
+
+    if (!buf) {
+        buf = calloc(1, sizeof(jtt1078_fanout_buf_t));
+        if (!buf) {
+            return NULL;
+        }
+    }
+    buf->next = NULL;
+    buf->refs = 0;
+    buf->len = 0;
+    buf->packets = 0;
+    return buf;
+}
+
+static void buf_free(jtt1078_fanout_buf_t *buf) {
+    free(buf->data);
+    free(buf);
+}
+
+// 释放一个引用, 归零时回到空闲链表(超出上限时释放)
+static void buf_unref(jtt1078_fanout_t *fo, jtt1078_fanout_buf_t *buf) {
+    if (__atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&fo->pool_mutex);
+    if (fo->pool_free < JTT1078_FANOUT_POOL_MAX) {
+        buf->next = fo->free_list;
+        fo->free_list = buf;
+        fo->pool_free++;
+        buf = NULL;
+    }
+    pthread_mutex_unlock(&fo->pool_mutex);
+
+    if (buf) {
+        buf_free(buf);
+    }
+}
+
+/*
+ * 目的地队列(调用方持有 dest->mutex)
+ */
+
+static bool dest_full(const jtt1078_fanout_dest_t *dest, uint32_t len) {
+    uint32_t pending = dest->count - (dest->head_busy ? 1 : 0);
+    return dest->count >= dest->cfg.max_frames ||
+           (pending > 0 && dest->bytes + len > dest->cfg.max_bytes);
+}
+
+// 丢弃尚未开始发送的帧
+static void dest_purge(jtt1078_fanout_dest_t *dest) {
+    uint32_t keep = dest->head_busy ? 1 : 0;
+
+    while (dest->count > keep) {
+        uint32_t idx = (dest->head + dest->count - 1) % dest->cfg.max_frames;
+        jtt1078_fanout_buf_t *buf = dest->queue[idx];
+        dest->count--;
+        dest->bytes -= buf->len;
+        dest->stats.frames_dropped++;
+        dest->stats.bytes_dropped += buf->len;
+        buf_unref(dest->fo, buf);
+    }
+    dest->stats.queued_frames = dest->count;
+    dest->stats.queued_bytes = dest->bytes;
+}
+
+static void dest_drop(jtt1078_fanout_dest_t *dest, const jtt1078_fanout_buf_t *buf, bool video) {
+    dest->stats.frames_dropped++;
+    dest->stats.bytes_dropped += buf->len;
+    if (video && !dest->dropping) {
+        dest->dropping = true;
+        dest->stats.drop_events++;
+    }
+}
+
+// 按丢帧策略把一帧加入目的地队列
+static void dest_push(jtt1078_fanout_dest_t *dest, jtt1078_fanout_buf_t *buf) {
+    bool key = buf->data_type == JTT1078_DATA_TYPE_VIDEO;
+    bool video = buf->data_type <= JTT1078_DATA_TYPE_VIDEO_B;
+
+    pthread_mutex_lock(&dest->mutex);
+    if (!dest->running) {
+        pthread_mutex_unlock(&dest->mutex);
+        return;
+    }
+
+    // 丢帧状态下的P/B帧缺少参考帧, 直到下一个I帧
+    if (video && !key && dest->dropping) {
+        dest->stats.frames_dropped++;
+        dest->stats.bytes_dropped += buf->len;
+        pthread_mutex_unlock(&dest->mutex);
+        return;
+    }
+    if (key) {
+        dest->dropping = false;
+    }
+
+    if (dest->cfg.policy == JTT1078_FANOUT_BLOCK && dest_full(dest, buf->len)) {
+        struct timespec deadline;
+        uint64_t start = monotonic_us();
+        deadline_after(&deadline, dest->cfg.block_ms);
+        while (dest->running && dest_full(dest, buf->len)) {
+            if (pthread_cond_timedwait(&dest->space, &dest->mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        dest->stats.blocked_us += monotonic_us() - start;
+    }
+
+    if (dest_full(dest, buf->len)) {
+        // I帧替换队列中的旧帧; 其他帧丢弃本帧
+        if (key) {
+            dest_purge(dest);
+        }
+        if (!key || dest_full(dest, buf->len)) {
+            dest_drop(dest, buf, video);
+            pthread_mutex_unlock(&dest->mutex);
+            return;
+        }
+    }
+
+    __atomic_add_fetch(&buf->refs, 1, __ATOMIC_RELAXED);
+    dest->queue[(dest->head + dest->count) % dest->cfg.max_frames] = buf;
+    dest->count++;
+    dest->bytes += buf->len;
+    dest->stats.queued_frames = dest->count;
+    dest->stats.queued_bytes = dest->bytes;
+    if (dest->bytes > dest->stats.max_queued_bytes) {
+        dest->stats.max_queued_bytes = dest->bytes;
+    }
+
+    pthread_cond_signal(&dest->cond);
+    pthread_mutex_unlock(&dest->mutex);
+}
+
+// 扇出编码器的iovec回调: 拷入当前帧缓冲区, 帧结束(标记位)时分发给各目的地
+// 整帧可能分多次回调(批量缓冲区不足/逐包发送)
+static int fanout_collect(const struct iovec *iov, int iovcnt, void *user_data) {
+    jtt1078_fanout_t *fo = (jtt1078_fanout_t *)user_data;
+    size_t total = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    jtt1078_fanout_buf_t *buf = fo->cur;
+    if (!buf) {
+        buf = fo->cur = buf_get(fo);
+        if (!buf) {
+            return -1;
+        }
+    }
+
+    if (buf->len + total > buf->capacity) {
+        size_t capacity = buf->capacity ? (size_t)buf->capacity * 2 : 64 * 1024;
+        while (capacity < buf->len + total) {
+            capacity *= 2;
+        }
+        uint8_t *data = realloc(buf->data, capacity);
+        if (!data) {
+            fprintf(stderr, "[JTT1078] Fan-out: failed to allocate %zu-byte frame buffer\n", capacity);
+            buf->len = 0;
+            buf->packets = 0;
+            return -1;
+        }
+        buf->data = data;
+        buf->capacity = (uint32_t)capacity;
+    }
+
+    uint32_t off = buf->len;
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(buf->data + buf->len, iov[i].iov_base, iov[i].iov_len);
+        buf->len += (uint32_t)iov[i].iov_len;
+    }
+
+    // 统计新加入的包, 最后一个包带帧结束标记时整帧分发
+    bool frame_end = false;
+    while (off + JTT1078_HEADER_SIZE <= buf->len) {
+        const uint8_t *hdr = buf->data + off;
+        uint8_t subpackage = hdr[JTT1078_OFF_TYPE] & 0x0F;
+        if (buf->packets == 0) {
+            buf->data_type = hdr[JTT1078_OFF_TYPE] >> 4;
+        }
+        buf->packets++;
+        off += JTT1078_HEADER_SIZE + get_be16(hdr + JTT1078_OFF_LENGTH);
+        frame_end = subpackage == JTT1078_PKT_ATOMIC || subpackage == JTT1078_PKT_LAST;
+    }
+    if (!frame_end) {
+        return 0;
+    }
+
+    fo->cur = NULL;
+    buf->refs = 1;
+    for (int i = 0; i < fo->ndests; i++) {
+        dest_push(&fo->dests[i], buf);
+    }
+    buf_unref(fo, buf);
+    return 0;
+}
+
+/*
+ * 发送线程
+ */
+
+// 以本目的地的包序号发送一帧: 复制并改写包头, 负载引用共享缓冲区
+// @return 0成功, 1未连接(跳过), -1发送失败
+static int dest_send(jtt1078_fanout_dest_t *dest, const jtt1078_fanout_buf_t *buf) {
+    jtt1078_conn_t *conn = dest->cfg.conn;
+    if (conn && jtt1078_conn_poll(conn, 0) != 1) {
+        return 1;
+    }
+
+    uint32_t off = 0;
+    int n = 0, iovcnt = 0;
+    while (off < buf->len) {
+        const uint8_t *pkt = buf->data + off;
+        uint16_t len = get_be16(pkt + JTT1078_OFF_LENGTH);
+        uint8_t *hdr = dest->hdrs + n * JTT1078_HEADER_SIZE;
+
+        memcpy(hdr, pkt, JTT1078_HEADER_SIZE);
+        put_be16(hdr + JTT1078_OFF_SEQ, dest->seq++);
+        dest->iov[iovcnt].iov_base = hdr;
+        dest->iov[iovcnt].iov_len = JTT1078_HEADER_SIZE;
+        iovcnt++;
+        if (len > 0) {
+            dest->iov[iovcnt].iov_base = (void *)(pkt + JTT1078_HEADER_SIZE);
+            dest->iov[iovcnt].iov_len = len;
+            iovcnt++;
+        }
+        off += JTT1078_HEADER_SIZE + len;
+        n++;
+
+        if (n == JTT1078_FANOUT_BATCH_PACKETS || off >= buf->len) {
+            int ret = conn ? jtt1078_conn_sendv(dest->iov, iovcnt, conn) :
+                             dest->cfg.send_packetv(dest->iov, iovcnt, dest->cfg.user_data);
+            if (ret < 0) {
+                return -1;
+            }
+            n = 0;
+            iovcnt = 0;
+        }
+    }
+    return 0;
+}
+
+static void *dest_thread(void *arg) {
+    jtt1078_fanout_dest_t *dest = (jtt1078_fanout_dest_t *)arg;
+    jtt1078_conn_t *conn = dest->cfg.conn;
+
+    pthread_mutex_lock(&dest->mutex);
+    for (;;) {
+        while (dest->running && dest->count == 0) {
+            // 断线期间定时推进重连, 不依赖P帧到达(丢帧状态下P帧不入队)
+            if (conn && conn->state != JTT1078_CONN_CONNECTED) {
+                pthread_mutex_unlock(&dest->mutex);
+                jtt1078_conn_poll(conn, 0);
+                pthread_mutex_lock(&dest->mutex);
+
+                struct timespec deadline;
+                deadline_after(&deadline, FANOUT_RECONNECT_POLL_MS);
+                pthread_cond_timedwait(&dest->cond, &dest->mutex, &deadline);
+            } else {
+                pthread_cond_wait(&dest->cond, &dest->mutex);
+            }
+        }
+        if (!dest->running) {
+            break;
+        }
+
+        // 队首帧发送期间不可被丢弃, 发送时无需持锁
+        jtt1078_fanout_buf_t *buf = dest->queue[dest->head];
+        dest->head_busy = true;
+        pthread_mutex_unlock(&dest->mutex);
+
+        int ret = dest_send(dest, buf);
+
+        pthread_mutex_lock(&dest->mutex);
+        dest->head = (dest->head + 1) % dest->cfg.max_frames;
+        dest->count--;
+        dest->bytes -= buf->len;
+        dest->head_busy = false;
+
+        bool video = buf->data_type <= JTT1078_DATA_TYPE_VIDEO_B;
+        if (ret == 0) {
+            dest->stats.frames_sent++;
+            dest->stats.packets_sent += buf->packets;
+            dest->stats.bytes_sent += buf->len;
+        } else {
+            // 断线: 队列中的帧已过时, 重连后从I帧开始
+            if (ret < 0) {
+                dest->stats.send_failures++;
+            }
+            dest_drop(dest, buf, video);
+            dest_purge(dest);
+            if (!dest->dropping) {
+                dest->dropping = true;
+                dest->stats.drop_events++;
+            }
+        }
+        dest->stats.queued_frames = dest->count;
+        dest->stats.queued_bytes = dest->bytes;
+        pthread_cond_broadcast(&dest->space);
+
+        pthread_mutex_unlock(&dest->mutex);
+        buf_unref(dest->fo, buf);
+        pthread_mutex_lock(&dest->mutex);
+    }
+    pthread_mutex_unlock(&dest->mutex);
+    return NULL;
+}
+
+/*
+ * 接口
+ */
+
+void jtt1078_fanout_default_config(jtt1078_fanout_dest_config_t *cfg) {
+    memset(cfg, 0, sizeof(jtt1078_fanout_dest_config_t));
+    cfg->max_frames = 64;
+    cfg->max_bytes = 1024 * 1024;
+    cfg->policy = JTT1078_FANOUT_DROP_GOP;
+    cfg->block_ms = 200;
+}
+
+jtt1078_encoder_t *jtt1078_fanout_init(jtt1078_fanout_t *fo,
+                                       const char *sim_number,
+                                       uint8_t channel,
+                                       uint8_t video_format) {
+    if (!fo) {
+        return NULL;
+    }
+
+    memset(fo, 0, sizeof(jtt1078_fanout_t));
+    if (jtt1078_encoder_init_iov(&fo->encoder, sim_number, channel, video_format,
+                                 fanout_collect, fo) < 0 ||
+        jtt1078_encoder_enable_batch(&fo->encoder, 256 * 1024) < 0) {
+        jtt1078_encoder_deinit(&fo->encoder);
+        return NULL;
+    }
+
+    pthread_mutex_init(&fo->pool_mutex, NULL);
+    return &fo->encoder;
+}
+
+int jtt1078_fanout_add_dest(jtt1078_fanout_t *fo, const jtt1078_fanout_dest_config_t *cfg) {
+    if (!fo || !cfg || fo->started || fo->ndests >= JTT1078_FANOUT_MAX_DESTS ||
+        (!cfg->conn && !cfg->send_packetv) || cfg->max_frames == 0 || cfg->max_bytes == 0 ||
+        cfg->policy > JTT1078_FANOUT_BLOCK) {
+        return -1;
+    }
+
+    jtt1078_fanout_dest_t *dest = &fo->dests[fo->ndests];
+    memset(dest, 0, sizeof(jtt1078_fanout_dest_t));
+    dest->cfg = *cfg;
+    dest->fo = fo;
+
+    dest->queue = calloc(cfg->max_frames, sizeof(jtt1078_fanout_buf_t *));
+    dest->hdrs = malloc(JTT1078_FANOUT_BATCH_PACKETS * JTT1078_HEADER_SIZE);
+    dest->iov = malloc(2 * JTT1078_FANOUT_BATCH_PACKETS * sizeof(struct iovec));
+    if (!dest->queue || !dest->hdrs || !dest->iov) {
+        free(dest->queue);
+        free(dest->hdrs);
+        free(dest->iov);
+        return -1;
+    }
+
+    pthread_mutex_init(&dest->mutex, NULL);
+    pthread_cond_init(&dest->cond, NULL);
+    pthread_cond_init(&dest->space, NULL);
+    return fo->ndests++;
+}
+
+int jtt1078_fanout_start(jtt1078_fanout_t *fo) {
+    if (!fo || fo->started) {
+        return -1;
+    }
+
+    for (int i = 0; i < fo->ndests; i++) {
+        jtt1078_fanout_dest_t *dest = &fo->dests[i];
+        dest->running = true;
+        if (pthread_create(&dest->thread, NULL, dest_thread, dest) != 0) {
+            dest->running = false;
+            fo->started = true;
+            jtt1078_fanout_stop(fo);
+            return -1;
+        }
+    }
+    fo->started = true;
+    return 0;
+}
+
+void jtt1078_fanout_stop(jtt1078_fanout_t *fo) {
+    if (!fo || !fo->started) {
+        return;
+    }
+
+    for (int i = 0; i < fo->ndests; i++) {
+        jtt1078_fanout_dest_t *dest = &fo->dests[i];
+        pthread_mutex_lock(&dest->mutex);
+        bool running = dest->running;
+        dest->running = false;
+        pthread_cond_broadcast(&dest->cond);
+        pthread_cond_broadcast(&dest->space);
+        pthread_mutex_unlock(&dest->mutex);
+        if (running) {
+            pthread_join(dest->thread, NULL);
+        }
+
+        pthread_mutex_lock(&dest->mutex);
+        dest_purge(dest);
+        pthread_mutex_unlock(&dest->mutex);
+    }
+    fo->started = false;
+}
+
+int jtt1078_fanout_get_stats(jtt1078_fanout_t *fo, int index, jtt1078_fanout_stats_t *out) {
+    if (!fo || !out || index < 0 || index >= fo->ndests) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&fo->dests[index].mutex);
+    *out = fo->dests[index].stats;
+    pthread_mutex_unlock(&fo->dests[index].mutex);
+    return 0;
+}
+
+void jtt1078_fanout_destroy(jtt1078_fanout_t *fo) {
+    if (!fo) {
+        return;
+    }
+
+    jtt1078_fanout_stop(fo);
+    jtt1078_encoder_deinit(&fo->encoder);
+
+    for (int i = 0; i < fo->ndests; i++) {
+        jtt1078_fanout_dest_t *dest = &fo->dests[i];
+        free(dest->queue);
+        free(dest->hdrs);
+        free(dest->iov);
+        pthread_mutex_destroy(&dest->mutex);
+        pthread_cond_destroy(&dest->cond);
+        pthread_cond_destroy(&dest->space);
+    }
+    fo->ndests = 0;
+
+    if (fo->cur) {
+        buf_free(fo->cur);
+        fo->cur = NULL;
+    }
+    while (fo->free_list) {
+        jtt1078_fanout_buf_t *buf = fo->free_list;
+        fo->free_list = buf->next;
+        buf_free(buf);
+    }
+    fo->pool_free = 0;
+    pthread_mutex_destroy(&fo->pool_mutex);
+}
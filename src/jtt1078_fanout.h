@@ -0,0 +1,157 @@
+/*
+ * JT/T 1078 Fan-out
+ * 一路码流同时推送到多个平台(主/备平台, 本地录像等)
+ *
+ * 每帧只分包一次: 扇出编码器的 iovec 回调把整帧(包头+负载)拷入一个引用计数
+ * 缓冲区, 各目的地的队列只持有引用, 不再拷贝负载。每个目的地:
+ *   - 独立的发送线程与有界队列(帧数/字节数), 慢速或断线的平台不阻塞其他平台
+ *   - 独立的包序号空间: 发送时复制包头(30字节)并改写包序号, 平台看到的序号
+ *     对其收到的包连续; 负载直接引用共享缓冲区
+ *   - 独立的丢帧策略:
+ *       JTT1078_FANOUT_DROP_GOP  队列满时丢弃P/B帧直到下一个I帧, I帧丢弃队列中
+ *                                尚未开始发送的旧帧(与 jtt1078_sendq 相同), 音频只丢本帧
+ *       JTT1078_FANOUT_BLOCK     生产者最多等待 block_ms 让出空间(本地录像等不宜
+ *                                丢帧的目的地), 超时后按 DROP_GOP 处理
+ *     发送失败(断线)后清空队列, 等待下一个I帧
+ *
+ * 每增加一个目的地的额外开销只有包头复制和一次 writev; NAL扫描、参数集缓存、
+ * 时间戳等在扇出编码器中只做一次。FEC 校验包引用包序号, 发送节奏控制针对
+ * 单条链路, 二者不能在扇出编码器上启用。
+ */
+
+#ifndef JTT1078_FANOUT_H
+#define JTT1078_FANOUT_H
+
+#include "jtt1078_protocol.h"
+#include "jtt1078_conn.h"
+#include <pthread.h>
+
+#define JTT1078_FANOUT_MAX_DESTS    4           // 最大目的地数
+#define JTT1078_FANOUT_POOL_MAX     32          // 缓存的空闲帧缓冲区上限
+#define JTT1078_FANOUT_BATCH_PACKETS 256        // 每次 writev 的最大包数
+
+// 丢帧策略
+#define JTT1078_FANOUT_DROP_GOP     0
+#define JTT1078_FANOUT_BLOCK        1
+
+// 目的地参数
+typedef struct {
+    // 发送方式二选一: 自动重连的TCP连接(发送前推进重连状态机), 或 iovec 回调
+    jtt1078_conn_t *conn;
+    int (*send_packetv)(const struct iovec *iov, int iovcnt, void *user_data);
+    void *user_data;
+
+    uint32_t max_frames;        // 队列帧数上限(默认64)
+    uint32_t max_bytes;         // 队列字节数上限(默认1MB)
+    uint8_t  policy;            // JTT1078_FANOUT_*
+    uint32_t block_ms;          // BLOCK 策略的最长等待(默认200)
+} jtt1078_fanout_dest_config_t;
+
+// 目的地统计
+typedef struct {
+    uint64_t frames_sent;
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t frames_dropped;    // 按丢帧策略丢弃的帧数(含断线清空的帧)
+    uint64_t bytes_dropped;
+    uint64_t drop_events;       // 进入丢帧状态的次数
+    uint64_t send_failures;
+    uint64_t blocked_us;        // BLOCK 策略下生产者累计等待时间
+    uint32_t queued_frames;     // 当前排队帧数
+    uint32_t queued_bytes;
+    uint32_t max_queued_bytes;
+} jtt1078_fanout_stats_t;
+
+// 整帧缓冲区(线上格式的包首尾相接), 引用计数归零后回到空闲链表
+typedef struct jtt1078_fanout_buf {
+    struct jtt1078_fanout_buf *next;
+    uint32_t refs;              // 原子操作
+    uint32_t len;
+    uint32_t capacity;
+    uint32_t packets;
+    uint8_t  data_type;         // 第一个包的数据类型
+    uint8_t *data;
+} jtt1078_fanout_buf_t;
+
+struct jtt1078_fanout;
+
+// 目的地
+typedef struct {
+    jtt1078_fanout_dest_config_t cfg;
+    struct jtt1078_fanout *fo;
+
+    // 队列(环形, 保存缓冲区引用)
+    jtt1078_fanout_buf_t **queue;
+    uint32_t head;
+    uint32_t count;
+    uint32_t bytes;
+    bool     head_busy;         // 队首帧正在发送, 不可丢弃
+    bool     dropping;          // 丢帧状态: 丢弃P/B帧直到下一个I帧
+
+    // 发送线程私有: 包序号与本目的地的包头/iovec 暂存区
+    uint16_t seq;
+    uint8_t *hdrs;
+    struct iovec *iov;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        // 有新帧
+    pthread_cond_t space;       // 队列有空间(BLOCK 策略)
+    pthread_t thread;
+    bool running;
+
+    jtt1078_fanout_stats_t stats;
+} jtt1078_fanout_dest_t;
+
+// 扇出器
+typedef struct jtt1078_fanout {
+    jtt1078_encoder_t encoder;  // 扇出编码器, 生产者直接调用 jtt1078_encode_*
+    jtt1078_fanout_dest_t dests[JTT1078_FANOUT_MAX_DESTS];
+    int ndests;
+    bool started;
+
+    jtt1078_fanout_buf_t *cur;  // 正在接收的帧(只由生产者线程访问)
+
+    // 空闲缓冲区
+    pthread_mutex_t pool_mutex;
+    jtt1078_fanout_buf_t *free_list;
+    uint32_t pool_free;
+} jtt1078_fanout_t;
+
+/**
+ * 填充默认目的地参数(发送方式需调用方设置)
+ */
+void jtt1078_fanout_default_config(jtt1078_fanout_dest_config_t *cfg);
+
+/**
+ * 初始化扇出器与扇出编码器(整帧批量回调)
+ * @return 扇出编码器(对其调用 jtt1078_encode_video_frame 等), 失败返回NULL
+ */
+jtt1078_encoder_t *jtt1078_fanout_init(jtt1078_fanout_t *fo,
+                                       const char *sim_number,
+                                       uint8_t channel,
+                                       uint8_t video_format);
+
+/**
+ * 添加目的地(在 jtt1078_fanout_start 之前调用)
+ * @return 目的地索引, -1参数错误或已达上限
+ */
+int jtt1078_fanout_add_dest(jtt1078_fanout_t *fo, const jtt1078_fanout_dest_config_t *cfg);
+
+/**
+ * 启动/停止各目的地的发送线程
+ * 停止时丢弃尚未发送的帧
+ */
+int jtt1078_fanout_start(jtt1078_fanout_t *fo);
+void jtt1078_fanout_stop(jtt1078_fanout_t *fo);
+
+/**
+ * 获取目的地统计(线程安全)
+ */
+int jtt1078_fanout_get_stats(jtt1078_fanout_t *fo, int index, jtt1078_fanout_stats_t *out);
+
+/**
+ * 释放扇出器资源(先停止发送线程, 不关闭各目的地的连接)
+ */
+void jtt1078_fanout_destroy(jtt1078_fanout_t *fo);
+
+#endif // JTT1078_FANOUT_H
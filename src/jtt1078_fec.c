@@ -0,0 +1,601 @@
+/*
+ * JT/T 1078 Forward Error Correction
+ * GF(2^8) 查表运算, 校验包生成与接收端恢复
+ */
+
+#include "jtt1078_fec.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FEC_NEON    1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define FEC_SSSE3   1
+#define FEC_SSE2    1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FEC_SSE2    1
+#endif
+
+#define GF_POLY         0x11D       // x^8 + x^4 + x^3 + x^2 + 1
+#define SLOT_SIZE       JTT1078_MAX_PACKET_SIZE
+
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+// 每个系数的乘积表: [c][0][n] = c*n, [c][1][n] = c*(n<<4)
+static uint8_t gf_nib[256][2][16] __attribute__((aligned(16)));
+// 归一化 Cauchy 系数: 第 i 个校验包中第 j 个源包的系数
+static uint8_t fec_coef[JTT1078_FEC_MAX_PARITY][JTT1078_FEC_MAX_SOURCE];
+static pthread_once_t gf_once = PTHREAD_ONCE_INIT;
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+static inline uint8_t gf_inv(uint8_t a) {
+    return gf_exp[255 - gf_log[a]];
+}
+
+static void gf_build(void) {
+    uint32_t x = 1;
+    for (int i = 0; i < 255; i++) {
+        gf_exp[i] = gf_exp[i + 255] = (uint8_t)x;
+        gf_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= GF_POLY;
+        }
+    }
+
+    for (int c = 0; c < 256; c++) {
+        for (int n = 0; n < 16; n++) {
+            gf_nib[c][0][n] = gf_mul((uint8_t)c, (uint8_t)n);
+            gf_nib[c][1][n] = gf_mul((uint8_t)c, (uint8_t)(n << 4));
+        }
+    }
+
+    // Cauchy 矩阵 1/(x_i + y_j), x_i = i, y_j = MAX_PARITY + j, 任意方子阵可逆;
+    // 每列除以第0行的元素(不改变可逆性), 第0行变为全1
+    for (int i = 0; i < JTT1078_FEC_MAX_PARITY; i++) {
+        for (int j = 0; j < JTT1078_FEC_MAX_SOURCE; j++) {
+            uint8_t y = (uint8_t)(JTT1078_FEC_MAX_PARITY + j);
+            fec_coef[i][j] = gf_mul(y, gf_inv((uint8_t)(i ^ y)));
+        }
+    }
+}
+
+void jtt1078_fec_init(void) {
+    pthread_once(&gf_once, gf_build);
+}
+
+const char *jtt1078_fec_simd(void) {
+#if defined(FEC_NEON)
+    return "neon";
+#elif defined(FEC_SSSE3)
+    return "ssse3";
+#else
+    return "scalar";
+#endif
+}
+
+static void xor_region(uint8_t *dst, const uint8_t *src, uint32_t len) {
+    uint32_t i = 0;
+
+#if defined(FEC_NEON)
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+#elif defined(FEC_SSE2)
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(a, b));
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+void jtt1078_fec_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, uint32_t len) {
+    if (c == 0) {
+        return;
+    }
+    if (c == 1) {
+        xor_region(dst, src, len);
+        return;
+    }
+
+    const uint8_t *lo = gf_nib[c][0];
+    const uint8_t *hi = gf_nib[c][1];
+    uint32_t i = 0;
+
+#if defined(FEC_NEON) && defined(__aarch64__)
+    const uint8x16_t tlo = vld1q_u8(lo);
+    const uint8x16_t thi = vld1q_u8(hi);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t p = veorq_u8(vqtbl1q_u8(tlo, vandq_u8(s, mask)),
+                                vqtbl1q_u8(thi, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), p));
+    }
+#elif defined(FEC_NEON)
+    // ARMv7 只有64位查表指令 vtbl2, 16字节拆成两半
+    const uint8x8x2_t tlo = { { vld1_u8(lo), vld1_u8(lo + 8) } };
+    const uint8x8x2_t thi = { { vld1_u8(hi), vld1_u8(hi + 8) } };
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t l = vandq_u8(s, mask);
+        uint8x16_t h = vshrq_n_u8(s, 4);
+        uint8x8_t p0 = veor_u8(vtbl2_u8(tlo, vget_low_u8(l)), vtbl2_u8(thi, vget_low_u8(h)));
+        uint8x8_t p1 = veor_u8(vtbl2_u8(tlo, vget_high_u8(l)), vtbl2_u8(thi, vget_high_u8(h)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vcombine_u8(p0, p1)));
+    }
+#elif defined(FEC_SSSE3)
+    const __m128i tlo = _mm_load_si128((const __m128i *)lo);
+    const __m128i thi = _mm_load_si128((const __m128i *)hi);
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, _mm_and_si128(s, mask)),
+                                  _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, p));
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] ^= lo[src[i] & 0x0F] ^ hi[src[i] >> 4];
+    }
+}
+
+/*
+ * 编码
+ */
+
+uint32_t jtt1078_fec_group_size(const jtt1078_fec_encoder_t *fec, uint32_t packets, uint32_t first) {
+    if (packets == 0) {
+        return 0;
+    }
+
+    uint32_t groups = (packets + fec->group_size - 1) / fec->group_size;
+    uint32_t base = packets / groups;
+    uint32_t extra = packets % groups;
+
+    // 前 extra 组各多一个源包
+    return first < extra * (base + 1) ? base + 1 : base;
+}
+
+uint32_t jtt1078_fec_parity_count(const jtt1078_fec_encoder_t *fec, uint8_t data_type, uint32_t k) {
+    uint32_t ratio;
+
+    if (data_type == JTT1078_DATA_TYPE_VIDEO) {
+        ratio = fec->i_ratio;
+    } else if (data_type <= JTT1078_DATA_TYPE_VIDEO_B) {
+        ratio = fec->p_ratio;
+    } else {
+        return 0;
+    }
+
+    uint32_t m = (k * ratio + 99) / 100;
+    return m > JTT1078_FEC_MAX_PARITY ? JTT1078_FEC_MAX_PARITY : m;
+}
+
+uint32_t jtt1078_fec_parity_total(const jtt1078_fec_encoder_t *fec, uint8_t data_type, uint32_t packets) {
+    uint32_t total = 0;
+
+    for (uint32_t first = 0; first < packets; ) {
+        uint32_t k = jtt1078_fec_group_size(fec, packets, first);
+        total += jtt1078_fec_parity_count(fec, data_type, k);
+        first += k;
+    }
+    return total;
+}
+
+int jtt1078_fec_reserve(jtt1078_fec_encoder_t *fec, uint32_t count) {
+    if (count <= fec->capacity) {
+        return 0;
+    }
+
+    uint8_t *bodies = realloc(fec->bodies, (size_t)count * fec->stride);
+    if (!bodies) {
+        fprintf(stderr, "[JTT1078] Failed to allocate %u FEC parity packets\n", count);
+        return -1;
+    }
+    fec->bodies = bodies;
+    fec->capacity = count;
+    return 0;
+}
+
+static inline void put_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline uint16_t get_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+void jtt1078_fec_encode(const jtt1078_fec_group_t *g, const uint8_t *src, uint32_t src_len,
+                        uint8_t *out, uint32_t stride) {
+    jtt1078_fec_init();
+
+    for (uint32_t i = 0; i < g->m; i++) {
+        uint8_t *body = out + i * stride;
+        body[0] = g->k;
+        body[1] = g->m;
+        body[2] = (uint8_t)i;
+        body[3] = g->pt;
+        put_be16(body + 4, g->first);
+        put_be16(body + 6, g->total);
+        put_be16(body + 8, g->last_len);
+        memset(body + JTT1078_FEC_HEADER_SIZE, 0, g->symbol);
+    }
+
+    // 源包在外层: 每个源包读入缓存一次, 累加到所有校验符号
+    uint32_t offset = 0;
+    for (uint32_t j = 0; j < g->k && offset < src_len; j++) {
+        uint32_t len = src_len - offset;
+        if (len > g->symbol) {
+            len = g->symbol;
+        }
+        for (uint32_t i = 0; i < g->m; i++) {
+            jtt1078_fec_mul_add(out + i * stride + JTT1078_FEC_HEADER_SIZE, src + offset,
+                                fec_coef[i][j], len);
+        }
+        offset += len;
+    }
+}
+
+int jtt1078_fec_parse(const uint8_t *body, uint32_t len, jtt1078_fec_group_t *g, uint8_t *index) {
+    if (!body || !g || !index || len <= JTT1078_FEC_HEADER_SIZE ||
+        len - JTT1078_FEC_HEADER_SIZE > JTT1078_FEC_MAX_SYMBOL) {
+        return -1;
+    }
+
+    g->k = body[0];
+    g->m = body[1];
+    *index = body[2];
+    g->pt = body[3] & 0x7F;
+    g->first = get_be16(body + 4);
+    g->total = get_be16(body + 6);
+    g->last_len = get_be16(body + 8);
+    g->symbol = (uint16_t)(len - JTT1078_FEC_HEADER_SIZE);
+
+    if (g->k == 0 || g->k > JTT1078_FEC_MAX_SOURCE || g->m == 0 || g->m > JTT1078_FEC_MAX_PARITY ||
+        *index >= g->m || (uint32_t)g->first + g->k > g->total ||
+        g->last_len == 0 || g->last_len > g->symbol) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * 解码
+ */
+
+static inline int16_t seq_diff(uint16_t a, uint16_t b) {
+    return (int16_t)(uint16_t)(a - b);
+}
+
+static inline uint32_t slot_index(uint16_t seq) {
+    return seq & (JTT1078_FEC_WINDOW - 1);
+}
+
+static inline bool slot_has(const jtt1078_fec_decoder_t *dec, uint16_t seq) {
+    uint32_t i = slot_index(seq);
+    return dec->slot_len[i] != 0 && dec->slot_seq[i] == seq;
+}
+
+static inline uint8_t *slot_data(const jtt1078_fec_decoder_t *dec, uint16_t seq) {
+    return dec->slots + (size_t)slot_index(seq) * SLOT_SIZE;
+}
+
+static void slot_set(jtt1078_fec_decoder_t *dec, uint16_t seq, uint32_t len) {
+    uint32_t i = slot_index(seq);
+    dec->slot_len[i] = (uint16_t)len;
+    dec->slot_seq[i] = seq;
+    if (seq_diff((uint16_t)(seq + 1), dec->end_seq) > 0) {
+        dec->end_seq = (uint16_t)(seq + 1);
+    }
+}
+
+int jtt1078_fec_decoder_init(jtt1078_fec_decoder_t *dec,
+                             void (*deliver)(const uint8_t *packet, uint32_t len, void *user_data),
+                             void *user_data) {
+    if (!dec || !deliver) {
+        return -1;
+    }
+
+    jtt1078_fec_init();
+    memset(dec, 0, sizeof(jtt1078_fec_decoder_t));
+    dec->slots = malloc((size_t)JTT1078_FEC_WINDOW * SLOT_SIZE);
+    dec->parity = malloc(JTT1078_FEC_MAX_PARITY * JTT1078_FEC_MAX_SYMBOL);
+    dec->scratch = malloc(JTT1078_FEC_MAX_PARITY * JTT1078_FEC_MAX_SYMBOL);
+    if (!dec->slots || !dec->parity || !dec->scratch) {
+        fprintf(stderr, "[JTT1078] Failed to allocate FEC decoder\n");
+        jtt1078_fec_decoder_deinit(dec);
+        return -1;
+    }
+
+    dec->deliver = deliver;
+    dec->user_data = user_data;
+    return 0;
+}
+
+void jtt1078_fec_decoder_deinit(jtt1078_fec_decoder_t *dec) {
+    if (!dec) {
+        return;
+    }
+
+    free(dec->slots);
+    free(dec->parity);
+    free(dec->scratch);
+    dec->slots = NULL;
+    dec->parity = NULL;
+    dec->scratch = NULL;
+}
+
+// 交付 next_seq 起连续已到达的包
+static void deliver_ready(jtt1078_fec_decoder_t *dec) {
+    while (seq_diff(dec->end_seq, dec->next_seq) > 0 && slot_has(dec, dec->next_seq)) {
+        dec->deliver(slot_data(dec, dec->next_seq), dec->slot_len[slot_index(dec->next_seq)],
+                     dec->user_data);
+        dec->next_seq++;
+    }
+}
+
+// 放弃 target 之前的空洞, 交付其间已到达的包
+static void skip_to(jtt1078_fec_decoder_t *dec, uint16_t target) {
+    while (seq_diff(target, dec->next_seq) > 0) {
+        if (slot_has(dec, dec->next_seq)) {
+            dec->deliver(slot_data(dec, dec->next_seq), dec->slot_len[slot_index(dec->next_seq)],
+                         dec->user_data);
+        } else {
+            dec->stats.lost++;
+        }
+        dec->next_seq++;
+    }
+    deliver_ready(dec);
+}
+
+void jtt1078_fec_decoder_flush(jtt1078_fec_decoder_t *dec) {
+    if (!dec || !dec->started) {
+        return;
+    }
+
+    skip_to(dec, dec->end_seq);
+    dec->pending = false;
+}
+
+static inline uint8_t subpackage_flag(uint32_t index, uint32_t total) {
+    if (total == 1) {
+        return JTT1078_PKT_ATOMIC;
+    } else if (index == 0) {
+        return JTT1078_PKT_FIRST;
+    } else if (index == total - 1) {
+        return JTT1078_PKT_LAST;
+    }
+    return JTT1078_PKT_MIDDLE;
+}
+
+// 按 b 行乘以 f 加到 a 行(e 列)
+static inline void row_mul_add(uint8_t *a, const uint8_t *b, uint8_t f, uint32_t e) {
+    for (uint32_t c = 0; c < e; c++) {
+        a[c] ^= gf_mul(f, b[c]);
+    }
+}
+
+// 恢复等待组的缺失源包
+// 返回1组已完整(无缺失或已恢复), 0校验包不足
+static int recover(jtt1078_fec_decoder_t *dec) {
+    const jtt1078_fec_group_t *g = &dec->group;
+    const uint32_t symbol = g->symbol;
+    uint8_t rows[JTT1078_FEC_MAX_PARITY];
+    uint8_t miss[JTT1078_FEC_MAX_PARITY];
+    uint32_t nrows = 0, e = 0;
+
+    for (uint32_t i = 0; i < g->m; i++) {
+        if (dec->parity_mask & (1u << i)) {
+            rows[nrows++] = (uint8_t)i;
+        }
+    }
+    for (uint32_t j = 0; j < g->k; j++) {
+        if (!slot_has(dec, (uint16_t)(dec->base_seq + j))) {
+            if (e == nrows) {
+                return 0;
+            }
+            miss[e++] = (uint8_t)j;
+        }
+    }
+    if (e == 0) {
+        return 1;
+    }
+
+    // 伴随式: 校验符号减去已收到源包的贡献, 剩下的只含缺失源包
+    for (uint32_t a = 0; a < e; a++) {
+        memcpy(dec->scratch + a * JTT1078_FEC_MAX_SYMBOL,
+               dec->parity + rows[a] * JTT1078_FEC_MAX_SYMBOL, symbol);
+    }
+    for (uint32_t j = 0; j < g->k; j++) {
+        uint16_t seq = (uint16_t)(dec->base_seq + j);
+        if (!slot_has(dec, seq)) {
+            continue;
+        }
+        uint32_t len = dec->slot_len[slot_index(seq)] - JTT1078_HEADER_SIZE;
+        if (len > symbol) {
+            return 0;
+        }
+        for (uint32_t a = 0; a < e; a++) {
+            jtt1078_fec_mul_add(dec->scratch + a * JTT1078_FEC_MAX_SYMBOL,
+                                slot_data(dec, seq) + JTT1078_HEADER_SIZE, fec_coef[rows[a]][j], len);
+        }
+    }
+
+    // 系数子矩阵求逆(Gauss-Jordan), Cauchy 子阵必然可逆
+    uint8_t mat[JTT1078_FEC_MAX_PARITY][JTT1078_FEC_MAX_PARITY];
+    uint8_t inv[JTT1078_FEC_MAX_PARITY][JTT1078_FEC_MAX_PARITY];
+    for (uint32_t a = 0; a < e; a++) {
+        for (uint32_t b = 0; b < e; b++) {
+            mat[a][b] = fec_coef[rows[a]][miss[b]];
+            inv[a][b] = (a == b);
+        }
+    }
+    for (uint32_t col = 0; col < e; col++) {
+        uint32_t piv = col;
+        while (piv < e && mat[piv][col] == 0) {
+            piv++;
+        }
+        if (piv == e) {
+            return 0;
+        }
+        if (piv != col) {
+            for (uint32_t c = 0; c < e; c++) {
+                uint8_t t = mat[piv][c]; mat[piv][c] = mat[col][c]; mat[col][c] = t;
+                t = inv[piv][c]; inv[piv][c] = inv[col][c]; inv[col][c] = t;
+            }
+        }
+        uint8_t s = gf_inv(mat[col][col]);
+        for (uint32_t c = 0; c < e; c++) {
+            mat[col][c] = gf_mul(mat[col][c], s);
+            inv[col][c] = gf_mul(inv[col][c], s);
+        }
+        for (uint32_t r = 0; r < e; r++) {
+            if (r != col && mat[r][col]) {
+                uint8_t f = mat[r][col];
+                row_mul_add(mat[r], mat[col], f, e);
+                row_mul_add(inv[r], inv[col], f, e);
+            }
+        }
+    }
+
+    // 还原缺失源包: 负载 = inv * 伴随式, 包头取校验包头并按帧内位置修正
+    uint8_t data_type = dec->parity_hdr[JTT1078_OFF_TYPE] >> 4;
+    for (uint32_t b = 0; b < e; b++) {
+        uint16_t seq = (uint16_t)(dec->base_seq + miss[b]);
+        if (seq_diff(seq, dec->next_seq) < 0) {
+            continue;   // 已放弃交付
+        }
+
+        uint32_t t = g->first + miss[b];
+        uint32_t len = (t + 1 == g->total) ? g->last_len : symbol;
+        uint8_t sub = subpackage_flag(t, g->total);
+        uint8_t *pkt = slot_data(dec, seq);
+
+        memcpy(pkt, dec->parity_hdr, JTT1078_HEADER_SIZE);
+        pkt[JTT1078_OFF_MPT] = g->pt;
+        if (sub == JTT1078_PKT_ATOMIC || sub == JTT1078_PKT_LAST) {
+            pkt[JTT1078_OFF_MPT] |= 0x80;
+        }
+        put_be16(pkt + JTT1078_OFF_SEQ, seq);
+        pkt[JTT1078_OFF_TYPE] = (uint8_t)((data_type << 4) | sub);
+        put_be16(pkt + JTT1078_OFF_LENGTH, (uint16_t)len);
+
+        memset(pkt + JTT1078_HEADER_SIZE, 0, len);
+        for (uint32_t a = 0; a < e; a++) {
+            jtt1078_fec_mul_add(pkt + JTT1078_HEADER_SIZE, dec->scratch + a * JTT1078_FEC_MAX_SYMBOL,
+                                inv[b][a], len);
+        }
+        slot_set(dec, seq, JTT1078_HEADER_SIZE + len);
+        dec->stats.recovered++;
+    }
+    return 1;
+}
+
+static int parity_packet(jtt1078_fec_decoder_t *dec, const uint8_t *packet, const jtt1078_header_t *h) {
+    jtt1078_fec_group_t g;
+    uint8_t index;
+
+    if (jtt1078_fec_parse(packet + JTT1078_HEADER_SIZE, h->data_length, &g, &index) < 0) {
+        dec->stats.dropped++;
+        return -1;
+    }
+    dec->stats.parity++;
+
+    uint16_t base = h->packet_seq;
+    if (seq_diff((uint16_t)(base + g.k), dec->next_seq) <= 0) {
+        return 0;   // 组已全部交付或放弃
+    }
+
+    if (!dec->pending || dec->base_seq != base || dec->group.k != g.k) {
+        // 校验包紧跟所在组发送, 更早的空洞不会再有校验包
+        skip_to(dec, base);
+        dec->pending = true;
+        dec->base_seq = base;
+        dec->group = g;
+        dec->parity_mask = 0;
+        memcpy(dec->parity_hdr, packet, JTT1078_HEADER_SIZE);
+    }
+
+    if (g.symbol != dec->group.symbol) {
+        dec->stats.dropped++;
+        return -1;
+    }
+    if (!(dec->parity_mask & (1u << index))) {
+        memcpy(dec->parity + index * JTT1078_FEC_MAX_SYMBOL,
+               packet + JTT1078_HEADER_SIZE + JTT1078_FEC_HEADER_SIZE, g.symbol);
+        dec->parity_mask |= 1u << index;
+    }
+
+    if (recover(dec)) {
+        dec->pending = false;
+    } else if ((uint32_t)__builtin_popcount(dec->parity_mask) == g.m) {
+        // 全部校验包已到仍无法恢复
+        skip_to(dec, (uint16_t)(base + g.k));
+        dec->pending = false;
+    }
+    deliver_ready(dec);
+    return 0;
+}
+
+int jtt1078_fec_decoder_feed(jtt1078_fec_decoder_t *dec, const uint8_t *packet, uint32_t len) {
+    jtt1078_header_t h;
+
+    if (!dec || !packet) {
+        return -1;
+    }
+    if (len > SLOT_SIZE || jtt1078_parse_header(packet, len, &h) < 0 ||
+        len != (uint32_t)JTT1078_HEADER_SIZE + h.data_length) {
+        dec->stats.dropped++;
+        return -1;
+    }
+
+    // 首包, 或序号远落后于窗口(终端重启编码器): 从该包重新开始
+    if (!dec->started || seq_diff(h.packet_seq, dec->next_seq) < -JTT1078_FEC_WINDOW) {
+        jtt1078_fec_decoder_flush(dec);
+        dec->started = true;
+        dec->next_seq = h.packet_seq;
+        dec->end_seq = h.packet_seq;
+    }
+
+    if (h.pt == JTT1078_FEC_PT) {
+        return parity_packet(dec, packet, &h);
+    }
+    dec->stats.packets++;
+
+    int16_t d = seq_diff(h.packet_seq, dec->next_seq);
+    if (d < 0 || slot_has(dec, h.packet_seq)) {
+        dec->stats.dropped++;
+        return 0;
+    }
+    if (d >= JTT1078_FEC_WINDOW) {
+        skip_to(dec, (uint16_t)(h.packet_seq - JTT1078_FEC_WINDOW + 1));
+    }
+
+    memcpy(slot_data(dec, h.packet_seq), packet, len);
+    slot_set(dec, h.packet_seq, len);
+    deliver_ready(dec);
+    return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * JT/T 1078 Forward Error Correction
+ * 前向纠错: 为帧内分包生成校验包, 丢包链路(UDP)上接收端直接恢复, 不重传不卡顿
+ *
+ * 编码: 帧的分包平均分成若干组(每组不超过 group_size 个源包), 每组按比例
+ * 生成 m 个校验包, 紧跟在组内源包之后发送。校验矩阵为 GF(2^8) 上按列归一化
+ * 的 Cauchy 矩阵, 第一行全为1(m=1 时即普通异或), 组内任意不超过 m 个包丢失
+ * 都可恢复。关键帧使用更高的校验比例。
+ *
+ * 校验包线上格式(不占用包序号, 不支持FEC的接收端按负载类型忽略):
+ *   包头: 同源包, 负载类型 JTT1078_FEC_PT, 包序号 = 组内首包序号,
+ *         数据类型 = 帧类型, 分包标识 = 原子包
+ *   数据体: FEC头(10字节, 大端序) + 校验符号(长度 = 分包负载大小)
+ *     [0] 源包数 k       [1] 校验包数 m      [2] 本校验包索引
+ *     [3] 源包负载类型   [4-5] 组内首包在帧内的索引
+ *     [6-7] 帧分包总数   [8-9] 帧最后一包负载长度
+ *   源包负载不足符号长度时按0补齐参与计算, 恢复后按帧内位置还原长度与分包标识。
+ *
+ * 热点是区域乘加 dst ^= c * src: 每个系数预先生成高/低4位两张16项乘积表,
+ * NEON(vtbl)/SSSE3(pshufb)一次查表处理8~16字节, 其余平台逐字节查表;
+ * c=1 的异或走整字/SIMD异或。
+ */
+
+#ifndef JTT1078_FEC_H
+#define JTT1078_FEC_H
+
+#include "jtt1078_protocol.h"
+
+#define JTT1078_FEC_PT              127         // 校验包负载类型(RTP动态负载类型上限)
+#define JTT1078_FEC_HEADER_SIZE     10          // 校验包数据体中的FEC头
+#define JTT1078_FEC_MAX_SOURCE      64          // 每组最多源包数
+#define JTT1078_FEC_MAX_PARITY      16          // 每组最多校验包数
+// 校验包不超过 JTT1078_MAX_PACKET_SIZE, 启用FEC时分包负载不大于该值
+#define JTT1078_FEC_MAX_SYMBOL      (JTT1078_MAX_PAYLOAD_SIZE - JTT1078_FEC_HEADER_SIZE)
+#define JTT1078_FEC_WINDOW          512         // 解码窗口(包数, 2的幂)
+
+// 一组源包的描述(即FEC头)
+typedef struct {
+    uint8_t  k;                 // 源包数
+    uint8_t  m;                 // 校验包数
+    uint8_t  pt;                // 源包负载类型
+    uint16_t first;             // 组内首包在帧内的索引
+    uint16_t total;             // 帧分包总数
+    uint16_t last_len;          // 帧最后一包负载长度
+    uint16_t symbol;            // 符号长度(分包负载大小)
+} jtt1078_fec_group_t;
+
+// 编码端参数与校验包缓冲区
+typedef struct jtt1078_fec_encoder {
+    uint8_t  i_ratio;           // 关键帧校验包占源包的百分比
+    uint8_t  p_ratio;           // P/B帧校验包占源包的百分比
+    uint8_t  group_size;        // 每组最多源包数
+    uint8_t *bodies;            // 校验数据体(FEC头 + 符号)
+    uint32_t capacity;          // bodies 可容纳的校验包数
+    uint32_t stride;            // 相邻数据体的间距(FEC头 + 最大符号长度)
+    uint64_t groups;            // 已保护的组数
+    uint64_t parity_packets;    // 已生成的校验包数
+} jtt1078_fec_encoder_t;
+
+// 解码统计
+typedef struct {
+    uint64_t packets;           // 输入的源包数
+    uint64_t parity;            // 输入的校验包数
+    uint64_t recovered;         // 恢复并交付的源包数
+    uint64_t lost;              // 无法恢复而放弃的源包数
+    uint64_t dropped;           // 迟到/重复/非法而丢弃的包数
+} jtt1078_fec_decoder_stats_t;
+
+// 解码器: 按包序号重排窗口, 有空洞时等待所在组的校验包
+typedef struct {
+    uint8_t *slots;                             // JTT1078_FEC_WINDOW 个包, 按 seq % 窗口 存放
+    uint16_t slot_len[JTT1078_FEC_WINDOW];      // 0 表示空
+    uint16_t slot_seq[JTT1078_FEC_WINDOW];
+    bool     started;
+    uint16_t next_seq;                          // 下一个交付的包序号
+    uint16_t end_seq;                           // 已收到的最大序号 + 1
+
+    // 等待恢复的组
+    bool     pending;
+    uint16_t base_seq;
+    jtt1078_fec_group_t group;
+    uint8_t  parity_hdr[JTT1078_HEADER_SIZE];
+    uint32_t parity_mask;                       // 已收到的校验包索引
+    uint8_t *parity;                            // JTT1078_FEC_MAX_PARITY 个校验符号
+    uint8_t *scratch;                           // 恢复用的伴随式
+
+    void (*deliver)(const uint8_t *packet, uint32_t len, void *user_data);
+    void *user_data;
+
+    jtt1078_fec_decoder_stats_t stats;
+} jtt1078_fec_decoder_t;
+
+/**
+ * 初始化 GF(2^8) 运算表(线程安全, 可重复调用)
+ */
+void jtt1078_fec_init(void);
+
+/**
+ * 区域乘加: dst[i] ^= c * src[i] (GF(2^8))
+ * 调用前须已执行 jtt1078_fec_init
+ */
+void jtt1078_fec_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, uint32_t len);
+
+/**
+ * 区域乘加使用的指令集("neon"/"ssse3"/"scalar")
+ */
+const char *jtt1078_fec_simd(void);
+
+/**
+ * 帧内从第 first 个分包开始的组的源包数
+ * 分包平均分组, 每组不超过 group_size 个
+ */
+uint32_t jtt1078_fec_group_size(const jtt1078_fec_encoder_t *fec, uint32_t packets, uint32_t first);
+
+/**
+ * 一组 k 个源包的校验包数(按帧类型取比例, 向上取整), 音频/透传为0
+ */
+uint32_t jtt1078_fec_parity_count(const jtt1078_fec_encoder_t *fec, uint8_t data_type, uint32_t k);
+
+/**
+ * 一帧 packets 个分包的校验包总数
+ */
+uint32_t jtt1078_fec_parity_total(const jtt1078_fec_encoder_t *fec, uint8_t data_type, uint32_t packets);
+
+/**
+ * 保证校验数据体缓冲区可容纳 count 个校验包
+ * @return 0成功, -1失败
+ */
+int jtt1078_fec_reserve(jtt1078_fec_encoder_t *fec, uint32_t count);
+
+/**
+ * 计算一组源包的校验数据体(含FEC头)
+ * @param g 组描述
+ * @param src 组内首包负载, 组内各包负载在帧数据中连续
+ * @param src_len 组内负载总长度
+ * @param out g->m 个数据体, 每个 JTT1078_FEC_HEADER_SIZE + g->symbol 字节
+ * @param stride 相邻数据体的间距
+ */
+void jtt1078_fec_encode(const jtt1078_fec_group_t *g, const uint8_t *src, uint32_t src_len,
+                        uint8_t *out, uint32_t stride);
+
+/**
+ * 解析校验包数据体
+ * @param body 数据体
+ * @param len 数据体长度
+ * @param g 输出组描述
+ * @param index 输出校验包索引
+ * @return 0成功, -1格式非法
+ */
+int jtt1078_fec_parse(const uint8_t *body, uint32_t len, jtt1078_fec_group_t *g, uint8_t *index);
+
+/**
+ * 初始化解码器
+ * 一个解码器对应一个编码器的包序号空间; 输入为逐个完整分包(UDP数据报),
+ * 源包按序号顺序经 deliver 交付(含恢复出的包), 校验包不交付。
+ * 空洞在所在组的校验包全部到达仍无法恢复、或更后面的组的校验包到达时放弃。
+ * @param deliver 交付回调, 可直接把包喂给 jtt1078_depack_feed
+ * @return 0成功, -1失败
+ */
+int jtt1078_fec_decoder_init(jtt1078_fec_decoder_t *dec,
+                             void (*deliver)(const uint8_t *packet, uint32_t len, void *user_data),
+                             void *user_data);
+
+/**
+ * 输入一个完整分包(源包或校验包)
+ * @return 0成功, -1不是合法分包(已计入 dropped)
+ */
+int jtt1078_fec_decoder_feed(jtt1078_fec_decoder_t *dec, const uint8_t *packet, uint32_t len);
+
+/**
+ * 放弃所有空洞, 交付窗口内剩余的包(流结束时调用)
+ */
+void jtt1078_fec_decoder_flush(jtt1078_fec_decoder_t *dec);
+
+/**
+ * 释放解码器资源
+ */
+void jtt1078_fec_decoder_deinit(jtt1078_fec_decoder_t *dec);
+
+#endif // JTT1078_FEC_H
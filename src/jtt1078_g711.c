@@ -0,0 +1,247 @@
+/*
+ * JT/T 1078 G.711 Audio Encoder
+ * PCM -> A律/μ律 批量编码
+ */
+
+#include "jtt1078_g711.h"
+#include <pthread.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define G711_NEON   1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define G711_SSE2   1
+#endif
+
+#define ULAW_BIAS   33          // 14位域的偏置(16位域为 0x84)
+#define ULAW_CLIP   8159
+
+// 查表: A律按 PCM 高13位索引, μ律按高14位索引
+static uint8_t alaw_lut[1 << 13];
+static uint8_t ulaw_lut[1 << 14];
+static pthread_once_t lut_once = PTHREAD_ONCE_INIT;
+
+uint8_t jtt1078_g711_alaw_sample(int16_t pcm) {
+    int v = pcm >> 3;
+    uint8_t mask;
+
+    if (v >= 0) {
+        mask = 0xD5;
+    } else {
+        mask = 0x55;
+        v = -v - 1;
+    }
+
+    // 段号: 第 seg 段的上界为 (32 << seg) - 1
+    int seg = 0;
+    while (seg < 8 && v > (32 << seg) - 1) {
+        seg++;
+    }
+    if (seg >= 8) {
+        return 0x7F ^ mask;
+    }
+
+    uint8_t aval = (uint8_t)(seg << 4);
+    aval |= (v >> (seg < 2 ? 1 : seg)) & 0x0F;
+    return aval ^ mask;
+}
+
+uint8_t jtt1078_g711_ulaw_sample(int16_t pcm) {
+    int v = pcm >> 2;
+    uint8_t mask;
+
+    if (v < 0) {
+        v = -v;
+        mask = 0x7F;
+    } else {
+        mask = 0xFF;
+    }
+    if (v > ULAW_CLIP) {
+        v = ULAW_CLIP;
+    }
+    v += ULAW_BIAS;
+
+    // 段号: 第 seg 段的上界为 (64 << seg) - 1
+    int seg = 0;
+    while (seg < 8 && v > (64 << seg) - 1) {
+        seg++;
+    }
+    if (seg >= 8) {
+        return 0x7F ^ mask;
+    }
+
+    return (uint8_t)((seg << 4) | ((v >> (seg + 1)) & 0x0F)) ^ mask;
+}
+
+static void lut_build(void) {
+    for (uint32_t i = 0; i < (1 << 13); i++) {
+        alaw_lut[i] = jtt1078_g711_alaw_sample((int16_t)(uint16_t)(i << 3));
+    }
+    for (uint32_t i = 0; i < (1 << 14); i++) {
+        ulaw_lut[i] = jtt1078_g711_ulaw_sample((int16_t)(uint16_t)(i << 2));
+    }
+}
+
+const char *jtt1078_g711_simd(void) {
+#if defined(G711_NEON)
+    return "neon";
+#elif defined(G711_SSE2)
+    return "sse2";
+#else
+    return "table";
+#endif
+}
+
+/*
+ * 向量化编码(每次8个样本), 与参考实现逐位一致:
+ *   幅度 mag 去符号后, 段号 = mag 超过的段下界个数(比较结果为全1, 减去即加1);
+ *   量化值 = mag >> max(seg, 1) (A律) / mag >> (seg + 1) (μ律), 以"每超过一个
+ *   段下界再右移一位"的条件选择实现, 不需要逐通道的变量移位。
+ * μ律钳位取 8158: 8158 + 33 = 8191 与参考实现 8159 + 33 = 8192 的编码同为 0x7F,
+ * 段号不会到8。
+ */
+#if defined(G711_NEON) || defined(G711_SSE2)
+static const uint16_t alaw_seg_end[] = { 0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF };
+static const uint16_t ulaw_seg_end[] = { 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF };
+#endif
+
+#if defined(G711_NEON)
+
+// 按段下界依次比较: 段号加1, 量化值再右移一位
+#define G711_SEG_STEP(end)                                              \
+    do {                                                                \
+        uint16x8_t m = vcgtq_u16(mag, vdupq_n_u16(end));                \
+        seg = vsubq_u16(seg, m);                                        \
+        v = vbslq_u16(m, vshrq_n_u16(v, 1), v);                         \
+    } while (0)
+
+static inline uint16x8_t alaw8(int16x8_t pcm) {
+    int16x8_t x = vshrq_n_s16(pcm, 3);
+    uint16x8_t neg = vreinterpretq_u16_s16(vshrq_n_s16(x, 15));
+    uint16x8_t mag = veorq_u16(vreinterpretq_u16_s16(x), neg);     // 负数取 -x-1
+    uint16x8_t seg = vsubq_u16(vdupq_n_u16(0), vcgtq_u16(mag, vdupq_n_u16(alaw_seg_end[0])));
+    uint16x8_t v = vshrq_n_u16(mag, 1);
+
+    for (int s = 1; s < 7; s++) {
+        G711_SEG_STEP(alaw_seg_end[s]);
+    }
+    uint16x8_t code = vorrq_u16(vshlq_n_u16(seg, 4), vandq_u16(v, vdupq_n_u16(0x0F)));
+    uint16x8_t mask = veorq_u16(vdupq_n_u16(0xD5), vandq_u16(neg, vdupq_n_u16(0x80)));
+    return veorq_u16(code, mask);
+}
+
+static inline uint16x8_t ulaw8(int16x8_t pcm) {
+    int16x8_t x = vshrq_n_s16(pcm, 2);
+    uint16x8_t neg = vreinterpretq_u16_s16(vshrq_n_s16(x, 15));
+    int16x8_t a = vminq_s16(vabsq_s16(x), vdupq_n_s16(ULAW_CLIP - 1));
+    uint16x8_t mag = vreinterpretq_u16_s16(vaddq_s16(a, vdupq_n_s16(ULAW_BIAS)));
+    uint16x8_t seg = vdupq_n_u16(0);
+    uint16x8_t v = vshrq_n_u16(mag, 1);
+
+    for (int s = 0; s < 7; s++) {
+        G711_SEG_STEP(ulaw_seg_end[s]);
+    }
+    uint16x8_t code = vorrq_u16(vshlq_n_u16(seg, 4), vandq_u16(v, vdupq_n_u16(0x0F)));
+    uint16x8_t mask = veorq_u16(vdupq_n_u16(0xFF), vandq_u16(neg, vdupq_n_u16(0x80)));
+    return veorq_u16(code, mask);
+}
+
+#define G711_ENCODE16(fn, pcm, out)                                     \
+    vst1q_u8((out), vcombine_u8(vmovn_u16(fn(vld1q_s16(pcm))),          \
+                                vmovn_u16(fn(vld1q_s16((pcm) + 8)))))
+
+#elif defined(G711_SSE2)
+
+#define G711_SEG_STEP(end)                                              \
+    do {                                                                \
+        __m128i m = _mm_cmpgt_epi16(mag, _mm_set1_epi16(end));          \
+        seg = _mm_sub_epi16(seg, m);                                    \
+        v = _mm_or_si128(_mm_and_si128(m, _mm_srli_epi16(v, 1)),        \
+                         _mm_andnot_si128(m, v));                       \
+    } while (0)
+
+static inline __m128i alaw8(__m128i pcm) {
+    __m128i x = _mm_srai_epi16(pcm, 3);
+    __m128i neg = _mm_srai_epi16(x, 15);
+    __m128i mag = _mm_xor_si128(x, neg);                            // 负数取 -x-1
+    __m128i seg = _mm_sub_epi16(_mm_setzero_si128(),
+                                _mm_cmpgt_epi16(mag, _mm_set1_epi16(alaw_seg_end[0])));
+    __m128i v = _mm_srli_epi16(mag, 1);
+
+    for (int s = 1; s < 7; s++) {
+        G711_SEG_STEP(alaw_seg_end[s]);
+    }
+    __m128i code = _mm_or_si128(_mm_slli_epi16(seg, 4), _mm_and_si128(v, _mm_set1_epi16(0x0F)));
+    __m128i mask = _mm_xor_si128(_mm_set1_epi16(0xD5), _mm_and_si128(neg, _mm_set1_epi16(0x80)));
+    return _mm_xor_si128(code, mask);
+}
+
+static inline __m128i ulaw8(__m128i pcm) {
+    __m128i x = _mm_srai_epi16(pcm, 2);
+    __m128i neg = _mm_srai_epi16(x, 15);
+    __m128i a = _mm_sub_epi16(_mm_xor_si128(x, neg), neg);        // |x|, 最大8192
+    __m128i mag = _mm_add_epi16(_mm_min_epi16(a, _mm_set1_epi16(ULAW_CLIP - 1)),
+                                _mm_set1_epi16(ULAW_BIAS));
+    __m128i seg = _mm_setzero_si128();
+    __m128i v = _mm_srli_epi16(mag, 1);
+
+    for (int s = 0; s < 7; s++) {
+        G711_SEG_STEP(ulaw_seg_end[s]);
+    }
+    __m128i code = _mm_or_si128(_mm_slli_epi16(seg, 4), _mm_and_si128(v, _mm_set1_epi16(0x0F)));
+    __m128i mask = _mm_xor_si128(_mm_set1_epi16(0xFF), _mm_and_si128(neg, _mm_set1_epi16(0x80)));
+    return _mm_xor_si128(code, mask);
+}
+
+#define G711_ENCODE16(fn, pcm, out)                                     \
+    _mm_storeu_si128((__m128i *)(out),                                  \
+                     _mm_packus_epi16(fn(_mm_loadu_si128((const __m128i *)(pcm))), \
+                                      fn(_mm_loadu_si128((const __m128i *)((pcm) + 8)))))
+
+#endif
+
+// 16个样本先全部读入再写出, out 与 pcm 可以是同一缓冲区
+static void encode_alaw(const int16_t *pcm, uint8_t *out, uint32_t samples) {
+    uint32_t i = 0;
+
+#if defined(G711_ENCODE16)
+    for (; i + 16 <= samples; i += 16) {
+        G711_ENCODE16(alaw8, pcm + i, out + i);
+    }
+#endif
+    for (; i < samples; i++) {
+        out[i] = alaw_lut[(uint16_t)pcm[i] >> 3];
+    }
+}
+
+static void encode_ulaw(const int16_t *pcm, uint8_t *out, uint32_t samples) {
+    uint32_t i = 0;
+
+#if defined(G711_ENCODE16)
+    for (; i + 16 <= samples; i += 16) {
+        G711_ENCODE16(ulaw8, pcm + i, out + i);
+    }
+#endif
+    for (; i < samples; i++) {
+        out[i] = ulaw_lut[(uint16_t)pcm[i] >> 2];
+    }
+}
+
+int jtt1078_g711_encode(uint8_t format, const int16_t *pcm, uint8_t *out, uint32_t samples) {
+    if (!pcm || !out) {
+        return -1;
+    }
+    pthread_once(&lut_once, lut_build);
+
+    switch (format) {
+    case JTT1078_AUDIO_G711A:
+        encode_alaw(pcm, out, samples);
+        return 0;
+    case JTT1078_AUDIO_G711U:
+        encode_ulaw(pcm, out, samples);
+        return 0;
+    default:
+        return -1;
+    }
+}
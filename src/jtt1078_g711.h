@@ -0,0 +1,45 @@
+/*
+ * JT/T 1078 G.711 Audio Encoder
+ * 16位线性PCM(8kHz单声道, 即 rkipc [audio.0] 的 S16 输出)编码为 G.711 A律/μ律
+ *
+ * 批量编码每次处理16个样本: NEON (ARM) / SSE2 (x86) 用比较计数求段号,
+ * 按段号条件移位取量化值, 无分支、无查表; 其他平台及尾部样本查表
+ * (A律按高13位、μ律按高14位索引, 共24KB)。
+ * 单样本函数按 ITU-T G.711 公式逐样本计算, 作为批量编码的参考实现。
+ */
+
+#ifndef JTT1078_G711_H
+#define JTT1078_G711_H
+
+#include <stdint.h>
+#include "jtt1078_protocol.h"
+
+#define JTT1078_G711_SAMPLE_RATE    8000        // G.711 采样率
+#define JTT1078_G711_SAMPLES_PER_MS 8           // 每毫秒样本数(每样本编码为1字节)
+
+/**
+ * 单个样本编码为A律(参考实现)
+ */
+uint8_t jtt1078_g711_alaw_sample(int16_t pcm);
+
+/**
+ * 单个样本编码为μ律(参考实现)
+ */
+uint8_t jtt1078_g711_ulaw_sample(int16_t pcm);
+
+/**
+ * 批量编码PCM
+ * @param format JTT1078_AUDIO_G711A / JTT1078_AUDIO_G711U
+ * @param pcm 16位线性PCM样本
+ * @param out 输出, samples 字节(可与 pcm 指向同一缓冲区)
+ * @param samples 样本数
+ * @return 0成功, -1格式不是G.711
+ */
+int jtt1078_g711_encode(uint8_t format, const int16_t *pcm, uint8_t *out, uint32_t samples);
+
+/**
+ * 批量编码使用的指令集("neon"/"sse2"/"table")
+ */
+const char *jtt1078_g711_simd(void);
+
+#endif // JTT1078_G711_H
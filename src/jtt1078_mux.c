@@ -0,0 +1,400 @@
+/*
+ * JT/T 1078 Multiplexer
+ * 多通道复用实现
+ */
+
+#include "jtt1078_mux.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 包池中每个包占用的字节数(8字节对齐)
+static inline size_t pkt_stride(uint16_t payload_size) {
+    size_t size = sizeof(jtt1078_mux_pkt_t) + JTT1078_HEADER_SIZE + payload_size;
+    return (size + 7) & ~(size_t)7;
+}
+
+static inline uint8_t packet_prio(const uint8_t *header) {
+    uint8_t data_type = header[JTT1078_OFF_TYPE] >> 4;
+    if (data_type == JTT1078_DATA_TYPE_AUDIO) {
+        return JTT1078_MUX_PRIO_AUDIO;
+    } else if (data_type == JTT1078_DATA_TYPE_VIDEO) {
+        return JTT1078_MUX_PRIO_KEYFRAME;
+    }
+    return JTT1078_MUX_PRIO_BULK;
+}
+
+int jtt1078_mux_init(jtt1078_mux_t *mux,
+                     uint32_t pool_packets,
+                     uint16_t payload_size,
+                     int (*send_callback_v)(const struct iovec *iov, int iovcnt, void *user_data),
+                     void *user_data) {
+    if (!mux || !send_callback_v || pool_packets == 0 || payload_size == 0) {
+        return -1;
+    }
+
+    memset(mux, 0, sizeof(jtt1078_mux_t));
+
+    size_t stride = pkt_stride(payload_size);
+    mux->pool = malloc(stride * pool_packets);
+    if (!mux->pool) {
+        fprintf(stderr, "[JTT1078] Mux: failed to allocate %u-packet pool\n", pool_packets);
+        return -1;
+    }
+
+    // 建立空闲链表
+    for (uint32_t i = 0; i < pool_packets; i++) {
+        jtt1078_mux_pkt_t *pkt = (jtt1078_mux_pkt_t *)(mux->pool + i * stride);
+        pkt->next = mux->free_list;
+        mux->free_list = pkt;
+    }
+    mux->pool_free = pool_packets;
+    mux->pool_packets = pool_packets;
+    mux->payload_size = payload_size;
+    mux->send_packetv = send_callback_v;
+    mux->user_data = user_data;
+
+    pthread_mutex_init(&mux->mutex, NULL);
+    pthread_cond_init(&mux->cond, NULL);
+    return 0;
+}
+
+// 通道编码器的iovec回调: 整帧拷入包池并挂到通道队列
+// 包池不足时整帧丢弃(返回0, 帧丢弃不视为连接错误)
+static int mux_enqueue(const struct iovec *iov, int iovcnt, void *user_data) {
+    jtt1078_mux_channel_t *ch = (jtt1078_mux_channel_t *)user_data;
+    jtt1078_mux_t *mux = ch->mux;
+
+    // 统计包数: 每包一个头部iovec, 数据体长度非0时后跟负载iovec
+    uint32_t npackets = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const uint8_t *hdr = iov[i].iov_base;
+        uint16_t len = (uint16_t)((hdr[JTT1078_OFF_LENGTH] << 8) | hdr[JTT1078_OFF_LENGTH + 1]);
+        if (len > 0) i++;
+        npackets++;
+    }
+    if (npackets == 0) {
+        return 0;
+    }
+
+    const uint8_t *first = iov[0].iov_base;
+    uint8_t prio = packet_prio(first);
+    bool video = (first[JTT1078_OFF_TYPE] >> 4) <= JTT1078_DATA_TYPE_VIDEO_B;
+
+    pthread_mutex_lock(&mux->mutex);
+
+    // 断线期间不排队, 视频通道恢复后从I帧开始
+    if (mux->failed) {
+        if (video) ch->dropping = true;
+        ch->stats.frames_dropped++;
+        pthread_mutex_unlock(&mux->mutex);
+        return 0;
+    }
+    if (prio == JTT1078_MUX_PRIO_KEYFRAME) {
+        ch->dropping = false;
+    }
+    if ((video && ch->dropping) || mux->pool_free < npackets) {
+        if (video) ch->dropping = true;
+        ch->stats.frames_dropped++;
+        pthread_mutex_unlock(&mux->mutex);
+        return 0;
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        jtt1078_mux_pkt_t *pkt = mux->free_list;
+        mux->free_list = pkt->next;
+        mux->pool_free--;
+
+        const uint8_t *hdr = iov[i].iov_base;
+        uint16_t len = (uint16_t)((hdr[JTT1078_OFF_LENGTH] << 8) | hdr[JTT1078_OFF_LENGTH + 1]);
+        memcpy(pkt->data, hdr, JTT1078_HEADER_SIZE);
+        if (len > 0) {
+            i++;
+            memcpy(pkt->data + JTT1078_HEADER_SIZE, iov[i].iov_base, len);
+        }
+        pkt->len = JTT1078_HEADER_SIZE + len;
+        pkt->prio = prio;
+        pkt->next = NULL;
+
+        if (ch->tail) {
+            ch->tail->next = pkt;
+        } else {
+            ch->head = pkt;
+        }
+        ch->tail = pkt;
+        ch->stats.queued_packets++;
+    }
+    ch->stats.frames_queued++;
+
+    pthread_cond_signal(&mux->cond);
+    pthread_mutex_unlock(&mux->mutex);
+    return 0;
+}
+
+jtt1078_encoder_t *jtt1078_mux_add_channel(jtt1078_mux_t *mux,
+                                           const char *sim_number,
+                                           uint8_t channel,
+                                           uint8_t video_format,
+                                           uint32_t weight) {
+    if (!mux || mux->nchannels >= JTT1078_MUX_MAX_CHANNELS) {
+        return NULL;
+    }
+
+    jtt1078_mux_channel_t *ch = &mux->channels[mux->nchannels];
+    memset(ch, 0, sizeof(jtt1078_mux_channel_t));
+    ch->mux = mux;
+    ch->weight = weight ? weight : 1;
+
+    if (jtt1078_encoder_init_iov(&ch->encoder, sim_number, channel, video_format,
+                                 mux_enqueue, ch) < 0 ||
+        jtt1078_encoder_set_payload_size(&ch->encoder, mux->payload_size) < 0 ||
+        jtt1078_encoder_enable_batch(&ch->encoder, mux->payload_size) < 0) {
+        jtt1078_encoder_deinit(&ch->encoder);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&mux->mutex);
+    mux->nchannels++;
+    pthread_mutex_unlock(&mux->mutex);
+    return &ch->encoder;
+}
+
+// 选出下一个要发送的包所在通道, 调用方持有锁
+static jtt1078_mux_channel_t *schedule(jtt1078_mux_t *mux) {
+    uint8_t best = JTT1078_MUX_PRIO_LEVELS;
+
+    for (int i = 0; i < mux->nchannels; i++) {
+        jtt1078_mux_pkt_t *head = mux->channels[i].head;
+        if (head && head->prio < best) {
+            best = head->prio;
+        }
+    }
+    if (best == JTT1078_MUX_PRIO_LEVELS) {
+        return NULL;
+    }
+
+    // 同优先级内DRR: 差额不足的通道补充配额后让给下一个通道
+    for (;;) {
+        jtt1078_mux_channel_t *ch = &mux->channels[mux->rr_cursor];
+        if (ch->head && ch->head->prio == best) {
+            if (ch->deficit >= (int64_t)ch->head->len) {
+                ch->deficit -= ch->head->len;
+                return ch;
+            }
+            ch->deficit += (int64_t)JTT1078_MUX_QUANTUM * ch->weight;
+        }
+        mux->rr_cursor = (mux->rr_cursor + 1) % mux->nchannels;
+    }
+}
+
+static inline void pkt_free(jtt1078_mux_t *mux, jtt1078_mux_pkt_t *pkt) {
+    pkt->next = mux->free_list;
+    mux->free_list = pkt;
+    mux->pool_free++;
+}
+
+// 发送失败: 进入失败状态, 清空各通道队列并等待I帧, 调用方持有锁
+static void mux_fail(jtt1078_mux_t *mux) {
+    uint32_t purged = 0;
+
+    mux->failed = true;
+    mux->send_errors++;
+    for (int i = 0; i < mux->nchannels; i++) {
+        jtt1078_mux_channel_t *ch = &mux->channels[i];
+        while (ch->head) {
+            jtt1078_mux_pkt_t *pkt = ch->head;
+            ch->head = pkt->next;
+            uint8_t sub = pkt->data[JTT1078_OFF_TYPE] & 0x0F;
+            if (sub == JTT1078_PKT_ATOMIC || sub == JTT1078_PKT_LAST) {
+                ch->stats.frames_dropped++;
+            }
+            if ((pkt->data[JTT1078_OFF_TYPE] >> 4) <= JTT1078_DATA_TYPE_VIDEO_B) {
+                ch->dropping = true;
+            }
+            pkt_free(mux, pkt);
+            purged++;
+        }
+        ch->tail = NULL;
+        ch->deficit = 0;
+        ch->stats.queued_packets = 0;
+    }
+
+    // 每秒最多打印一次
+    uint64_t now = jtt1078_get_monotonic_ms();
+    if (mux->last_error_ms && now - mux->last_error_ms < 1000) {
+        mux->errors_suppressed++;
+        return;
+    }
+    fprintf(stderr, "[JTT1078] Mux: send failed, %u queued packets purged (%u earlier failures "
+                    "suppressed), waiting for resume\n", purged, mux->errors_suppressed);
+    mux->last_error_ms = now;
+    mux->errors_suppressed = 0;
+}
+
+int jtt1078_mux_pump(jtt1078_mux_t *mux, int max_packets) {
+    jtt1078_mux_pkt_t *batch[JTT1078_MUX_BATCH_PACKETS];
+    struct iovec iov[JTT1078_MUX_BATCH_PACKETS];
+    jtt1078_mux_channel_t *owner[JTT1078_MUX_BATCH_PACKETS];
+    int n = 0;
+
+    if (max_packets > JTT1078_MUX_BATCH_PACKETS) {
+        max_packets = JTT1078_MUX_BATCH_PACKETS;
+    }
+
+    pthread_mutex_lock(&mux->mutex);
+    if (mux->failed) {
+        pthread_mutex_unlock(&mux->mutex);
+        return -1;
+    }
+    while (n < max_packets) {
+        jtt1078_mux_channel_t *ch = schedule(mux);
+        if (!ch) break;
+
+        jtt1078_mux_pkt_t *pkt = ch->head;
+        ch->head = pkt->next;
+        if (!ch->head) {
+            ch->tail = NULL;
+            ch->deficit = 0;    // 队列空时清零, 避免积攒配额
+        }
+        ch->stats.queued_packets--;
+
+        batch[n] = pkt;
+        owner[n] = ch;
+        iov[n].iov_base = pkt->data;
+        iov[n].iov_len = pkt->len;
+        n++;
+    }
+    pthread_mutex_unlock(&mux->mutex);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    // 已出队的包不再被生产者访问, 发送期间无需持锁
+    int ret = mux->send_packetv(iov, n, mux->user_data);
+
+    pthread_mutex_lock(&mux->mutex);
+    for (int i = 0; i < n; i++) {
+        if (ret >= 0) {
+            owner[i]->stats.packets_sent++;
+            owner[i]->stats.bytes_sent += batch[i]->len;
+        }
+        pkt_free(mux, batch[i]);
+    }
+    if (ret < 0) {
+        mux_fail(mux);
+    }
+    pthread_mutex_unlock(&mux->mutex);
+
+    return ret < 0 ? -1 : n;
+}
+
+static bool has_pending(jtt1078_mux_t *mux) {
+    return mux->pool_free < mux->pool_packets;
+}
+
+static void *mux_thread(void *arg) {
+    jtt1078_mux_t *mux = (jtt1078_mux_t *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&mux->mutex);
+        // 失败状态下不再发送, 等待 jtt1078_mux_resume
+        while (mux->running && (mux->failed || !has_pending(mux))) {
+            pthread_cond_wait(&mux->cond, &mux->mutex);
+        }
+        bool running = mux->running;
+        pthread_mutex_unlock(&mux->mutex);
+
+        if (!running) break;
+
+        jtt1078_mux_pump(mux, JTT1078_MUX_BATCH_PACKETS);
+    }
+
+    return NULL;
+}
+
+void jtt1078_mux_resume(jtt1078_mux_t *mux) {
+    if (!mux) {
+        return;
+    }
+
+    // 等待I帧的视频通道, 解锁后请求关键帧
+    uint32_t need_keyframe = 0;
+    pthread_mutex_lock(&mux->mutex);
+    if (mux->failed) {
+        for (int i = 0; i < mux->nchannels; i++) {
+            if (mux->channels[i].dropping) {
+                need_keyframe |= 1u << i;
+            }
+        }
+    }
+    mux->failed = false;
+    pthread_cond_signal(&mux->cond);
+    pthread_mutex_unlock(&mux->mutex);
+
+    for (int i = 0; i < mux->nchannels; i++) {
+        jtt1078_encoder_t *encoder = &mux->channels[i].encoder;
+        if ((need_keyframe & (1u << i)) && encoder->request_keyframe) {
+            encoder->request_keyframe(encoder->keyframe_user_data);
+        }
+    }
+}
+
+bool jtt1078_mux_failed(jtt1078_mux_t *mux) {
+    pthread_mutex_lock(&mux->mutex);
+    bool failed = mux->failed;
+    pthread_mutex_unlock(&mux->mutex);
+    return failed;
+}
+
+int jtt1078_mux_start(jtt1078_mux_t *mux) {
+    if (!mux || mux->running) {
+        return -1;
+    }
+
+    mux->running = true;
+    if (pthread_create(&mux->thread, NULL, mux_thread, mux) != 0) {
+        mux->running = false;
+        return -1;
+    }
+    return 0;
+}
+
+void jtt1078_mux_stop(jtt1078_mux_t *mux) {
+    if (!mux || !mux->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&mux->mutex);
+    mux->running = false;
+    pthread_cond_broadcast(&mux->cond);
+    pthread_mutex_unlock(&mux->mutex);
+    pthread_join(mux->thread, NULL);
+}
+
+int jtt1078_mux_get_channel_stats(jtt1078_mux_t *mux, int index,
+                                  jtt1078_mux_channel_stats_t *out) {
+    if (!mux || !out || index < 0 || index >= mux->nchannels) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&mux->mutex);
+    *out = mux->channels[index].stats;
+    pthread_mutex_unlock(&mux->mutex);
+    return 0;
+}
+
+void jtt1078_mux_destroy(jtt1078_mux_t *mux) {
+    if (!mux || !mux->pool) {
+        return;
+    }
+
+    jtt1078_mux_stop(mux);
+    for (int i = 0; i < mux->nchannels; i++) {
+        jtt1078_encoder_deinit(&mux->channels[i].encoder);
+    }
+    free(mux->pool);
+    mux->pool = NULL;
+    pthread_mutex_destroy(&mux->mutex);
+    pthread_cond_destroy(&mux->cond);
+}
@@ -0,0 +1,151 @@
+/*
+ * JT/T 1078 Multiplexer
+ * 多个逻辑通道(视频/音频/透传)复用一条连接
+ *
+ * 每个逻辑通道持有自己的 jtt1078_encoder_t, 其 iovec 回调把整帧分包
+ * 拷入复用器的包池(预分配, 无逐包分配)。发送线程按包调度:
+ *   1. 严格优先级: 音频 > I帧 > P/B帧与透传数据 (按各通道队首包判断)
+ *   2. 同一优先级内按权重做差额轮询(DRR, 以字节计)
+ * 同一通道内的包保持原顺序, 保证服务端按通道重组分包。
+ * 包池不足时整帧丢弃, 视频通道随后丢弃P/B帧直到下一个I帧。
+ * 发送失败(断线)后停止发送: 清空各通道队列(队列末尾总是帧边界), 视频通道
+ * 等待下一个I帧, 期间入队的帧直接丢弃; 调用方重连后以 jtt1078_mux_resume 恢复。
+ */
+
+#ifndef JTT1078_MUX_H
+#define JTT1078_MUX_H
+
+#include "jtt1078_protocol.h"
+#include <pthread.h>
+
+#define JTT1078_MUX_MAX_CHANNELS    8           // 最大逻辑通道数
+#define JTT1078_MUX_BATCH_PACKETS   32          // 每次 writev 的最大包数
+#define JTT1078_MUX_QUANTUM         JTT1078_MAX_PACKET_SIZE // DRR 基础配额(字节)
+
+// 调度优先级(数值越小越优先)
+#define JTT1078_MUX_PRIO_AUDIO      0
+#define JTT1078_MUX_PRIO_KEYFRAME   1
+#define JTT1078_MUX_PRIO_BULK       2
+#define JTT1078_MUX_PRIO_LEVELS     3
+
+// 包池中的一个包
+typedef struct jtt1078_mux_pkt {
+    struct jtt1078_mux_pkt *next;
+    uint32_t len;               // 头部+负载长度
+    uint8_t  prio;              // 调度优先级
+    uint8_t  data[];            // 线上格式的完整包
+} jtt1078_mux_pkt_t;
+
+// 通道统计
+typedef struct {
+    uint64_t packets_sent;
+    uint64_t bytes_sent;
+    uint64_t frames_queued;
+    uint64_t frames_dropped;    // 包池不足、等待I帧或断线清空而丢弃的帧数
+    uint32_t queued_packets;    // 当前排队包数
+} jtt1078_mux_channel_stats_t;
+
+struct jtt1078_mux;
+
+// 逻辑通道
+typedef struct {
+    jtt1078_encoder_t encoder;  // 通道编码器, 生产者直接调用 jtt1078_encode_*
+    struct jtt1078_mux *mux;
+    uint32_t weight;            // DRR 权重
+    int64_t deficit;            // DRR 差额(字节)
+    jtt1078_mux_pkt_t *head;
+    jtt1078_mux_pkt_t *tail;
+    bool dropping;              // 丢帧状态: 丢弃P/B帧直到下一个I帧
+    jtt1078_mux_channel_stats_t stats;
+} jtt1078_mux_channel_t;
+
+// 复用器
+typedef struct jtt1078_mux {
+    jtt1078_mux_channel_t channels[JTT1078_MUX_MAX_CHANNELS];
+    int nchannels;
+    int rr_cursor;              // DRR 轮询位置
+
+    // 包池
+    uint8_t *pool;
+    jtt1078_mux_pkt_t *free_list;
+    uint32_t pool_free;
+    uint32_t pool_packets;
+    uint16_t payload_size;
+
+    // 连接发送回调
+    int (*send_packetv)(const struct iovec *iov, int iovcnt, void *user_data);
+    void *user_data;
+    uint64_t send_errors;
+    bool     failed;            // 发送失败, 等待 jtt1078_mux_resume
+    uint64_t last_error_ms;     // 上次打印发送失败的时刻(限频)
+    uint32_t errors_suppressed; // 限频期间未打印的失败次数
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool running;
+} jtt1078_mux_t;
+
+/**
+ * 初始化复用器
+ * @param mux 复用器
+ * @param pool_packets 包池容量(包数), 决定所有通道共享的排队上限
+ * @param payload_size 每包最大负载, 所有通道的编码器按此分包
+ * @param send_callback_v 连接的iovec发送回调
+ * @param user_data 回调用户数据
+ * @return 0成功, -1失败
+ */
+int jtt1078_mux_init(jtt1078_mux_t *mux,
+                     uint32_t pool_packets,
+                     uint16_t payload_size,
+                     int (*send_callback_v)(const struct iovec *iov, int iovcnt, void *user_data),
+                     void *user_data);
+
+/**
+ * 添加逻辑通道
+ * @param weight DRR 权重(>=1), 同优先级下按权重分配带宽
+ * @return 通道编码器(对其调用 jtt1078_encode_video_frame 等入队), 失败返回NULL
+ */
+jtt1078_encoder_t *jtt1078_mux_add_channel(jtt1078_mux_t *mux,
+                                           const char *sim_number,
+                                           uint8_t channel,
+                                           uint8_t video_format,
+                                           uint32_t weight);
+
+/**
+ * 调度并发送最多 max_packets 个包(一次 writev)
+ * 可由调用方自行驱动, 或使用 jtt1078_mux_start 启动的发送线程
+ * @return 发送的包数, 0表示无数据, -1发送失败或处于失败状态
+ */
+int jtt1078_mux_pump(jtt1078_mux_t *mux, int max_packets);
+
+/**
+ * 连接已恢复: 清除失败状态, 继续发送; 向视频通道请求关键帧
+ * (已设置 jtt1078_encoder_set_keyframe_callback 时)
+ */
+void jtt1078_mux_resume(jtt1078_mux_t *mux);
+
+/**
+ * 是否处于发送失败状态(等待 jtt1078_mux_resume)
+ */
+bool jtt1078_mux_failed(jtt1078_mux_t *mux);
+
+/**
+ * 启动/停止发送线程
+ */
+int jtt1078_mux_start(jtt1078_mux_t *mux);
+void jtt1078_mux_stop(jtt1078_mux_t *mux);
+
+/**
+ * 获取通道统计
+ * @param index 通道索引(按添加顺序)
+ */
+int jtt1078_mux_get_channel_stats(jtt1078_mux_t *mux, int index,
+                                  jtt1078_mux_channel_stats_t *out);
+
+/**
+ * 释放复用器资源(先停止发送线程)
+ */
+void jtt1078_mux_destroy(jtt1078_mux_t *mux);
+
+#endif // JTT1078_MUX_H
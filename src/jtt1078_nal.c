@@ -0,0 +1,384 @@
+/*
+ * H.264/H.265 Annex-B NAL Scanner
+ * NAL 扫描实现
+ */
+
+#include "jtt1078_nal.h"
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define NAL_SCAN_NEON   1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define NAL_SCAN_SSE2   1
+#endif
+
+// 标量查找: 以 p[2] 为探针, 不可能构成起始码时一次跳过3字节
+static const uint8_t *find_start_code_scalar(const uint8_t *p, const uint8_t *end) {
+    while (p + 2 < end) {
+        if (p[2] > 1) {
+            p += 3;
+        } else if (p[1]) {
+            p += 2;
+        } else if (p[0] || p[2] != 1) {
+            p += 1;
+        } else {
+            return p;
+        }
+    }
+    return end;
+}
+
+const uint8_t *jtt1078_find_start_code(const uint8_t *p, const uint8_t *end) {
+#if defined(NAL_SCAN_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+
+    // 每次检查16个起点: p[i]==0 && p[i+1]==0 && p[i+2]==1
+    while (p + 18 <= end) {
+        uint8x16_t a = vld1q_u8(p);
+        uint8x16_t b = vld1q_u8(p + 1);
+        uint8x16_t c = vld1q_u8(p + 2);
+        uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(a, zero), vceqq_u8(b, zero)),
+                                vceqq_u8(c, one));
+        uint64x2_t m64 = vreinterpretq_u64_u8(m);
+        if (vgetq_lane_u64(m64, 0) | vgetq_lane_u64(m64, 1)) {
+            // 命中块内用标量定位(范围限定在本块的16个起点)
+            return find_start_code_scalar(p, p + 18);
+        }
+        p += 16;
+    }
+#elif defined(NAL_SCAN_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+
+    while (p + 18 <= end) {
+        __m128i a = _mm_loadu_si128((const __m128i *)p);
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + 1));
+        __m128i c = _mm_loadu_si128((const __m128i *)(p + 2));
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(a, zero),
+                                                _mm_cmpeq_epi8(b, zero)),
+                                  _mm_cmpeq_epi8(c, one));
+        int mask = _mm_movemask_epi8(m);
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    return find_start_code_scalar(p, end);
+}
+
+const char *jtt1078_nal_scanner_impl(void) {
+#if defined(NAL_SCAN_NEON)
+    return "neon";
+#elif defined(NAL_SCAN_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/*
+ * slice 头解析用的位读取器(跳过防竞争字节 00 00 03)
+ */
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint32_t cache;
+    int bits;
+    int zeros;
+} bitreader_t;
+
+static int br_byte(bitreader_t *br) {
+    while (br->p < br->end) {
+        uint8_t b = *br->p++;
+        if (br->zeros >= 2 && b == 0x03) {
+            br->zeros = 0;
+            continue;
+        }
+        br->zeros = b ? 0 : br->zeros + 1;
+        return b;
+    }
+    return -1;
+}
+
+static int br_bit(bitreader_t *br) {
+    if (br->bits == 0) {
+        int b = br_byte(br);
+        if (b < 0) return -1;
+        br->cache = (uint32_t)b;
+        br->bits = 8;
+    }
+    br->bits--;
+    return (br->cache >> br->bits) & 1;
+}
+
+// 指数哥伦布码 ue(v)
+static int32_t br_ue(bitreader_t *br) {
+    int lz = 0;
+    int b;
+    while ((b = br_bit(br)) == 0) {
+        if (++lz > 30) return -1;
+    }
+    if (b < 0) return -1;
+
+    uint32_t v = 0;
+    for (int i = 0; i < lz; i++) {
+        if ((b = br_bit(br)) < 0) return -1;
+        v = (v << 1) | (uint32_t)b;
+    }
+    return (int32_t)((1u << lz) - 1 + v);
+}
+
+// 从 slice 头读取 slice_type, 转换为 JT/T 1078 数据类型
+static uint8_t parse_slice_type(const uint8_t *nal, uint32_t size, uint8_t video_format, uint8_t nal_type) {
+    bitreader_t br = { .p = nal, .end = nal + size };
+    int32_t slice_type;
+
+    if (video_format == JTT1078_VIDEO_H265) {
+        br.p += 2;  // NAL 头2字节
+        int first_slice = br_bit(&br);
+        if (first_slice != 1) {
+            // 非首个 slice segment 需要 PPS/SPS 才能定位 slice_type
+            return 0xFF;
+        }
+        if (nal_type >= 16 && nal_type <= 23) {
+            br_bit(&br);            // no_output_of_prior_pics_flag
+        }
+        br_ue(&br);                 // slice_pic_parameter_set_id
+        // 假定 num_extra_slice_header_bits == 0 (常见编码器默认)
+        slice_type = br_ue(&br);    // 0=B, 1=P, 2=I
+        switch (slice_type) {
+        case 0: return JTT1078_DATA_TYPE_VIDEO_B;
+        case 1: return JTT1078_DATA_TYPE_VIDEO_P;
+        case 2: return JTT1078_DATA_TYPE_VIDEO;
+        default: return 0xFF;
+        }
+    }
+
+    br.p += 1;                      // NAL 头1字节
+    br_ue(&br);                     // first_mb_in_slice
+    slice_type = br_ue(&br);        // 0/5=P, 1/6=B, 2/7=I, 3/8=SP, 4/9=SI
+    if (slice_type < 0) {
+        return 0xFF;
+    }
+    switch (slice_type % 5) {
+    case 1:  return JTT1078_DATA_TYPE_VIDEO_B;
+    case 2:
+    case 4:  return JTT1078_DATA_TYPE_VIDEO;
+    default: return JTT1078_DATA_TYPE_VIDEO_P;
+    }
+}
+
+// NAL 分类
+static void classify(const uint8_t *nal, uint32_t size, uint8_t video_format, jtt1078_nal_t *out) {
+    out->slice_type = 0xFF;
+
+    if (video_format == JTT1078_VIDEO_H265) {
+        uint8_t type = (nal[0] >> 1) & 0x3F;
+        out->type = type;
+        if (type <= 9) {
+            out->kind = JTT1078_NAL_SLICE;
+        } else if (type >= 16 && type <= 20) {
+            out->kind = JTT1078_NAL_IDR;    // BLA_W_LP..IDR_N_LP
+        } else if (type == 21) {
+            out->kind = JTT1078_NAL_CRA;
+        } else if (type == 32) {
+            out->kind = JTT1078_NAL_VPS;
+        } else if (type == 33) {
+            out->kind = JTT1078_NAL_SPS;
+        } else if (type == 34) {
+            out->kind = JTT1078_NAL_PPS;
+        } else if (type == 35) {
+            out->kind = JTT1078_NAL_AUD;
+        } else if (type == 39 || type == 40) {
+            out->kind = JTT1078_NAL_SEI;
+        } else {
+            out->kind = JTT1078_NAL_OTHER;
+        }
+        if (size < 3) {
+            return;
+        }
+    } else {
+        uint8_t type = nal[0] & 0x1F;
+        out->type = type;
+        switch (type) {
+        case 1:  out->kind = JTT1078_NAL_SLICE; break;
+        case 5:  out->kind = JTT1078_NAL_IDR; break;
+        case 6:  out->kind = JTT1078_NAL_SEI; break;
+        case 7:  out->kind = JTT1078_NAL_SPS; break;
+        case 8:  out->kind = JTT1078_NAL_PPS; break;
+        case 9:  out->kind = JTT1078_NAL_AUD; break;
+        default: out->kind = JTT1078_NAL_OTHER; break;
+        }
+        if (size < 2) {
+            return;
+        }
+    }
+
+    if (out->kind == JTT1078_NAL_SLICE || out->kind == JTT1078_NAL_IDR ||
+        out->kind == JTT1078_NAL_CRA) {
+        out->slice_type = parse_slice_type(nal, size, video_format, out->type);
+    }
+}
+
+// 迭代下一个 NAL, pos 为当前查找位置; 返回0成功, -1结束
+static int next_nal(const uint8_t *data, const uint8_t *end, const uint8_t **pos,
+                    uint8_t video_format, jtt1078_nal_t *out) {
+    const uint8_t *sc = jtt1078_find_start_code(*pos, end);
+
+    while (sc < end) {
+        const uint8_t *nal = sc + 3;
+        const uint8_t *next = jtt1078_find_start_code(nal, end);
+        const uint8_t *nal_end = next;
+
+        // 去掉尾随零字节(包括下一个4字节起始码的前导零)
+        while (nal_end > nal && nal_end[-1] == 0) {
+            nal_end--;
+        }
+
+        if (nal_end > nal) {
+            out->offset = (uint32_t)(nal - data);
+            out->size = (uint32_t)(nal_end - nal);
+            out->start_code_len = (sc > data && sc[-1] == 0) ? 4 : 3;
+            classify(nal, out->size, video_format, out);
+            *pos = next;
+            return 0;
+        }
+        sc = next;
+    }
+
+    *pos = end;
+    return -1;
+}
+
+int jtt1078_nal_scan(const uint8_t *data, uint32_t size, uint8_t video_format,
+                     jtt1078_nal_t *out, int max) {
+    if (!data) {
+        return -1;
+    }
+
+    const uint8_t *end = data + size;
+    const uint8_t *pos = data;
+    jtt1078_nal_t nal;
+    int count = 0;
+
+    while (next_nal(data, end, &pos, video_format, &nal) == 0) {
+        if (out && count < max) {
+            out[count] = nal;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+// 是否为图像数据(VCL) NAL
+static inline bool is_vcl(const uint8_t *nal, uint8_t video_format) {
+    if (video_format == JTT1078_VIDEO_H265) {
+        return ((nal[0] >> 1) & 0x3F) < 32;
+    }
+    uint8_t type = nal[0] & 0x1F;
+    return type >= 1 && type <= 5;
+}
+
+int jtt1078_nal_scan_prefix(const uint8_t *data, uint32_t size, uint8_t video_format,
+                            jtt1078_nal_t *out, int max) {
+    if (!data || !out) {
+        return -1;
+    }
+
+    const uint8_t *end = data + size;
+    const uint8_t *sc = jtt1078_find_start_code(data, end);
+    int count = 0;
+
+    while (sc < end && count < max) {
+        const uint8_t *nal = sc + 3;
+        if (nal >= end) {
+            break;
+        }
+
+        jtt1078_nal_t *n = &out[count];
+        n->offset = (uint32_t)(nal - data);
+        n->start_code_len = (sc > data && sc[-1] == 0) ? 4 : 3;
+
+        if (is_vcl(nal, video_format)) {
+            // slice 数据不再扫描, 长度记为到缓冲区末尾
+            n->size = (uint32_t)(end - nal);
+            classify(nal, n->size, video_format, n);
+            count++;
+            break;
+        }
+
+        const uint8_t *next = jtt1078_find_start_code(nal, end);
+        const uint8_t *nal_end = next;
+        while (nal_end > nal && nal_end[-1] == 0) {
+            nal_end--;
+        }
+        if (nal_end > nal) {
+            n->size = (uint32_t)(nal_end - nal);
+            classify(nal, n->size, video_format, n);
+            count++;
+        }
+        sc = next;
+    }
+
+    return count;
+}
+
+int jtt1078_nal_frame_type(const uint8_t *data, uint32_t size, uint8_t video_format,
+                           bool *is_keyframe) {
+    bool param_sets = false;
+    jtt1078_nal_t nal;
+
+    if (is_keyframe) *is_keyframe = false;
+    if (!data) {
+        return -1;
+    }
+
+    // 只看每个起始码后的NAL头: 图像 slice 直接返回, 不查找其结尾(不扫描 slice 数据)
+    const uint8_t *end = data + size;
+    const uint8_t *sc = jtt1078_find_start_code(data, end);
+    while (sc < end) {
+        const uint8_t *nal_start = sc + 3;
+        if (nal_start >= end) {
+            break;
+        }
+
+        // 空NAL: 起始码后紧跟下一个起始码或尾随零(H.265 NAL头第二字节不为0)
+        if (nal_start[0] == 0 && (nal_start + 1 >= end || nal_start[1] == 0)) {
+            sc = jtt1078_find_start_code(nal_start, end);
+            continue;
+        }
+
+        classify(nal_start, (uint32_t)(end - nal_start), video_format, &nal);
+        switch (nal.kind) {
+        case JTT1078_NAL_IDR:
+        case JTT1078_NAL_CRA:
+            if (is_keyframe) *is_keyframe = true;
+            return JTT1078_DATA_TYPE_VIDEO;
+        case JTT1078_NAL_SLICE:
+            return nal.slice_type == 0xFF ? JTT1078_DATA_TYPE_VIDEO_P : nal.slice_type;
+        case JTT1078_NAL_VPS:
+        case JTT1078_NAL_SPS:
+        case JTT1078_NAL_PPS:
+            param_sets = true;
+            break;
+        default:
+            break;
+        }
+
+        // 非图像单元(参数集/SEI/AUD)很短, 查找下一个起始码
+        sc = jtt1078_find_start_code(nal_start + 1, end);
+    }
+
+    // 单独的参数集(VENC 分包输出)归入随后的关键帧
+    if (param_sets) {
+        if (is_keyframe) *is_keyframe = true;
+        return JTT1078_DATA_TYPE_VIDEO;
+    }
+    return -1;
+}
@@ -0,0 +1,82 @@
+/*
+ * H.264/H.265 Annex-B NAL Scanner
+ * Annex-B 码流 NAL 单元扫描与帧类型识别
+ *
+ * 起始码查找使用 NEON (ARM) / SSE2 (x86) 每次比较16字节, 其他平台用标量实现。
+ * 扫描结果只记录偏移和长度, 不拷贝数据。
+ */
+
+#ifndef JTT1078_NAL_H
+#define JTT1078_NAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "jtt1078_protocol.h"
+
+// NAL 单元分类(与编码格式无关)
+#define JTT1078_NAL_OTHER       0
+#define JTT1078_NAL_SLICE       1           // 非IRAP图像的slice
+#define JTT1078_NAL_IDR         2           // IDR (H.264/H.265), BLA (H.265)
+#define JTT1078_NAL_CRA         3           // CRA (H.265)
+#define JTT1078_NAL_VPS         4
+#define JTT1078_NAL_SPS         5
+#define JTT1078_NAL_PPS         6
+#define JTT1078_NAL_SEI         7
+#define JTT1078_NAL_AUD         8
+
+// NAL 单元索引项
+typedef struct {
+    uint32_t offset;            // NAL 头在缓冲区中的偏移(起始码之后)
+    uint32_t size;              // NAL 长度(不含起始码和尾随零字节)
+    uint8_t  start_code_len;    // 起始码长度(3或4)
+    uint8_t  type;              // nal_unit_type
+    uint8_t  kind;              // 分类 JTT1078_NAL_*
+    uint8_t  slice_type;        // slice 类型(JTT1078_DATA_TYPE_VIDEO/_P/_B), 非slice为0xFF
+} jtt1078_nal_t;
+
+/**
+ * 查找起始码 00 00 01
+ * @param p 查找起点
+ * @param end 缓冲区末尾
+ * @return 指向起始码首字节的指针, 未找到返回 end
+ */
+const uint8_t *jtt1078_find_start_code(const uint8_t *p, const uint8_t *end);
+
+/**
+ * 扫描 Annex-B 码流, 建立 NAL 索引
+ * @param data 码流数据
+ * @param size 数据长度
+ * @param video_format JTT1078_VIDEO_H264 或 JTT1078_VIDEO_H265
+ * @param out 输出索引数组
+ * @param max 索引数组容量
+ * @return NAL 数量(超过 max 时只填充前 max 项, 返回值仍为实际总数)
+ */
+int jtt1078_nal_scan(const uint8_t *data, uint32_t size, uint8_t video_format,
+                     jtt1078_nal_t *out, int max);
+
+/**
+ * 扫描帧起始处的非图像单元(参数集/SEI/AUD), 到第一个 slice 为止
+ * 不扫描 slice 数据, 用于从关键帧中提取参数集。
+ * 第一个 slice 也计入输出, 其 size 为到缓冲区末尾的长度。
+ * @return 填充的 NAL 数量(不超过 max), -1参数错误
+ */
+int jtt1078_nal_scan_prefix(const uint8_t *data, uint32_t size, uint8_t video_format,
+                            jtt1078_nal_t *out, int max);
+
+/**
+ * 根据码流判断帧类型
+ * 含 IDR/BLA/CRA 的为关键帧; 否则按第一个 slice 的 slice_type 判断I/P/B。
+ * 只读取各起始码后的NAL头, 遇到第一个图像 slice 即返回, 不扫描 slice 数据,
+ * 耗时与帧大小无关(参数集/SEI 之间仍查找起始码)。
+ * @param is_keyframe 输出是否为随机接入点, 可为NULL
+ * @return JTT1078_DATA_TYPE_VIDEO / _VIDEO_P / _VIDEO_B, 无 slice 时返回 -1
+ */
+int jtt1078_nal_frame_type(const uint8_t *data, uint32_t size, uint8_t video_format,
+                           bool *is_keyframe);
+
+/**
+ * 使用的起始码查找实现名称("neon" / "sse2" / "scalar")
+ */
+const char *jtt1078_nal_scanner_impl(void);
+
+#endif // JTT1078_NAL_H
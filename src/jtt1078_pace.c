@@ -0,0 +1,201 @@
+/*
+ * JT/T 1078 Send Pacer
+ * 令牌桶 / SO_MAX_PACING_RATE 发送节奏控制实现
+ */
+
+#include "jtt1078_pace.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#ifndef SO_MAX_PACING_RATE
+#define SO_MAX_PACING_RATE      47          // asm-generic/socket.h, 旧工具链头文件缺少
+#endif
+
+#define PACE_KERNEL_STEP_PCT    12          // 内核速率变化不足该比例时不重新设置
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int jtt1078_pacer_init(jtt1078_pacer_t *pacer, uint8_t fraction_pct, uint32_t burst_bytes) {
+    if (!pacer || fraction_pct == 0 || fraction_pct > 100) {
+        return -1;
+    }
+
+    memset(pacer, 0, sizeof(jtt1078_pacer_t));
+    pacer->fraction_pct = fraction_pct;
+    pacer->burst_bytes = burst_bytes ? burst_bytes : 4 * JTT1078_MAX_PACKET_SIZE;
+    pacer->min_rate = JTT1078_PACE_MIN_RATE;
+    pacer->interval_ms = JTT1078_PACE_DEFAULT_INTERVAL;
+    pacer->fd = -1;
+    pacer->rate = pacer->min_rate;
+    pacer->tokens = pacer->burst_bytes;
+    pacer->last_us = now_us();
+    return 0;
+}
+
+void jtt1078_pacer_set_max_rate(jtt1078_pacer_t *pacer, uint32_t max_rate) {
+    if (!pacer) {
+        return;
+    }
+    pacer->max_rate = max_rate && max_rate < pacer->min_rate ? pacer->min_rate : max_rate;
+}
+
+void jtt1078_pacer_deinit(jtt1078_pacer_t *pacer) {
+    (void)pacer;
+}
+
+static int set_kernel_rate(int fd, uint32_t rate) {
+    return setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate));
+}
+
+int jtt1078_pacer_set_socket(jtt1078_pacer_t *pacer, int fd) {
+    if (!pacer) {
+        return 0;
+    }
+
+    int type = 0;
+    socklen_t len = sizeof(type);
+    pacer->fd = fd;
+    pacer->kernel = false;
+    pacer->kernel_rate = 0;
+    pacer->kernel_busy_us = 0;
+
+    // 新连接先不限速, 第一帧开始时按帧设置
+    if (fd >= 0 && getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0 &&
+        type == SOCK_STREAM && set_kernel_rate(fd, ~0U) == 0) {
+        pacer->kernel = true;
+        pacer->kernel_rate = ~0U;
+    }
+
+    JTT1078_STAT_STORE(pacer->stats.kernel, pacer->kernel);
+    return pacer->kernel ? 1 : 0;
+}
+
+// 按当前速率补充令牌, 不超过桶深
+static void refill(jtt1078_pacer_t *pacer, uint64_t now) {
+    if (now > pacer->last_us) {
+        pacer->tokens += (int64_t)((now - pacer->last_us) * pacer->rate / 1000000);
+        if (pacer->tokens > (int64_t)pacer->burst_bytes) {
+            pacer->tokens = pacer->burst_bytes;
+        }
+    }
+    pacer->last_us = now;
+}
+
+void jtt1078_pacer_begin(jtt1078_pacer_t *pacer, uint32_t bytes, uint32_t interval_ms) {
+    uint64_t now = now_us();
+
+    if (interval_ms > 0 && interval_ms <= JTT1078_PACE_MAX_INTERVAL) {
+        pacer->interval_ms = (uint16_t)interval_ms;
+    }
+
+    // 速率 = 帧字节数 / (帧间隔 × fraction_pct%)
+    uint64_t rate = (uint64_t)bytes * 1000 * 100 / ((uint64_t)pacer->interval_ms * pacer->fraction_pct);
+    if (rate < pacer->min_rate) {
+        rate = pacer->min_rate;
+    }
+    if (pacer->max_rate && rate > pacer->max_rate) {
+        rate = pacer->max_rate;
+    }
+    if (rate > 0xFFFFFFFEu) {
+        rate = 0xFFFFFFFEu;
+    }
+
+    // 以上一帧的速率结算已积攒的令牌, 之后按本帧速率补充
+    refill(pacer, now);
+    pacer->rate = (uint32_t)rate;
+    pacer->frame_delay_us = 0;
+    pacer->in_frame = true;
+
+    if (pacer->kernel) {
+        // 上一帧预计未发完时速率只升不降
+        if (now < pacer->kernel_busy_us && pacer->kernel_rate != ~0U && pacer->kernel_rate > rate) {
+            rate = pacer->kernel_rate;
+        }
+        uint64_t diff = rate > pacer->kernel_rate ? rate - pacer->kernel_rate : pacer->kernel_rate - rate;
+        if (diff * 100 > (uint64_t)pacer->kernel_rate * PACE_KERNEL_STEP_PCT) {
+            if (set_kernel_rate(pacer->fd, (uint32_t)rate) < 0) {
+                fprintf(stderr, "[JTT1078] SO_MAX_PACING_RATE failed: %s, using userspace pacing\n",
+                        strerror(errno));
+                pacer->kernel = false;
+                JTT1078_STAT_STORE(pacer->stats.kernel, false);
+                return;
+            }
+            pacer->kernel_rate = (uint32_t)rate;
+        }
+
+        // 内核按速率发出桶深以外的部分, 记为本帧的节奏控制时延
+        uint64_t start = now > pacer->kernel_busy_us ? now : pacer->kernel_busy_us;
+        pacer->kernel_busy_us = start + (uint64_t)bytes * 1000000 / pacer->kernel_rate;
+        if (bytes > pacer->burst_bytes) {
+            pacer->frame_delay_us = (uint64_t)(bytes - pacer->burst_bytes) * 1000000 / pacer->kernel_rate;
+        }
+    }
+}
+
+bool jtt1078_pacer_split(const jtt1078_pacer_t *pacer, uint32_t bytes) {
+    return !pacer->kernel && bytes > pacer->burst_bytes;
+}
+
+void jtt1078_pacer_wait(jtt1078_pacer_t *pacer, uint32_t bytes) {
+    if (pacer->kernel) {
+        return;
+    }
+
+    uint64_t now = now_us();
+    refill(pacer, now);
+
+    if (pacer->tokens < (int64_t)bytes) {
+        uint64_t wait = (uint64_t)((int64_t)bytes - pacer->tokens) * 1000000 / pacer->rate;
+        struct timespec ts = {
+            .tv_sec = (time_t)(wait / 1000000),
+            .tv_nsec = (long)(wait % 1000000) * 1000,
+        };
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+        }
+
+        uint64_t after = now_us();
+        refill(pacer, after);
+        pacer->frame_delay_us += after - now;
+
+        JTT1078_STAT_ADD(pacer->stats.waits, 1);
+    }
+    pacer->tokens -= bytes;
+}
+
+void jtt1078_pacer_end(jtt1078_pacer_t *pacer) {
+    if (!pacer->in_frame) {
+        return;
+    }
+    pacer->in_frame = false;
+
+    uint32_t delay = pacer->frame_delay_us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)pacer->frame_delay_us;
+    JTT1078_STAT_ADD(pacer->stats.frames, 1);
+    uint32_t rate = pacer->kernel ? pacer->kernel_rate : pacer->rate;
+    JTT1078_STAT_STORE(pacer->stats.rate, rate);
+    JTT1078_STAT_MAX(pacer->stats.max_rate, rate);
+    if (delay > 0) {
+        JTT1078_STAT_ADD(pacer->stats.paced_frames, 1);
+        JTT1078_STAT_STORE(pacer->stats.last_delay_us, delay);
+        JTT1078_STAT_ADD(pacer->stats.total_delay_us, delay);
+        JTT1078_STAT_MAX(pacer->stats.max_delay_us, delay);
+    }
+}
+
+void jtt1078_pacer_get_stats(const jtt1078_pacer_t *pacer, jtt1078_pace_stats_t *out) {
+    out->kernel = JTT1078_STAT_LOAD(pacer->stats.kernel);
+    out->rate = JTT1078_STAT_LOAD(pacer->stats.rate);
+    out->max_rate = JTT1078_STAT_LOAD(pacer->stats.max_rate);
+    out->frames = JTT1078_STAT_LOAD(pacer->stats.frames);
+    out->paced_frames = JTT1078_STAT_LOAD(pacer->stats.paced_frames);
+    out->waits = JTT1078_STAT_LOAD(pacer->stats.waits);
+    out->last_delay_us = JTT1078_STAT_LOAD(pacer->stats.last_delay_us);
+    out->max_delay_us = JTT1078_STAT_LOAD(pacer->stats.max_delay_us);
+    out->total_delay_us = JTT1078_STAT_LOAD(pacer->stats.total_delay_us);
+}
@@ -0,0 +1,113 @@
+/*
+ * JT/T 1078 Send Pacer
+ * 关键帧突发平滑: 1080p I帧约150个分包连续写出, 会使蜂窝调制解调器的浅缓冲区
+ * 溢出, 丢包恰好落在最重要的帧上。发送节奏控制把一帧的分包分散到帧间隔的
+ * 一部分(fraction_pct)内发出:
+ *
+ *   发送速率 = 帧字节数 / (帧间隔 × fraction_pct%), 不低于 min_rate, 不高于 max_rate
+ *
+ * 大I帧按 fraction_pct 算出的速率可能超过上行链路速率(72KB 的I帧在20ms内发出
+ * 约需 29Mbit/s), 此时 fraction_pct 本身不能防止溢出; max_rate 设为链路速率后
+ * 这样的帧按链路速率发出, 分散时间相应超过 fraction_pct。
+ *
+ *   - 内核 pacing: TCP socket 设置 SO_MAX_PACING_RATE(Linux 4.13 起 TCP 自带
+ *     pacing, 无需 fq 队列规则), 整帧仍一次写入, 由内核按速率发出;
+ *     上一帧预计发完之前速率只升不降, 避免拖慢队列中的剩余数据
+ *   - 用户态 pacing: UDP 或内核不支持时使用令牌桶, 桶深 burst_bytes,
+ *     每次发送不超过桶深的若干完整分包, 令牌不足时在发送线程中等待
+ *
+ * 不超过桶深的帧(通常是P帧和音频)不等待。节奏控制只由发送线程使用,
+ * 统计以原子操作更新, jtt1078_pacer_get_stats / jtt1078_encoder_get_stats
+ * 可在任意线程无锁读取。
+ */
+
+#ifndef JTT1078_PACE_H
+#define JTT1078_PACE_H
+
+#include "jtt1078_protocol.h"
+
+#define JTT1078_PACE_DEFAULT_INTERVAL   40      // 帧间隔未知(首帧)时使用的间隔(ms)
+#define JTT1078_PACE_MAX_INTERVAL       1000    // 帧间隔上限(ms), 跳帧/断线后的长间隔不用于计算速率
+#define JTT1078_PACE_MIN_RATE           16000   // 发送速率下限(字节/秒)
+
+typedef struct jtt1078_pacer {
+    uint8_t  fraction_pct;          // 一帧分散发出的时间占帧间隔的百分比(1-100)
+    uint32_t burst_bytes;           // 令牌桶深度: 可连续写出的字节数
+    uint32_t min_rate;              // 发送速率下限(字节/秒)
+    uint32_t max_rate;              // 发送速率上限(字节/秒), 0不限
+    uint16_t interval_ms;           // 最近的有效视频帧间隔
+
+    // 内核 pacing
+    int      fd;                    // 当前socket, <0表示未设置(只用用户态)
+    bool     kernel;                // SO_MAX_PACING_RATE 已生效
+    uint32_t kernel_rate;           // 最近设置的内核速率(字节/秒)
+    uint64_t kernel_busy_us;        // 按内核速率预计发完已写入数据的时刻
+
+    // 令牌桶(用户态)
+    uint32_t rate;                  // 当前帧的发送速率(字节/秒)
+    int64_t  tokens;                // 可用字节数(不超过 burst_bytes)
+    uint64_t last_us;               // 上次补充令牌的时刻
+    uint64_t frame_delay_us;        // 当前帧累计等待时间
+    bool     in_frame;
+
+    jtt1078_pace_stats_t stats;     // 原子更新
+} jtt1078_pacer_t;
+
+/**
+ * 初始化节奏控制(只用用户态令牌桶, 调用 jtt1078_pacer_set_socket 后尝试内核 pacing)
+ * @param fraction_pct 一帧分散发出的时间占帧间隔的百分比(1-100, 如50)
+ * @param burst_bytes 令牌桶深度(字节), 0取 4 个最大分包; 不超过该值的帧直接发出
+ * @return 0成功, -1参数错误
+ */
+int jtt1078_pacer_init(jtt1078_pacer_t *pacer, uint8_t fraction_pct, uint32_t burst_bytes);
+
+/**
+ * 设置发送速率上限(通常取上行链路速率)
+ * @param max_rate 速率上限(字节/秒), 0不限; 低于 min_rate 时取 min_rate
+ */
+void jtt1078_pacer_set_max_rate(jtt1078_pacer_t *pacer, uint32_t max_rate);
+
+/**
+ * 设置发送socket(新连接建立后调用)
+ * TCP socket 设置 SO_MAX_PACING_RATE 成功时改用内核 pacing; UDP 的内核 pacing
+ * 依赖 fq 队列规则, 无法确认是否生效, 仍用用户态令牌桶
+ * @param fd socket描述符, <0表示只用用户态令牌桶
+ * @return 1使用内核pacing, 0使用用户态令牌桶
+ */
+int jtt1078_pacer_set_socket(jtt1078_pacer_t *pacer, int fd);
+
+/**
+ * 一帧开始: 按帧字节数和帧间隔计算发送速率(内核 pacing 时同时更新socket速率)
+ * @param bytes 本帧线上字节数(含包头与校验包)
+ * @param interval_ms 本帧帧间隔, 0或超过上限时沿用最近的有效间隔
+ */
+void jtt1078_pacer_begin(jtt1078_pacer_t *pacer, uint32_t bytes, uint32_t interval_ms);
+
+/**
+ * 用户态令牌桶: 取得 bytes 字节的发送额度, 令牌不足时等待
+ * 内核 pacing 时直接返回
+ * @param bytes 本次写出的字节数(应不超过 burst_bytes)
+ */
+void jtt1078_pacer_wait(jtt1078_pacer_t *pacer, uint32_t bytes);
+
+/**
+ * 是否需要按桶深分段写出(用户态 pacing 且本帧超过桶深)
+ */
+bool jtt1078_pacer_split(const jtt1078_pacer_t *pacer, uint32_t bytes);
+
+/**
+ * 一帧结束: 记录本帧的节奏控制时延
+ */
+void jtt1078_pacer_end(jtt1078_pacer_t *pacer);
+
+/**
+ * 获取统计快照(无锁, 可在任意线程调用)
+ */
+void jtt1078_pacer_get_stats(const jtt1078_pacer_t *pacer, jtt1078_pace_stats_t *out);
+
+/**
+ * 释放资源(不关闭socket, 也不恢复其 SO_MAX_PACING_RATE)
+ */
+void jtt1078_pacer_deinit(jtt1078_pacer_t *pacer);
+
+#endif // JTT1078_PACE_H
@@ -0,0 +1,496 @@
+/*
+ * JT/T 1078 Playback Streamer
+ * 录像段映射、帧边界扫描、关键帧索引与倍速回放实现
+ */
+
+#define _GNU_SOURCE
+#include "jtt1078_playback.h"
+#include "jtt1078_nal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PLAYBACK_PREFETCH       (256 * 1024)    // 关键帧跳转时预读的字节数
+#define PLAYBACK_MAX_LAG_US     1000000         // 落后发送时刻超过该值时重新开始计时
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static size_t page_size(void) {
+    static size_t size;
+    if (!size) {
+        long ps = sysconf(_SC_PAGESIZE);
+        size = ps > 0 ? (size_t)ps : 4096;
+    }
+    return size;
+}
+
+// 段文件名 video_YYYYMMDD_HHMMSS_segNNN.h264 中的开始时间(录像按本地时间命名)
+static uint64_t parse_start_time(const char *path) {
+    const char *name = strrchr(path, '/');
+    struct tm tm;
+    name = name ? name + 1 : path;
+
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(name, "video_%4d%2d%2d_%2d%2d%2d",
+               &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return 0;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+
+    time_t t = mktime(&tm);
+    return t == (time_t)-1 ? 0 : (uint64_t)t * 1000;
+}
+
+static int add_key(jtt1078_playback_t *pb, size_t offset, uint64_t time_ms, uint32_t frame) {
+    if (pb->key_count > 0 && pb->keys[pb->key_count - 1].offset >= offset) {
+        return 0;
+    }
+    if (pb->key_count == pb->key_capacity) {
+        uint32_t capacity = pb->key_capacity ? pb->key_capacity * 2 : 128;
+        jtt1078_playback_key_t *keys = realloc(pb->keys, capacity * sizeof(jtt1078_playback_key_t));
+        if (!keys) {
+            return -1;
+        }
+        pb->keys = keys;
+        pb->key_capacity = capacity;
+    }
+
+    jtt1078_playback_key_t *k = &pb->keys[pb->key_count++];
+    k->offset = offset;
+    k->time_ms = time_ms;
+    k->frame = frame;
+    k->reserved = 0;
+    return 0;
+}
+
+// 读取旁路索引文件; 偏移/帧序号不递增或超出段文件(录像中断)的项及其后各项丢弃
+static void load_index(jtt1078_playback_t *pb, const char *path) {
+    char idx_path[512];
+    if (snprintf(idx_path, sizeof(idx_path), "%s%s", path, JTT1078_PLAYBACK_INDEX_SUFFIX) >=
+        (int)sizeof(idx_path)) {
+        return;
+    }
+
+    int fd = open(idx_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    jtt1078_playback_key_t buf[64];
+    ssize_t n;
+    bool valid = true;
+    while (valid && (n = read(fd, buf, sizeof(buf))) > 0) {
+        for (size_t i = 0; i < (size_t)n / sizeof(buf[0]); i++) {
+            const jtt1078_playback_key_t *k = &buf[i];
+            const jtt1078_playback_key_t *last = pb->key_count ? &pb->keys[pb->key_count - 1] : NULL;
+            if (k->offset >= pb->size ||
+                (last && (k->offset <= last->offset || k->frame <= last->frame)) ||
+                add_key(pb, (size_t)k->offset, k->time_ms, k->frame) < 0) {
+                valid = false;
+                break;
+            }
+        }
+    }
+    close(fd);
+
+    if (pb->key_count > 0) {
+        pb->indexed = true;
+        pb->timed = true;
+    }
+}
+
+int jtt1078_playback_open(jtt1078_playback_t *pb, const char *path, uint8_t video_format, uint32_t fps) {
+    if (!pb || !path || (video_format != JTT1078_VIDEO_H264 && video_format != JTT1078_VIDEO_H265)) {
+        return -1;
+    }
+
+    memset(pb, 0, sizeof(jtt1078_playback_t));
+    pb->fd = -1;
+    pb->video_format = video_format;
+    pb->fps = fps ? fps : JTT1078_PLAYBACK_DEFAULT_FPS;
+    pb->speed = 1;
+
+    struct stat st;
+    pb->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (pb->fd < 0 || fstat(pb->fd, &st) < 0) {
+        fprintf(stderr, "[JTT1078] Playback open %s failed: %s\n", path, strerror(errno));
+        if (pb->fd >= 0) {
+            close(pb->fd);
+        }
+        pb->fd = -1;
+        return -1;
+    }
+    if (st.st_size <= 0) {
+        fprintf(stderr, "[JTT1078] Playback %s: empty segment\n", path);
+        close(pb->fd);
+        pb->fd = -1;
+        return -1;
+    }
+
+    pb->size = (size_t)st.st_size;
+    void *map = mmap(NULL, pb->size, PROT_READ, MAP_SHARED, pb->fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[JTT1078] Playback mmap %s failed: %s\n", path, strerror(errno));
+        close(pb->fd);
+        pb->fd = -1;
+        return -1;
+    }
+    pb->data = map;
+    madvise(map, pb->size, MADV_SEQUENTIAL);
+
+    load_index(pb, path);
+    if (pb->timed) {
+        pb->start_ms = pb->keys[0].time_ms - (uint64_t)pb->keys[0].frame * 1000 / pb->fps;
+    } else {
+        pb->start_ms = parse_start_time(path);
+        if (!pb->start_ms) {
+            pb->start_ms = (uint64_t)st.st_mtime * 1000;
+        }
+    }
+    return 0;
+}
+
+void jtt1078_playback_close(jtt1078_playback_t *pb) {
+    if (!pb) {
+        return;
+    }
+    if (pb->data) {
+        munmap((void *)pb->data, pb->size);
+        pb->data = NULL;
+    }
+    if (pb->fd >= 0) {
+        posix_fadvise(pb->fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(pb->fd);
+        pb->fd = -1;
+    }
+    free(pb->keys);
+    pb->keys = NULL;
+    pb->key_count = 0;
+    pb->key_capacity = 0;
+}
+
+/*
+ * 帧边界
+ */
+
+static bool is_vcl(const uint8_t *nal, uint8_t video_format) {
+    if (video_format == JTT1078_VIDEO_H265) {
+        return ((nal[0] >> 1) & 0x3F) < 32;
+    }
+    uint8_t type = nal[0] & 0x1F;
+    return type >= 1 && type <= 5;
+}
+
+// 在已出现 slice 之后, 该 NAL 是否开始新的一帧
+static bool starts_frame(const uint8_t *nal, const uint8_t *end, uint8_t video_format) {
+    if (video_format == JTT1078_VIDEO_H265) {
+        if (nal + 2 >= end) {
+            return false;
+        }
+        uint8_t type = (nal[0] >> 1) & 0x3F;
+        if (type < 32) {
+            return (nal[2] & 0x80) != 0;        // first_slice_segment_in_pic_flag
+        }
+        return (type >= 32 && type <= 35) || type == 39;    // VPS/SPS/PPS/AUD/前缀SEI
+    }
+
+    if (nal + 1 >= end) {
+        return false;
+    }
+    uint8_t type = nal[0] & 0x1F;
+    if (type >= 1 && type <= 5) {
+        return (nal[1] & 0x80) != 0;            // first_mb_in_slice == 0 (ue(v) 编码为 '1')
+    }
+    return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);  // SEI/SPS/PPS/AUD/前缀等
+}
+
+// 从 start 开始的一帧的结束偏移(下一帧的起始码, 4字节起始码的前导零归下一帧)
+static size_t frame_end(const jtt1078_playback_t *pb, size_t start) {
+    const uint8_t *base = pb->data + start;
+    const uint8_t *end = pb->data + pb->size;
+    const uint8_t *p = jtt1078_find_start_code(base, end);
+    bool vcl = false;
+
+    while (p < end) {
+        const uint8_t *nal = p + 3;
+        if (nal >= end) {
+            break;
+        }
+        if (vcl && starts_frame(nal, end, pb->video_format)) {
+            if (p > base && p[-1] == 0) {
+                p--;
+            }
+            return (size_t)(p - pb->data);
+        }
+        if (is_vcl(nal, pb->video_format)) {
+            vcl = true;
+        }
+        p = jtt1078_find_start_code(nal, end);
+    }
+    return pb->size;
+}
+
+/*
+ * 时间戳与索引
+ */
+
+// 段内第 frame 帧的采集时间; pb->key 为该帧所属GOP的关键帧
+static uint64_t frame_time(const jtt1078_playback_t *pb, uint32_t frame) {
+    if (!pb->timed || frame < pb->keys[0].frame) {
+        return pb->start_ms + (uint64_t)frame * 1000 / pb->fps;
+    }
+
+    // 帧间隔取本GOP(最后一个GOP取上一个GOP)的平均值
+    const jtt1078_playback_key_t *k = &pb->keys[pb->key];
+    const jtt1078_playback_key_t *a = NULL, *b = NULL;
+    if (pb->key + 1 < pb->key_count) {
+        a = k;
+        b = k + 1;
+    } else if (pb->key > 0) {
+        a = k - 1;
+        b = k;
+    }
+
+    uint64_t num = 1000, den = pb->fps;
+    if (a && b->frame > a->frame && b->time_ms >= a->time_ms) {
+        num = b->time_ms - a->time_ms;
+        den = b->frame - a->frame;
+    }
+    return k->time_ms + (uint64_t)(frame - k->frame) * num / den;
+}
+
+// 扫描整段建立索引(从已知的最后一个关键帧开始), 扫描过的页随即释放
+static void build_index(jtt1078_playback_t *pb) {
+    if (pb->indexed) {
+        return;
+    }
+
+    size_t pos = 0;
+    uint32_t frame = 0;
+    if (pb->key_count > 0) {
+        pos = (size_t)pb->keys[pb->key_count - 1].offset;
+        frame = pb->keys[pb->key_count - 1].frame;
+    }
+    size_t from = pos & ~(page_size() - 1);
+
+    while (pos < pb->size) {
+        size_t end = frame_end(pb, pos);
+        bool key = false;
+        if (jtt1078_nal_frame_type(pb->data + pos, (uint32_t)(end - pos), pb->video_format, &key) >= 0) {
+            if (key && add_key(pb, pos, pb->start_ms + (uint64_t)frame * 1000 / pb->fps, frame) < 0) {
+                return;
+            }
+            frame++;
+        }
+        pos = end;
+    }
+    pb->indexed = true;
+
+    // 当前读取位置之后的页在读取时重新载入
+    if (pb->size > from) {
+        madvise((void *)(pb->data + from), pb->size - from, MADV_DONTNEED);
+        posix_fadvise(pb->fd, (off_t)from, (off_t)(pb->size - from), POSIX_FADV_DONTNEED);
+    }
+}
+
+uint32_t jtt1078_playback_keyframes(jtt1078_playback_t *pb) {
+    if (!pb || !pb->data) {
+        return 0;
+    }
+    build_index(pb);
+    return pb->key_count;
+}
+
+// 释放已发送的映射和页缓存, 按块进行以减少系统调用
+static void release_behind(jtt1078_playback_t *pb) {
+    if (pb->pos < pb->released + JTT1078_PLAYBACK_RELEASE_CHUNK) {
+        return;
+    }
+
+    size_t upto = pb->pos & ~(page_size() - 1);
+    size_t len = upto - pb->released;
+    madvise((void *)(pb->data + pb->released), len, MADV_DONTNEED);
+    posix_fadvise(pb->fd, (off_t)pb->released, (off_t)len, POSIX_FADV_DONTNEED);
+    pb->stats.released += len;
+    pb->released = upto;
+}
+
+// 读取位置移到索引项 k
+static void move_to_key(jtt1078_playback_t *pb, uint32_t k) {
+    const jtt1078_playback_key_t *key = &pb->keys[k];
+
+    pb->pos = (size_t)key->offset;
+    pb->frame = key->frame;
+    pb->key = k;
+    if (pb->pos < pb->released) {
+        pb->released = pb->pos & ~(page_size() - 1);
+    }
+
+    // 跳转读取不触发顺序预读, 提前异步读入关键帧所在区域
+    size_t from = pb->pos & ~(page_size() - 1);
+    size_t len = pb->size - from < PLAYBACK_PREFETCH ? pb->size - from : PLAYBACK_PREFETCH;
+    madvise((void *)(pb->data + from), len, MADV_WILLNEED);
+}
+
+int jtt1078_playback_set_mode(jtt1078_playback_t *pb, uint8_t mode, uint8_t speed) {
+    if (!pb || !pb->data || mode > JTT1078_PLAYBACK_KEYFRAME || speed > JTT1078_PLAYBACK_MAX_SPEED ||
+        (speed & (speed - 1)) != 0) {
+        return -1;
+    }
+
+    if (mode != pb->mode) {
+        pb->need_key = true;
+        // 有索引的关键帧模式只读取关键帧, 关闭顺序预读
+        madvise((void *)pb->data, pb->size,
+                mode == JTT1078_PLAYBACK_KEYFRAME && pb->indexed ? MADV_RANDOM : MADV_SEQUENTIAL);
+    }
+    pb->mode = mode;
+    pb->speed = speed;
+    pb->clock_started = false;
+    return 0;
+}
+
+int jtt1078_playback_seek(jtt1078_playback_t *pb, uint64_t time_ms) {
+    if (!pb || !pb->data) {
+        return -1;
+    }
+
+    build_index(pb);
+    if (pb->key_count == 0) {
+        return -1;
+    }
+
+    // 不晚于 time_ms 的最后一个关键帧
+    uint32_t lo = 0, hi = pb->key_count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (pb->keys[mid].time_ms <= time_ms) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    move_to_key(pb, lo);
+    pb->need_key = false;
+    pb->clock_started = false;
+    return 0;
+}
+
+int jtt1078_playback_next(jtt1078_playback_t *pb, video_frame_t *frame) {
+    if (!pb || !pb->data || !frame) {
+        return 0;
+    }
+
+    for (;;) {
+        bool want_key = pb->mode == JTT1078_PLAYBACK_KEYFRAME || pb->need_key;
+
+        // 有完整索引时直接跳到下一个关键帧, 不读取中间的数据
+        if (want_key && pb->indexed) {
+            uint32_t k = pb->key;
+            while (k < pb->key_count && pb->keys[k].offset < pb->pos) {
+                k++;
+            }
+            if (k == pb->key_count) {
+                pb->pos = pb->size;
+                return 0;
+            }
+            if (pb->keys[k].offset > pb->pos) {
+                pb->stats.skipped += pb->keys[k].frame - pb->frame;
+                move_to_key(pb, k);
+            }
+        }
+
+        if (pb->pos >= pb->size) {
+            pb->indexed = true;     // 顺序读到段尾, 已见过全部关键帧
+            return 0;
+        }
+
+        size_t start = pb->pos;
+        size_t end = frame_end(pb, start);
+        bool key = false;
+        int type = jtt1078_nal_frame_type(pb->data + start, (uint32_t)(end - start),
+                                          pb->video_format, &key);
+        pb->pos = end;
+        if (type < 0) {
+            continue;       // 不含 slice 的数据(段尾残缺等)
+        }
+
+        uint32_t no = pb->frame++;
+        while (pb->key + 1 < pb->key_count && pb->keys[pb->key + 1].offset <= start) {
+            pb->key++;
+        }
+        if (key && !pb->indexed) {
+            add_key(pb, start, pb->start_ms + (uint64_t)no * 1000 / pb->fps, no);
+            if (pb->key_count > 0 && pb->keys[pb->key_count - 1].offset == start) {
+                pb->key = pb->key_count - 1;
+            }
+        }
+        release_behind(pb);
+
+        if (want_key && !key) {
+            pb->stats.skipped++;
+            continue;
+        }
+        pb->need_key = false;
+
+        frame->data = (uint8_t *)(pb->data + start);
+        frame->size = (uint32_t)(end - start);
+        frame->frame_type = (uint8_t)type;
+        frame->is_keyframe = key;
+        frame->pts = frame_time(pb, no);
+
+        pb->stats.frames++;
+        pb->stats.bytes += frame->size;
+        if (key) {
+            pb->stats.keyframes++;
+        }
+        return 1;
+    }
+}
+
+int jtt1078_playback_step(jtt1078_playback_t *pb, jtt1078_encoder_t *encoder) {
+    video_frame_t frame;
+    int ret = jtt1078_playback_next(pb, &frame);
+    if (ret <= 0) {
+        return ret;
+    }
+
+    // 发送时刻 = 基准时刻 + (帧时间 - 基准帧时间) / 倍速
+    if (pb->speed > 0) {
+        uint64_t now = monotonic_us();
+        uint64_t due = 0;
+        if (pb->clock_started && frame.pts >= pb->base_pts) {
+            due = pb->base_mono_us + (frame.pts - pb->base_pts) * 1000 / pb->speed;
+        }
+        // 首帧、时间回退或发送落后过多(链路慢)时重新开始计时, 不突发追赶
+        if (!pb->clock_started || frame.pts < pb->base_pts || now > due + PLAYBACK_MAX_LAG_US) {
+            pb->base_mono_us = now;
+            pb->base_pts = frame.pts;
+            pb->clock_started = true;
+        } else if (due > now) {
+            struct timespec ts = {
+                .tv_sec = (time_t)(due / 1000000),
+                .tv_nsec = (long)(due % 1000000) * 1000,
+            };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+            }
+            pb->stats.wait_us += due - now;
+        }
+    }
+
+    return jtt1078_encode_video_frame(encoder, &frame) < 0 ? -1 : 1;
+}
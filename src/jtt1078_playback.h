@@ -0,0 +1,147 @@
+/*
+ * JT/T 1078 Playback Streamer
+ * SD卡录像回放上传: 平台下发历史音视频回放请求(0x9201)后, 把
+ * /mnt/sdcard/recordings 中的录像段逐帧送入 jtt1078_encode_video_frame
+ *
+ * 录像段为 video_stream_record 写出的 Annex-B 裸码流(无容器, 无时间戳):
+ *   - 段文件以 mmap 只读映射, 不整体读入内存; 顺序读取时按 MADV_SEQUENTIAL 预读,
+ *     已发送部分按块释放映射和页缓存(MADV_DONTNEED / POSIX_FADV_DONTNEED),
+ *     回放不挤占实时编码与录像的内存
+ *   - 帧边界由起始码扫描(NEON/SSE2)和 NAL 头确定: AUD/参数集/SEI, 或
+ *     first_mb_in_slice(H.265 为 first_slice_segment_in_pic_flag)为0的 slice
+ *     开始新的一帧; 每字节只扫描一次, 吞吐受SD卡读取速度限制
+ *   - 关键帧索引: 录像程序为每个IDR写一项到旁路文件 <段文件>.idx(偏移、采集时间、
+ *     帧序号); 没有索引文件(旧录像)时首次需要时扫描整段建立
+ *   - 时间戳: 有索引文件时以各关键帧的采集时间为基准, 帧间隔取相邻关键帧之间的
+ *     平均值, 不随录像时长漂移; 否则为段文件名中的开始时间(本地时间)+
+ *     帧序号 × 1000/fps
+ *
+ * 回放方式(对应 0x9202 回放控制):
+ *   - JTT1078_PLAYBACK_NORMAL:   逐帧发送, speed 为 1 时按原始帧间隔实时发送,
+ *                                2/4/8/16 时快进(间隔除以倍数)
+ *   - JTT1078_PLAYBACK_KEYFRAME: 只发送关键帧(按索引跳转, 不读取其间的数据),
+ *                                关键帧间隔同样除以倍数
+ * speed 为 0 时不等待, 以最快速度上传(由发送速率限制)。
+ * 帧的 pts 为原始采集时间(UTC 毫秒), 编码器应设置为 JTT1078_TS_ABSOLUTE。
+ *
+ * 回放对象只由一个线程使用。
+ */
+
+#ifndef JTT1078_PLAYBACK_H
+#define JTT1078_PLAYBACK_H
+
+#include "jtt1078_protocol.h"
+
+// 回放方式
+#define JTT1078_PLAYBACK_NORMAL     0           // 逐帧(1倍速或快进)
+#define JTT1078_PLAYBACK_KEYFRAME   1           // 只发送关键帧
+
+#define JTT1078_PLAYBACK_MAX_SPEED  16          // 最大倍速
+#define JTT1078_PLAYBACK_DEFAULT_FPS 30         // 录像帧率(与 video_stream_record 的默认值一致)
+#define JTT1078_PLAYBACK_RELEASE_CHUNK  (1024 * 1024)   // 已发送数据按该粒度释放
+
+#define JTT1078_PLAYBACK_INDEX_SUFFIX   ".idx"
+
+/*
+ * 关键帧索引项(旁路文件 <段文件>.idx, 每个IDR一项, 本机字节序, 按偏移递增)
+ * 录像程序在写入关键帧之前追加
+ */
+typedef struct {
+    uint64_t offset;            // 关键帧(含其前的参数集)在段文件中的偏移
+    uint64_t time_ms;           // 采集时间(UTC 毫秒)
+    uint32_t frame;             // 段内帧序号(从0开始)
+    uint32_t reserved;
+} jtt1078_playback_key_t;
+
+// 回放统计
+typedef struct {
+    uint64_t frames;            // 已送出的帧数
+    uint64_t keyframes;         // 其中关键帧数
+    uint64_t bytes;             // 已送出的帧字节数
+    uint64_t skipped;           // 关键帧模式/切换方式时跳过的帧数
+    uint64_t wait_us;           // 按倍速等待的累计时间
+    uint64_t released;          // 已释放的映射字节数
+} jtt1078_playback_stats_t;
+
+typedef struct {
+    int      fd;
+    const uint8_t *data;        // 段文件映射
+    size_t   size;
+    uint8_t  video_format;      // JTT1078_VIDEO_H264 / _H265
+    uint32_t fps;               // 无索引时用于计算时间戳
+
+    uint64_t start_ms;          // 段开始时间(UTC 毫秒, 取自索引或文件名)
+
+    // 关键帧索引
+    jtt1078_playback_key_t *keys;
+    uint32_t key_count;
+    uint32_t key_capacity;
+    bool     indexed;           // 索引已覆盖整段(旁路文件或整段扫描)
+    bool     timed;             // 索引来自旁路文件, 含采集时间
+
+    // 读取位置
+    size_t   pos;               // 下一帧的偏移
+    uint32_t frame;             // 下一帧的段内帧序号
+    uint32_t key;               // 不晚于 pos 的最后一个关键帧的索引项
+    size_t   released;          // 该偏移之前的映射已释放
+
+    // 回放方式与节奏
+    uint8_t  mode;
+    uint8_t  speed;             // 0不等待, 1/2/4/8/16
+    bool     need_key;          // 切换方式或跳转后从关键帧开始
+    bool     clock_started;
+    uint64_t base_mono_us;      // 节奏基准: 单调时钟
+    uint64_t base_pts;          // 节奏基准: 对应的帧时间戳
+
+    jtt1078_playback_stats_t stats;
+} jtt1078_playback_t;
+
+/**
+ * 打开录像段
+ * @param path 段文件路径(video_YYYYMMDD_HHMMSS_segNNN.h264)
+ * @param video_format JTT1078_VIDEO_H264 或 JTT1078_VIDEO_H265
+ * @param fps 录像帧率, 0使用 JTT1078_PLAYBACK_DEFAULT_FPS
+ * @return 0成功, -1失败(文件无法打开/映射或为空)
+ */
+int jtt1078_playback_open(jtt1078_playback_t *pb, const char *path, uint8_t video_format, uint32_t fps);
+
+/**
+ * 设置回放方式与倍速
+ * 从下一个关键帧开始按新方式发送(跳过的P/B帧缺少参考帧), 节奏基准重新开始
+ * @param mode JTT1078_PLAYBACK_NORMAL / _KEYFRAME
+ * @param speed 0(不等待), 1, 2, 4, 8, 16
+ * @return 0成功, -1参数错误
+ */
+int jtt1078_playback_set_mode(jtt1078_playback_t *pb, uint8_t mode, uint8_t speed);
+
+/**
+ * 跳转到不晚于 time_ms 的最后一个关键帧(拖动回放)
+ * @param time_ms 目标时间(UTC 毫秒), 早于段开始时从头开始
+ * @return 0成功, -1段内没有关键帧
+ */
+int jtt1078_playback_seek(jtt1078_playback_t *pb, uint64_t time_ms);
+
+/**
+ * 读取下一帧(按当前回放方式, 不等待)
+ * frame->data 指向映射区, 在下一次调用 next/step/seek 之前有效
+ * @return 1读到一帧, 0段结束
+ */
+int jtt1078_playback_next(jtt1078_playback_t *pb, video_frame_t *frame);
+
+/**
+ * 读取下一帧, 按倍速等到发送时刻后交给编码器
+ * @return 1已发送, 0段结束, -1编码器发送失败
+ */
+int jtt1078_playback_step(jtt1078_playback_t *pb, jtt1078_encoder_t *encoder);
+
+/**
+ * 段内的关键帧数(无索引文件时扫描整段)
+ */
+uint32_t jtt1078_playback_keyframes(jtt1078_playback_t *pb);
+
+/**
+ * 关闭录像段, 释放映射与索引
+ */
+void jtt1078_playback_close(jtt1078_playback_t *pb);
+
+#endif // JTT1078_PLAYBACK_H
@@ -4,6 +4,10 @@
  */
 
 #include "jtt1078_protocol.h"
+#include "jtt1078_nal.h"
+#include "jtt1078_fec.h"
+#include "jtt1078_g711.h"
+#include "jtt1078_pace.h"
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
@@ -28,6 +32,32 @@ uint64_t jtt1078_htonll(uint64_t val) {
 #endif
 }
 
+// 大端序字节写入/读取, 不依赖编译器的结构体打包和位域布局
+static inline void put_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void put_be64(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+static inline uint16_t get_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint64_t get_be64(const uint8_t *p) {
+    return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
 // 获取当前时间戳(毫秒)
 uint64_t jtt1078_get_timestamp_ms(void) {
     struct timeval tv;
@@ -35,6 +65,13 @@ uint64_t jtt1078_get_timestamp_ms(void) {
     return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
 
+// 获取单调时钟(毫秒)
+uint64_t jtt1078_get_monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 // SIM卡号字符串转BCD码
 void jtt1078_sim_to_bcd(const char *sim_number, uint8_t *bcd_out) {
     memset(bcd_out, 0, 6);
@@ -50,17 +87,12 @@ void jtt1078_sim_to_bcd(const char *sim_number, uint8_t *bcd_out) {
     }
 }
 
-// 初始化编码器
-int jtt1078_encoder_init(jtt1078_encoder_t *encoder,
-                         const char *sim_number,
-                         uint8_t channel,
-                         uint8_t video_format,
-                         int (*send_callback)(const uint8_t *data, size_t len, void *user_data),
-                         void *user_data) {
-    if (!encoder || !sim_number || !send_callback) {
-        return -1;
-    }
-    
+// 编码器公共初始化
+static void encoder_setup(jtt1078_encoder_t *encoder,
+                          const char *sim_number,
+                          uint8_t channel,
+                          uint8_t video_format,
+                          void *user_data) {
     memset(encoder, 0, sizeof(jtt1078_encoder_t));
     
     // 设置基本参数
@@ -68,111 +100,415 @@ int jtt1078_encoder_init(jtt1078_encoder_t *encoder,
     encoder->channel = channel;
     encoder->video_format = video_format;
     encoder->audio_format = JTT1078_AUDIO_G711A;
+    encoder->payload_size = JTT1078_MAX_PAYLOAD_SIZE;
     
     // 初始化序列号
     encoder->packet_seq = 0;
+    encoder->send_seq = 0;
+    pthread_mutex_init(&encoder->send_mutex, NULL);
+    pthread_cond_init(&encoder->send_cond, NULL);
     encoder->rtp_seq = rand() & 0xFFFF;
     encoder->ssrc = rand();
     
+    // 包头模板: 固定头标识, V=2/P=0/X=0/CC=0, 负载类型, SIM卡号(BCD), 通道号
+    uint8_t *t = encoder->hdr_template;
+    t[JTT1078_OFF_FLAG + 0] = (uint8_t)(JTT1078_HEADER_FLAG >> 24);
+    t[JTT1078_OFF_FLAG + 1] = (uint8_t)(JTT1078_HEADER_FLAG >> 16);
+    t[JTT1078_OFF_FLAG + 2] = (uint8_t)(JTT1078_HEADER_FLAG >> 8);
+    t[JTT1078_OFF_FLAG + 3] = (uint8_t)JTT1078_HEADER_FLAG;
+    t[JTT1078_OFF_VPXCC] = 2 << 6;
+    // H.265/H.264动态负载类型
+    t[JTT1078_OFF_MPT] = (video_format == JTT1078_VIDEO_H265) ? 98 : 96;
+    jtt1078_sim_to_bcd(encoder->sim_number, t + JTT1078_OFF_SIM);
+    t[JTT1078_OFF_CHANNEL] = channel;
+    
     // 初始化时间戳
-    encoder->start_time_ms = jtt1078_get_timestamp_ms();
+    encoder->ts_mode = JTT1078_TS_CLOCK;
+    encoder->start_time_ms = jtt1078_get_monotonic_ms();
     encoder->last_timestamp = 0;
     encoder->last_i_timestamp = 0;
     
-    // 设置回调
-    encoder->send_packet = send_callback;
     encoder->user_data = user_data;
     
     printf("[JTT1078] Encoder initialized: SIM=%s, Channel=%d, Format=%s\n",
            sim_number, channel, 
            video_format == JTT1078_VIDEO_H265 ? "H.265" : "H.264");
+}
+
+// 初始化编码器
+int jtt1078_encoder_init(jtt1078_encoder_t *encoder,
+                         const char *sim_number,
+                         uint8_t channel,
+                         uint8_t video_format,
+                         int (*send_callback)(const uint8_t *data, size_t len, void *user_data),
+                         void *user_data) {
+    if (!encoder || !sim_number || !send_callback) {
+        return -1;
+    }
     
+    encoder_setup(encoder, sim_number, channel, video_format, user_data);
+    encoder->send_packet = send_callback;
     return 0;
 }
 
-// 创建JT/T 1078数据包头
-int jtt1078_create_packet(jtt1078_encoder_t *encoder,
-                          jtt1078_packet_t *packet,
-                          const uint8_t *data,
-                          uint16_t data_len,
-                          uint8_t data_type,
-                          uint8_t subpackage) {
-    if (!encoder || !packet || !data) {
+// 初始化编码器(iovec回调)
+int jtt1078_encoder_init_iov(jtt1078_encoder_t *encoder,
+                             const char *sim_number,
+                             uint8_t channel,
+                             uint8_t video_format,
+                             int (*send_callback_v)(const struct iovec *iov, int iovcnt, void *user_data),
+                             void *user_data) {
+    if (!encoder || !sim_number || !send_callback_v) {
         return -1;
     }
     
-    if (data_len > JTT1078_MAX_PAYLOAD_SIZE) {
-        fprintf(stderr, "[JTT1078] Payload too large: %d > %d\n", 
-                data_len, JTT1078_MAX_PAYLOAD_SIZE);
-        return -1;
+    encoder_setup(encoder, sim_number, channel, video_format, user_data);
+    encoder->send_packetv = send_callback_v;
+    return 0;
+}
+
+// 数据类型所属的媒体类别
+static inline int media_of(uint8_t data_type) {
+    if (data_type <= JTT1078_DATA_TYPE_VIDEO_B) {
+        return JTT1078_MEDIA_VIDEO;
+    }
+    return data_type == JTT1078_DATA_TYPE_AUDIO ? JTT1078_MEDIA_AUDIO : JTT1078_MEDIA_TRANS;
+}
+
+// 扩容批量模式的头部区和iovec向量
+static int batch_reserve(jtt1078_batch_arena_t *arena, uint32_t packets) {
+    if (packets <= arena->capacity) {
+        return 0;
     }
     
-    memset(packet, 0, sizeof(jtt1078_packet_t));
+    uint8_t *hdrs = realloc(arena->hdrs, packets * JTT1078_HEADER_SIZE);
+    if (!hdrs) {
+        return -1;
+    }
+    arena->hdrs = hdrs;
     
-    jtt1078_header_t *hdr = &packet->header;
+    struct iovec *iov = realloc(arena->iov, packets * 2 * sizeof(struct iovec));
+    if (!iov) {
+        return -1;
+    }
+    arena->iov = iov;
+    arena->capacity = packets;
     
-    // 固定头标识 "01cd" (0x30316364)
-    hdr->header_flag = jtt1078_htonl(JTT1078_HEADER_FLAG);
+    return 0;
+}
+
+// 启用整帧批量发送
+int jtt1078_encoder_enable_batch(jtt1078_encoder_t *encoder, uint32_t max_frame_size) {
+    if (!encoder || !encoder->send_packetv) {
+        return -1;
+    }
     
-    // RTP版本信息
-    hdr->v = 2;         // RTP version 2
-    hdr->p = 0;         // 无填充
-    hdr->x = 0;         // 无扩展
-    hdr->cc = 0;        // 无CSRC
+    uint32_t packets = (max_frame_size + encoder->payload_size - 1) / encoder->payload_size;
+    if (packets == 0) packets = 1;
     
-    // 负载类型
-    if (encoder->video_format == JTT1078_VIDEO_H265) {
-        hdr->pt = 98;   // H.265动态负载类型
-    } else {
-        hdr->pt = 96;   // H.264动态负载类型  
+    if (batch_reserve(&encoder->batch[JTT1078_MEDIA_VIDEO], packets) < 0) {
+        fprintf(stderr, "[JTT1078] Failed to allocate batch arena\n");
+        return -1;
     }
     
-    // 标记位(帧结束标志)
-    hdr->m = (subpackage == JTT1078_PKT_ATOMIC || 
-              subpackage == JTT1078_PKT_LAST) ? 1 : 0;
-    
-    // 包序号(循环递增)
-    hdr->packet_seq = jtt1078_htons(encoder->packet_seq++);
+    encoder->batch_mode = true;
+    return 0;
+}
+
+// 设置分包负载大小
+int jtt1078_encoder_set_payload_size(jtt1078_encoder_t *encoder, uint32_t payload_size) {
+    if (!encoder || payload_size == 0 || payload_size > JTT1078_PAYLOAD_SIZE_LIMIT) {
+        fprintf(stderr, "[JTT1078] Invalid payload size: %u (1-%d)\n",
+                payload_size, JTT1078_PAYLOAD_SIZE_LIMIT);
+        return -1;
+    }
     
-    // SIM卡号(BCD码)
-    jtt1078_sim_to_bcd(encoder->sim_number, hdr->sim);
+    // 启用FEC后校验包符号区按 JTT1078_FEC_MAX_SYMBOL 分配, 更大的分包会越界
+    if (encoder->fec && payload_size > JTT1078_FEC_MAX_SYMBOL) {
+        fprintf(stderr, "[JTT1078] Payload size %u exceeds FEC symbol limit %d\n",
+                payload_size, JTT1078_FEC_MAX_SYMBOL);
+        return -1;
+    }
     
-    // 逻辑通道号
-    hdr->channel = encoder->channel;
+    // 旧回调需要整包连续内存, 超过栈缓冲区时改用堆缓冲区
+    if (encoder->send_packet && !encoder->send_packetv &&
+        payload_size > JTT1078_MAX_PAYLOAD_SIZE) {
+        uint8_t *buf = realloc(encoder->tx_buf, JTT1078_HEADER_SIZE + payload_size);
+        if (!buf) {
+            return -1;
+        }
+        encoder->tx_buf = buf;
+    }
     
-    // 数据类型
-    hdr->data_type = data_type;
+    encoder->payload_size = (uint16_t)payload_size;
+    return 0;
+}
+
+// 释放编码器资源
+void jtt1078_encoder_deinit(jtt1078_encoder_t *encoder) {
+    if (!encoder) {
+        return;
+    }
     
-    // 分包标识
-    hdr->subpackage = subpackage;
-    hdr->reserved = 0;
+    for (int i = 0; i < JTT1078_MEDIA_TYPES; i++) {
+        free(encoder->batch[i].hdrs);
+        free(encoder->batch[i].iov);
+    }
+    memset(encoder->batch, 0, sizeof(encoder->batch));
+    free(encoder->tx_buf);
+    if (encoder->gop) {
+        free(encoder->gop->data);
+        free(encoder->gop);
+        encoder->gop = NULL;
+    }
+    if (encoder->fec) {
+        free(encoder->fec->bodies);
+        free(encoder->fec);
+        encoder->fec = NULL;
+    }
+    if (encoder->audio_agg) {
+        free(encoder->audio_agg->data);
+        free(encoder->audio_agg);
+        encoder->audio_agg = NULL;
+    }
+    if (encoder->pacer) {
+        jtt1078_pacer_deinit(encoder->pacer);
+        free(encoder->pacer);
+        encoder->pacer = NULL;
+    }
+    encoder->tx_buf = NULL;
+    encoder->batch_mode = false;
+    pthread_cond_destroy(&encoder->send_cond);
+    pthread_mutex_destroy(&encoder->send_mutex);
+}
+
+// 设置时间戳模式
+int jtt1078_encoder_set_timestamp_mode(jtt1078_encoder_t *encoder, uint8_t mode) {
+    if (!encoder || mode > JTT1078_TS_ABSOLUTE) {
+        return -1;
+    }
     
-    // 时间戳(相对于起始时间的毫秒数)
-    uint64_t current_ts = jtt1078_get_timestamp_ms();
-    uint64_t relative_ts = current_ts - encoder->start_time_ms;
-    hdr->timestamp = jtt1078_htonll(relative_ts);
+    encoder->ts_mode = mode;
+    encoder->pts_started = false;
+    return 0;
+}
+
+// 帧间隔字段为16位毫秒, 超出范围时取上限
+static inline uint16_t clamp_interval(uint64_t ms) {
+    return ms > 0xFFFF ? 0xFFFF : (uint16_t)ms;
+}
+
+// 按时间戳模式把帧的 pts 换算为包头时间戳
+static uint64_t frame_time(jtt1078_encoder_t *encoder, uint64_t pts) {
+    uint64_t relative_ts;
     
-    // 计算帧间隔
-    if (encoder->last_timestamp > 0) {
-        encoder->frame_interval = (uint16_t)(relative_ts - encoder->last_timestamp);
+    if (encoder->ts_mode == JTT1078_TS_PTS) {
+        // PTS回退(编码器重启等)时重新以当前帧为基准; 音视频共用基准, 加锁设置
+        pthread_mutex_lock(&encoder->send_mutex);
+        if (!encoder->pts_started || pts < encoder->start_pts) {
+            encoder->start_pts = pts;
+            encoder->pts_started = true;
+        }
+        relative_ts = pts - encoder->start_pts;
+        pthread_mutex_unlock(&encoder->send_mutex);
+    } else if (encoder->ts_mode == JTT1078_TS_ABSOLUTE) {
+        relative_ts = pts;
+    } else {
+        relative_ts = jtt1078_get_monotonic_ms() - encoder->start_time_ms;
     }
-    
-    if (data_type == JTT1078_DATA_TYPE_VIDEO && encoder->last_i_timestamp > 0) {
-        encoder->i_frame_interval = (uint16_t)(relative_ts - encoder->last_i_timestamp);
+    return relative_ts;
+}
+
+// 帧开始: 记录该帧的时间戳并计算帧间隔, 之后所有分包沿用
+// 只写入本媒体类别的当前帧时间, 音视频线程互不覆盖
+static void begin_frame_at(jtt1078_encoder_t *encoder, uint8_t data_type, uint64_t relative_ts) {
+    // 帧间隔只对视频有意义, 音频帧不影响视频的间隔统计
+    switch (media_of(data_type)) {
+    case JTT1078_MEDIA_AUDIO:
+        encoder->audio_timestamp = relative_ts;
+        return;
+    case JTT1078_MEDIA_TRANS:
+        encoder->trans_timestamp = relative_ts;
+        return;
     }
+    encoder->frame_timestamp = relative_ts;
+    
+    // 回放拖动后时间戳可能回退, 此时间隔记为0
+    encoder->frame_interval = encoder->have_last && relative_ts >= encoder->last_timestamp ?
+        clamp_interval(relative_ts - encoder->last_timestamp) : 0;
+    encoder->i_frame_interval = encoder->have_last_i && relative_ts >= encoder->last_i_timestamp ?
+        clamp_interval(relative_ts - encoder->last_i_timestamp) : 0;
     
     // 更新时间戳记录
     encoder->last_timestamp = relative_ts;
+    encoder->have_last = true;
     if (data_type == JTT1078_DATA_TYPE_VIDEO) {
         encoder->last_i_timestamp = relative_ts;
+        encoder->have_last_i = true;
+    }
+}
+
+// 带 pts 的帧(视频/音频)
+static inline void begin_frame(jtt1078_encoder_t *encoder, uint8_t data_type, uint64_t pts) {
+    begin_frame_at(encoder, data_type, frame_time(encoder, pts));
+}
+
+// 没有 pts 的数据(手工组包, 透传数据)按单调时钟计时, 任何模式下都不影响PTS基准
+static inline void begin_frame_clock(jtt1078_encoder_t *encoder, uint8_t data_type) {
+    begin_frame_at(encoder, data_type, jtt1078_get_monotonic_ms() - encoder->start_time_ms);
+}
+
+// 填充JT/T 1078数据包头
+// 从模板拷贝固定部分, 再以大端序写入序号/标记/分包/时间戳/间隔/长度
+// 时间戳和间隔取自 begin_frame 计算的本媒体类别的当前帧值
+static void fill_header(jtt1078_encoder_t *encoder,
+                        uint8_t *out,
+                        uint16_t seq,
+                        uint16_t data_len,
+                        uint8_t data_type,
+                        uint8_t subpackage) {
+    memcpy(out, encoder->hdr_template, JTT1078_HEADER_SIZE);
+    
+    // 标记位(帧结束标志)
+    if (subpackage == JTT1078_PKT_ATOMIC || subpackage == JTT1078_PKT_LAST) {
+        out[JTT1078_OFF_MPT] |= 0x80;
+    }
+    
+    // 包序号(循环递增, 由 alloc_seq 按帧分配)
+    put_be16(out + JTT1078_OFF_SEQ, seq);
+    
+    // 数据类型 | 分包标识
+    out[JTT1078_OFF_TYPE] = (uint8_t)((data_type << 4) | (subpackage & 0x0F));
+    
+    switch (media_of(data_type)) {
+    case JTT1078_MEDIA_VIDEO:
+        put_be64(out + JTT1078_OFF_TIMESTAMP, encoder->frame_timestamp);
+        put_be16(out + JTT1078_OFF_I_INTERVAL, encoder->i_frame_interval);
+        put_be16(out + JTT1078_OFF_INTERVAL, encoder->frame_interval);
+        break;
+    case JTT1078_MEDIA_AUDIO:
+        put_be64(out + JTT1078_OFF_TIMESTAMP, encoder->audio_timestamp);
+        put_be16(out + JTT1078_OFF_I_INTERVAL, 0);
+        put_be16(out + JTT1078_OFF_INTERVAL, 0);
+        break;
+    default:
+        put_be64(out + JTT1078_OFF_TIMESTAMP, encoder->trans_timestamp);
+        put_be16(out + JTT1078_OFF_I_INTERVAL, 0);
+        put_be16(out + JTT1078_OFF_INTERVAL, 0);
+        break;
+    }
+    put_be16(out + JTT1078_OFF_LENGTH, data_len);
+}
+
+// 分配 n 个连续的包序号, 返回首包序号
+static inline uint16_t alloc_seq(jtt1078_encoder_t *encoder, uint32_t n) {
+    return __atomic_fetch_add(&encoder->packet_seq, (uint16_t)n, __ATOMIC_RELAXED);
+}
+
+// 发送顺序: 各帧按首包序号依次回调, 一帧的分包在线上连续
+// 轮到本帧时无锁进入, 只有另一线程的帧尚未发完时才在条件变量上等待
+static void turn_wait(jtt1078_encoder_t *encoder, uint16_t first) {
+    if (__atomic_load_n(&encoder->send_seq, __ATOMIC_ACQUIRE) == first) {
+        return;
+    }
+    
+    JTT1078_STAT_ADD(encoder->stats.order_waits, 1);
+    pthread_mutex_lock(&encoder->send_mutex);
+    __atomic_fetch_add(&encoder->send_waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&encoder->send_seq, __ATOMIC_SEQ_CST) != first) {
+        pthread_cond_wait(&encoder->send_cond, &encoder->send_mutex);
+    }
+    __atomic_fetch_sub(&encoder->send_waiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&encoder->send_mutex);
+}
+
+// 本帧发完(或失败): 轮到下一帧; 有等待者时才加锁唤醒
+static void turn_release(jtt1078_encoder_t *encoder, uint16_t next) {
+    __atomic_store_n(&encoder->send_seq, next, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&encoder->send_waiters, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&encoder->send_mutex);
+        pthread_cond_broadcast(&encoder->send_cond);
+        pthread_mutex_unlock(&encoder->send_mutex);
+    }
+}
+
+// 填充校验包头: 沿用当前帧的时间信息, 序号取组内首包序号(不占用包序号)
+static void fill_parity_header(jtt1078_encoder_t *encoder,
+                               uint8_t *out,
+                               uint16_t data_len,
+                               uint8_t data_type,
+                               uint16_t base_seq) {
+    memcpy(out, encoder->hdr_template, JTT1078_HEADER_SIZE);
+    out[JTT1078_OFF_MPT] = 0x80 | JTT1078_FEC_PT;
+    put_be16(out + JTT1078_OFF_SEQ, base_seq);
+    out[JTT1078_OFF_TYPE] = (uint8_t)((data_type << 4) | JTT1078_PKT_ATOMIC);
+    put_be64(out + JTT1078_OFF_TIMESTAMP, encoder->frame_timestamp);
+    put_be16(out + JTT1078_OFF_I_INTERVAL, encoder->i_frame_interval);
+    put_be16(out + JTT1078_OFF_INTERVAL, encoder->frame_interval);
+    put_be16(out + JTT1078_OFF_LENGTH, data_len);
+}
+
+// 解析线上格式包头
+int jtt1078_parse_header(const uint8_t *buf, size_t len, jtt1078_header_t *hdr) {
+    if (!buf || !hdr || len < JTT1078_HEADER_SIZE) {
+        return -1;
+    }
+    
+    hdr->header_flag = get_be32(buf + JTT1078_OFF_FLAG);
+    if (hdr->header_flag != JTT1078_HEADER_FLAG) {
+        return -1;
     }
     
-    // 帧间隔信息
-    hdr->last_i_frame_interval = jtt1078_htons(encoder->i_frame_interval);
-    hdr->last_frame_interval = jtt1078_htons(encoder->frame_interval);
+    uint8_t b = buf[JTT1078_OFF_VPXCC];
+    hdr->v = b >> 6;
+    hdr->p = (b >> 5) & 0x01;
+    hdr->x = (b >> 4) & 0x01;
+    hdr->cc = b & 0x0F;
+    
+    b = buf[JTT1078_OFF_MPT];
+    hdr->m = b >> 7;
+    hdr->pt = b & 0x7F;
     
-    // 数据体长度
-    hdr->data_length = jtt1078_htons(data_len);
+    hdr->packet_seq = get_be16(buf + JTT1078_OFF_SEQ);
+    memcpy(hdr->sim, buf + JTT1078_OFF_SIM, 6);
+    hdr->channel = buf[JTT1078_OFF_CHANNEL];
+    hdr->data_type = buf[JTT1078_OFF_TYPE] >> 4;
+    hdr->subpackage = buf[JTT1078_OFF_TYPE] & 0x0F;
+    hdr->timestamp = get_be64(buf + JTT1078_OFF_TIMESTAMP);
+    hdr->last_i_frame_interval = get_be16(buf + JTT1078_OFF_I_INTERVAL);
+    hdr->last_frame_interval = get_be16(buf + JTT1078_OFF_INTERVAL);
+    hdr->data_length = get_be16(buf + JTT1078_OFF_LENGTH);
+    
+    return 0;
+}
+
+// 创建JT/T 1078数据包
+int jtt1078_create_packet(jtt1078_encoder_t *encoder,
+                          jtt1078_packet_t *packet,
+                          const uint8_t *data,
+                          uint16_t data_len,
+                          uint8_t data_type,
+                          uint8_t subpackage) {
+    if (!encoder || !packet || !data) {
+        return -1;
+    }
+    
+    if (data_len > JTT1078_MAX_PAYLOAD_SIZE) {
+        fprintf(stderr, "[JTT1078] Payload too large: %d > %d\n", 
+                data_len, JTT1078_MAX_PAYLOAD_SIZE);
+        return -1;
+    }
+    
+    // 单独调用时按单调时钟计时, 新帧从原子包或第一包开始
+    if (subpackage == JTT1078_PKT_ATOMIC || subpackage == JTT1078_PKT_FIRST) {
+        begin_frame_clock(encoder, data_type);
+    }
+    
+    // 包由调用方自行发送, 不占用发送顺序
+    uint16_t seq = alloc_seq(encoder, 1);
+    turn_wait(encoder, seq);
+    turn_release(encoder, (uint16_t)(seq + 1));
+    fill_header(encoder, packet->header, seq, data_len, data_type, subpackage);
     
     // 拷贝负载数据
     memcpy(packet->payload, data, data_len);
@@ -181,167 +517,1019 @@ int jtt1078_create_packet(jtt1078_encoder_t *encoder,
     return 0;
 }
 
+static inline uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 记录一次发送回调的结果与耗时
+static void record_send(jtt1078_encoder_t *encoder, uint64_t start_us, int ret) {
+    uint64_t us = monotonic_us() - start_us;
+    uint32_t bucket = us ? 64 - __builtin_clzll(us) : 0;
+    if (bucket >= JTT1078_STATS_LAT_BUCKETS) {
+        bucket = JTT1078_STATS_LAT_BUCKETS - 1;
+    }
+    
+    JTT1078_STAT_ADD(encoder->stats.send_calls, 1);
+    JTT1078_STAT_ADD(encoder->stats.send_us_hist[bucket], 1);
+    JTT1078_STAT_MAX(encoder->stats.send_us_max, us);
+    if (ret < 0) {
+        JTT1078_STAT_ADD(encoder->stats.send_failures, 1);
+    }
+}
+
+// 调用发送回调并计时
+static int call_sendv(jtt1078_encoder_t *encoder, const struct iovec *iov, int iovcnt) {
+    uint64_t start = monotonic_us();
+    int ret = encoder->send_packetv(iov, iovcnt, encoder->user_data);
+    record_send(encoder, start, ret);
+    return ret;
+}
+
+static int call_send(jtt1078_encoder_t *encoder, const uint8_t *data, size_t len) {
+    uint64_t start = monotonic_us();
+    int ret = encoder->send_packet(data, len, encoder->user_data);
+    record_send(encoder, start, ret);
+    return ret;
+}
+
+// 发送头部+负载
+// 优先走iovec回调(零拷贝); 仅注册了旧回调时, 在栈上拼包后调用(兼容层)
+static int send_iov(jtt1078_encoder_t *encoder,
+                    const void *header, size_t header_len,
+                    const uint8_t *payload, size_t payload_len) {
+    int ret;
+    
+    if (encoder->send_packetv) {
+        struct iovec iov[2] = {
+            { .iov_base = (void *)header,  .iov_len = header_len },
+            { .iov_base = (void *)payload, .iov_len = payload_len },
+        };
+        ret = call_sendv(encoder, iov, payload_len ? 2 : 1);
+    } else if (encoder->send_packet) {
+        uint8_t stack_buf[JTT1078_MAX_PACKET_SIZE];
+        uint8_t *buf = stack_buf;
+        if (header_len + payload_len > sizeof(stack_buf)) {
+            if (!encoder->tx_buf) {
+                return -1;
+            }
+            buf = encoder->tx_buf;
+        }
+        memcpy(buf, header, header_len);
+        memcpy(buf + header_len, payload, payload_len);
+        ret = call_send(encoder, buf, header_len + payload_len);
+    } else {
+        return -1;
+    }
+    
+    if (ret < 0) {
+        fprintf(stderr, "[JTT1078] Send failed\n");
+        return -1;
+    }
+    
+    return 0;
+}
+
 // 发送数据包
 int jtt1078_send_packet(jtt1078_encoder_t *encoder, const jtt1078_packet_t *packet) {
-    if (!encoder || !packet || !encoder->send_packet) {
+    if (!encoder || !packet) {
         return -1;
     }
     
-    // 计算总长度
-    size_t total_len = sizeof(jtt1078_header_t) + packet->payload_len;
-    
-    // 分配发送缓冲区
-    uint8_t *send_buf = (uint8_t *)malloc(total_len);
-    if (!send_buf) {
-        fprintf(stderr, "[JTT1078] Failed to allocate send buffer\n");
+    if (send_iov(encoder, packet->header, JTT1078_HEADER_SIZE,
+                 packet->payload, packet->payload_len) < 0) {
         return -1;
     }
     
-    // 拷贝头部和负载
-    memcpy(send_buf, &packet->header, sizeof(jtt1078_header_t));
-    memcpy(send_buf + sizeof(jtt1078_header_t), packet->payload, packet->payload_len);
+    uint8_t data_type = packet->header[JTT1078_OFF_TYPE] >> 4;
+    if (data_type < JTT1078_STATS_TYPES) {
+        uint8_t subpackage = packet->header[JTT1078_OFF_TYPE] & 0x0F;
+        if (subpackage == JTT1078_PKT_ATOMIC || subpackage == JTT1078_PKT_LAST) {
+            JTT1078_STAT_ADD(encoder->stats.frames[data_type], 1);
+        }
+        JTT1078_STAT_ADD(encoder->stats.packets[data_type], 1);
+        JTT1078_STAT_ADD(encoder->stats.bytes[data_type], JTT1078_HEADER_SIZE + packet->payload_len);
+    }
+    return 0;
+}
+
+// 获取分包标识
+static inline uint8_t subpackage_flag(uint32_t index, uint32_t total) {
+    if (total == 1) {
+        return JTT1078_PKT_ATOMIC;     // 不分包
+    } else if (index == 0) {
+        return JTT1078_PKT_FIRST;      // 第一包
+    } else if (index == total - 1) {
+        return JTT1078_PKT_LAST;       // 最后一包
+    }
+    return JTT1078_PKT_MIDDLE;         // 中间包
+}
+
+// 本帧的校验包总数, 未启用FEC或该类型不保护时为0
+static uint32_t fec_parity_total(const jtt1078_encoder_t *encoder, uint8_t data_type,
+                                 uint32_t total_packets) {
+    if (!encoder->fec || total_packets > 0xFFFF) {
+        return 0;
+    }
+    return jtt1078_fec_parity_total(encoder->fec, data_type, total_packets);
+}
+
+// 为帧内 [first, first + k) 分包生成 m 个校验包
+// 包头写入 hdrs, 数据体写入 fec->bodies 的第 slot 个起, 返回数据体长度
+static uint32_t fec_group(jtt1078_encoder_t *encoder,
+                          const uint8_t *data,
+                          uint32_t size,
+                          uint8_t data_type,
+                          uint32_t first,
+                          uint32_t k,
+                          uint32_t m,
+                          uint32_t total,
+                          uint16_t base_seq,
+                          uint8_t *hdrs,
+                          uint32_t slot) {
+    jtt1078_fec_encoder_t *fec = encoder->fec;
+    const uint32_t payload_size = encoder->payload_size;
+    uint32_t offset = first * payload_size;
+    uint32_t src_len = size - offset;
+    if (src_len > k * payload_size) {
+        src_len = k * payload_size;
+    }
     
-    // 调用发送回调
-    int ret = encoder->send_packet(send_buf, total_len, encoder->user_data);
+    jtt1078_fec_group_t g = {
+        .k = (uint8_t)k,
+        .m = (uint8_t)m,
+        .pt = encoder->hdr_template[JTT1078_OFF_MPT] & 0x7F,
+        .first = (uint16_t)first,
+        .total = (uint16_t)total,
+        .last_len = (uint16_t)(size - (total - 1) * payload_size),
+        .symbol = (uint16_t)(total > 1 ? payload_size : size),
+    };
+    jtt1078_fec_encode(&g, data + offset, src_len, fec->bodies + slot * fec->stride, fec->stride);
     
-    free(send_buf);
+    uint32_t body_len = JTT1078_FEC_HEADER_SIZE + g.symbol;
+    for (uint32_t i = 0; i < m; i++) {
+        fill_parity_header(encoder, hdrs + i * JTT1078_HEADER_SIZE, (uint16_t)body_len,
+                           data_type, base_seq);
+    }
+    fec->groups++;
+    fec->parity_packets += m;
+    return body_len;
+}
+
+// 节奏控制: 逐包发送时每包取得发送额度(只对视频帧生效)
+static inline void pace_packet(jtt1078_encoder_t *encoder, uint32_t bytes, uint8_t data_type) {
+    if (encoder->pacer && encoder->pacer->in_frame && data_type <= JTT1078_DATA_TYPE_VIDEO_B) {
+        jtt1078_pacer_wait(encoder->pacer, bytes);
+    }
+}
+
+// 发出批量模式的 n 个分包({头部, 数据体}成对)
+// 用户态节奏控制且整帧超过桶深时, 按不超过桶深的完整分包分段回调
+// 节奏控制状态属于视频线程, 音频/透传帧不经过
+static int send_batch(jtt1078_encoder_t *encoder, const struct iovec *iov, uint32_t n,
+                      uint8_t data_type) {
+    jtt1078_pacer_t *pacer = encoder->pacer;
     
-    if (ret < 0) {
-        fprintf(stderr, "[JTT1078] Send failed\n");
-        return -1;
+    if (!pacer || !pacer->in_frame || data_type > JTT1078_DATA_TYPE_VIDEO_B) {
+        return call_sendv(encoder, iov, n * 2);
+    }
+    
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < n * 2; i++) {
+        total += iov[i].iov_len;
+    }
+    if (!jtt1078_pacer_split(pacer, total)) {
+        jtt1078_pacer_wait(pacer, total);
+        return call_sendv(encoder, iov, n * 2);
     }
     
+    for (uint32_t first = 0; first < n; ) {
+        uint32_t count = 0, bytes = 0;
+        while (first + count < n) {
+            uint32_t len = iov[(first + count) * 2].iov_len + iov[(first + count) * 2 + 1].iov_len;
+            if (count > 0 && bytes + len > pacer->burst_bytes) {
+                break;
+            }
+            bytes += len;
+            count++;
+        }
+        jtt1078_pacer_wait(pacer, bytes);
+        if (call_sendv(encoder, iov + first * 2, count * 2) < 0) {
+            return -1;
+        }
+        first += count;
+    }
     return 0;
 }
 
-// 编码并发送视频帧
-int jtt1078_encode_video_frame(jtt1078_encoder_t *encoder, const video_frame_t *frame) {
-    if (!encoder || !frame || !frame->data) {
+// 批量模式: 整帧头部写入本媒体类别的头部区, 轮到本帧时一次回调发出
+// 启用FEC时每组源包之后紧跟该组的校验包
+static int encode_payload_batch(jtt1078_encoder_t *encoder,
+                                const uint8_t *data,
+                                uint32_t size,
+                                uint8_t data_type) {
+    const uint32_t payload_size = encoder->payload_size;
+    uint32_t total_packets = (size + payload_size - 1) / payload_size;
+    uint32_t parity_packets = fec_parity_total(encoder, data_type, total_packets);
+    jtt1078_batch_arena_t *arena = &encoder->batch[media_of(data_type)];
+    
+    if (batch_reserve(arena, total_packets + parity_packets) < 0) {
+        fprintf(stderr, "[JTT1078] Failed to grow batch arena to %u packets\n",
+                total_packets + parity_packets);
+        return -1;
+    }
+    if (parity_packets && jtt1078_fec_reserve(encoder->fec, parity_packets) < 0) {
         return -1;
     }
     
-    // 确定数据类型
-    uint8_t data_type;
-    if (frame->is_keyframe || frame->frame_type == JTT1078_DATA_TYPE_VIDEO) {
-        data_type = JTT1078_DATA_TYPE_VIDEO;  // I帧
-    } else if (frame->frame_type == JTT1078_DATA_TYPE_VIDEO_P) {
-        data_type = JTT1078_DATA_TYPE_VIDEO_P; // P帧
-    } else {
-        data_type = JTT1078_DATA_TYPE_VIDEO_B; // B帧
+    struct iovec *iov = arena->iov;
+    uint16_t seq = alloc_seq(encoder, total_packets);
+    uint32_t offset = 0;
+    uint32_t n = 0;                 // 已写入的包数(含校验包)
+    uint32_t parity_used = 0;
+    uint32_t group_first = 0, group_k = 0;
+    uint16_t group_seq = 0;
+    
+    for (uint32_t i = 0; i < total_packets; i++) {
+        if (parity_packets && i == group_first + group_k) {
+            group_first = i;
+            group_k = jtt1078_fec_group_size(encoder->fec, total_packets, i);
+            group_seq = (uint16_t)(seq + i);
+        }
+        
+        uint32_t chunk_size = size - offset;
+        if (chunk_size > payload_size) {
+            chunk_size = payload_size;
+        }
+        
+        uint8_t *hdr = arena->hdrs + n * JTT1078_HEADER_SIZE;
+        fill_header(encoder, hdr, (uint16_t)(seq + i), chunk_size, data_type,
+                    subpackage_flag(i, total_packets));
+        
+        iov[n * 2].iov_base = hdr;
+        iov[n * 2].iov_len = JTT1078_HEADER_SIZE;
+        iov[n * 2 + 1].iov_base = (void *)(data + offset);
+        iov[n * 2 + 1].iov_len = chunk_size;
+        n++;
+        
+        offset += chunk_size;
+        
+        uint32_t m = 0;
+        if (parity_packets && i + 1 == group_first + group_k) {
+            m = jtt1078_fec_parity_count(encoder->fec, data_type, group_k);
+        }
+        if (m > 0) {
+            uint32_t body_len = fec_group(encoder, data, size, data_type, group_first, group_k, m,
+                                          total_packets, group_seq,
+                                          arena->hdrs + n * JTT1078_HEADER_SIZE, parity_used);
+            for (uint32_t j = 0; j < m; j++, n++) {
+                iov[n * 2].iov_base = arena->hdrs + n * JTT1078_HEADER_SIZE;
+                iov[n * 2].iov_len = JTT1078_HEADER_SIZE;
+                iov[n * 2 + 1].iov_base = encoder->fec->bodies + (parity_used + j) * encoder->fec->stride;
+                iov[n * 2 + 1].iov_len = body_len;
+            }
+            parity_used += m;
+        }
     }
     
-    uint32_t remaining = frame->size;
+    turn_wait(encoder, seq);
+    int ret = send_batch(encoder, iov, n, data_type);
+    turn_release(encoder, (uint16_t)(seq + total_packets));
+    if (ret < 0) {
+        fprintf(stderr, "[JTT1078] Failed to send frame (%u packets)\n", n);
+        return -1;
+    }
+    
+    return n;
+}
+
+// 逐包模式: 每个分包单独回调
+static int encode_payload_packets(jtt1078_encoder_t *encoder,
+                                  const uint8_t *data,
+                                  uint32_t size,
+                                  uint8_t data_type) {
+    uint32_t remaining = size;
     uint32_t offset = 0;
+    uint32_t index = 0;
     int packet_count = 0;
     
     // 计算需要分包的数量
-    int total_packets = (remaining + JTT1078_MAX_PAYLOAD_SIZE - 1) / JTT1078_MAX_PAYLOAD_SIZE;
+    const uint32_t payload_size = encoder->payload_size;
+    uint32_t total_packets = (remaining + payload_size - 1) / payload_size;
+    
+    bool fec = fec_parity_total(encoder, data_type, total_packets) > 0;
+    if (fec && jtt1078_fec_reserve(encoder->fec, JTT1078_FEC_MAX_PARITY) < 0) {
+        return -1;
+    }
+    uint32_t group_first = 0, group_k = 0;
+    uint16_t group_seq = 0;
     
-    printf("[JTT1078] Encoding video frame: type=%d, size=%u, packets=%d\n",
-           data_type, frame->size, total_packets);
+    if (total_packets == 0) {
+        return 0;
+    }
+    
+    // 整帧逐包回调期间占用发送顺序, 另一线程的帧排在本帧之后
+    uint16_t seq = alloc_seq(encoder, total_packets);
+    turn_wait(encoder, seq);
     
     while (remaining > 0) {
-        uint16_t chunk_size = (remaining > JTT1078_MAX_PAYLOAD_SIZE) ? 
-                              JTT1078_MAX_PAYLOAD_SIZE : remaining;
-        
-        // 确定分包标识
-        uint8_t subpackage;
-        if (total_packets == 1) {
-            subpackage = JTT1078_PKT_ATOMIC;     // 不分包
-        } else if (offset == 0) {
-            subpackage = JTT1078_PKT_FIRST;      // 第一包
-        } else if (chunk_size == remaining) {
-            subpackage = JTT1078_PKT_LAST;       // 最后一包
-        } else {
-            subpackage = JTT1078_PKT_MIDDLE;     // 中间包
+        if (fec && index == group_first + group_k) {
+            group_first = index;
+            group_k = jtt1078_fec_group_size(encoder->fec, total_packets, index);
+            group_seq = (uint16_t)(seq + index);
         }
         
-        // 创建数据包
-        jtt1078_packet_t packet;
-        if (jtt1078_create_packet(encoder, &packet,
-                                  frame->data + offset,
-                                  chunk_size,
-                                  data_type,
-                                  subpackage) < 0) {
-            fprintf(stderr, "[JTT1078] Failed to create packet\n");
-            return -1;
-        }
+        uint16_t chunk_size = (remaining > payload_size) ? 
+                              payload_size : remaining;
+        
+        uint8_t hdr[JTT1078_HEADER_SIZE];
+        fill_header(encoder, hdr, (uint16_t)(seq + index), chunk_size, data_type,
+                    subpackage_flag(index, total_packets));
         
         // 发送数据包
-        if (jtt1078_send_packet(encoder, &packet) < 0) {
-            fprintf(stderr, "[JTT1078] Failed to send packet %d\n", packet_count);
-            return -1;
+        pace_packet(encoder, JTT1078_HEADER_SIZE + chunk_size, data_type);
+        if (send_iov(encoder, hdr, JTT1078_HEADER_SIZE, data + offset, chunk_size) < 0) {
+            fprintf(stderr, "[JTT1078] Failed to send packet %u\n", index);
+            packet_count = -1;
+            break;
         }
         
         offset += chunk_size;
         remaining -= chunk_size;
+        index++;
         packet_count++;
+        
+        // 组内最后一个源包之后发送该组的校验包
+        uint32_t m = 0;
+        if (fec && index == group_first + group_k) {
+            m = jtt1078_fec_parity_count(encoder->fec, data_type, group_k);
+        }
+        if (m > 0) {
+            uint8_t phdr[JTT1078_FEC_MAX_PARITY * JTT1078_HEADER_SIZE];
+            uint32_t body_len = fec_group(encoder, data, size, data_type, group_first, group_k, m,
+                                          total_packets, group_seq, phdr, 0);
+            for (uint32_t j = 0; j < m && packet_count >= 0; j++) {
+                pace_packet(encoder, JTT1078_HEADER_SIZE + body_len, data_type);
+                if (send_iov(encoder, phdr + j * JTT1078_HEADER_SIZE, JTT1078_HEADER_SIZE,
+                             encoder->fec->bodies + j * encoder->fec->stride, body_len) < 0) {
+                    fprintf(stderr, "[JTT1078] Failed to send FEC packet %u\n", j);
+                    packet_count = -1;
+                    break;
+                }
+                packet_count++;
+            }
+            if (packet_count < 0) {
+                break;
+            }
+        }
     }
     
-    printf("[JTT1078] Video frame sent: %d packets\n", packet_count);
+    turn_release(encoder, (uint16_t)(seq + total_packets));
     return packet_count;
 }
 
+// 分包并发送负载, 负载直接引用调用方缓冲区
+// 启用节奏控制时视频帧按线上字节数(含包头与校验包)和帧间隔确定发送速率
+static int encode_payload(jtt1078_encoder_t *encoder,
+                          const uint8_t *data,
+                          uint32_t size,
+                          uint8_t data_type) {
+    uint32_t packets = (size + encoder->payload_size - 1) / encoder->payload_size;
+    uint32_t parity = fec_parity_total(encoder, data_type, packets);
+    uint32_t parity_bytes = parity * (JTT1078_HEADER_SIZE + JTT1078_FEC_HEADER_SIZE + encoder->payload_size);
+    bool paced = encoder->pacer && size > 0 && data_type <= JTT1078_DATA_TYPE_VIDEO_B;
+    
+    if (paced) {
+        jtt1078_pacer_begin(encoder->pacer, size + packets * JTT1078_HEADER_SIZE + parity_bytes,
+                            encoder->frame_interval);
+    }
+    
+    int ret;
+    if (encoder->batch_mode && size > 0) {
+        ret = encode_payload_batch(encoder, data, size, data_type);
+    } else {
+        ret = encode_payload_packets(encoder, data, size, data_type);
+    }
+    
+    if (paced) {
+        jtt1078_pacer_end(encoder->pacer);
+    }
+    
+    if (ret > 0 && data_type < JTT1078_STATS_TYPES) {
+        JTT1078_STAT_ADD(encoder->stats.frames[data_type], 1);
+        JTT1078_STAT_ADD(encoder->stats.packets[data_type], packets);
+        JTT1078_STAT_ADD(encoder->stats.bytes[data_type], size + packets * JTT1078_HEADER_SIZE);
+        if (parity) {
+            JTT1078_STAT_ADD(encoder->stats.parity_packets, parity);
+            JTT1078_STAT_ADD(encoder->stats.parity_bytes, parity_bytes);
+        }
+    }
+    return ret;
+}
+
+// 设置关键帧请求回调
+int jtt1078_encoder_set_keyframe_callback(jtt1078_encoder_t *encoder,
+                                          void (*request_keyframe)(void *user_data),
+                                          void *user_data) {
+    if (!encoder) {
+        return -1;
+    }
+    
+    encoder->request_keyframe = request_keyframe;
+    encoder->keyframe_user_data = user_data;
+    return 0;
+}
+
+// 启用GOP缓存
+int jtt1078_encoder_enable_gop_cache(jtt1078_encoder_t *encoder, uint32_t max_bytes) {
+    if (!encoder || max_bytes == 0) {
+        return -1;
+    }
+    
+    jtt1078_gop_cache_t *gop = encoder->gop;
+    if (!gop) {
+        gop = calloc(1, sizeof(jtt1078_gop_cache_t));
+        if (!gop) {
+            return -1;
+        }
+    }
+    
+    uint8_t *data = realloc(gop->data, max_bytes);
+    if (!data) {
+        fprintf(stderr, "[JTT1078] Failed to allocate %u-byte GOP cache\n", max_bytes);
+        if (!encoder->gop) {
+            free(gop);
+        }
+        return -1;
+    }
+    
+    gop->data = data;
+    gop->capacity = max_bytes;
+    gop->used = 0;
+    gop->count = 0;
+    gop->valid = false;
+    encoder->gop = gop;
+    return 0;
+}
+
+// 启用前向纠错
+int jtt1078_encoder_enable_fec(jtt1078_encoder_t *encoder, uint8_t i_ratio, uint8_t p_ratio,
+                               uint8_t group_size) {
+    if (!encoder || group_size == 0 || group_size > JTT1078_FEC_MAX_SOURCE) {
+        return -1;
+    }
+    
+    jtt1078_fec_encoder_t *fec = encoder->fec;
+    if (!fec) {
+        fec = calloc(1, sizeof(jtt1078_fec_encoder_t));
+        if (!fec) {
+            return -1;
+        }
+        fec->stride = JTT1078_FEC_HEADER_SIZE + JTT1078_FEC_MAX_SYMBOL;
+    }
+    if (jtt1078_fec_reserve(fec, JTT1078_FEC_MAX_PARITY) < 0) {
+        if (!encoder->fec) {
+            free(fec);
+        }
+        return -1;
+    }
+    
+    fec->i_ratio = i_ratio;
+    fec->p_ratio = p_ratio;
+    fec->group_size = group_size;
+    encoder->fec = fec;
+    
+    // 校验包 = 包头 + FEC头 + 符号, 不超过 JTT1078_MAX_PACKET_SIZE
+    if (encoder->payload_size > JTT1078_FEC_MAX_SYMBOL) {
+        encoder->payload_size = JTT1078_FEC_MAX_SYMBOL;
+    }
+    
+    jtt1078_fec_init();
+    return 0;
+}
+
+// 启用音频聚合
+int jtt1078_encoder_enable_audio_aggregation(jtt1078_encoder_t *encoder, uint16_t max_ms) {
+    if (!encoder || max_ms == 0) {
+        return -1;
+    }
+    
+    jtt1078_audio_agg_t *agg = encoder->audio_agg;
+    if (!agg) {
+        agg = calloc(1, sizeof(jtt1078_audio_agg_t));
+        if (!agg) {
+            return -1;
+        }
+    }
+    
+    // 未发送的音频在调整前发出
+    if (agg->used > 0 && jtt1078_encoder_flush_audio(encoder) < 0) {
+        return -1;
+    }
+    
+    uint8_t *data = realloc(agg->data, encoder->payload_size);
+    if (!data) {
+        fprintf(stderr, "[JTT1078] Failed to allocate audio aggregation buffer\n");
+        if (!encoder->audio_agg) {
+            free(agg);
+        }
+        return -1;
+    }
+    
+    agg->data = data;
+    agg->capacity = encoder->payload_size;
+    agg->max_ms = max_ms;
+    encoder->audio_agg = agg;
+    return 0;
+}
+
+// 启用视频发送节奏控制
+int jtt1078_encoder_enable_pacing(jtt1078_encoder_t *encoder, uint8_t fraction_pct,
+                                  uint32_t burst_bytes) {
+    if (!encoder || fraction_pct == 0 || fraction_pct > 100) {
+        fprintf(stderr, "[JTT1078] Invalid pacing fraction: %u%% (1-100)\n", fraction_pct);
+        return -1;
+    }
+    
+    // 重新配置时保留已设置的socket和速率上限
+    int fd = -1;
+    uint32_t max_rate = 0;
+    jtt1078_pacer_t *pacer = encoder->pacer;
+    if (pacer) {
+        fd = pacer->fd;
+        max_rate = pacer->max_rate;
+        jtt1078_pacer_deinit(pacer);
+    } else {
+        pacer = calloc(1, sizeof(jtt1078_pacer_t));
+        if (!pacer) {
+            return -1;
+        }
+    }
+    
+    jtt1078_pacer_init(pacer, fraction_pct, burst_bytes);
+    jtt1078_pacer_set_max_rate(pacer, max_rate);
+    if (fd >= 0) {
+        jtt1078_pacer_set_socket(pacer, fd);
+    }
+    encoder->pacer = pacer;
+    return 0;
+}
+
+// 设置节奏控制的发送速率上限
+int jtt1078_encoder_set_pacing_max_rate(jtt1078_encoder_t *encoder, uint32_t max_rate) {
+    if (!encoder || !encoder->pacer) {
+        return -1;
+    }
+    
+    jtt1078_pacer_set_max_rate(encoder->pacer, max_rate);
+    return 0;
+}
+
+// 设置节奏控制使用的socket
+int jtt1078_encoder_set_pacing_socket(jtt1078_encoder_t *encoder, int fd) {
+    if (!encoder || !encoder->pacer) {
+        return -1;
+    }
+    
+    return jtt1078_pacer_set_socket(encoder->pacer, fd);
+}
+
+// 逐个计数器原子读取
+static void load_counters(uint64_t *dst, const uint64_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = JTT1078_STAT_LOAD(src[i]);
+    }
+}
+
+// 获取编码器统计快照(无锁)
+void jtt1078_encoder_get_stats(const jtt1078_encoder_t *encoder, jtt1078_encoder_stats_t *out) {
+    const jtt1078_encoder_stats_t *s = &encoder->stats;
+    
+    memset(out, 0, sizeof(jtt1078_encoder_stats_t));
+    load_counters(out->packets, s->packets, JTT1078_STATS_TYPES);
+    load_counters(out->bytes, s->bytes, JTT1078_STATS_TYPES);
+    load_counters(out->frames, s->frames, JTT1078_STATS_TYPES);
+    load_counters(out->send_us_hist, s->send_us_hist, JTT1078_STATS_LAT_BUCKETS);
+    out->parity_packets = JTT1078_STAT_LOAD(s->parity_packets);
+    out->parity_bytes = JTT1078_STAT_LOAD(s->parity_bytes);
+    out->send_calls = JTT1078_STAT_LOAD(s->send_calls);
+    out->send_failures = JTT1078_STAT_LOAD(s->send_failures);
+    out->send_us_max = JTT1078_STAT_LOAD(s->send_us_max);
+    out->frames_dropped = JTT1078_STAT_LOAD(s->frames_dropped);
+    out->frames_skipped = JTT1078_STAT_LOAD(s->frames_skipped);
+    out->resyncs = JTT1078_STAT_LOAD(s->resyncs);
+    out->order_waits = JTT1078_STAT_LOAD(s->order_waits);
+    if (encoder->pacer) {
+        jtt1078_pacer_get_stats(encoder->pacer, &out->pacing);
+    }
+}
+
+// 直方图百分位: 返回所在桶的上界
+uint64_t jtt1078_stats_hist_percentile(const uint64_t *hist, double p) {
+    uint64_t total = 0;
+    for (int i = 0; i < JTT1078_STATS_LAT_BUCKETS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    
+    uint64_t rank = (uint64_t)(p * total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < JTT1078_STATS_LAT_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= rank) {
+            return 1ULL << i;
+        }
+    }
+    return 1ULL << (JTT1078_STATS_LAT_BUCKETS - 1);
+}
+
+// 从关键帧起始处提取参数集更新缓存, 返回帧内参数集数量
+static int cache_param_sets(jtt1078_encoder_t *encoder, const uint8_t *data, uint32_t size) {
+    jtt1078_nal_t nals[8];
+    int n = jtt1078_nal_scan_prefix(data, size, encoder->video_format, nals, 8);
+    int found = 0;
+    
+    for (int i = 0; i < n; i++) {
+        if (nals[i].kind < JTT1078_NAL_VPS || nals[i].kind > JTT1078_NAL_PPS) {
+            continue;
+        }
+        found++;
+        if (nals[i].size > JTT1078_PARAM_SET_MAX) {
+            fprintf(stderr, "[JTT1078] Parameter set too large to cache: %u bytes\n", nals[i].size);
+            continue;
+        }
+        int slot = nals[i].kind - JTT1078_NAL_VPS;
+        memcpy(encoder->param_sets[slot], data + nals[i].offset, nals[i].size);
+        encoder->param_set_len[slot] = (uint16_t)nals[i].size;
+    }
+    
+    return found;
+}
+
+// 以当前帧的时间戳发送缓存的参数集(Annex-B, 作为一个I帧数据单元)
+static int send_param_sets(jtt1078_encoder_t *encoder) {
+    uint8_t buf[JTT1078_PARAM_SET_SLOTS * (4 + JTT1078_PARAM_SET_MAX)];
+    uint32_t len = 0;
+    
+    for (int slot = 0; slot < JTT1078_PARAM_SET_SLOTS; slot++) {
+        if (encoder->param_set_len[slot] == 0) {
+            continue;
+        }
+        buf[len++] = 0x00;
+        buf[len++] = 0x00;
+        buf[len++] = 0x00;
+        buf[len++] = 0x01;
+        memcpy(buf + len, encoder->param_sets[slot], encoder->param_set_len[slot]);
+        len += encoder->param_set_len[slot];
+    }
+    
+    if (len == 0) {
+        return 0;
+    }
+    return encode_payload(encoder, buf, len, JTT1078_DATA_TYPE_VIDEO);
+}
+
+// 记录一帧到GOP缓存, 时间信息取 begin_frame 的计算结果
+static void gop_cache_frame(jtt1078_encoder_t *encoder, const uint8_t *data, uint32_t size,
+                            uint8_t data_type) {
+    jtt1078_gop_cache_t *gop = encoder->gop;
+    
+    // 关键帧开始新GOP; 连续的I帧(参数集与IDR分开输出)属于同一GOP
+    if (data_type == JTT1078_DATA_TYPE_VIDEO &&
+        (gop->count == 0 || gop->frames[gop->count - 1].data_type != JTT1078_DATA_TYPE_VIDEO)) {
+        gop->count = 0;
+        gop->used = 0;
+        gop->valid = true;
+    }
+    if (!gop->valid) {
+        return;
+    }
+    
+    if (gop->count == JTT1078_GOP_CACHE_FRAMES || size > gop->capacity - gop->used) {
+        // 本GOP不再回放, 下一个关键帧重新开始
+        gop->count = 0;
+        gop->used = 0;
+        gop->valid = false;
+        return;
+    }
+    
+    jtt1078_gop_frame_t *f = &gop->frames[gop->count++];
+    f->offset = gop->used;
+    f->size = size;
+    f->data_type = data_type;
+    f->timestamp = encoder->frame_timestamp;
+    f->frame_interval = encoder->frame_interval;
+    f->i_frame_interval = encoder->i_frame_interval;
+    memcpy(gop->data + gop->used, data, size);
+    gop->used += size;
+}
+
+// 回放GOP缓存(参数集在前), 各帧沿用原时间戳
+static int gop_replay(jtt1078_encoder_t *encoder) {
+    jtt1078_gop_cache_t *gop = encoder->gop;
+    uint64_t timestamp = encoder->frame_timestamp;
+    uint16_t interval = encoder->frame_interval;
+    uint16_t i_interval = encoder->i_frame_interval;
+    
+    // 参数集使用GOP首帧的时间戳, 保证时间戳不回退
+    encoder->frame_timestamp = gop->frames[0].timestamp;
+    encoder->frame_interval = gop->frames[0].frame_interval;
+    encoder->i_frame_interval = gop->frames[0].i_frame_interval;
+    int total = send_param_sets(encoder);
+    
+    for (uint32_t i = 0; i < gop->count && total >= 0; i++) {
+        const jtt1078_gop_frame_t *f = &gop->frames[i];
+        encoder->frame_timestamp = f->timestamp;
+        encoder->frame_interval = f->frame_interval;
+        encoder->i_frame_interval = f->i_frame_interval;
+        
+        int ret = encode_payload(encoder, gop->data + f->offset, f->size, f->data_type);
+        if (ret < 0) {
+            total = -1;
+            break;
+        }
+        total += ret;
+    }
+    
+    encoder->frame_timestamp = timestamp;
+    encoder->frame_interval = interval;
+    encoder->i_frame_interval = i_interval;
+    return total;
+}
+
+// 新连接建立后: 补发参数集, 回放GOP或等待关键帧
+int jtt1078_encoder_resync(jtt1078_encoder_t *encoder) {
+    if (!encoder) {
+        return -1;
+    }
+    JTT1078_STAT_ADD(encoder->stats.resyncs, 1);
+    
+    if (encoder->gop && encoder->gop->valid && encoder->gop->count > 0) {
+        int total = gop_replay(encoder);
+        if (total < 0) {
+            return -1;
+        }
+        encoder->resync = false;
+        return total;
+    }
+    
+    int total = send_param_sets(encoder);
+    if (total < 0) {
+        return -1;
+    }
+    
+    encoder->resync = true;
+    if (encoder->request_keyframe) {
+        encoder->request_keyframe(encoder->keyframe_user_data);
+    }
+    return total;
+}
+
+// 确定视频帧数据类型
+static uint8_t video_data_type(const jtt1078_encoder_t *encoder, const video_frame_t *frame) {
+    if (frame->frame_type == JTT1078_FRAME_TYPE_AUTO && !frame->is_keyframe) {
+        int type = jtt1078_nal_frame_type(frame->data, frame->size, encoder->video_format, NULL);
+        return type < 0 ? JTT1078_DATA_TYPE_VIDEO_P : (uint8_t)type;
+    } else if (frame->is_keyframe || frame->frame_type == JTT1078_DATA_TYPE_VIDEO) {
+        return JTT1078_DATA_TYPE_VIDEO;  // I帧
+    } else if (frame->frame_type == JTT1078_DATA_TYPE_VIDEO_P) {
+        return JTT1078_DATA_TYPE_VIDEO_P; // P帧
+    }
+    return JTT1078_DATA_TYPE_VIDEO_B; // B帧
+}
+
+// 不发送, 只更新帧间隔和参数集/GOP缓存
+int jtt1078_encoder_skip_video_frame(jtt1078_encoder_t *encoder, const video_frame_t *frame) {
+    if (!encoder || !frame || !frame->data) {
+        return -1;
+    }
+    
+    uint8_t data_type = video_data_type(encoder, frame);
+    begin_frame(encoder, data_type, frame->pts);
+    JTT1078_STAT_ADD(encoder->stats.frames_skipped, 1);
+    
+    if (data_type == JTT1078_DATA_TYPE_VIDEO) {
+        cache_param_sets(encoder, frame->data, frame->size);
+    }
+    if (encoder->gop) {
+        gop_cache_frame(encoder, frame->data, frame->size, data_type);
+    }
+    return 0;
+}
+
+// 编码并发送视频帧
+int jtt1078_encode_video_frame(jtt1078_encoder_t *encoder, const video_frame_t *frame) {
+    if (!encoder || !frame || !frame->data) {
+        return -1;
+    }
+    
+    uint8_t data_type = video_data_type(encoder, frame);
+    begin_frame(encoder, data_type, frame->pts);
+    
+    int param_sets = 0;
+    if (data_type == JTT1078_DATA_TYPE_VIDEO) {
+        param_sets = cache_param_sets(encoder, frame->data, frame->size);
+    }
+    if (encoder->gop) {
+        gop_cache_frame(encoder, frame->data, frame->size, data_type);
+    }
+    
+    // 新连接在关键帧之前无法解码P/B帧
+    int prefix_packets = 0;
+    if (encoder->resync) {
+        if (data_type != JTT1078_DATA_TYPE_VIDEO) {
+            JTT1078_STAT_ADD(encoder->stats.frames_dropped, 1);
+            return 0;
+        }
+        if (param_sets == 0) {
+            prefix_packets = send_param_sets(encoder);
+            if (prefix_packets < 0) {
+                return -1;
+            }
+        }
+        encoder->resync = false;
+    }
+    
+    int packet_count = encode_payload(encoder, frame->data, frame->size, data_type);
+    if (packet_count < 0) {
+        return -1;
+    }
+    return packet_count + prefix_packets;
+}
+
+// 发送聚合缓冲区, 时间戳取第一帧的时间
+static int audio_agg_send(jtt1078_encoder_t *encoder) {
+    jtt1078_audio_agg_t *agg = encoder->audio_agg;
+    
+    // 时钟模式下 first_time 是第一帧入缓冲区时的单调时钟
+    if (encoder->ts_mode == JTT1078_TS_CLOCK) {
+        begin_frame_at(encoder, JTT1078_DATA_TYPE_AUDIO, agg->first_time - encoder->start_time_ms);
+    } else {
+        begin_frame(encoder, JTT1078_DATA_TYPE_AUDIO, agg->first_time);
+    }
+    
+    // 发送失败时缓冲区同样清空, 与单帧发送失败一样丢弃
+    int ret = encode_payload(encoder, agg->data, agg->used, JTT1078_DATA_TYPE_AUDIO);
+    agg->used = 0;
+    agg->frames = 0;
+    agg->duration_ms = 0;
+    return ret;
+}
+
+// 立即发送缓冲的音频
+int jtt1078_encoder_flush_audio(jtt1078_encoder_t *encoder) {
+    if (!encoder) {
+        return -1;
+    }
+    if (!encoder->audio_agg || encoder->audio_agg->used == 0) {
+        return 0;
+    }
+    
+    return audio_agg_send(encoder);
+}
+
+// 音频帧加入聚合缓冲区, 返回本次发送的包数
+static int audio_agg_frame(jtt1078_encoder_t *encoder, const audio_frame_t *frame) {
+    jtt1078_audio_agg_t *agg = encoder->audio_agg;
+    uint64_t now = encoder->ts_mode != JTT1078_TS_CLOCK ? frame->pts : jtt1078_get_monotonic_ms();
+    uint32_t limit = agg->capacity < encoder->payload_size ? agg->capacity : encoder->payload_size;
+    int total = 0;
+    
+    // 帧时长: G.711 每样本1字节, 其他格式取相邻帧的时间差
+    if (agg->have_last && now > agg->last_time) {
+        agg->frame_ms = (uint32_t)(now - agg->last_time);
+    }
+    agg->last_time = now;
+    agg->have_last = true;
+    uint32_t frame_ms = agg->frame_ms;
+    if (encoder->audio_format == JTT1078_AUDIO_G711A || encoder->audio_format == JTT1078_AUDIO_G711U) {
+        frame_ms = frame->size / JTT1078_G711_SAMPLES_PER_MS;
+    }
+    
+    // 放不下或超过时长上限: 先发送已缓冲的帧
+    if (agg->used > 0 &&
+        (agg->used + frame->size > limit || agg->duration_ms + frame_ms > agg->max_ms)) {
+        total = audio_agg_send(encoder);
+        if (total < 0) {
+            return -1;
+        }
+    }
+    
+    // 单帧超过一个分包, 不聚合
+    if (frame->size > limit) {
+        begin_frame(encoder, JTT1078_DATA_TYPE_AUDIO, frame->pts);
+        int ret = encode_payload(encoder, frame->data, frame->size, JTT1078_DATA_TYPE_AUDIO);
+        return ret < 0 ? -1 : total + ret;
+    }
+    
+    if (agg->used == 0) {
+        agg->first_time = now;
+    }
+    memcpy(agg->data + agg->used, frame->data, frame->size);
+    agg->used += frame->size;
+    agg->frames++;
+    agg->duration_ms += frame_ms;
+    
+    if (agg->duration_ms >= agg->max_ms) {
+        int ret = audio_agg_send(encoder);
+        if (ret < 0) {
+            return -1;
+        }
+        total += ret;
+    }
+    return total;
+}
+
 // 编码并发送音频帧
 int jtt1078_encode_audio_frame(jtt1078_encoder_t *encoder, const audio_frame_t *frame) {
     if (!encoder || !frame || !frame->data) {
         return -1;
     }
     
-    uint32_t remaining = frame->size;
-    uint32_t offset = 0;
-    int packet_count = 0;
+    if (encoder->audio_agg) {
+        return audio_agg_frame(encoder, frame);
+    }
     
-    int total_packets = (remaining + JTT1078_MAX_PAYLOAD_SIZE - 1) / JTT1078_MAX_PAYLOAD_SIZE;
+    begin_frame(encoder, JTT1078_DATA_TYPE_AUDIO, frame->pts);
     
-    while (remaining > 0) {
-        uint16_t chunk_size = (remaining > JTT1078_MAX_PAYLOAD_SIZE) ? 
-                              JTT1078_MAX_PAYLOAD_SIZE : remaining;
-        
-        // 音频一般不分包，或按相同逻辑分包
-        uint8_t subpackage = (total_packets == 1) ? JTT1078_PKT_ATOMIC :
-                            (offset == 0) ? JTT1078_PKT_FIRST :
-                            (chunk_size == remaining) ? JTT1078_PKT_LAST :
-                            JTT1078_PKT_MIDDLE;
-        
-        jtt1078_packet_t packet;
-        if (jtt1078_create_packet(encoder, &packet,
-                                  frame->data + offset,
-                                  chunk_size,
-                                  JTT1078_DATA_TYPE_AUDIO,
-                                  subpackage) < 0) {
+    // 音频一般不分包，或按相同逻辑分包
+    return encode_payload(encoder, frame->data, frame->size, JTT1078_DATA_TYPE_AUDIO);
+}
+
+// PCM编码为G.711后发送, 长帧按分包负载切段
+int jtt1078_encode_audio_pcm(jtt1078_encoder_t *encoder, const int16_t *pcm, uint32_t samples,
+                             uint64_t pts) {
+    uint8_t g711[JTT1078_MAX_PAYLOAD_SIZE];
+    int total = 0;
+    
+    if (!encoder || !pcm) {
+        return -1;
+    }
+    
+    for (uint32_t off = 0; off < samples; ) {
+        uint32_t n = samples - off;
+        if (n > sizeof(g711)) {
+            n = sizeof(g711);
+        }
+        if (jtt1078_g711_encode(encoder->audio_format, pcm + off, g711, n) < 0) {
+            fprintf(stderr, "[JTT1078] Audio format 0x%02X is not G.711\n", encoder->audio_format);
             return -1;
         }
         
-        if (jtt1078_send_packet(encoder, &packet) < 0) {
+        audio_frame_t frame = {
+            .data = g711,
+            .size = n,
+            .pts = pts + off / JTT1078_G711_SAMPLES_PER_MS,
+        };
+        int ret = jtt1078_encode_audio_frame(encoder, &frame);
+        if (ret < 0) {
             return -1;
         }
-        
-        offset += chunk_size;
-        remaining -= chunk_size;
-        packet_count++;
+        total += ret;
+        off += n;
+    }
+    return total;
+}
+
+// 编码并发送透传数据
+int jtt1078_encode_trans_data(jtt1078_encoder_t *encoder, const uint8_t *data, uint32_t size) {
+    if (!encoder || !data) {
+        return -1;
     }
     
-    return packet_count;
+    begin_frame_clock(encoder, JTT1078_DATA_TYPE_TRANS);
+    
+    return encode_payload(encoder, data, size, JTT1078_DATA_TYPE_TRANS);
 }
 
 // 打印数据包信息(调试用)
 void jtt1078_print_packet_info(const jtt1078_packet_t *packet) {
-    const jtt1078_header_t *hdr = &packet->header;
+    jtt1078_header_t hdr;
     
     printf("=== JT/T 1078 Packet ===\n");
-    printf("Header Flag: 0x%08X\n", ntohl(hdr->header_flag));
-    printf("Version: %d\n", hdr->v);
-    printf("Payload Type: %d\n", hdr->pt);
-    printf("Marker: %d\n", hdr->m);
-    printf("Sequence: %d\n", ntohs(hdr->packet_seq));
-    printf("Channel: %d\n", hdr->channel);
-    printf("Data Type: %d\n", hdr->data_type);
-    printf("Subpackage: %d\n", hdr->subpackage);
-    printf("Timestamp: %llu ms\n", (unsigned long long)jtt1078_htonll(hdr->timestamp));
-    printf("I-Frame Interval: %d ms\n", ntohs(hdr->last_i_frame_interval));
-    printf("Frame Interval: %d ms\n", ntohs(hdr->last_frame_interval));
-    printf("Data Length: %d bytes\n", ntohs(hdr->data_length));
+    if (jtt1078_parse_header(packet->header, JTT1078_HEADER_SIZE, &hdr) < 0) {
+        printf("Invalid header\n");
+        printf("========================\n");
+        return;
+    }
+    printf("Header Flag: 0x%08X\n", hdr.header_flag);
+    printf("Version: %d\n", hdr.v);
+    printf("Payload Type: %d\n", hdr.pt);
+    printf("Marker: %d\n", hdr.m);
+    printf("Sequence: %d\n", hdr.packet_seq);
+    printf("Channel: %d\n", hdr.channel);
+    printf("Data Type: %d\n", hdr.data_type);
+    printf("Subpackage: %d\n", hdr.subpackage);
+    printf("Timestamp: %llu ms\n", (unsigned long long)hdr.timestamp);
+    printf("I-Frame Interval: %d ms\n", hdr.last_i_frame_interval);
+    printf("Frame Interval: %d ms\n", hdr.last_frame_interval);
+    printf("Data Length: %d bytes\n", hdr.data_length);
     printf("Payload Length: %d bytes\n", packet->payload_len);
     printf("========================\n");
 }
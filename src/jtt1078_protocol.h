@@ -12,6 +12,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <sys/uio.h>
+#include <pthread.h>
 
 // JT/T 1078 固定头标识
 #define JTT1078_HEADER_FLAG         0x30316364  // "01cd" 
@@ -22,6 +24,7 @@
 #define JTT1078_DATA_TYPE_VIDEO_B   0x02        // 视频 B 帧
 #define JTT1078_DATA_TYPE_AUDIO     0x03        // 音频帧
 #define JTT1078_DATA_TYPE_TRANS     0x04        // 透传数据
+#define JTT1078_FRAME_TYPE_AUTO     0xFF        // 视频帧类型由码流NAL头判断
 
 // 分包处理标识
 #define JTT1078_PKT_ATOMIC          0x00        // 原子包（不分包）
@@ -38,10 +41,22 @@
 #define JTT1078_AUDIO_G711U         0x02        // G.711μ
 #define JTT1078_AUDIO_AAC           0x13        // AAC
 
+// 时间戳模式
+#define JTT1078_TS_CLOCK            0           // 单调时钟, 每帧读取一次
+#define JTT1078_TS_PTS              1           // 使用帧的 pts(毫秒)
+#define JTT1078_TS_ABSOLUTE         2           // pts 直接作为时间戳(录像回放的采集时间)
+
+// 媒体类别: 各由一个生产者线程编码, 当前帧时间与批量头部区各自独立
+#define JTT1078_MEDIA_VIDEO         0
+#define JTT1078_MEDIA_AUDIO         1
+#define JTT1078_MEDIA_TRANS         2
+#define JTT1078_MEDIA_TYPES         3
+
 // 最大包大小定义
 #define JTT1078_MAX_PACKET_SIZE     950         // TCP MTU考虑
 #define JTT1078_HEADER_SIZE         30          // 固定头长度
 #define JTT1078_MAX_PAYLOAD_SIZE    (JTT1078_MAX_PACKET_SIZE - JTT1078_HEADER_SIZE)
+#define JTT1078_PAYLOAD_SIZE_LIMIT  0xFFFF      // 数据体长度字段为16位
 
 // RTP 固定头部
 typedef struct {
@@ -58,17 +73,31 @@ typedef struct {
     uint32_t ssrc;          // 同步源标识符
 } __attribute__((packed)) rtp_header_t;
 
-// JT/T 1078 扩展头部
+// JT/T 1078 包头线上格式(30字节, 大端序), 各字段偏移
+#define JTT1078_OFF_FLAG            0           // 固定头标识(4)
+#define JTT1078_OFF_VPXCC           4           // V(2) P(1) X(1) CC(4)
+#define JTT1078_OFF_MPT             5           // M(1) PT(7)
+#define JTT1078_OFF_SEQ             6           // 包序号(2)
+#define JTT1078_OFF_SIM             8           // SIM卡号BCD(6)
+#define JTT1078_OFF_CHANNEL         14          // 逻辑通道号(1)
+#define JTT1078_OFF_TYPE            15          // 数据类型(高4位) 分包标识(低4位)
+#define JTT1078_OFF_TIMESTAMP       16          // 时间戳(8)
+#define JTT1078_OFF_I_INTERVAL      24          // 与上一个I帧的间隔(2)
+#define JTT1078_OFF_INTERVAL        26          // 与上一帧的间隔(2)
+#define JTT1078_OFF_LENGTH          28          // 数据体长度(2)
+
+// JT/T 1078 包头(解析后的主机字节序字段)
+// 线上格式不依赖本结构体布局, 由 jtt1078_parse_header 按字节解析
 typedef struct {
     uint32_t header_flag;   // 固定头标识 0x30316364
     
-    uint8_t  v:2;           // 版本号
-    uint8_t  p:1;           // 填充标志
-    uint8_t  x:1;           // 扩展标志
-    uint8_t  cc:4;          // CSRC计数
+    uint8_t  v;             // 版本号
+    uint8_t  p;             // 填充标志
+    uint8_t  x;             // 扩展标志
+    uint8_t  cc;            // CSRC计数
     
-    uint8_t  pt:7;          // 负载类型
-    uint8_t  m:1;           // 标记位
+    uint8_t  pt;            // 负载类型
+    uint8_t  m;             // 标记位
     
     uint16_t packet_seq;    // 包序号
     
@@ -76,56 +105,203 @@ typedef struct {
     uint8_t  channel;       // 逻辑通道号
     
     uint8_t  data_type;     // 数据类型
-    uint8_t  subpackage:2;  // 分包处理标识
-    uint8_t  reserved:6;    // 保留位
+    uint8_t  subpackage;    // 分包处理标识
     
     uint64_t timestamp;     // 时间戳(8字节)
     
     uint16_t last_i_frame_interval;     // 与上一个I帧的间隔
     uint16_t last_frame_interval;       // 与上一帧的间隔
     uint16_t data_length;               // 数据体长度
-} __attribute__((packed)) jtt1078_header_t;
+} jtt1078_header_t;
 
 // 完整的JT/T 1078数据包
 typedef struct {
-    jtt1078_header_t header;
+    uint8_t header[JTT1078_HEADER_SIZE];    // 线上格式包头
     uint8_t payload[JTT1078_MAX_PAYLOAD_SIZE];
     uint16_t payload_len;
 } jtt1078_packet_t;
 
+// 参数集缓存
+#define JTT1078_PARAM_SET_MAX       256         // 单个参数集最大长度(不含起始码)
+#define JTT1078_PARAM_SET_SLOTS     3           // VPS/SPS/PPS
+
+// GOP缓存(连接时回放)
+#define JTT1078_GOP_CACHE_FRAMES    128         // 最多缓存的帧数
+
+typedef struct {
+    uint32_t offset;            // 帧数据在缓存区中的偏移
+    uint32_t size;
+    uint8_t  data_type;
+    uint64_t timestamp;         // 原始发送时的时间戳和间隔, 回放时沿用
+    uint16_t frame_interval;
+    uint16_t i_frame_interval;
+} jtt1078_gop_frame_t;
+
+typedef struct {
+    uint8_t *data;              // 帧数据缓存区
+    uint32_t capacity;          // 缓存区字节数
+    uint32_t used;
+    jtt1078_gop_frame_t frames[JTT1078_GOP_CACHE_FRAMES];
+    uint32_t count;
+    bool     valid;             // 当前GOP完整缓存(以关键帧开始且未溢出)
+} jtt1078_gop_cache_t;
+
+// 音频聚合缓冲区: 连续的音频帧合并为一个分包
+typedef struct {
+    uint8_t *data;              // 缓冲区(启用时的分包负载大小)
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t frames;            // 缓冲的帧数
+    uint32_t duration_ms;       // 缓冲的音频时长
+    uint16_t max_ms;            // 每个分包的最大音频时长
+    uint32_t frame_ms;          // 非G.711格式的帧时长估计(相邻帧时间差)
+    uint64_t first_time;        // 第一帧的时间(PTS模式为帧PTS, 否则为单调时钟)
+    uint64_t last_time;         // 上一帧的时间
+    bool     have_last;
+} jtt1078_audio_agg_t;
+
+// 统计计数器: 发送线程以 relaxed 原子操作更新, 任意线程无锁读取
+// (各字段单独一致, 快照内字段之间不保证同一时刻)
+#define JTT1078_STAT_ADD(field, v)      __atomic_fetch_add(&(field), (v), __ATOMIC_RELAXED)
+#define JTT1078_STAT_STORE(field, v)    __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+#define JTT1078_STAT_LOAD(field)        __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define JTT1078_STAT_MAX(field, v)                                                      \
+    do {                                                                                \
+        __typeof__(field) _cur = JTT1078_STAT_LOAD(field);                              \
+        while ((v) > _cur && !__atomic_compare_exchange_n(&(field), &_cur, (v), true,   \
+                                                          __ATOMIC_RELAXED,             \
+                                                          __ATOMIC_RELAXED)) {          \
+        }                                                                               \
+    } while (0)
+
+#define JTT1078_STATS_TYPES         5           // 按数据类型统计: 视频I/P/B, 音频, 透传
+#define JTT1078_STATS_LAT_BUCKETS   24          // 发送调用耗时直方图桶数
+
+// 发送节奏控制统计(见 jtt1078_pace.h)
+// 节奏控制时延: 用户态为等待令牌的实际时间, 内核 pacing 为按速率发出
+// 桶深以外部分的预计时间
+typedef struct {
+    bool     kernel;                // 使用内核 pacing(SO_MAX_PACING_RATE)
+    uint32_t rate;                  // 最近一帧的发送速率(字节/秒)
+    uint32_t max_rate;              // 单帧发送速率的最大值(通常为I帧)
+    uint64_t frames;                // 经节奏控制的帧数
+    uint64_t paced_frames;          // 超过桶深、被分散发出的帧数
+    uint64_t waits;                 // 用户态等待令牌的次数
+    uint32_t last_delay_us;         // 最近一个被分散帧的节奏控制时延(微秒)
+    uint32_t max_delay_us;          // 最大节奏控制时延
+    uint64_t total_delay_us;        // 累计节奏控制时延
+} jtt1078_pace_stats_t;
+
+// 编码器统计
+// 发送调用耗时直方图按2的幂分桶: 第0桶 <1us, 第i桶 [2^(i-1), 2^i) us,
+// 最后一桶包含更长的调用(约4秒以上)
+typedef struct {
+    uint64_t packets[JTT1078_STATS_TYPES];      // 按数据类型的分包数(不含校验包)
+    uint64_t bytes[JTT1078_STATS_TYPES];        // 按数据类型的线上字节数(含包头)
+    uint64_t frames[JTT1078_STATS_TYPES];       // 按数据类型发出的帧数(含补发的参数集和回放的GOP)
+    uint64_t parity_packets;                    // FEC校验包数
+    uint64_t parity_bytes;                      // FEC校验包线上字节数
+    uint64_t send_calls;                        // 发送回调调用次数
+    uint64_t send_failures;                     // 发送回调失败次数
+    uint64_t send_us_hist[JTT1078_STATS_LAT_BUCKETS];   // 发送回调耗时直方图
+    uint64_t send_us_max;                       // 最长的一次发送回调(微秒)
+    uint64_t frames_dropped;                    // 新连接等待关键帧期间丢弃的P/B帧
+    uint64_t frames_skipped;                    // 经 jtt1078_encoder_skip_video_frame 跳过的帧(断线/拥塞)
+    uint64_t resyncs;                           // 新连接/重连次数(jtt1078_encoder_resync 调用次数)
+    uint64_t order_waits;                       // 等待另一生产者线程的帧发完的次数
+    jtt1078_pace_stats_t pacing;                // 发送节奏控制, 未启用时全为0
+} jtt1078_encoder_stats_t;
+
+struct jtt1078_fec_encoder;
+struct jtt1078_pacer;
+
+// 批量模式的头部区(每个媒体类别一个)
+typedef struct {
+    uint8_t *hdrs;              // 分包头部区, 每个分包 JTT1078_HEADER_SIZE 字节
+    struct iovec *iov;          // 整帧iovec向量(头部/负载交替)
+    uint32_t capacity;          // 头部区可容纳的分包数
+} jtt1078_batch_arena_t;
+
 // 编码器上下文
+//
+// 线程模型: 视频、音频、透传数据可以各由一个线程同时调用 jtt1078_encode_*
+// (同一媒体类别只能有一个线程)。每帧开始发送前原子地分配整帧的包序号,
+// 各帧按首包序号依次回调, 一帧的全部分包在线上连续、包序号逐包加1;
+// 当前帧时间与批量头部区按媒体类别分开, 互不覆盖。发送回调在同一时刻
+// 只被一个线程调用, 无需自行加锁; 轮到本帧时无锁进入, 只有另一线程的帧
+// 正在发送时才等待。发送回调阻塞(或视频帧节奏控制)期间另一线程的帧排在
+// 其后。回调只与同一编码器的其他回调互斥, 与其他线程共享的发送状态仍由
+// 调用方同步: jtt1078_aio_sendv 只能在循环线程中调用, 不适用于多线程生产者。
+// 连接/重连、GOP回放、FEC、节奏控制只属于视频线程; 启用/配置类接口须在
+// 生产者线程启动之前调用。
 typedef struct {
     // 基本参数
     char sim_number[13];        // SIM卡号(字符串)
     uint8_t channel;            // 通道号
     uint8_t video_format;       // 视频编码格式
     uint8_t audio_format;       // 音频编码格式
+    uint16_t payload_size;      // 分包负载大小(默认 JTT1078_MAX_PAYLOAD_SIZE)
+    uint8_t *tx_buf;            // 旧回调拼包缓冲区(负载大于默认值时分配)
     
     // 序列号管理
-    uint16_t packet_seq;        // 包序号
+    uint16_t packet_seq;        // 下一个待分配的包序号(原子分配)
+    uint16_t send_seq;          // 轮到发送的帧的首包序号
+    uint32_t send_waiters;      // 等待发送顺序的线程数
+    pthread_mutex_t send_mutex; // 只在等待发送顺序和设置PTS基准时使用
+    pthread_cond_t send_cond;
     uint32_t rtp_seq;           // RTP序列号
     uint32_t ssrc;              // RTP SSRC
     
     // 时间戳管理
-    uint64_t start_time_ms;     // 起始时间(毫秒)
+    uint8_t  ts_mode;           // 时间戳模式(JTT1078_TS_*)
+    uint64_t start_time_ms;     // 起始时间(单调时钟, 毫秒)
+    uint64_t start_pts;         // 首帧PTS(PTS模式)
+    bool     pts_started;       // 是否已记录首帧PTS
     uint64_t last_timestamp;    // 上一帧时间戳
     uint64_t last_i_timestamp;  // 上一个I帧时间戳
+    bool     have_last;         // 已发送过视频帧
+    bool     have_last_i;       // 已发送过I帧
+    
+    // 当前帧的时间信息, 每帧计算一次, 该帧所有分包共用
+    uint64_t frame_timestamp;   // 当前视频帧时间戳(ms)
+    uint16_t frame_interval;    // 当前视频帧间隔(ms)
+    uint16_t i_frame_interval;  // 与上一个I帧的间隔(ms)
+    uint64_t audio_timestamp;   // 当前音频帧时间戳(ms), 间隔字段为0
+    uint64_t trans_timestamp;   // 当前透传数据时间戳(ms)
     
-    // 帧间隔统计
-    uint16_t frame_interval;    // 当前帧间隔(ms)
-    uint16_t i_frame_interval;  // I帧间隔(ms)
+    // 预序列化的包头模板(标识/版本/PT/SIM/通道), 每包只修补可变字段
+    uint8_t hdr_template[JTT1078_HEADER_SIZE];
     
     // 回调函数
     int (*send_packet)(const uint8_t *data, size_t len, void *user_data);
+    int (*send_packetv)(const struct iovec *iov, int iovcnt, void *user_data);
     void *user_data;
     
+    // 整帧批量发送(需要iovec回调)
+    bool batch_mode;            // 是否启用批量模式
+    jtt1078_batch_arena_t batch[JTT1078_MEDIA_TYPES];   // 按媒体类别的头部区
+    
+    // 最近的参数集(按 VPS/SPS/PPS 存放, 不含起始码), 新连接时补发
+    uint8_t  param_sets[JTT1078_PARAM_SET_SLOTS][JTT1078_PARAM_SET_MAX];
+    uint16_t param_set_len[JTT1078_PARAM_SET_SLOTS];
+    bool     resync;            // 新连接等待关键帧: 丢弃P/B帧, 关键帧前补发参数集
+    void (*request_keyframe)(void *user_data);  // 请求视频编码器立即输出IDR
+    void *keyframe_user_data;
+    jtt1078_gop_cache_t *gop;   // 当前GOP缓存, 未启用时为NULL
+    struct jtt1078_fec_encoder *fec;    // 前向纠错, 未启用时为NULL(见 jtt1078_fec.h)
+    jtt1078_audio_agg_t *audio_agg;     // 音频聚合, 未启用时为NULL
+    struct jtt1078_pacer *pacer;        // 视频发送节奏控制, 未启用时为NULL(见 jtt1078_pace.h)
+    
+    // 统计(原子更新, 经 jtt1078_encoder_get_stats 读取快照)
+    jtt1078_encoder_stats_t stats;
+    
 } jtt1078_encoder_t;
 
 // 视频帧信息
 typedef struct {
     uint8_t  *data;             // 帧数据
     uint32_t size;              // 数据大小
-    uint8_t  frame_type;        // 帧类型(I/P/B)
+    uint8_t  frame_type;        // 帧类型(I/P/B), 或 JTT1078_FRAME_TYPE_AUTO
     uint64_t pts;               // 显示时间戳(毫秒)
     bool     is_keyframe;       // 是否关键帧
 } video_frame_t;
@@ -158,24 +334,216 @@ int jtt1078_encoder_init(jtt1078_encoder_t *encoder,
                          int (*send_callback)(const uint8_t *data, size_t len, void *user_data),
                          void *user_data);
 
+/**
+ * 初始化JT/T 1078编码器(iovec发送回调)
+ * 每个分包以 {头部, 负载} 两个iovec交给回调, 负载直接指向帧数据,
+ * 传输层可用 writev/sendmsg 发送, 避免分配和拷贝。
+ * @param send_callback_v iovec发送回调, 返回<0表示失败
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_init_iov(jtt1078_encoder_t *encoder,
+                             const char *sim_number,
+                             uint8_t channel,
+                             uint8_t video_format,
+                             int (*send_callback_v)(const struct iovec *iov, int iovcnt, void *user_data),
+                             void *user_data);
+
+/**
+ * 启用整帧批量发送
+ * 一帧的所有分包头写入预分配的头部区, 整帧以一个iovec向量
+ * (头0, 负载0, 头1, 负载1, ...) 调用一次 send_packetv,
+ * 传输层按 IOV_MAX 分批 writev。超出容量的帧会扩容头部区。
+ * @param encoder 编码器上下文(须以 jtt1078_encoder_init_iov 初始化)
+ * @param max_frame_size 预计最大帧大小(字节), 用于预分配
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_enable_batch(jtt1078_encoder_t *encoder, uint32_t max_frame_size);
+
+/**
+ * 释放编码器持有的资源(批量模式的头部区等)
+ * @param encoder 编码器上下文
+ */
+void jtt1078_encoder_deinit(jtt1078_encoder_t *encoder);
+
+/**
+ * 设置分包负载大小
+ * 默认按 JTT1078_MAX_PAYLOAD_SIZE 分包; 对接收更大数据体的平台(TCP)
+ * 可调大以减少每包开销。
+ * @param encoder 编码器上下文
+ * @param payload_size 每个分包的最大负载(1 ~ JTT1078_PAYLOAD_SIZE_LIMIT,
+ *                     启用FEC后不超过 JTT1078_FEC_MAX_SYMBOL)
+ * @return 0成功, -1参数超出16位长度字段范围、超过FEC符号上限或分配失败
+ */
+int jtt1078_encoder_set_payload_size(jtt1078_encoder_t *encoder, uint32_t payload_size);
+
+/**
+ * 设置时间戳模式
+ * JTT1078_TS_CLOCK: 每帧读取一次单调时钟(默认)
+ * JTT1078_TS_PTS: 使用 video_frame_t.pts / audio_frame_t.pts(毫秒),
+ *                 时间戳为相对首帧的偏移, 不受系统时间跳变影响
+ * JTT1078_TS_ABSOLUTE: pts 不减首帧, 直接作为时间戳(如录像回放时的原始
+ *                 采集时间, UTC 毫秒), 平台据此对齐回放进度
+ * 各模式下时间戳与帧间隔均按帧计算, 同一帧的所有分包取值相同。
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_set_timestamp_mode(jtt1078_encoder_t *encoder, uint8_t mode);
+
+/**
+ * 设置关键帧请求回调
+ * 调用 jtt1078_encoder_resync 且无法回放GOP时调用, 让视频编码器立即输出IDR,
+ * 缩短新连接等待关键帧的时间
+ * @param request_keyframe 回调函数, NULL表示只等待下一个自然关键帧
+ * @param user_data 回调用户数据
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_set_keyframe_callback(jtt1078_encoder_t *encoder,
+                                          void (*request_keyframe)(void *user_data),
+                                          void *user_data);
+
+/**
+ * 启用GOP缓存
+ * 编码器保留自最近关键帧以来的所有视频帧, jtt1078_encoder_resync 时
+ * 立即回放, 新连接无需等待下一个关键帧即可解码出当前画面
+ * @param max_bytes 缓存区大小, 当前GOP超出时本GOP不回放
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_enable_gop_cache(jtt1078_encoder_t *encoder, uint32_t max_bytes);
+
+/**
+ * 启用前向纠错(丢包链路, 平台须支持 jtt1078_fec.h 中的校验包格式)
+ * 视频帧的分包平均分组, 每组源包之后追加按比例生成的校验包, 接收端
+ * 组内丢失不超过校验包数时直接恢复。校验包不占用包序号。
+ * 校验包须不超过 JTT1078_MAX_PACKET_SIZE, 分包负载大于
+ * JTT1078_FEC_MAX_SYMBOL 时调小到该值, 之后 jtt1078_encoder_set_payload_size
+ * 拒绝超过该值的负载。
+ * @param i_ratio 关键帧校验包占源包的百分比(如20), 0不保护
+ * @param p_ratio P/B帧校验包占源包的百分比(如10), 0不保护
+ * @param group_size 每组最多源包数(1 ~ JTT1078_FEC_MAX_SOURCE)
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_enable_fec(jtt1078_encoder_t *encoder, uint8_t i_ratio, uint8_t p_ratio,
+                               uint8_t group_size);
+
+/**
+ * 启用音频聚合
+ * 连续的音频帧合并到一个分包发送(不超过分包负载大小), 减少包头和发送调用开销。
+ * 缓冲的音频时长达到 max_ms, 或再加一帧会超过 max_ms 时发送; 帧时长
+ * G.711 按字节数计算(8字节/毫秒), 其他格式取相邻帧的时间差。
+ * 聚合带来的额外时延不超过 max_ms 减一帧时长, 分包时间戳取第一帧的时间。
+ * @param max_ms 每个分包的最大音频时长(毫秒), 如60即三个20ms帧
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_enable_audio_aggregation(jtt1078_encoder_t *encoder, uint16_t max_ms);
+
+/**
+ * 立即发送聚合缓冲区中的音频(停止推流前调用)
+ * @return 发送的包数量(缓冲区为空时为0), <0表示失败
+ */
+int jtt1078_encoder_flush_audio(jtt1078_encoder_t *encoder);
+
+/**
+ * 启用视频发送节奏控制
+ * 一帧视频的分包分散到帧间隔的 fraction_pct% 内发出, 避免关键帧的上百个分包
+ * 连续写出使调制解调器缓冲区溢出。不超过 burst_bytes 的帧直接发出。
+ * 默认用户态令牌桶(在发送回调之间等待); 设置TCP socket后改用内核
+ * SO_MAX_PACING_RATE, 整帧一次写入, 发送线程不等待。
+ * @param fraction_pct 一帧分散发出的时间占帧间隔的百分比(1-100, 如50)
+ * @param burst_bytes 令牌桶深度(字节), 0取 4 个最大分包
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_enable_pacing(jtt1078_encoder_t *encoder, uint8_t fraction_pct,
+                                  uint32_t burst_bytes);
+
+/**
+ * 设置节奏控制的发送速率上限(取上行链路速率)
+ * 按 fraction_pct 计算的速率超过上限的帧(大I帧)按上限速率发出, 分散时间超过
+ * fraction_pct。重新调用 jtt1078_encoder_enable_pacing 时保留。
+ * @param max_rate 速率上限(字节/秒), 0不限
+ * @return 0成功, -1未启用节奏控制
+ */
+int jtt1078_encoder_set_pacing_max_rate(jtt1078_encoder_t *encoder, uint32_t max_rate);
+
+/**
+ * 设置节奏控制使用的socket(新连接建立后调用, jtt1078_conn_send_video 自动调用)
+ * @param fd socket描述符, <0表示只用用户态令牌桶
+ * @return 1使用内核pacing, 0使用用户态令牌桶, -1未启用节奏控制
+ */
+int jtt1078_encoder_set_pacing_socket(jtt1078_encoder_t *encoder, int fd);
+
+/**
+ * 获取编码器统计快照
+ * 不加锁, 可在任意线程调用, 不阻塞发送线程
+ */
+void jtt1078_encoder_get_stats(const jtt1078_encoder_t *encoder, jtt1078_encoder_stats_t *out);
+
+/**
+ * 由发送调用耗时直方图估计百分位数
+ * @param hist jtt1078_encoder_stats_t.send_us_hist
+ * @param p 百分位(0-1, 如0.99)
+ * @return 所在桶的上界(微秒), 无样本时为0
+ */
+uint64_t jtt1078_stats_hist_percentile(const uint64_t *hist, double p);
+
+/**
+ * 新连接(或重连)建立后调用
+ * 1. 立即发送缓存的参数集(VPS/SPS/PPS)
+ * 2. 启用GOP缓存且当前GOP完整时, 回放当前GOP, 之后正常发送
+ * 3. 否则请求关键帧(见 jtt1078_encoder_set_keyframe_callback), 在下一个关键帧
+ *    到来前丢弃P/B帧, 并在该关键帧前再次发送参数集(若帧内未携带)
+ * @return 发送的包数量, <0表示失败
+ */
+int jtt1078_encoder_resync(jtt1078_encoder_t *encoder);
+
+/**
+ * 跳过一帧视频(断线期间调用)
+ * 不发送, 只更新帧间隔与参数集/GOP缓存, 重连后回放的GOP是最新的
+ * @return 0成功, -1失败
+ */
+int jtt1078_encoder_skip_video_frame(jtt1078_encoder_t *encoder, const video_frame_t *frame);
+
 /**
  * 编码并发送视频帧
+ * frame_type 为 JTT1078_FRAME_TYPE_AUTO 时扫描 Annex-B 码流确定 I/P/B 类型
  * @param encoder 编码器上下文
  * @param frame 视频帧数据
- * @return 发送的包数量, <0表示失败
+ * @return 发送的包数量(resync 等待关键帧期间丢弃的帧返回0), <0表示失败
  */
 int jtt1078_encode_video_frame(jtt1078_encoder_t *encoder, const video_frame_t *frame);
 
 /**
  * 编码并发送音频帧  
+ * 启用音频聚合时帧可能只进入缓冲区(返回0), 随后续帧一起发送
  * @param encoder 编码器上下文
- * @param frame 音频帧数据
+ * @param frame 音频帧数据(已按 audio_format 编码)
  * @return 发送的包数量, <0表示失败
  */
 int jtt1078_encode_audio_frame(jtt1078_encoder_t *encoder, const audio_frame_t *frame);
 
+/**
+ * 将16位线性PCM(8kHz单声道)按 audio_format 编码为G.711后发送
+ * 等同于 jtt1078_g711_encode + jtt1078_encode_audio_frame, 长帧按分包负载切段
+ * @param pcm PCM样本
+ * @param samples 样本数
+ * @param pts 第一个样本的时间戳(毫秒)
+ * @return 发送的包数量, <0表示失败(含 audio_format 不是G.711)
+ */
+int jtt1078_encode_audio_pcm(jtt1078_encoder_t *encoder, const int16_t *pcm, uint32_t samples,
+                             uint64_t pts);
+
+/**
+ * 编码并发送透传数据
+ * 透传数据没有 pts, 时间戳取单调时钟
+ * @param encoder 编码器上下文
+ * @param data 透传数据
+ * @param size 数据长度
+ * @return 发送的包数量, <0表示失败
+ */
+int jtt1078_encode_trans_data(jtt1078_encoder_t *encoder, const uint8_t *data, uint32_t size);
+
 /**
  * 创建JT/T 1078数据包
+ * 手工组包只分配包序号, 不参与多线程的发送顺序, 只在单线程中使用
+ * 时间戳取编码器启动以来的单调时钟, 不受时间戳模式影响(不改变PTS基准)
  * @param encoder 编码器上下文
  * @param packet 输出数据包
  * @param data 负载数据
@@ -199,6 +567,15 @@ int jtt1078_create_packet(jtt1078_encoder_t *encoder,
  */
 int jtt1078_send_packet(jtt1078_encoder_t *encoder, const jtt1078_packet_t *packet);
 
+/**
+ * 解析线上格式的JT/T 1078包头
+ * @param buf 包头数据
+ * @param len 数据长度(至少 JTT1078_HEADER_SIZE)
+ * @param hdr 输出解析结果(主机字节序)
+ * @return 0成功, -1长度不足或标识错误
+ */
+int jtt1078_parse_header(const uint8_t *buf, size_t len, jtt1078_header_t *hdr);
+
 /**
  * 将SIM卡号字符串转换为BCD码
  * @param sim_str SIM卡号字符串(12位数字)
@@ -212,6 +589,12 @@ void jtt1078_sim_to_bcd(const char *sim_number, uint8_t *bcd_out);
  */
 uint64_t jtt1078_get_timestamp_ms(void);
 
+/**
+ * 获取单调时钟时间(毫秒), 不受NTP/手动校时影响
+ * @return 时间戳
+ */
+uint64_t jtt1078_get_monotonic_ms(void);
+
 /**
  * 字节序转换辅助函数
  */
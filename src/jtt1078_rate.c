@@ -0,0 +1,272 @@
+/*
+ * JT/T 1078 Rate Controller
+ * 发送队列感知的码率自适应实现
+ */
+
+#include "jtt1078_rate.h"
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#define RATE_SATURATED_BYTES    8192        // 采样周期两端发送队列都不低于该值时视为链路饱和
+#define RATE_RTT_WINDOW_MS      10000       // 最小RTT的取样窗口
+#define RATE_DECREASE_PCT       85          // 下降到容量的百分比
+#define RATE_PROBE_PCT          110         // 上调不超过容量估计的百分比
+
+void jtt1078_rate_default_config(jtt1078_rate_config_t *cfg) {
+    memset(cfg, 0, sizeof(jtt1078_rate_config_t));
+    cfg->min_bitrate = 256000;
+    cfg->max_bitrate = 2048000;
+    cfg->start_bitrate = 0;
+    cfg->target_delay_ms = 300;
+    cfg->max_delay_ms = 1000;
+    cfg->interval_ms = 200;
+    cfg->hold_ms = 2000;
+}
+
+int jtt1078_rate_init(jtt1078_rate_t *rc, const jtt1078_rate_config_t *cfg,
+                      const jtt1078_rate_hooks_t *hooks) {
+    if (!rc) {
+        return -1;
+    }
+
+    memset(rc, 0, sizeof(jtt1078_rate_t));
+    if (cfg) {
+        rc->cfg = *cfg;
+    } else {
+        jtt1078_rate_default_config(&rc->cfg);
+    }
+    if (rc->cfg.min_bitrate == 0 || rc->cfg.max_bitrate < rc->cfg.min_bitrate ||
+        rc->cfg.target_delay_ms == 0 || rc->cfg.max_delay_ms < rc->cfg.target_delay_ms) {
+        fprintf(stderr, "[JTT1078] Invalid rate controller config\n");
+        return -1;
+    }
+    if (rc->cfg.interval_ms == 0) {
+        rc->cfg.interval_ms = 1;
+    }
+    if (hooks) {
+        rc->hooks = *hooks;
+    }
+
+    uint32_t start = rc->cfg.start_bitrate ? rc->cfg.start_bitrate : rc->cfg.max_bitrate;
+    if (start < rc->cfg.min_bitrate) start = rc->cfg.min_bitrate;
+    if (start > rc->cfg.max_bitrate) start = rc->cfg.max_bitrate;
+
+    rc->fd = -1;
+    rc->stats.bitrate = start;
+    rc->reported = start;
+    pthread_mutex_init(&rc->stats_mutex, NULL);
+
+    if (rc->hooks.set_bitrate) {
+        rc->hooks.set_bitrate(start, rc->hooks.user_data);
+    }
+    return 0;
+}
+
+void jtt1078_rate_deinit(jtt1078_rate_t *rc) {
+    if (!rc) {
+        return;
+    }
+    pthread_mutex_destroy(&rc->stats_mutex);
+}
+
+// 平滑RTT(微秒), 非TCP socket 返回0
+static uint32_t read_srtt(int fd) {
+    struct tcp_info ti;
+    socklen_t len = sizeof(ti);
+
+    memset(&ti, 0, sizeof(ti));
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0) {
+        return 0;
+    }
+    return ti.tcpi_rtt;
+}
+
+// 最小RTT取最近一个完整窗口与当前窗口的较小值, 路由变化后10秒内更新
+static uint32_t track_min_rtt(jtt1078_rate_t *rc, uint32_t srtt, uint64_t now_ms) {
+    jtt1078_rate_stats_t *st = &rc->stats;
+
+    if (srtt == 0) {
+        return 0;
+    }
+    if (rc->rtt_window_min == 0 || srtt < rc->rtt_window_min) {
+        rc->rtt_window_min = srtt;
+    }
+    if (st->min_rtt_us == 0 || srtt < st->min_rtt_us) {
+        st->min_rtt_us = srtt;
+    }
+    if (now_ms - rc->rtt_window_ms >= RATE_RTT_WINDOW_MS) {
+        st->min_rtt_us = rc->rtt_window_min;
+        rc->rtt_window_min = srtt;
+        rc->rtt_window_ms = now_ms;
+    }
+    return srtt > st->min_rtt_us ? srtt - st->min_rtt_us : 0;
+}
+
+int jtt1078_rate_update(jtt1078_rate_t *rc, int fd, uint64_t bytes_written, uint64_t now_ms) {
+    if (!rc) {
+        return -1;
+    }
+    if (fd < 0) {
+        rc->fd = -1;
+        return 0;
+    }
+
+    int queue = 0;
+    if (fd != rc->fd) {
+        // 新连接: 重新开始采样, 码率与容量估计保留
+        if (ioctl(fd, SIOCOUTQ, &queue) < 0) {
+            return -1;
+        }
+        rc->fd = fd;
+        rc->last_ms = now_ms;
+        rc->last_written = bytes_written;
+        rc->last_queue = (uint32_t)queue;
+        rc->rtt_window_min = 0;
+        rc->rtt_window_ms = now_ms;
+        pthread_mutex_lock(&rc->stats_mutex);
+        rc->stats.min_rtt_us = 0;
+        pthread_mutex_unlock(&rc->stats_mutex);
+        return 0;
+    }
+
+    uint64_t dt = now_ms - rc->last_ms;
+    if (dt < rc->cfg.interval_ms) {
+        return 0;
+    }
+    if (ioctl(fd, SIOCOUTQ, &queue) < 0) {
+        return -1;
+    }
+    uint32_t srtt = read_srtt(fd);
+
+    // 周期内被确认的字节 = 写入的字节 - 发送队列增量
+    int64_t drained = (int64_t)(bytes_written - rc->last_written) - ((int64_t)queue - rc->last_queue);
+    if (drained < 0) {
+        drained = 0;
+    }
+    uint32_t drain_bps = (uint32_t)((uint64_t)drained * 8000 / dt);
+    bool saturated = rc->last_queue >= RATE_SATURATED_BYTES && (uint32_t)queue >= RATE_SATURATED_BYTES;
+
+    rc->last_ms = now_ms;
+    rc->last_written = bytes_written;
+    rc->last_queue = (uint32_t)queue;
+
+    pthread_mutex_lock(&rc->stats_mutex);
+    jtt1078_rate_stats_t *st = &rc->stats;
+    const jtt1078_rate_config_t *cfg = &rc->cfg;
+
+    // 链路饱和时排空速率即容量(下降立即采用, 上升平滑); 未饱和时只是下限
+    if (saturated) {
+        st->capacity = st->capacity && drain_bps > st->capacity ?
+            (uint32_t)(((uint64_t)st->capacity * 3 + drain_bps) / 4) : drain_bps;
+    } else if (drain_bps > st->capacity) {
+        st->capacity = drain_bps;
+    }
+
+    uint32_t rtt_queue_ms = track_min_rtt(rc, srtt, now_ms) / 1000;
+    uint32_t rate = st->capacity ? st->capacity : st->bitrate;
+    uint32_t delay_ms = (uint32_t)((uint64_t)queue * 8000 / (rate ? rate : 1)) + rtt_queue_ms;
+
+    uint32_t bitrate = st->bitrate;
+    uint32_t rtt_ms = srtt / 1000;
+    if (delay_ms > cfg->target_delay_ms) {
+        // 乘性下降, 每个RTT(至少一个采样周期)最多一次
+        if (now_ms - rc->last_decrease_ms >= (rtt_ms > cfg->interval_ms ? rtt_ms : cfg->interval_ms)) {
+            uint32_t base = st->capacity && st->capacity < bitrate ? st->capacity : bitrate;
+            bitrate = (uint32_t)((uint64_t)base * RATE_DECREASE_PCT / 100);
+            rc->last_decrease_ms = now_ms;
+            st->decreases++;
+        }
+    } else if (delay_ms < cfg->target_delay_ms / 2 && now_ms - rc->last_decrease_ms >= cfg->hold_ms) {
+        // 加性上调, 不超过容量估计太多(容量只在发送更快时才会被测到更高)
+        uint32_t next = bitrate + bitrate / 32 + 16000;
+        uint32_t ceiling = st->capacity ? (uint32_t)((uint64_t)st->capacity * RATE_PROBE_PCT / 100) : next;
+        if (next > ceiling) {
+            next = ceiling > bitrate ? ceiling : bitrate;
+        }
+        if (next > bitrate) {
+            bitrate = next;
+            st->increases++;
+        }
+    }
+    if (bitrate < cfg->min_bitrate) bitrate = cfg->min_bitrate;
+    if (bitrate > cfg->max_bitrate) bitrate = cfg->max_bitrate;
+
+    // 跳帧状态带回差: 超过 max_delay_ms 进入, 回到 target_delay_ms 以内退出
+    bool congested = rc->congested;
+    if (delay_ms > cfg->max_delay_ms) {
+        congested = true;
+    } else if (delay_ms <= cfg->target_delay_ms) {
+        congested = false;
+    }
+
+    st->bitrate = bitrate;
+    st->drain_rate = drain_bps;
+    st->queue_bytes = (uint32_t)queue;
+    st->queue_delay_ms = delay_ms;
+    st->srtt_us = srtt;
+    st->samples++;
+    pthread_mutex_unlock(&rc->stats_mutex);
+
+    int changed = congested != rc->congested;
+    rc->congested = congested;
+
+    // 变化不足5%不打扰编码器, 到达上下限时总是通知
+    uint32_t diff = bitrate > rc->reported ? bitrate - rc->reported : rc->reported - bitrate;
+    if (diff > 0 && ((uint64_t)diff * 20 >= rc->reported ||
+                     bitrate == cfg->min_bitrate || bitrate == cfg->max_bitrate)) {
+        rc->reported = bitrate;
+        if (rc->hooks.set_bitrate) {
+            rc->hooks.set_bitrate(bitrate, rc->hooks.user_data);
+        }
+        changed = 1;
+    }
+    return changed;
+}
+
+bool jtt1078_rate_admit(jtt1078_rate_t *rc, const video_frame_t *frame) {
+    if (!rc || !frame) {
+        return true;
+    }
+
+    bool key = frame->is_keyframe || frame->frame_type == JTT1078_DATA_TYPE_VIDEO;
+    bool skip = false;
+    bool request = false;
+
+    pthread_mutex_lock(&rc->stats_mutex);
+    jtt1078_rate_stats_t *st = &rc->stats;
+    if (key) {
+        // 关键帧总是发送; 仍拥塞时其后的P/B帧继续跳过
+        st->skipping = rc->congested;
+        rc->need_keyframe = false;
+    } else if (st->skipping) {
+        skip = true;
+        if (!rc->congested && !rc->need_keyframe) {
+            rc->need_keyframe = true;
+            request = true;
+        }
+    } else if (rc->congested) {
+        skip = true;
+        st->skipping = true;
+        st->skip_events++;
+    }
+    if (skip) {
+        st->frames_skipped++;
+    }
+    pthread_mutex_unlock(&rc->stats_mutex);
+
+    if (request && rc->hooks.request_keyframe) {
+        rc->hooks.request_keyframe(rc->hooks.user_data);
+    }
+    return !skip;
+}
+
+void jtt1078_rate_get_stats(jtt1078_rate_t *rc, jtt1078_rate_stats_t *out) {
+    pthread_mutex_lock(&rc->stats_mutex);
+    *out = rc->stats;
+    pthread_mutex_unlock(&rc->stats_mutex);
+}
@@ -0,0 +1,123 @@
+/*
+ * JT/T 1078 Rate Controller
+ * 发送队列感知的码率自适应: 上行带宽下降时降低编码码率并跳帧,
+ * 让数据不在 socket 发送缓冲区(及基站/调制解调器缓冲区)中堆积, 时延有界
+ *
+ * 每个采样周期读取:
+ *   - SIOCOUTQ: socket 中已写入但未被确认的字节数(发送队列)
+ *   - TCP_INFO: 平滑RTT; 相对最小RTT的增量反映链路中间的排队
+ *   - 调用方提供的累计写入字节数
+ * 排空速率 = 周期内写入字节 - 发送队列增量(即被确认的字节), 队列持续
+ * 非空(链路饱和)时作为链路容量估计, 否则只用于上调容量估计。
+ * 排队时延 = 发送队列 / 容量 + (平滑RTT - 最小RTT):
+ *   - 超过 target_delay_ms: 码率降到容量的 85% 以下(乘性下降)
+ *   - 低于 target_delay_ms 的一半且距上次下降超过 hold_ms: 每周期加性上调
+ *   - 超过 max_delay_ms: 跳过P/B帧, 关键帧照常发送; 拥塞解除后在下一个
+ *     关键帧恢复, 并请求编码器立即输出IDR
+ * 决策经编码器控制钩子输出(真实 VENC 或合成编码器), 码率变化不足5%不通知。
+ *
+ * 控制器只由发送线程使用; jtt1078_rate_get_stats 可在任意线程调用。
+ */
+
+#ifndef JTT1078_RATE_H
+#define JTT1078_RATE_H
+
+#include "jtt1078_protocol.h"
+#include <pthread.h>
+
+// 控制参数
+typedef struct {
+    uint32_t min_bitrate;           // 码率下限(bps, 默认 256000)
+    uint32_t max_bitrate;           // 码率上限(bps, 默认 2048000, 即 rkipc.ini max_rate)
+    uint32_t start_bitrate;         // 初始码率(bps, 默认 max_bitrate)
+    uint32_t target_delay_ms;       // 排队时延目标(默认 300)
+    uint32_t max_delay_ms;          // 超过后跳过P/B帧(默认 1000)
+    uint32_t interval_ms;           // 采样周期(默认 200)
+    uint32_t hold_ms;               // 下降后暂停上调的时间(默认 2000)
+} jtt1078_rate_config_t;
+
+// 编码器控制钩子
+typedef struct {
+    void (*set_bitrate)(uint32_t bitrate, void *user_data);    // 调整编码器目标码率(bps)
+    void (*request_keyframe)(void *user_data);                 // 跳帧结束, 请求立即输出IDR
+    void *user_data;
+} jtt1078_rate_hooks_t;
+
+// 控制器状态与统计
+typedef struct {
+    uint32_t bitrate;               // 当前目标码率(bps)
+    bool     skipping;              // 正在跳过P/B帧
+    uint32_t capacity;              // 链路容量估计(bps), 0表示未知
+    uint32_t drain_rate;            // 最近一个周期的排空速率(bps)
+    uint32_t queue_bytes;           // 最近一次采样的发送队列(SIOCOUTQ)
+    uint32_t queue_delay_ms;        // 最近一次的排队时延估计
+    uint32_t srtt_us;               // 平滑RTT, 0表示不可用(非TCP)
+    uint32_t min_rtt_us;            // 最小RTT(每10秒重新取样)
+    uint64_t samples;               // 采样次数
+    uint64_t decreases;             // 码率下降次数
+    uint64_t increases;             // 码率上调次数
+    uint64_t frames_skipped;        // 跳过的帧数
+    uint64_t skip_events;           // 进入跳帧状态的次数
+} jtt1078_rate_stats_t;
+
+typedef struct {
+    jtt1078_rate_config_t cfg;
+    jtt1078_rate_hooks_t hooks;
+
+    int      fd;                    // 上次采样的socket, 变化时重新开始采样
+    uint64_t last_ms;               // 上次采样时刻
+    uint64_t last_written;          // 上次采样时的累计写入字节
+    uint32_t last_queue;            // 上次采样的发送队列
+    uint64_t last_decrease_ms;
+    uint32_t rtt_window_min;        // 本轮(10秒)内的最小RTT
+    uint64_t rtt_window_ms;         // 本轮开始时刻
+    uint32_t reported;              // 最近一次通知编码器的码率
+    bool     congested;             // 排队时延超过 max_delay_ms
+    bool     need_keyframe;         // 跳帧后等待关键帧
+
+    pthread_mutex_t stats_mutex;
+    jtt1078_rate_stats_t stats;
+} jtt1078_rate_t;
+
+/**
+ * 填充默认控制参数
+ */
+void jtt1078_rate_default_config(jtt1078_rate_config_t *cfg);
+
+/**
+ * 初始化控制器, 立即以初始码率调用 set_bitrate
+ * @param cfg 控制参数, NULL使用默认值
+ * @param hooks 编码器控制钩子, NULL表示只通过 jtt1078_rate_get_stats 查询决策
+ * @return 0成功, -1参数错误
+ */
+int jtt1078_rate_init(jtt1078_rate_t *rc, const jtt1078_rate_config_t *cfg,
+                      const jtt1078_rate_hooks_t *hooks);
+
+/**
+ * 采样发送队列并更新决策, 发送线程每次发送后调用即可(不足一个采样周期时直接返回)
+ * @param fd 当前连接的socket(TCP; UDP 只有发送队列没有RTT), <0表示未连接
+ * @param bytes_written 写入该socket的累计字节数
+ * @param now_ms 单调时钟(毫秒)
+ * @return 1码率或跳帧状态有变化, 0无变化, -1采样失败
+ */
+int jtt1078_rate_update(jtt1078_rate_t *rc, int fd, uint64_t bytes_written, uint64_t now_ms);
+
+/**
+ * 是否发送这一帧
+ * 拥塞时跳过P/B帧, 跳帧开始后直到下一个关键帧之前的P/B帧都不发送
+ * (参考帧已缺失); 关键帧总是发送
+ * @return true发送, false跳过(调用方可用 jtt1078_encoder_skip_video_frame 保持编码器状态)
+ */
+bool jtt1078_rate_admit(jtt1078_rate_t *rc, const video_frame_t *frame);
+
+/**
+ * 获取当前决策与统计(线程安全)
+ */
+void jtt1078_rate_get_stats(jtt1078_rate_t *rc, jtt1078_rate_stats_t *out);
+
+/**
+ * 释放控制器资源
+ */
+void jtt1078_rate_deinit(jtt1078_rate_t *rc);
+
+#endif // JTT1078_RATE_H
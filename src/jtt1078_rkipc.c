@@ -9,23 +9,35 @@
  *   arm-rockchip830-linux-uclibcgnueabihf-gcc \
  *       -o jtt1078_rkipc \
  *       jtt1078_protocol.c \
+ *       jtt1078_transport.c \
+ *       jtt1078_conn.c \
+ *       jtt1078_nal.c \
+ *       jtt1078_fec.c \
+ *       jtt1078_g711.c \
+ *       jtt1078_rate.c \
+ *       jtt1078_pace.c \
+ *       jtt1078_playback.c \
+ *       jtt1078_fanout.c \
+ *       jtt1078_zerocopy.c \
+ *       jtt1078_aio.c \
+ *       jtt1078_sendq.c \
  *       jtt1078_rkipc.c \
  *       -I/path/to/luckfox-pico/media/rkipc/include \
  *       -L/path/to/luckfox-pico/media/rkipc/lib \
- *       -lrockchip_mpp -leasymedia -lpthread -O2
+ *       -lrockchip_mpp -leasymedia -lpthread -O2 -mfpu=neon-vfpv4
  */
 
 #include "jtt1078_protocol.h"
+#include "jtt1078_conn.h"
+#include "jtt1078_nal.h"
+#include "jtt1078_sendq.h"
+#include "jtt1078_rate.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <pthread.h>
-#include <arpa/inet.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netinet/tcp.h>
 
 // Rockchip MPP headers (bạn cần điều chỉnh path)
 // #include "rk_mpi_venc.h"
@@ -50,10 +62,41 @@ typedef struct {
 #define H265E_NALU_PSLICE  0
 #define H265E_NALU_ISLICE  1
 
+// Largest expected encoded frame (1080p H.265 I-frame), sizes the batch header arena
+#define JTT1078_RKIPC_MAX_FRAME  (256 * 1024)
+
+// Send queue depth in frames (~2 s at 25 fps)
+#define JTT1078_RKIPC_QUEUE_FRAMES  50
+
+// Current-GOP cache replayed on connect (~4 s at 2 Mbps); 0 disables replay
+#define JTT1078_RKIPC_GOP_CACHE  (1024 * 1024)
+
+// Bitrate adaptation range: max_rate of [video.0] in rkipc.ini down to a floor
+// that still gives a usable picture on a congested 3G/4G uplink
+#define JTT1078_RKIPC_MAX_BITRATE  (2048 * 1000)
+#define JTT1078_RKIPC_MIN_BITRATE  (256 * 1000)
+
+// Spread each frame's sub-packets over this share of the frame interval so an
+// I-frame does not hit the modem as ~150 back-to-back packets
+#define JTT1078_RKIPC_PACING_PCT  50
+
+// Never pace faster than the modem uplink: at 2 Mbps a ~72 KB I-frame needs
+// ~29 Mbit/s to leave within half of a 40 ms interval, which overflows the modem
+// buffer on a 16 Mbit/s link; with the cap it is stretched to ~36 ms instead.
+// 0 removes the cap
+#define JTT1078_RKIPC_PACING_MAX_KBPS  16000
+
+// Send frames of at least this size with MSG_ZEROCOPY; 0 disables. Pays off only
+// when the NIC does scatter-gather/checksum offload (Ethernet); USB modems make
+// the kernel copy anyway, which costs more than a plain send
+#define JTT1078_RKIPC_ZEROCOPY_MIN  0
+
 // Global variables
 static volatile int g_running = 1;
-static int g_tcp_sock = -1;
+static jtt1078_conn_t g_conn;
 static jtt1078_encoder_t g_encoder;
+static jtt1078_sendq_t g_sendq;
+static jtt1078_rate_t g_rate;
 
 // Signal handler
 void signal_handler(int sig) {
@@ -61,58 +104,32 @@ void signal_handler(int sig) {
     g_running = 0;
 }
 
-// TCP send callback
-int jtt1078_tcp_send(const uint8_t *data, size_t len, void *user_data) {
+// Ask VENC for an IDR so a new session does not wait for the next GOP
+void request_idr(void *user_data) {
     (void)user_data;
     
-    if (g_tcp_sock < 0) {
-        return -1;
-    }
-    
-    size_t sent = 0;
-    while (sent < len) {
-        ssize_t ret = send(g_tcp_sock, data + sent, len - sent, 0);
-        if (ret < 0) {
-            perror("[JTT1078] send");
-            return -1;
-        }
-        sent += ret;
-    }
-    
-    return sent;
+    // Actual code would be:
+    // RK_MPI_VENC_RequestIDR(0, RK_FALSE);
+    printf("[JTT1078] Requesting IDR\n");
 }
 
-// Connect to JT/T 1078 server
-int connect_to_server(const char *ip, int port) {
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        perror("[JTT1078] socket");
-        return -1;
-    }
-    
-    // Set TCP_NODELAY for low latency
-    int flag = 1;
-    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-    
-    // Set send buffer
-    int sendbuf = 256 * 1024;
-    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &sendbuf, sizeof(sendbuf));
-    
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    inet_pton(AF_INET, ip, &addr.sin_addr);
-    
-    printf("[JTT1078] Connecting to %s:%d...\n", ip, port);
-    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        perror("[JTT1078] connect");
-        close(sock);
-        return -1;
-    }
+// Rate controller hook: retarget the VENC bitrate when the uplink changes
+void set_venc_bitrate(uint32_t bitrate, void *user_data) {
+    (void)user_data;
     
-    printf("[JTT1078] Connected successfully\n");
-    return sock;
+    // Actual code would be:
+    /*
+    VENC_CHN_ATTR_S attr;
+    RK_MPI_VENC_GetChnAttr(0, &attr);
+    attr.stRcAttr.stH265Cbr.u32BitRate = bitrate / 1000;   // kbps
+    RK_MPI_VENC_SetChnAttr(0, &attr);
+    */
+    printf("[JTT1078] Target bitrate %u kbps\n", bitrate / 1000);
+}
+
+// Zero-copy completion: the kernel no longer references the send-queue slot
+void release_slot(void *user_data, void *buf) {
+    jtt1078_sendq_unpin((jtt1078_sendq_t *)user_data, buf);
 }
 
 // Main video streaming thread
@@ -143,21 +160,17 @@ void* venc_stream_thread(void *arg) {
             video_frame_t frame;
             frame.data = pack->pu8Addr;
             frame.size = pack->u32Len;
-            frame.pts = pack->u64PTS;
+            frame.pts = pack->u64PTS / 1000;  // VENC PTS is in microseconds
             
-            // Detect frame type
-            if (pack->DataType.enH265EType == H265E_NALU_ISLICE) {
-                frame.is_keyframe = true;
-                frame.frame_type = JTT1078_DATA_TYPE_VIDEO;
-            } else {
-                frame.is_keyframe = false;
-                frame.frame_type = JTT1078_DATA_TYPE_VIDEO_P;
-            }
+            // Detect frame type from the bitstream (VPS/SPS/PPS packs count as
+            // keyframe so the send queue keeps them with the following IDR)
+            int type = jtt1078_nal_frame_type(frame.data, frame.size, JTT1078_VIDEO_H265,
+                                              &frame.is_keyframe);
+            frame.frame_type = type < 0 ? JTT1078_DATA_TYPE_VIDEO_P : (uint8_t)type;
             
-            // Encode and send via JT/T 1078
-            if (jtt1078_encode_video_frame(&g_encoder, &frame) < 0) {
-                printf("[JTT1078] Failed to send frame\n");
-            }
+            // Hand off to the sender thread; never blocks on the network.
+            // The frame is copied, so the VENC buffer can be released below.
+            jtt1078_sendq_push(&g_sendq, &frame);
         }
         
         // Release stream
@@ -172,6 +185,47 @@ void* venc_stream_thread(void *arg) {
     return NULL;
 }
 
+// Sender thread: drains the send queue into the JT/T 1078 encoder
+void* sender_thread(void *arg) {
+    (void)arg;
+    
+    printf("[JTT1078] Sender thread started\n");
+    
+    while (g_running) {
+        video_frame_t frame;
+        int ret = jtt1078_sendq_peek(&g_sendq, &frame, 1000);
+        if (ret < 0) break;     // queue stopped
+        if (ret > 0) {
+            // Idle: keep reconnecting even when no frames arrive, and hand
+            // zero-copy slots back to the queue
+            jtt1078_conn_poll(&g_conn, 0);
+            jtt1078_conn_reap(&g_conn, 0);
+            continue;
+        }
+        
+        // Congested uplink: drop P/B frames until the socket queue drains,
+        // resume at the next keyframe
+        if (g_conn.state == JTT1078_CONN_CONNECTED && !jtt1078_rate_admit(&g_rate, &frame)) {
+            jtt1078_encoder_skip_video_frame(&g_encoder, &frame);
+        } else if (g_conn.zc) {
+            // The slot buffer stays pinned until the kernel reports completion
+            void *buf = jtt1078_sendq_pin(&g_sendq);
+            jtt1078_conn_send_video_zc(&g_conn, &g_encoder, &frame, buf);
+        } else {
+            // Skipped while disconnected; resumes at the next keyframe (or GOP replay)
+            jtt1078_conn_send_video(&g_conn, &g_encoder, &frame);
+        }
+        
+        jtt1078_sendq_release(&g_sendq);
+        
+        // Sample the socket send queue and drain rate, retarget VENC bitrate
+        jtt1078_rate_update(&g_rate, g_conn.fd, g_conn.bytes_sent, jtt1078_get_monotonic_ms());
+    }
+    
+    printf("[JTT1078] Sender thread stopped\n");
+    return NULL;
+}
+
 // Parse config file
 int parse_config(const char *config_file, char *server_ip, int *server_port, 
                  char *sim_number, int *channel) {
@@ -232,25 +286,53 @@ int main(int argc, char *argv[]) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
-    // Connect to JT/T 1078 server
-    g_tcp_sock = connect_to_server(server_ip, server_port);
-    if (g_tcp_sock < 0) {
-        printf("[JTT1078] Failed to connect to server\n");
+    // Reconnecting transport: the first connect happens on the sender thread,
+    // a dead or unreachable server never stops streaming
+    if (jtt1078_conn_init(&g_conn, server_ip, server_port, NULL) != 0) {
+        printf("[JTT1078] Invalid server address\n");
         return 1;
     }
     
     // Initialize JT/T 1078 encoder
-    if (jtt1078_encoder_init(&g_encoder,
-                             sim_number,
-                             channel,
-                             JTT1078_VIDEO_H265,
-                             jtt1078_tcp_send,
-                             NULL) != 0) {
+    if (jtt1078_encoder_init_iov(&g_encoder,
+                                 sim_number,
+                                 channel,
+                                 JTT1078_VIDEO_H265,
+                                 jtt1078_conn_sendv,
+                                 &g_conn) != 0) {
         printf("[JTT1078] Failed to initialize encoder\n");
-        close(g_tcp_sock);
+        jtt1078_conn_deinit(&g_conn);
         return 1;
     }
     
+    // Timestamps follow the VENC PTS instead of the wall clock
+    jtt1078_encoder_set_timestamp_mode(&g_encoder, JTT1078_TS_PTS);
+    
+    // Whole-frame batching: one writev per frame instead of one send() per sub-packet
+    if (jtt1078_encoder_enable_batch(&g_encoder, JTT1078_RKIPC_MAX_FRAME) != 0) {
+        printf("[JTT1078] Batch mode unavailable, sending per packet\n");
+    }
+    
+    // Time to first picture: cache parameter sets / current GOP, request IDR on
+    // every (re)connect (jtt1078_conn_send_video calls jtt1078_encoder_resync)
+    jtt1078_encoder_set_keyframe_callback(&g_encoder, request_idr, NULL);
+    if (JTT1078_RKIPC_GOP_CACHE > 0 &&
+        jtt1078_encoder_enable_gop_cache(&g_encoder, JTT1078_RKIPC_GOP_CACHE) != 0) {
+        printf("[JTT1078] GOP cache unavailable, waiting for keyframes on connect\n");
+    }
+    
+    // Keyframe burst pacing (SO_MAX_PACING_RATE on the TCP socket, set on every connect)
+    if (jtt1078_encoder_enable_pacing(&g_encoder, JTT1078_RKIPC_PACING_PCT, 0) != 0) {
+        printf("[JTT1078] Pacing unavailable, frames are sent back-to-back\n");
+    } else {
+        jtt1078_encoder_set_pacing_max_rate(&g_encoder, JTT1078_RKIPC_PACING_MAX_KBPS * 1000 / 8);
+    }
+    
+    if (JTT1078_RKIPC_ZEROCOPY_MIN > 0 &&
+        jtt1078_conn_enable_zerocopy(&g_conn, JTT1078_RKIPC_ZEROCOPY_MIN, release_slot, &g_sendq) != 0) {
+        printf("[JTT1078] Zero-copy unavailable, copying into the socket\n");
+    }
+    
     printf("[JTT1078] Encoder initialized successfully\n");
     
     // TODO: Initialize rkipc video encoder
@@ -260,8 +342,29 @@ int main(int argc, char *argv[]) {
     RK_MPI_VENC_StartRecvFrame(0);
     */
     
-    // Start streaming thread
-    pthread_t stream_thread;
+    // Send-queue-aware bitrate adaptation; keeps latency bounded when the uplink degrades
+    jtt1078_rate_config_t rate_cfg;
+    jtt1078_rate_default_config(&rate_cfg);
+    rate_cfg.min_bitrate = JTT1078_RKIPC_MIN_BITRATE;
+    rate_cfg.max_bitrate = JTT1078_RKIPC_MAX_BITRATE;
+    jtt1078_rate_hooks_t rate_hooks = {
+        .set_bitrate = set_venc_bitrate,
+        .request_keyframe = request_idr,
+        .user_data = NULL,
+    };
+    jtt1078_rate_init(&g_rate, &rate_cfg, &rate_hooks);
+    
+    if (jtt1078_sendq_init(&g_sendq, JTT1078_RKIPC_QUEUE_FRAMES) != 0) {
+        printf("[JTT1078] Failed to initialize send queue\n");
+        jtt1078_rate_deinit(&g_rate);
+        jtt1078_encoder_deinit(&g_encoder);
+        jtt1078_conn_deinit(&g_conn);
+        return 1;
+    }
+    
+    // Start sender and streaming threads
+    pthread_t send_thread, stream_thread;
+    pthread_create(&send_thread, NULL, sender_thread, NULL);
     pthread_create(&stream_thread, NULL, venc_stream_thread, NULL);
     
     // Main loop - keep alive
@@ -272,9 +375,80 @@ int main(int argc, char *argv[]) {
         // Print statistics every 10 seconds
         static int counter = 0;
         if (++counter >= 10) {
-            printf("[JTT1078] Sent packets: %u, RTP seq: %u\n",
-                   g_encoder.packet_seq,
-                   g_encoder.rtp_seq);
+            // Lock-free snapshot; never blocks the sender thread
+            jtt1078_encoder_stats_t es;
+            jtt1078_encoder_get_stats(&g_encoder, &es);
+            uint64_t video_frames = 0, video_packets = 0, video_bytes = 0;
+            for (int t = JTT1078_DATA_TYPE_VIDEO; t <= JTT1078_DATA_TYPE_VIDEO_B; t++) {
+                video_frames += es.frames[t];
+                video_packets += es.packets[t];
+                video_bytes += es.bytes[t];
+            }
+            printf("[JTT1078] Sent: video %llu frames %llu packets %llu bytes, audio %llu packets, "
+                   "FEC %llu packets\n",
+                   (unsigned long long)video_frames,
+                   (unsigned long long)video_packets,
+                   (unsigned long long)video_bytes,
+                   (unsigned long long)es.packets[JTT1078_DATA_TYPE_AUDIO],
+                   (unsigned long long)es.parity_packets);
+            printf("[JTT1078] Send calls: %llu failed=%llu p50<%llu us p99<%llu us max=%llu us "
+                   "dropped=%llu skipped=%llu resyncs=%llu\n",
+                   (unsigned long long)es.send_calls,
+                   (unsigned long long)es.send_failures,
+                   (unsigned long long)jtt1078_stats_hist_percentile(es.send_us_hist, 0.50),
+                   (unsigned long long)jtt1078_stats_hist_percentile(es.send_us_hist, 0.99),
+                   (unsigned long long)es.send_us_max,
+                   (unsigned long long)es.frames_dropped,
+                   (unsigned long long)es.frames_skipped,
+                   (unsigned long long)es.resyncs);
+            
+            jtt1078_sendq_stats_t qs;
+            jtt1078_sendq_get_stats(&g_sendq, &qs);
+            printf("[JTT1078] Queue: depth=%u max=%u sent=%llu dropped=%llu (%llu bytes, %llu events)\n",
+                   qs.depth, qs.max_depth,
+                   (unsigned long long)qs.sent,
+                   (unsigned long long)qs.dropped_frames,
+                   (unsigned long long)qs.dropped_bytes,
+                   (unsigned long long)qs.drop_events);
+            
+            jtt1078_conn_stats_t cs;
+            jtt1078_conn_get_stats(&g_conn, &cs);
+            printf("[JTT1078] Link: %s connects=%llu failures=%llu drops=%llu skipped=%llu "
+                   "dark last=%u ms max=%u ms total=%llu ms\n",
+                   cs.state == JTT1078_CONN_CONNECTED ? "up" : "down",
+                   (unsigned long long)cs.connects,
+                   (unsigned long long)cs.connect_failures,
+                   (unsigned long long)cs.disconnects,
+                   (unsigned long long)cs.frames_skipped,
+                   cs.last_dark_ms, cs.max_dark_ms,
+                   (unsigned long long)cs.total_dark_ms);
+            
+            jtt1078_rate_stats_t rs;
+            jtt1078_rate_get_stats(&g_rate, &rs);
+            printf("[JTT1078] Rate: target=%u kbps capacity=%u kbps queue=%u bytes delay=%u ms "
+                   "rtt=%u ms skipped=%llu%s\n",
+                   rs.bitrate / 1000, rs.capacity / 1000, rs.queue_bytes, rs.queue_delay_ms,
+                   rs.srtt_us / 1000, (unsigned long long)rs.frames_skipped,
+                   rs.skipping ? " (skipping)" : "");
+            
+            printf("[JTT1078] Pacing: %s rate last=%u kbps max=%u kbps paced=%llu/%llu "
+                   "delay last=%u ms max=%u ms\n",
+                   es.pacing.kernel ? "kernel" : "user",
+                   (unsigned)(es.pacing.rate * 8ULL / 1000),
+                   (unsigned)(es.pacing.max_rate * 8ULL / 1000),
+                   (unsigned long long)es.pacing.paced_frames,
+                   (unsigned long long)es.pacing.frames,
+                   es.pacing.last_delay_us / 1000, es.pacing.max_delay_us / 1000);
+            
+            if (g_conn.zc) {
+                jtt1078_zc_stats_t zs;
+                jtt1078_zc_get_stats(g_conn.zc, &zs);
+                printf("[JTT1078] Zero-copy: frames=%llu copied_frames=%llu completions=%llu "
+                       "kernel_copied=%llu pending=%u hold max=%u us\n",
+                       (unsigned long long)zs.frames, (unsigned long long)zs.frames_copied,
+                       (unsigned long long)zs.completions, (unsigned long long)zs.copied,
+                       zs.pending, zs.max_hold_us);
+            }
             counter = 0;
         }
     }
@@ -282,6 +456,11 @@ int main(int argc, char *argv[]) {
     // Cleanup
     printf("[JTT1078] Cleaning up...\n");
     pthread_join(stream_thread, NULL);
+    jtt1078_sendq_stop(&g_sendq);
+    pthread_join(send_thread, NULL);
+    // Reset the connection so no zero-copy send still references a slot
+    jtt1078_conn_close(&g_conn);
+    jtt1078_sendq_destroy(&g_sendq);
     
     // TODO: Cleanup rkipc
     /*
@@ -290,7 +469,9 @@ int main(int argc, char *argv[]) {
     RK_MPI_SYS_Exit();
     */
     
-    close(g_tcp_sock);
+    jtt1078_rate_deinit(&g_rate);
+    jtt1078_encoder_deinit(&g_encoder);
+    jtt1078_conn_deinit(&g_conn);
     printf("[JTT1078] Stopped\n");
     
     return 0;
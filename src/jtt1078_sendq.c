@@ -0,0 +1,240 @@
+/*
+ * JT/T 1078 Send Queue
+ * 有界发送队列实现
+ */
+
+#include "jtt1078_sendq.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static inline bool is_keyframe(const video_frame_t *frame) {
+    return frame->is_keyframe || frame->frame_type == JTT1078_DATA_TYPE_VIDEO;
+}
+
+int jtt1078_sendq_init(jtt1078_sendq_t *q, uint32_t capacity) {
+    if (!q || capacity == 0) {
+        return -1;
+    }
+
+    memset(q, 0, sizeof(jtt1078_sendq_t));
+    q->slots = calloc(capacity, sizeof(jtt1078_sendq_slot_t));
+    if (!q->slots) {
+        return -1;
+    }
+    q->capacity = capacity;
+    q->active = true;
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    return 0;
+}
+
+void jtt1078_sendq_destroy(jtt1078_sendq_t *q) {
+    if (!q || !q->slots) {
+        return;
+    }
+
+    jtt1078_sendq_stop(q);
+    for (uint32_t i = 0; i < q->capacity; i++) {
+        free(q->slots[i].data);
+    }
+    free(q->slots);
+    q->slots = NULL;
+    pthread_mutex_destroy(&q->mutex);
+    pthread_cond_destroy(&q->cond);
+}
+
+static inline jtt1078_sendq_slot_t *slot_at(jtt1078_sendq_t *q, uint32_t i) {
+    return &q->slots[(q->head + i) % q->capacity];
+}
+
+// 队列满时关键帧入队: 丢弃队首之后(或包括未在发送中的队首)的旧帧, 但保留队尾
+// 连续的关键帧类槽位(参数集单独成包时, 先入队的 VPS/SPS/PPS 须随后续IDR发出);
+// 至少腾出一个槽位。调用方持有锁
+static void drop_queued(jtt1078_sendq_t *q) {
+    uint32_t keep = q->head_busy ? 1 : 0;
+    uint32_t run = 0;
+
+    while (keep + run < q->count && is_keyframe(&slot_at(q, q->count - 1 - run)->frame)) {
+        run++;
+    }
+    if (run > 0 && keep + run == q->capacity) {
+        run--;
+    }
+
+    uint32_t first = q->count - run;
+    for (uint32_t i = keep; i < first; i++) {
+        jtt1078_sendq_slot_t *slot = slot_at(q, i);
+        q->stats.dropped_frames++;
+        q->stats.dropped_bytes += slot->frame.size;
+    }
+
+    // 保留的槽位前移(交换槽位, 缓冲区与零拷贝引用标记随槽位移动)
+    for (uint32_t i = 0; i < run && first > keep; i++) {
+        jtt1078_sendq_slot_t *dst = slot_at(q, keep + i);
+        jtt1078_sendq_slot_t *src = slot_at(q, first + i);
+        jtt1078_sendq_slot_t tmp = *dst;
+        *dst = *src;
+        *src = tmp;
+    }
+    q->count = keep + run;
+}
+
+int jtt1078_sendq_push(jtt1078_sendq_t *q, const video_frame_t *frame) {
+    if (!q || !frame || !frame->data) {
+        return -1;
+    }
+
+    bool key = is_keyframe(frame);
+
+    pthread_mutex_lock(&q->mutex);
+
+    if (!q->active) {
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+
+    if (key) {
+        // 新GOP开始, 队列满时旧GOP的排队帧已无保留价值
+        if (q->count == q->capacity) {
+            drop_queued(q);
+        }
+        q->dropping = false;
+    } else if (q->dropping || q->count == q->capacity) {
+        if (!q->dropping) {
+            q->dropping = true;
+            q->stats.drop_events++;
+        }
+        q->stats.dropped_frames++;
+        q->stats.dropped_bytes += frame->size;
+        pthread_mutex_unlock(&q->mutex);
+        return 1;
+    }
+
+    if (q->count == q->capacity) {
+        // 队首正在发送且容量为1, I帧也只能丢弃
+        q->stats.dropped_frames++;
+        q->stats.dropped_bytes += frame->size;
+        q->dropping = true;
+        q->stats.drop_events++;
+        pthread_mutex_unlock(&q->mutex);
+        return 1;
+    }
+
+    jtt1078_sendq_slot_t *slot = &q->slots[(q->head + q->count) % q->capacity];
+    if (slot->pinned) {
+        // 旧缓冲区仍被内核引用, 由 jtt1078_sendq_unpin 释放
+        slot->data = NULL;
+        slot->capacity = 0;
+        slot->pinned = false;
+    }
+    if (slot->capacity < frame->size) {
+        uint8_t *buf = realloc(slot->data, frame->size);
+        if (!buf) {
+            pthread_mutex_unlock(&q->mutex);
+            fprintf(stderr, "[JTT1078] Send queue: out of memory (%u bytes)\n", frame->size);
+            return -1;
+        }
+        slot->data = buf;
+        slot->capacity = frame->size;
+    }
+    memcpy(slot->data, frame->data, frame->size);
+    slot->frame = *frame;
+    slot->frame.data = slot->data;
+
+    q->count++;
+    q->stats.enqueued++;
+    if (q->count > q->stats.max_depth) {
+        q->stats.max_depth = q->count;
+    }
+
+    pthread_cond_signal(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+int jtt1078_sendq_peek(jtt1078_sendq_t *q, video_frame_t *out, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&q->mutex);
+
+    while (q->count == 0 && q->active) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&q->cond, &q->mutex);
+        } else if (pthread_cond_timedwait(&q->cond, &q->mutex, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&q->mutex);
+            return 1;
+        }
+    }
+
+    if (!q->active) {
+        pthread_mutex_unlock(&q->mutex);
+        return -1;
+    }
+
+    *out = q->slots[q->head].frame;
+    q->head_busy = true;
+
+    pthread_mutex_unlock(&q->mutex);
+    return 0;
+}
+
+void jtt1078_sendq_release(jtt1078_sendq_t *q) {
+    pthread_mutex_lock(&q->mutex);
+
+    if (q->head_busy && q->count > 0) {
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        q->stats.sent++;
+    }
+    q->head_busy = false;
+
+    pthread_mutex_unlock(&q->mutex);
+}
+
+void *jtt1078_sendq_pin(jtt1078_sendq_t *q) {
+    pthread_mutex_lock(&q->mutex);
+    jtt1078_sendq_slot_t *slot = &q->slots[q->head];
+    slot->pinned = true;
+    void *buf = slot->data;
+    pthread_mutex_unlock(&q->mutex);
+    return buf;
+}
+
+void jtt1078_sendq_unpin(jtt1078_sendq_t *q, void *buf) {
+    pthread_mutex_lock(&q->mutex);
+    for (uint32_t i = 0; i < q->capacity; i++) {
+        if (q->slots[i].data == buf && q->slots[i].pinned) {
+            q->slots[i].pinned = false;
+            buf = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&q->mutex);
+    free(buf);
+}
+
+void jtt1078_sendq_stop(jtt1078_sendq_t *q) {
+    pthread_mutex_lock(&q->mutex);
+    q->active = false;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+void jtt1078_sendq_get_stats(jtt1078_sendq_t *q, jtt1078_sendq_stats_t *out) {
+    pthread_mutex_lock(&q->mutex);
+    *out = q->stats;
+    out->depth = q->count;
+    pthread_mutex_unlock(&q->mutex);
+}
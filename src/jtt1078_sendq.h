@@ -0,0 +1,110 @@
+/*
+ * JT/T 1078 Send Queue
+ * 有界发送队列, 编码线程入队, 独立发送线程出队发送
+ *
+ * 队列满时不阻塞编码线程, 而是按GOP丢帧:
+ *   - P/B帧: 丢弃, 并进入丢帧状态, 直到下一个I帧之前的P/B帧全部丢弃
+ *     (参考帧缺失后的后续P帧无法解码, 发送也没有意义)
+ *   - I帧: 丢弃队列中尚未开始发送的旧帧, 为I帧腾出空间; 队尾紧邻的关键帧类
+ *     帧(单独成包的 VPS/SPS/PPS)属于这个I帧, 保留
+ * 帧数据拷贝到槽位缓冲区(按需扩容, 复用), 入队后即可释放编码器缓冲区。
+ *
+ * 零拷贝发送时, 已出队的槽位缓冲区可能仍被内核引用: 发送前 jtt1078_sendq_pin
+ * 标记队首槽位, 完成通知后 jtt1078_sendq_unpin; 入队写到仍被引用的槽位时,
+ * 该槽位换用新缓冲区, 旧缓冲区在 unpin 时释放。
+ */
+
+#ifndef JTT1078_SENDQ_H
+#define JTT1078_SENDQ_H
+
+#include "jtt1078_protocol.h"
+#include <pthread.h>
+
+// 队列统计
+typedef struct {
+    uint32_t depth;             // 当前队列深度(帧)
+    uint32_t max_depth;         // 历史最大深度
+    uint64_t enqueued;          // 入队帧数
+    uint64_t sent;              // 出队(已发送)帧数
+    uint64_t dropped_frames;    // 丢弃帧数
+    uint64_t dropped_bytes;     // 丢弃字节数
+    uint64_t drop_events;       // 进入丢帧状态的次数
+} jtt1078_sendq_stats_t;
+
+// 队列槽位
+typedef struct {
+    uint8_t *data;
+    uint32_t capacity;
+    bool pinned;                // 零拷贝发送中, 缓冲区不可覆盖
+    video_frame_t frame;        // frame.data 指向 data
+} jtt1078_sendq_slot_t;
+
+// 发送队列
+typedef struct {
+    jtt1078_sendq_slot_t *slots;
+    uint32_t capacity;
+    uint32_t head;              // 队首(发送线程正在/即将发送)
+    uint32_t count;
+    bool head_busy;             // 队首帧正在发送, 不可丢弃
+    bool dropping;              // 丢帧状态: 丢弃P/B帧直到下一个I帧
+    bool active;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    jtt1078_sendq_stats_t stats;
+} jtt1078_sendq_t;
+
+/**
+ * 初始化发送队列
+ * @param q 队列
+ * @param capacity 最大帧数
+ * @return 0成功, -1失败
+ */
+int jtt1078_sendq_init(jtt1078_sendq_t *q, uint32_t capacity);
+
+/**
+ * 销毁发送队列并释放槽位缓冲区
+ */
+void jtt1078_sendq_destroy(jtt1078_sendq_t *q);
+
+/**
+ * 帧入队(拷贝帧数据), 从不阻塞
+ * @return 0入队, 1按丢帧策略丢弃, -1失败
+ */
+int jtt1078_sendq_push(jtt1078_sendq_t *q, const video_frame_t *frame);
+
+/**
+ * 获取队首帧(发送线程调用), 帧数据在 jtt1078_sendq_release 之前有效
+ * @param timeout_ms 等待超时(毫秒), -1 表示无限等待
+ * @return 0成功, 1超时, -1队列已停止
+ */
+int jtt1078_sendq_peek(jtt1078_sendq_t *q, video_frame_t *out, int timeout_ms);
+
+/**
+ * 释放队首帧(发送完成后调用)
+ */
+void jtt1078_sendq_release(jtt1078_sendq_t *q);
+
+/**
+ * 标记队首帧的缓冲区被零拷贝发送引用(peek 之后、发送之前调用)
+ * @return 缓冲区标识, 完成后传给 jtt1078_sendq_unpin
+ */
+void *jtt1078_sendq_pin(jtt1078_sendq_t *q);
+
+/**
+ * 零拷贝发送完成, 缓冲区可以复用(已被换下的缓冲区在此释放)
+ */
+void jtt1078_sendq_unpin(jtt1078_sendq_t *q, void *buf);
+
+/**
+ * 停止队列, 唤醒等待中的发送线程
+ */
+void jtt1078_sendq_stop(jtt1078_sendq_t *q);
+
+/**
+ * 获取队列统计
+ */
+void jtt1078_sendq_get_stats(jtt1078_sendq_t *q, jtt1078_sendq_stats_t *out);
+
+#endif // JTT1078_SENDQ_H
@@ -0,0 +1,189 @@
+/*
+ * JT/T 1078 Transport Helpers
+ * iovec 发送实现
+ */
+
+#define _GNU_SOURCE
+#include "jtt1078_transport.h"
+#include "jtt1078_protocol.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// 单次sendmsg的iovec上限, 整帧批量发送时一次调用可覆盖约500个分包
+#define SENDV_BATCH_MAX     (IOV_MAX < 1024 ? IOV_MAX : 1024)
+
+// 单次sendmmsg的数据报上限(UIO_MAXIOV), 4K I帧约300个分包, 一次调用可发完
+#define UDP_BATCH_MAX       1024
+
+size_t jtt1078_iov_length(const struct iovec *iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    return total;
+}
+
+// 等待socket可写
+static int wait_writable(int fd, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret == 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+ssize_t jtt1078_sock_sendv(int fd, const struct iovec *iov, int iovcnt, int timeout_ms) {
+    if (fd < 0 || !iov || iovcnt <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // 本地工作副本, 部分写入时只调整当前批次的首个iovec
+    struct iovec batch[SENDV_BATCH_MAX];
+    const int batch_max = SENDV_BATCH_MAX;
+    size_t total = 0;
+    int idx = 0;
+
+    while (idx < iovcnt) {
+        int n = iovcnt - idx;
+        if (n > batch_max) n = batch_max;
+        memcpy(batch, iov + idx, n * sizeof(struct iovec));
+
+        struct iovec *cur = batch;
+        int cur_cnt = n;
+        while (cur_cnt > 0) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = cur;
+            msg.msg_iovlen = cur_cnt;
+
+            ssize_t ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (wait_writable(fd, timeout_ms) < 0) return -1;
+                    continue;
+                }
+                return -1;
+            }
+            total += ret;
+
+            // 跳过已完整发送的iovec
+            size_t left = (size_t)ret;
+            while (cur_cnt > 0 && left >= cur->iov_len) {
+                left -= cur->iov_len;
+                cur++;
+                cur_cnt--;
+            }
+            if (cur_cnt > 0) {
+                cur->iov_base = (uint8_t *)cur->iov_base + left;
+                cur->iov_len -= left;
+            }
+        }
+        idx += n;
+    }
+
+    return (ssize_t)total;
+}
+
+int jtt1078_udp_connect(const char *ip, uint16_t port, int sndbuf) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (sndbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+int jtt1078_udp_sendv(int fd, const struct iovec *iov, int iovcnt) {
+    if (fd < 0 || !iov || iovcnt <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct mmsghdr msgs[UDP_BATCH_MAX];
+    int total = 0;
+    int idx = 0;
+
+    while (idx < iovcnt) {
+        // 按包头中的数据体长度把 iovec 划分为数据报
+        int nmsg = 0;
+        while (idx < iovcnt && nmsg < UDP_BATCH_MAX) {
+            if (iov[idx].iov_len < JTT1078_HEADER_SIZE) {
+                errno = EINVAL;
+                return -1;
+            }
+            const uint8_t *hdr = iov[idx].iov_base;
+            size_t need = JTT1078_HEADER_SIZE + ((size_t)hdr[28] << 8 | hdr[29]);
+            if (need > JTT1078_MAX_PACKET_SIZE) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+
+            int first = idx;
+            size_t len = 0;
+            while (idx < iovcnt && len < need) {
+                len += iov[idx].iov_len;
+                idx++;
+            }
+            if (len != need) {
+                errno = EINVAL;
+                return -1;
+            }
+
+            memset(&msgs[nmsg], 0, sizeof(struct mmsghdr));
+            msgs[nmsg].msg_hdr.msg_iov = (struct iovec *)(iov + first);
+            msgs[nmsg].msg_hdr.msg_iovlen = idx - first;
+            nmsg++;
+        }
+
+        // sendmmsg 可能只发出部分数据报, 从未发出的继续
+        int sent = 0;
+        while (sent < nmsg) {
+            int ret = sendmmsg(fd, msgs + sent, nmsg - sent, 0);
+            if (ret < 0) {
+                // 之前数据报的ICMP端口不可达以 ECONNREFUSED 报告一次, 本次未发出, 重试
+                if (errno == EINTR || errno == ECONNREFUSED) continue;
+                return -1;
+            }
+            sent += ret;
+        }
+        total += nmsg;
+    }
+
+    return total;
+}
@@ -0,0 +1,58 @@
+/*
+ * JT/T 1078 Transport Helpers
+ * 基于 iovec 的 socket 发送辅助函数
+ *
+ * 编码器的 send_packetv 回调收到的是 {头部, 负载} iovec 数组,
+ * 负载直接指向 video_frame_t.data, 传输层用 sendmsg 一次性发出,
+ * 无需拼包拷贝。
+ *
+ * UDP: 每个分包(30字节包头 + 数据体)是一个数据报, 整帧分包用一次
+ * sendmmsg 发出; 数据报不超过 JTT1078_MAX_PACKET_SIZE, 不依赖IP分片。
+ */
+
+#ifndef JTT1078_TRANSPORT_H
+#define JTT1078_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * 通过 sendmsg 完整发送 iovec 数组
+ * 处理部分写入、EINTR, 以及超过 IOV_MAX 的分批发送;
+ * 非阻塞 socket 遇到 EAGAIN 时 poll 等待可写。
+ * @param fd socket 描述符
+ * @param iov iovec 数组(不会被修改)
+ * @param iovcnt iovec 数量
+ * @param timeout_ms 等待可写的超时(毫秒), -1 表示无限等待
+ * @return 发送的总字节数, -1失败(errno 有效, 超时为 ETIMEDOUT)
+ */
+ssize_t jtt1078_sock_sendv(int fd, const struct iovec *iov, int iovcnt, int timeout_ms);
+
+/**
+ * 创建已连接的UDP socket
+ * @param ip 服务器IPv4地址
+ * @param port 服务器端口
+ * @param sndbuf SO_SNDBUF(字节), 0表示系统默认
+ * @return socket描述符, -1失败
+ */
+int jtt1078_udp_connect(const char *ip, uint16_t port, int sndbuf);
+
+/**
+ * 以UDP数据报发送分包
+ * iovec 按包排列: 每包以包含完整包头的 iovec 开始(包头与数据体可在同一
+ * iovec, 如 jtt1078_mux), 其后的 iovec 合计为包头中的数据体长度。
+ * 每包一个数据报, 全部分包用尽量少的 sendmmsg 调用发出(通常一次)。
+ * @param fd 已连接的UDP socket
+ * @return 发送的数据报数, -1失败(errno 有效; 包超过 JTT1078_MAX_PACKET_SIZE
+ *         或 iovec 与包头长度不符时为 EMSGSIZE/EINVAL)
+ */
+int jtt1078_udp_sendv(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ * 计算 iovec 数组总长度
+ */
+size_t jtt1078_iov_length(const struct iovec *iov, int iovcnt);
+
+#endif // JTT1078_TRANSPORT_H
@@ -0,0 +1,431 @@
+/*
+ * JT/T 1078 Zero-copy Transmit
+ * MSG_ZEROCOPY 发送与完成通知收割实现
+ */
+
+#include "jtt1078_zerocopy.h"
+#include "jtt1078_transport.h"
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+// 旧工具链头文件缺少(include/uapi/linux/socket.h, errqueue.h)
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY                 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY                0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY       5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED  1
+#endif
+
+#define ZC_BATCH_MAX    1024        // 每次 sendmsg 的最大 iovec 数(UIO_MAXIOV)
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int jtt1078_zc_init(jtt1078_zc_t *zc, uint32_t min_bytes,
+                    void (*release)(void *user_data, void *buf), void *user_data) {
+    if (!zc || !release) {
+        return -1;
+    }
+
+    memset(zc, 0, sizeof(jtt1078_zc_t));
+    zc->fd = -1;
+    zc->min_bytes = min_bytes ? min_bytes : JTT1078_ZC_DEFAULT_MIN;
+    zc->release = release;
+    zc->user_data = user_data;
+
+    for (int i = 0; i < JTT1078_ZC_MAX_PENDING; i++) {
+        zc->frames[i].stage = malloc(JTT1078_ZC_STAGE_BYTES);
+        if (!zc->frames[i].stage) {
+            jtt1078_zc_deinit(zc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void jtt1078_zc_deinit(jtt1078_zc_t *zc) {
+    if (!zc) {
+        return;
+    }
+
+    jtt1078_zc_detach(zc);
+    for (int i = 0; i < JTT1078_ZC_MAX_PENDING; i++) {
+        free(zc->frames[i].stage);
+        zc->frames[i].stage = NULL;
+    }
+    free(zc->iov);
+    zc->iov = NULL;
+    zc->iov_capacity = 0;
+}
+
+int jtt1078_zc_attach(jtt1078_zc_t *zc, int fd) {
+    int one = 1;
+
+    zc->fd = fd;
+    zc->next_seq = 0;
+    zc->enabled = fd >= 0 && setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+    if (fd >= 0 && !zc->enabled) {
+        fprintf(stderr, "[JTT1078] SO_ZEROCOPY unavailable: %s, copying\n", strerror(errno));
+    }
+    return zc->enabled ? 1 : 0;
+}
+
+static void release_frame(jtt1078_zc_t *zc, jtt1078_zc_frame_t *f, bool aborted) {
+    uint64_t hold = monotonic_us() - f->start_us;
+    uint32_t hold32 = hold > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)hold;
+
+    if (aborted) {
+        JTT1078_STAT_ADD(zc->stats.aborted, 1);
+    } else {
+        JTT1078_STAT_MAX(zc->stats.max_hold_us, hold32);
+        JTT1078_STAT_ADD(zc->stats.total_hold_us, hold);
+    }
+    zc->release(zc->user_data, f->buf);
+}
+
+// 按发送顺序释放已全部完成的帧(正在发送的帧除外)
+static int release_done(jtt1078_zc_t *zc) {
+    int released = 0;
+
+    while (zc->count > 0) {
+        jtt1078_zc_frame_t *f = &zc->frames[zc->head];
+        if (f == zc->cur || f->done < f->sends) {
+            break;
+        }
+        release_frame(zc, f, false);
+        zc->head = (zc->head + 1) % JTT1078_ZC_MAX_PENDING;
+        zc->count--;
+        released++;
+    }
+    JTT1078_STAT_STORE(zc->stats.pending, zc->count);
+    return released;
+}
+
+// 完成的 sendmsg 序号 [lo, hi] 计入各帧(序号按32位回绕比较)
+static void complete_range(jtt1078_zc_t *zc, uint32_t lo, uint32_t hi) {
+    for (uint32_t i = 0; i < zc->count; i++) {
+        jtt1078_zc_frame_t *f = &zc->frames[(zc->head + i) % JTT1078_ZC_MAX_PENDING];
+        if (f->sends == 0) {
+            continue;
+        }
+        uint32_t last = f->first + f->sends - 1;
+        uint32_t start = (int32_t)(lo - f->first) > 0 ? lo : f->first;
+        uint32_t end = (int32_t)(hi - last) < 0 ? hi : last;
+        if ((int32_t)(end - start) >= 0) {
+            f->done += end - start + 1;
+        }
+    }
+}
+
+// 读取错误队列中的全部完成通知
+// @return 通知条数
+static int drain_errqueue(jtt1078_zc_t *zc) {
+    int notes = 0;
+
+    for (;;) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(zc->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;      // EAGAIN: 队列已空
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            const struct sock_extended_err *ee = (const struct sock_extended_err *)CMSG_DATA(cm);
+            if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY || ee->ee_errno != 0) {
+                continue;
+            }
+
+            uint32_t lo = ee->ee_info, hi = ee->ee_data;
+            uint32_t n = hi - lo + 1;
+            JTT1078_STAT_ADD(zc->stats.completions, n);
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                JTT1078_STAT_ADD(zc->stats.copied, n);
+            }
+            complete_range(zc, lo, hi);
+            notes++;
+        }
+    }
+    return notes;
+}
+
+int jtt1078_zc_reap(jtt1078_zc_t *zc, int timeout_ms) {
+    if (!zc || zc->fd < 0) {
+        return 0;
+    }
+
+    drain_errqueue(zc);
+    int released = release_done(zc);
+
+    uint64_t deadline = monotonic_us() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000;
+    while (released == 0 && zc->count > (zc->cur ? 1u : 0u)) {
+        uint64_t now = monotonic_us();
+        if (now >= deadline) {
+            break;
+        }
+
+        // 错误队列非空时 poll 返回 POLLERR
+        struct pollfd pfd = { .fd = zc->fd, .events = 0 };
+        int ret = poll(&pfd, 1, (int)((deadline - now + 999) / 1000));
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        if (drain_errqueue(zc) == 0) {
+            break;      // socket错误而非完成通知, 由下一次发送处理
+        }
+        released = release_done(zc);
+    }
+    return released;
+}
+
+void jtt1078_zc_detach(jtt1078_zc_t *zc) {
+    if (!zc) {
+        return;
+    }
+
+    // 正在发送的帧保留到 jtt1078_zc_end, 其余立即释放
+    while (zc->count > 0 && &zc->frames[zc->head] != zc->cur) {
+        release_frame(zc, &zc->frames[zc->head], true);
+        zc->head = (zc->head + 1) % JTT1078_ZC_MAX_PENDING;
+        zc->count--;
+    }
+    if (zc->cur) {
+        zc->cur->sends = 0;
+        zc->cur->done = 0;
+    }
+    JTT1078_STAT_STORE(zc->stats.pending, zc->count);
+
+    zc->fd = -1;
+    zc->enabled = false;
+    zc->next_seq = 0;
+}
+
+void jtt1078_zc_begin(jtt1078_zc_t *zc, const uint8_t *data, uint32_t size, void *buf,
+                      int timeout_ms) {
+    zc->cur = NULL;
+    zc->cur_data = data;
+    zc->cur_size = size;
+    zc->cur_buf = buf;
+    zc->cur_open = true;
+
+    // 每帧收割一次, 小帧之间也能及时释放之前的大帧
+    if (zc->count > 0) {
+        jtt1078_zc_reap(zc, 0);
+    }
+    if (!zc->enabled || size < zc->min_bytes) {
+        return;
+    }
+
+    if (zc->count == JTT1078_ZC_MAX_PENDING) {
+        JTT1078_STAT_ADD(zc->stats.slot_waits, 1);
+        jtt1078_zc_reap(zc, timeout_ms);
+        if (zc->count == JTT1078_ZC_MAX_PENDING) {
+            return;     // 仍无空闲槽位, 本帧拷贝发送
+        }
+    }
+
+    jtt1078_zc_frame_t *f = &zc->frames[(zc->head + zc->count) % JTT1078_ZC_MAX_PENDING];
+    f->buf = buf;
+    f->first = zc->next_seq;
+    f->sends = 0;
+    f->done = 0;
+    f->start_us = monotonic_us();
+    f->stage_len = 0;
+    zc->count++;
+    zc->cur = f;
+}
+
+void jtt1078_zc_end(jtt1078_zc_t *zc) {
+    if (!zc->cur_open) {
+        return;
+    }
+    zc->cur_open = false;
+
+    jtt1078_zc_frame_t *f = zc->cur;
+    zc->cur = NULL;
+    if (!f || f->sends == 0) {
+        // 没有零拷贝发送(小帧/跳过/断线), 缓冲区立即可用; 槽位是环的末尾
+        if (f) {
+            zc->count--;
+        }
+        JTT1078_STAT_ADD(zc->stats.frames_copied, 1);
+        zc->release(zc->user_data, zc->cur_buf);
+    } else {
+        JTT1078_STAT_ADD(zc->stats.frames, 1);
+        JTT1078_STAT_MAX(zc->stats.max_pending, zc->count);
+    }
+    release_done(zc);
+}
+
+// 等待可写; 期间收割完成通知
+static int wait_writable(jtt1078_zc_t *zc, uint64_t deadline_us, bool infinite) {
+    for (;;) {
+        uint64_t now = monotonic_us();
+        int wait = infinite ? -1 : now >= deadline_us ? 0 : (int)((deadline_us - now + 999) / 1000);
+
+        struct pollfd pfd = { .fd = zc->fd, .events = POLLOUT };
+        int ret = poll(&pfd, 1, wait);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (ret == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (pfd.revents & POLLERR) {
+            // 完成通知或socket错误; 后者由重试的 sendmsg 返回
+            drain_errqueue(zc);
+            release_done(zc);
+        }
+        return 0;
+    }
+}
+
+ssize_t jtt1078_zc_sendv(jtt1078_zc_t *zc, const struct iovec *iov, int iovcnt, int timeout_ms) {
+    jtt1078_zc_frame_t *f = zc->cur;
+    if (!f || !zc->enabled) {
+        return jtt1078_sock_sendv(zc->fd, iov, iovcnt, timeout_ms);
+    }
+
+    // 帧缓冲区以外的数据(包头/校验包/GOP回放)拷入暂存区
+    const uint8_t *lo = zc->cur_data, *hi = zc->cur_data + zc->cur_size;
+    size_t extra = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const uint8_t *p = (const uint8_t *)iov[i].iov_base;
+        if (p < lo || p + iov[i].iov_len > hi) {
+            extra += iov[i].iov_len;
+        }
+    }
+    if (f->stage_len + extra > JTT1078_ZC_STAGE_BYTES) {
+        JTT1078_STAT_ADD(zc->stats.fallbacks, 1);
+        return jtt1078_sock_sendv(zc->fd, iov, iovcnt, timeout_ms);
+    }
+
+    if (zc->iov_capacity < iovcnt) {
+        struct iovec *v = realloc(zc->iov, iovcnt * sizeof(struct iovec));
+        if (!v) {
+            return jtt1078_sock_sendv(zc->fd, iov, iovcnt, timeout_ms);
+        }
+        zc->iov = v;
+        zc->iov_capacity = iovcnt;
+    }
+
+    size_t zc_bytes = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const uint8_t *p = (const uint8_t *)iov[i].iov_base;
+        if (p < lo || p + iov[i].iov_len > hi) {
+            memcpy(f->stage + f->stage_len, p, iov[i].iov_len);
+            zc->iov[i].iov_base = f->stage + f->stage_len;
+            f->stage_len += (uint32_t)iov[i].iov_len;
+        } else {
+            zc->iov[i].iov_base = iov[i].iov_base;
+            zc_bytes += iov[i].iov_len;
+        }
+        zc->iov[i].iov_len = iov[i].iov_len;
+    }
+
+    uint64_t deadline = monotonic_us() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000;
+    size_t total = 0;
+    int idx = 0;
+
+    while (idx < iovcnt) {
+        struct iovec *cur = zc->iov + idx;
+        int cur_cnt = iovcnt - idx < ZC_BATCH_MAX ? iovcnt - idx : ZC_BATCH_MAX;
+        idx += cur_cnt;
+
+        while (cur_cnt > 0) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = cur;
+            msg.msg_iovlen = cur_cnt;
+
+            ssize_t ret = sendmsg(zc->fd, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (wait_writable(zc, deadline, timeout_ms < 0) < 0) {
+                        return -1;
+                    }
+                    continue;
+                }
+                if (errno == ENOBUFS) {
+                    // 通知占满 optmem, 剩余部分拷贝发送(仍引用暂存区, 返回前完成拷贝)
+                    JTT1078_STAT_ADD(zc->stats.fallbacks, 1);
+                    ssize_t n = jtt1078_sock_sendv(zc->fd, cur, iovcnt - (int)(cur - zc->iov), timeout_ms);
+                    if (n < 0) {
+                        return -1;
+                    }
+                    return (ssize_t)(total + n);
+                }
+                return -1;
+            }
+
+            // 每次成功的零拷贝 sendmsg 占用一个完成序号
+            f->sends++;
+            zc->next_seq++;
+            JTT1078_STAT_ADD(zc->stats.sends, 1);
+            total += ret;
+
+            size_t left = (size_t)ret;
+            while (cur_cnt > 0 && left >= cur->iov_len) {
+                left -= cur->iov_len;
+                cur++;
+                cur_cnt--;
+            }
+            if (cur_cnt > 0) {
+                cur->iov_base = (uint8_t *)cur->iov_base + left;
+                cur->iov_len -= left;
+            }
+        }
+    }
+
+    JTT1078_STAT_ADD(zc->stats.bytes, zc_bytes);
+    return (ssize_t)total;
+}
+
+void jtt1078_zc_get_stats(const jtt1078_zc_t *zc, jtt1078_zc_stats_t *out) {
+    out->frames = JTT1078_STAT_LOAD(zc->stats.frames);
+    out->frames_copied = JTT1078_STAT_LOAD(zc->stats.frames_copied);
+    out->sends = JTT1078_STAT_LOAD(zc->stats.sends);
+    out->bytes = JTT1078_STAT_LOAD(zc->stats.bytes);
+    out->completions = JTT1078_STAT_LOAD(zc->stats.completions);
+    out->copied = JTT1078_STAT_LOAD(zc->stats.copied);
+    out->fallbacks = JTT1078_STAT_LOAD(zc->stats.fallbacks);
+    out->slot_waits = JTT1078_STAT_LOAD(zc->stats.slot_waits);
+    out->aborted = JTT1078_STAT_LOAD(zc->stats.aborted);
+    out->pending = JTT1078_STAT_LOAD(zc->stats.pending);
+    out->max_pending = JTT1078_STAT_LOAD(zc->stats.max_pending);
+    out->max_hold_us = JTT1078_STAT_LOAD(zc->stats.max_hold_us);
+    out->total_hold_us = JTT1078_STAT_LOAD(zc->stats.total_hold_us);
+}
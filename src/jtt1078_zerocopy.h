@@ -0,0 +1,145 @@
+/*
+ * JT/T 1078 Zero-copy Transmit
+ * MSG_ZEROCOPY 发送(Linux 4.14+): 大I帧的负载不再拷入socket发送缓冲区,
+ * 内核直接引用用户页, 数据发出(TCP为被确认)后经socket错误队列通知完成
+ *
+ *   - 只有落在已登记帧缓冲区内的 iovec(即分包负载)零拷贝引用; 包头、FEC 校验包、
+ *     GOP回放等编码器内部复用的数据先拷入本帧的暂存区(随帧保留到完成),
+ *     编码器缓冲区在发送返回后即可复用
+ *   - 帧缓冲区(RK_MPI_VENC_ReleaseStream 释放的码流缓冲区, 或发送队列/缓冲池中的
+ *     帧)在 release 回调之前不可修改或释放; 回调在发送线程中, 于之后的
+ *     发送/jtt1078_zc_reap 中收割完成通知时调用
+ *   - 小于 min_bytes 的帧(P帧、音频)拷贝发送更快: 锁页与完成通知的开销
+ *     只在大帧上划算, 这些帧在 jtt1078_zc_end 中立即回调
+ *   - 内核无法零拷贝时(回环、网卡不支持分散聚集/校验和卸载)仍会拷贝,
+ *     完成通知带 SO_EE_CODE_ZEROCOPY_COPIED, 计入 stats.copied
+ *   - 未完成的帧数达到 JTT1078_ZC_MAX_PENDING 时, 新帧等待完成通知
+ *     (最长为发送超时), 超时后该帧退回拷贝发送
+ *
+ * 对象只由发送线程使用; 统计以原子操作更新, jtt1078_zc_get_stats 可在任意线程调用。
+ */
+
+#ifndef JTT1078_ZEROCOPY_H
+#define JTT1078_ZEROCOPY_H
+
+#include "jtt1078_protocol.h"
+#include <sys/uio.h>
+
+#define JTT1078_ZC_MAX_PENDING      16              // 最多未完成的帧数
+#define JTT1078_ZC_STAGE_BYTES      (48 * 1024)     // 每帧暂存区(包头等), 约1600个分包(1.5MB的帧)
+#define JTT1078_ZC_DEFAULT_MIN      (32 * 1024)     // 默认零拷贝发送的最小帧长
+
+// 统计
+typedef struct {
+    uint64_t frames;            // 零拷贝发送的帧数
+    uint64_t frames_copied;     // 小于 min_bytes 或无空闲槽位而拷贝发送的帧数
+    uint64_t sends;             // 带 MSG_ZEROCOPY 的 sendmsg 次数
+    uint64_t bytes;             // 其中零拷贝引用的负载字节数
+    uint64_t completions;       // 完成的 sendmsg 数
+    uint64_t copied;            // 其中内核仍然拷贝的数量(回环/网卡不支持)
+    uint64_t fallbacks;         // 暂存区不足或 ENOBUFS 而改为普通发送的次数
+    uint64_t slot_waits;        // 无空闲槽位而等待完成的次数
+    uint64_t aborted;           // 连接断开时未等到完成即释放的帧数
+    uint32_t pending;           // 当前未完成的帧数
+    uint32_t max_pending;
+    uint32_t max_hold_us;       // 帧缓冲区从开始发送到释放的最长时间
+    uint64_t total_hold_us;     // 零拷贝帧的累计持有时间
+} jtt1078_zc_stats_t;
+
+// 未完成的帧
+typedef struct {
+    void    *buf;               // 调用方的缓冲区标识, 传给 release
+    uint32_t first;             // 本帧 sendmsg 序号范围 [first, first + sends)
+    uint32_t sends;
+    uint32_t done;              // 已完成的 sendmsg 数
+    uint64_t start_us;
+    uint8_t *stage;             // 暂存区(JTT1078_ZC_STAGE_BYTES)
+    uint32_t stage_len;
+} jtt1078_zc_frame_t;
+
+typedef struct {
+    int      fd;                // 当前socket, <0未连接
+    bool     enabled;           // 当前socket已设置 SO_ZEROCOPY
+    uint32_t min_bytes;
+    void   (*release)(void *user_data, void *buf);
+    void    *user_data;
+
+    // 未完成的帧(环形, 按发送顺序)
+    jtt1078_zc_frame_t frames[JTT1078_ZC_MAX_PENDING];
+    uint32_t head;
+    uint32_t count;
+    uint32_t next_seq;          // 下一次零拷贝 sendmsg 的序号(内核按socket从0计数)
+
+    // 正在发送的帧
+    jtt1078_zc_frame_t *cur;
+    const uint8_t *cur_data;
+    uint32_t cur_size;
+    void    *cur_buf;
+    bool     cur_open;
+
+    struct iovec *iov;          // 重建的 iovec
+    int      iov_capacity;
+
+    jtt1078_zc_stats_t stats;   // 原子更新
+} jtt1078_zc_t;
+
+/**
+ * 初始化
+ * @param min_bytes 帧长不小于该值时零拷贝发送, 0使用 JTT1078_ZC_DEFAULT_MIN
+ * @param release 帧缓冲区可以复用时回调(发送线程)
+ * @return 0成功, -1参数错误或内存不足
+ */
+int jtt1078_zc_init(jtt1078_zc_t *zc, uint32_t min_bytes,
+                    void (*release)(void *user_data, void *buf), void *user_data);
+
+/**
+ * 绑定新连接的socket(设置 SO_ZEROCOPY, 序号从0开始)
+ * @return 1启用零拷贝, 0内核不支持(只拷贝发送)
+ */
+int jtt1078_zc_attach(jtt1078_zc_t *zc, int fd);
+
+/**
+ * 连接即将关闭: 释放全部未完成的帧
+ * 调用方应以 SO_LINGER{1,0} 关闭socket(复位连接), 使内核丢弃仍引用这些缓冲区的数据
+ */
+void jtt1078_zc_detach(jtt1078_zc_t *zc);
+
+/**
+ * 开始发送一帧: 登记帧缓冲区, 之后 jtt1078_zc_sendv 引用其中的负载
+ * 无空闲槽位时等待完成通知, 最长 timeout_ms
+ * @param data/size 帧缓冲区(video_frame_t.data/size)
+ * @param buf 缓冲区标识, 完成后传给 release
+ */
+void jtt1078_zc_begin(jtt1078_zc_t *zc, const uint8_t *data, uint32_t size, void *buf,
+                      int timeout_ms);
+
+/**
+ * 发送 iovec 数组(语义同 jtt1078_sock_sendv)
+ * 帧已登记且可零拷贝时带 MSG_ZEROCOPY 发送, 否则普通发送
+ * @return 发送的总字节数, -1失败
+ */
+ssize_t jtt1078_zc_sendv(jtt1078_zc_t *zc, const struct iovec *iov, int iovcnt, int timeout_ms);
+
+/**
+ * 一帧发送结束: 没有零拷贝发送的帧立即回调 release, 否则等待完成通知
+ */
+void jtt1078_zc_end(jtt1078_zc_t *zc);
+
+/**
+ * 收割完成通知, 释放已完成的帧
+ * @param timeout_ms 没有可释放的帧时最长等待(毫秒), 0不等待
+ * @return 释放的帧数
+ */
+int jtt1078_zc_reap(jtt1078_zc_t *zc, int timeout_ms);
+
+/**
+ * 获取统计(线程安全)
+ */
+void jtt1078_zc_get_stats(const jtt1078_zc_t *zc, jtt1078_zc_stats_t *out);
+
+/**
+ * 释放资源(先 detach)
+ */
+void jtt1078_zc_deinit(jtt1078_zc_t *zc);
+
+#endif // JTT1078_ZEROCOPY_H
@@ -23,6 +23,9 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include "jtt1078_nal.h"
+#include "jtt1078_playback.h"
+
 // Configuration - Will be overridden by config file
 #define DEFAULT_VIDEO_WIDTH     1920
 #define DEFAULT_VIDEO_HEIGHT    1080
@@ -435,16 +438,28 @@ static void *camera_thread(void *arg) {
         struct tm tm_gmt7;
         localtime_r(&now, &tm_gmt7);
         
-        // Dummy H.264 NAL unit with timestamp (replace with real MPP output + OSD)
+        // Dummy Annex-B access unit with timestamp (replace with real MPP output + OSD):
+        // start code, NAL header (IDR every 2 sec, else non-IDR slice), then
+        // first_mb_in_slice=0 and slice_type (I=2 / P=0) as Exp-Golomb codes
         unsigned char dummy_frame[4096];
-        int size = snprintf((char*)dummy_frame, sizeof(dummy_frame),
+        int idr = (frame_count % (VIDEO_FPS * 2)) == 0;
+        dummy_frame[0] = 0x00;
+        dummy_frame[1] = 0x00;
+        dummy_frame[2] = 0x00;
+        dummy_frame[3] = 0x01;
+        dummy_frame[4] = idr ? 0x65 : 0x41;
+        dummy_frame[5] = idr ? 0xB0 : 0xC0;
+        int size = 6 + snprintf((char*)dummy_frame + 6, sizeof(dummy_frame) - 6,
                            "FRAME_%06d_TIME_%04d%02d%02d_%02d%02d%02d",
                            frame_count,
                            tm_gmt7.tm_year + 1900, tm_gmt7.tm_mon + 1, tm_gmt7.tm_mday,
                            tm_gmt7.tm_hour, tm_gmt7.tm_min, tm_gmt7.tm_sec);
         
         int64_t pts = frame_count * (1000000 / VIDEO_FPS);
-        int keyframe = (frame_count % (VIDEO_FPS * 2)) == 0; // I-frame every 2 sec
+        
+        // Derive the keyframe flag from the bitstream rather than the frame counter
+        bool keyframe = false;
+        jtt1078_nal_frame_type(dummy_frame, (uint32_t)size, JTT1078_VIDEO_H264, &keyframe);
         
         if (frame_queue_push(&g_frame_queue, dummy_frame, size, pts, keyframe) < 0) {
             fprintf(stderr, "[CAMERA] Failed to push frame %d\n", frame_count);
@@ -550,6 +565,8 @@ static void *record_thread(void *arg) {
     }
     
     FILE *out_file = NULL;
+    FILE *idx_file = NULL;      // Keyframe index for playback upload (<segment>.idx)
+    uint64_t segment_bytes = 0;
     time_t segment_start = 0;
     int segment_num = 0;
     int frame_count = 0;
@@ -573,8 +590,19 @@ static void *record_thread(void *arg) {
         
         time_t now = time(NULL);
         
-        // Create new segment file based on SEGMENT_DURATION
-        if (!out_file || (now - segment_start) >= SEGMENT_DURATION) {
+        // Re-check the bitstream: only an IDR may start a segment, otherwise the
+        // new file would begin with frames that cannot be decoded on their own
+        bool keyframe = false;
+        if (jtt1078_nal_frame_type(frame.data, (uint32_t)frame.size, JTT1078_VIDEO_H264, &keyframe) < 0) {
+            keyframe = frame.keyframe;
+        }
+        
+        // Create new segment file once SEGMENT_DURATION has elapsed, at the next keyframe
+        if (!out_file || ((now - segment_start) >= SEGMENT_DURATION && keyframe)) {
+            if (idx_file) {
+                fclose(idx_file);
+                idx_file = NULL;
+            }
             if (out_file) {
                 fclose(out_file);
                 printf("[RECORD] Segment %d closed: %d frames (%d sec)\n", 
@@ -602,24 +630,53 @@ static void *record_thread(void *arg) {
                 break;
             }
             
+            // Playback works without the index (it falls back to a NAL scan)
+            char idx_name[sizeof(filename) + sizeof(JTT1078_PLAYBACK_INDEX_SUFFIX)];
+            snprintf(idx_name, sizeof(idx_name), "%s%s", filename, JTT1078_PLAYBACK_INDEX_SUFFIX);
+            idx_file = fopen(idx_name, "wb");
+            if (!idx_file) {
+                fprintf(stderr, "[RECORD] Failed to create %s: %s\n", idx_name, strerror(errno));
+            }
+            
             printf("[RECORD] New segment: %s (duration: %ds)\n", filename, SEGMENT_DURATION);
             log_message("[RECORD] New segment: %s", filename);
             segment_start = now;
             segment_num++;
             frame_count = 0;
+            segment_bytes = 0;
+        }
+        
+        // Index the keyframe before writing it: offset, capture time (UTC ms), frame number
+        if (keyframe && idx_file) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            jtt1078_playback_key_t key = {
+                .offset = segment_bytes,
+                .time_ms = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000,
+                .frame = (uint32_t)frame_count,
+            };
+            if (fwrite(&key, sizeof(key), 1, idx_file) != 1) {
+                fprintf(stderr, "[RECORD] Index write error\n");
+            }
+            fflush(idx_file);
         }
         
         // Write frame to file
-        if (fwrite(frame.data, 1, frame.size, out_file) != frame.size) {
+        size_t written = fwrite(frame.data, 1, frame.size, out_file);
+        if (written != frame.size) {
             fprintf(stderr, "[RECORD] Write error\n");
             log_message("[RECORD] ERROR: Write error to file");
         }
         fflush(out_file);  // Ensure data is written
+        segment_bytes += written;
         frame_count++;
         
         free(frame.data);
     }
     
+    if (idx_file) {
+        fclose(idx_file);
+    }
     if (out_file) {
         fclose(out_file);
         printf("[RECORD] Final segment %d closed: %d frames\n", segment_num, frame_count);
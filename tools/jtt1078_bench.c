@@ -0,0 +1,3824 @@
+/*
+ * JT/T 1078 Benchmarks
+ * 性能测试工具, 结果以 JSON Lines 输出到标准输出, 便于不同版本/平台对比
+ *
+ * Usage:
+ *   jtt1078_bench sweep [-s seconds] [-f frame_bytes] [-p] [payload_size ...]
+ *       分包大小扫描: 经本机回环TCP发送合成视频帧,
+ *       报告每个分包大小下的 packets/s, bytes/s 和每MB CPU时间
+ *       -p  每个分包单独发送(默认整帧批量发送)
+ *
+ *   jtt1078_bench depack [-s seconds] [-f frame_bytes] [-c chunk_bytes]
+ *       接收端解析: 内存中的分包流按 chunk 切分喂入 jtt1078_depack,
+ *       报告解析吞吐(MB/s); 再经本机回环TCP往返一次, 校验帧数与内容
+ *
+ *   jtt1078_bench nal [-s seconds] [-m megabytes]
+ *       NAL 起始码扫描: 合成多MB的H.265 I帧, 对比逐字节循环与
+ *       jtt1078_find_start_code (NEON/SSE2/标量) 的吞吐(MB/s); 以及
+ *       jtt1078_nal_frame_type(只读NAL头)与整帧扫描判断帧类型的每帧耗时,
+ *       并用小样本(参数集/AUD/SEI/空NAL/H.264)校验两者结果一致
+ *
+ *   jtt1078_bench packetize [-s seconds] [-P payload_size] [-c cpu]
+ *       打包微基准: 合成 I/P 帧(1080p/4K 典型大小), 分别经
+ *       encode_video_frame(批量/逐包), create_packet, create_packet+send_packet,
+ *       发往空回调/内存拷贝/本机回环TCP, 报告 ns/包, 包/秒, 每帧内存分配次数
+ *       和每字节周期数(perf_event 周期计数器, 不可用时退回 TSC 或不报告)
+ *       -c  绑定到指定CPU, 减少结果抖动
+ *       第一行为运行环境(架构/内核/编译器), 便于跨版本和平台对比
+ *
+ *   jtt1078_bench latency [-s seconds] [-b bitrate] [-r fps] [-g gop] [-t tcp|udp]
+ *                         [-f i_ratio:p_ratio] [-L loss_pct]
+ *       端到端延迟: 按帧率发送合成GOP(帧内携带发送时刻), 分别经本机回环
+ *       TCP 和 UDP(每包一个数据报, 整帧一次 sendmmsg)收包重组,
+ *       报告帧延迟 p50/p90/p99/最大值与丢帧数; 配合 netem 比较弱网下两种传输:
+ *         tc qdisc add dev lo root netem loss 2% delay 20ms
+ *         jtt1078_bench latency -s 10
+ *         tc qdisc del dev lo root
+ *       -f  UDP 启用FEC(关键帧/P帧校验比例%, 如 20:10), 接收端经 jtt1078_fec_decoder 恢复
+ *       -L  UDP 接收端按比例随机丢弃数据报(无 tc 权限时模拟丢包)
+ *
+ *   jtt1078_bench fec [-s seconds] [-g group_size]
+ *       前向纠错: GF(2^8) 区域乘加吞吐(异或/查表乘法, NEON/SSSE3/标量),
+ *       I/P帧生成校验包的额外耗时, 以及每组丢失 m 个源包时的恢复耗时;
+ *       并检查启用FEC后调大分包负载被拒绝(校验包不超过最大包长)
+ *
+ *   jtt1078_bench audio [-s seconds] [-n samples_per_frame]
+ *       G.711 编码: 全部65536个PCM值与参考实现逐一比对, 报告逐样本参考实现与
+ *       批量编码(NEON/SSE2/查表)的 samples/s; 再按 20ms 帧经 jtt1078_encode_audio_pcm
+ *       发送, 比较不同聚合时长下每秒包数、发送调用次数、包头开销和额外时延
+ *
+ *   jtt1078_bench rate [-s seconds] [-c high:low] [-b max_bitrate] [-m static|adaptive]
+ *       码率自适应: 本机回环TCP的接收端按 高/低/高 三段容量(kbps, 默认 3000:1000)
+ *       限速读取, 合成编码器按目标码率产生GOP; 对比固定码率与 jtt1078_rate
+ *       控制(经 set_bitrate 钩子调整合成帧大小, 拥塞时跳帧)下每段的
+ *       帧延迟 p50/p99/最大值、平均目标码率和跳帧数
+ *
+ *   jtt1078_bench pace [-s seconds] [-b bitrate] [-F fraction_pct] [-l link_kbps] [-r max_rate_kbps]
+ *                      [-q queue_bytes] [-m off|user|kernel]
+ *       关键帧突发平滑: 经本机回环TCP(MSS 1400)按帧率发送合成GOP, 接收端记录
+ *       每次读取的到达时刻与字节数, 离线送入调制解调器模型(浅缓冲区 queue_bytes,
+ *       按 link_kbps 排空, 满时丢弃); 对比不限速、用户态令牌桶和内核
+ *       SO_MAX_PACING_RATE 下I帧的到达时长、模型队列峰值、溢出字节与受损帧数,
+ *       以及编码器统计中的节奏控制时延和最大单帧速率(I帧)。节奏控制速率上限
+ *       max_rate_kbps 默认取 link_kbps(0不限)。回环RTT极小, Linux 5.18 起 TCP 按
+ *       tcp_tso_rtt_log 允许整块64KB的TSO突发, 内核模式须先关闭:
+ *         sysctl -w net.ipv4.tcp_tso_rtt_log=0
+ *       (真实蜂窝链路RTT在几十毫秒以上, 不受影响)
+ *
+ *   jtt1078_bench playback [-s seconds] [-t footage_seconds] [-b bitrate] [-d dir] [-f segment.h264]
+ *       录像回放上传: 在 dir 下合成两个内容相同的录像段(默认180秒, 一个带 .idx 索引,
+ *       一个需要扫描), 每次先丢弃页缓存, 经 jtt1078_playback 逐帧/只发关键帧送入
+ *       编码器(空回调); 不等待时报告 MB/s、CPU占用和相对实时的倍数(CPU占用低即
+ *       受读取速度限制), 16倍速时运行 seconds 秒, 报告实际达到的倍数;
+ *       校验帧数、关键帧数和时间戳递增。-f 使用已有的录像段(H.264)
+ *
+ *   jtt1078_bench fanout [-s seconds] [-f frames] [-n max_dests] [-b bitrate]
+ *       多平台推送: 1..max_dests 个本机回环TCP接收端, 对比每个平台一个编码器
+ *       (各自分包)与 jtt1078_fanout 分包一次后扇出, 报告每帧发送CPU时间(含各
+ *       发送线程)和采集线程的CPU时间, 接收端校验帧数与包序号连续; 再按帧率实时
+ *       发送 seconds 秒, 其中一个接收端不读取, 报告正常平台收到的帧数、采集线程
+ *       最长阻塞时间和卡住平台的丢帧数
+ *
+ *   jtt1078_bench zerocopy [-s seconds] [-m min_bytes] [-H host:port] [frame_bytes ...]
+ *       零拷贝发送: 缓冲池中的I帧(默认 16K/64K/256K/1MB)经 jtt1078_conn 分别
+ *       拷贝发送和 MSG_ZEROCOPY 发送, 报告 MB/s、每MB发送CPU(用户/内核)、内核仍拷贝
+ *       的比例和缓冲区持有时间; 回环接收端校验帧内容, 缓冲区在完成前被复用即失败。
+ *       回环上内核总是拷贝(接收方需要私有副本), 零拷贝只增加开销; 真实网卡的
+ *       结果用 -H 发往另一台主机(如 nc -lk 6605 >/dev/null)
+ *
+ *   jtt1078_bench aio [-n streams] [-f frames] [-g gop] [-i i_bytes] [-p p_bytes]
+ *       一个事件循环为 n 路编码器发送(默认16路, I帧64KB/P帧8KB): 回调中阻塞发送、
+ *       epoll 后端与 io_uring 后端, 报告每帧系统调用数与CPU、每次收割的最大完成数;
+ *       各回环接收端校验帧内容与帧数。内核不支持 io_uring 时跳过该项
+ *
+ *   jtt1078_bench concurrent [-f frames] [-g gop] [-i i_bytes] [-p p_bytes] [-d delay_us] [-P]
+ *       多线程生产者: 视频线程与音频线程(20ms G.711, 帧数为视频的2倍)不加节拍地
+ *       同时调用同一编码器, 回调逐包检查包序号逐包加1、分包帧不被其他帧插入、
+ *       回调不并发、各媒体时间戳单调且间隔字段正确; 对比调用方以一把全局锁
+ *       串行化两个线程的基线, 报告包/秒、音频调用耗时 p50/p99/最大值和编码器
+ *       等待发送顺序的次数。-d 每次回调忙等模拟阻塞发送, -P 逐包回调
+ *
+ *   jtt1078_bench sendq
+ *       发送队列丢帧策略: 按 rkipc 的方式(jtt1078_nal_frame_type)把单独成包的
+ *       VPS/SPS/PPS 和 IDR 依次压入已满的队列(队首空闲/正在发送, 槽位环绕),
+ *       检查出队的是完整且按序的 VPS, SPS, PPS, IDR
+ *
+ * 每帧内存分配次数依赖链接选项 -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+ * (见 Makefile.jtt1078 的 BENCH_LDFLAGS), 只统计本程序和协议库内的调用。
+ */
+
+#define _GNU_SOURCE
+#include "jtt1078_protocol.h"
+#include "jtt1078_transport.h"
+#include "jtt1078_nal.h"
+#include "jtt1078_depack.h"
+#include "jtt1078_fec.h"
+#include "jtt1078_g711.h"
+#include "jtt1078_rate.h"
+#include "jtt1078_pace.h"
+#include "jtt1078_playback.h"
+#include "jtt1078_fanout.h"
+#include "jtt1078_conn.h"
+#include "jtt1078_aio.h"
+#include "jtt1078_sendq.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static FILE *g_out;
+
+/*
+ * 内存分配计数(链接时 --wrap 替换)
+ */
+
+static uint64_t g_allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    __atomic_fetch_add(&g_allocs, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+    __atomic_fetch_add(&g_allocs, 1, __ATOMIC_RELAXED);
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    __atomic_fetch_add(&g_allocs, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+static inline uint64_t alloc_count(void) {
+    return __atomic_load_n(&g_allocs, __ATOMIC_RELAXED);
+}
+
+static uint64_t now_ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Loopback TCP sink
+ */
+
+typedef struct {
+    int listen_fd;
+    uint64_t bytes;
+    jtt1078_depack_t *depack;   // 非NULL时接收数据送入解析器
+} sink_t;
+
+static void *sink_thread(void *arg) {
+    sink_t *sink = (sink_t *)arg;
+    sink->bytes = 0;
+    int fd = accept(sink->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    static uint8_t buf[256 * 1024];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        sink->bytes += n;
+        if (sink->depack) {
+            jtt1078_depack_feed(sink->depack, buf, n);
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+// 回环连接的socket参数, 0为系统默认
+typedef struct {
+    int rcvbuf;                 // 接收端 SO_RCVBUF(设在监听socket上, 由 accept 的连接继承)
+    int sndbuf;                 // 发送端 SO_SNDBUF
+    int mss;                    // 发送端 TCP_MAXSEG(回环 MTU 为64KB, 按蜂窝链路的MSS分段)
+    bool nonblock;              // 发送端非阻塞(与 jtt1078_conn 相同, 发送超时才生效)
+} loopback_opts_t;
+
+// 回环接收端开始监听, 启动接收线程 thread(arg)(从 *listen_fd accept), 返回端口
+static int loopback_listen(int *listen_fd, void *(*thread)(void *), void *arg, int rcvbuf, pthread_t *tid) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    *listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (*listen_fd >= 0 && rcvbuf > 0) {
+        setsockopt(*listen_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    if (*listen_fd < 0 ||
+        bind(*listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(*listen_fd, 1) < 0 ||
+        getsockname(*listen_fd, (struct sockaddr *)&addr, &len) < 0) {
+        perror("[BENCH] listen");
+        return -1;
+    }
+    pthread_create(tid, NULL, thread, arg);
+    return ntohs(addr.sin_port);
+}
+
+// 建立回环连接(接收线程同 loopback_listen), 返回发送端socket; opts 可为NULL
+static int loopback_open(int *listen_fd, void *(*thread)(void *), void *arg,
+                         const loopback_opts_t *opts, pthread_t *tid) {
+    static const loopback_opts_t defaults = { 0 };
+    struct sockaddr_in addr;
+
+    if (!opts) {
+        opts = &defaults;
+    }
+    int port = loopback_listen(listen_fd, thread, arg, opts->rcvbuf, tid);
+    if (port < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && opts->sndbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &opts->sndbuf, sizeof(opts->sndbuf));
+    }
+    if (fd >= 0 && opts->mss > 0) {
+        setsockopt(fd, IPPROTO_TCP, TCP_MAXSEG, &opts->mss, sizeof(opts->mss));
+    }
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("[BENCH] connect");
+        return -1;
+    }
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    if (opts->nonblock) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return fd;
+}
+
+static void loopback_close(int fd, int listen_fd, pthread_t tid) {
+    shutdown(fd, SHUT_WR);
+    pthread_join(tid, NULL);
+    close(fd);
+    close(listen_fd);
+}
+
+// 发送回调: 每次回调一次 jtt1078_sock_sendv(阻塞socket时恰好一次系统调用),
+// 记录回调次数与写出的字节数
+typedef struct {
+    int fd;
+    int timeout_ms;             // 非阻塞socket等待可写的上限, 与 jtt1078_conn 的 send_timeout_ms 相当; -1不限
+    uint64_t calls;
+    uint64_t written;
+} sock_conn_t;
+
+static int sock_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    sock_conn_t *c = (sock_conn_t *)user_data;
+    c->calls++;
+    ssize_t n = jtt1078_sock_sendv(c->fd, iov, iovcnt, c->timeout_ms);
+    if (n < 0) {
+        return -1;
+    }
+    c->written += (uint64_t)n;
+    return 0;
+}
+
+/*
+ * sweep: 分包大小扫描
+ */
+
+static int bench_sweep(int argc, char **argv) {
+    double seconds = 2.0;
+    uint32_t frame_size = 100 * 1024;
+    bool per_packet = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:f:p")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 'f': frame_size = (uint32_t)atoi(optarg); break;
+        case 'p': per_packet = true; break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench sweep [-s seconds] [-f frame_bytes] [-p] [size ...]\n");
+            return 1;
+        }
+    }
+
+    static const uint32_t default_sizes[] = { 512, 920, 1400, 4096, 8192, 16384, 32768, 65535 };
+    uint32_t sizes[64];
+    int nsizes = 0;
+    for (int i = optind; i < argc && nsizes < 64; i++) {
+        sizes[nsizes++] = (uint32_t)atoi(argv[i]);
+    }
+    if (nsizes == 0) {
+        nsizes = sizeof(default_sizes) / sizeof(default_sizes[0]);
+        memcpy(sizes, default_sizes, sizeof(default_sizes));
+    }
+
+    uint8_t *frame_data = malloc(frame_size);
+    if (!frame_data) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < frame_size; i++) {
+        frame_data[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    for (int i = 0; i < nsizes; i++) {
+        sink_t sink;
+        pthread_t tid;
+        sock_conn_t conn = { .fd = loopback_open(&sink.listen_fd, sink_thread, &sink, NULL, &tid), .timeout_ms = -1 };
+        if (conn.fd < 0) {
+            free(frame_data);
+            return 1;
+        }
+
+        jtt1078_encoder_t encoder;
+        jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265,
+                                 sock_sendv_cb, &conn);
+        if (jtt1078_encoder_set_payload_size(&encoder, sizes[i]) < 0) {
+            loopback_close(conn.fd, sink.listen_fd, tid);
+            continue;
+        }
+        if (!per_packet) {
+            jtt1078_encoder_enable_batch(&encoder, frame_size);
+        }
+
+        video_frame_t frame = {
+            .data = frame_data,
+            .size = frame_size,
+            .frame_type = JTT1078_DATA_TYPE_VIDEO_P,
+            .is_keyframe = false,
+        };
+
+        uint64_t packets = 0, frames = 0;
+        uint64_t wall_start = now_ns(CLOCK_MONOTONIC);
+        uint64_t cpu_start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+        uint64_t wall_end = wall_start + (uint64_t)(seconds * 1e9);
+        uint64_t wall_now = wall_start;
+
+        do {
+            frame.pts = frames * 40;
+            int ret = jtt1078_encode_video_frame(&encoder, &frame);
+            if (ret < 0) {
+                break;
+            }
+            packets += ret;
+            frames++;
+            wall_now = now_ns(CLOCK_MONOTONIC);
+        } while (wall_now < wall_end);
+
+        uint64_t cpu_ns = now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+        loopback_close(conn.fd, sink.listen_fd, tid);
+        double elapsed = (wall_now - wall_start) / 1e9;
+        double mbytes = sink.bytes / 1e6;
+
+        fprintf(g_out,
+                "{\"bench\":\"sweep\",\"payload_size\":%u,\"frame_size\":%u,\"mode\":\"%s\","
+                "\"frames\":%llu,\"packets\":%llu,\"bytes\":%llu,\"seconds\":%.3f,"
+                "\"packets_per_s\":%.0f,\"bytes_per_s\":%.0f,\"cpu_ms_per_mb\":%.3f}\n",
+                sizes[i], frame_size, per_packet ? "packet" : "batch",
+                (unsigned long long)frames, (unsigned long long)packets,
+                (unsigned long long)sink.bytes, elapsed,
+                packets / elapsed, sink.bytes / elapsed,
+                mbytes > 0 ? (cpu_ns / 1e6) / mbytes : 0.0);
+        fflush(g_out);
+
+        jtt1078_encoder_deinit(&encoder);
+    }
+
+    free(frame_data);
+    return 0;
+}
+
+/*
+ * depack: 接收端解析
+ */
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} membuf_t;
+
+static int membuf_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    membuf_t *mb = (membuf_t *)user_data;
+    size_t len = jtt1078_iov_length(iov, iovcnt);
+
+    if (mb->len + len > mb->capacity) {
+        return -1;
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(mb->data + mb->len, iov[i].iov_base, iov[i].iov_len);
+        mb->len += iov[i].iov_len;
+    }
+    return 0;
+}
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t corrupt;
+} frame_check_t;
+
+// 帧内容为 (帧号 + i) 的字节序列, 帧号取自时间戳
+static void fill_pattern(uint8_t *data, uint32_t size, uint64_t frame_no) {
+    for (uint32_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)(frame_no + i);
+    }
+}
+
+static void check_frame_cb(const jtt1078_frame_t *frame, void *user_data) {
+    frame_check_t *chk = (frame_check_t *)user_data;
+    uint64_t frame_no = frame->header.timestamp / 40;
+
+    chk->frames++;
+    chk->bytes += frame->size;
+    for (uint32_t i = 0; i < frame->size; i++) {
+        if (frame->data[i] != (uint8_t)(frame_no + i)) {
+            chk->corrupt++;
+            break;
+        }
+    }
+}
+
+static void count_frame_cb(const jtt1078_frame_t *frame, void *user_data) {
+    frame_check_t *chk = (frame_check_t *)user_data;
+    chk->frames++;
+    chk->bytes += frame->size;
+}
+
+static int bench_depack(int argc, char **argv) {
+    double seconds = 1.0;
+    uint32_t frame_size = 100 * 1024;
+    uint32_t chunk = 4096;
+    const uint32_t frames = 256;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:f:c:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 'f': frame_size = (uint32_t)atoi(optarg); break;
+        case 'c': chunk = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench depack [-s seconds] [-f frame_bytes] [-c chunk_bytes]\n");
+            return 1;
+        }
+    }
+    if (frame_size == 0 || chunk == 0) {
+        return 1;
+    }
+
+    uint8_t *frame_data = malloc(frame_size);
+    membuf_t mb = { .capacity = (size_t)frames * (frame_size + frame_size / 16 + 2 * JTT1078_HEADER_SIZE) };
+    mb.data = malloc(mb.capacity);
+    if (!frame_data || !mb.data) {
+        free(frame_data);
+        free(mb.data);
+        return 1;
+    }
+
+    // 1. 预先生成分包流
+    jtt1078_encoder_t encoder;
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, membuf_sendv_cb, &mb);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    jtt1078_encoder_enable_batch(&encoder, frame_size);
+    for (uint32_t i = 0; i < frames; i++) {
+        fill_pattern(frame_data, frame_size, i);
+        video_frame_t frame = {
+            .data = frame_data,
+            .size = frame_size,
+            .frame_type = (i % 50) ? JTT1078_DATA_TYPE_VIDEO_P : JTT1078_DATA_TYPE_VIDEO,
+            .pts = (uint64_t)i * 40,
+        };
+        if (jtt1078_encode_video_frame(&encoder, &frame) < 0) {
+            fprintf(stderr, "[BENCH] Stream buffer too small\n");
+            jtt1078_encoder_deinit(&encoder);
+            free(frame_data);
+            free(mb.data);
+            return 1;
+        }
+    }
+    jtt1078_encoder_deinit(&encoder);
+
+    // 2. 解析吞吐
+    jtt1078_depack_t depack;
+    frame_check_t chk = { 0 };
+    jtt1078_depack_init(&depack, 0, count_frame_cb, &chk);
+
+    uint64_t passes = 0;
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    uint64_t now;
+    do {
+        jtt1078_depack_reset(&depack);
+        for (size_t off = 0; off < mb.len; off += chunk) {
+            size_t n = mb.len - off < chunk ? mb.len - off : chunk;
+            jtt1078_depack_feed(&depack, mb.data + off, n);
+        }
+        passes++;
+        now = now_ns(CLOCK_MONOTONIC);
+    } while (now < end);
+
+    double elapsed = (now - start) / 1e9;
+    jtt1078_depack_stats_t st;
+    jtt1078_depack_get_stats(&depack, &st);
+    fprintf(g_out,
+            "{\"bench\":\"depack\",\"mode\":\"memory\",\"frame_size\":%u,\"chunk\":%u,"
+            "\"stream_bytes\":%zu,\"passes\":%llu,\"seconds\":%.3f,\"mb_per_s\":%.1f,"
+            "\"packets_per_s\":%.0f,\"frames_ok\":%s}\n",
+            frame_size, chunk, mb.len, (unsigned long long)passes, elapsed,
+            passes * (mb.len / 1e6) / elapsed, st.packets / elapsed,
+            chk.frames == passes * frames ? "true" : "false");
+    fflush(g_out);
+    jtt1078_depack_deinit(&depack);
+
+    // 3. 回环TCP往返校验
+    sink_t sink = { 0 };
+    pthread_t tid;
+    frame_check_t rt = { 0 };
+    jtt1078_depack_init(&depack, 0, check_frame_cb, &rt);
+    sink.depack = &depack;
+
+    sock_conn_t conn = { .fd = loopback_open(&sink.listen_fd, sink_thread, &sink, NULL, &tid), .timeout_ms = -1 };
+    if (conn.fd < 0) {
+        free(frame_data);
+        free(mb.data);
+        return 1;
+    }
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, sock_sendv_cb, &conn);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    jtt1078_encoder_enable_batch(&encoder, frame_size);
+    for (uint32_t i = 0; i < frames; i++) {
+        fill_pattern(frame_data, frame_size, i);
+        video_frame_t frame = {
+            .data = frame_data,
+            .size = frame_size,
+            .frame_type = JTT1078_DATA_TYPE_VIDEO_P,
+            .pts = (uint64_t)i * 40,
+        };
+        jtt1078_encode_video_frame(&encoder, &frame);
+    }
+    jtt1078_encoder_deinit(&encoder);
+    loopback_close(conn.fd, sink.listen_fd, tid);
+
+    jtt1078_depack_channel_stats_t cs = { 0 };
+    jtt1078_depack_get_channel_stats(&depack, 0, &cs);
+    bool ok = rt.frames == frames && rt.corrupt == 0 && cs.seq_gaps == 0;
+    fprintf(g_out,
+            "{\"bench\":\"depack\",\"mode\":\"loopback\",\"frames_sent\":%u,\"frames_received\":%llu,"
+            "\"corrupt\":%llu,\"seq_gaps\":%llu,\"ok\":%s}\n",
+            frames, (unsigned long long)rt.frames, (unsigned long long)rt.corrupt,
+            (unsigned long long)cs.seq_gaps, ok ? "true" : "false");
+    fflush(g_out);
+    jtt1078_depack_deinit(&depack);
+
+    free(frame_data);
+    free(mb.data);
+    return ok ? 0 : 1;
+}
+
+/*
+ * nal: 起始码扫描
+ */
+
+// 对照实现: 逐字节比较
+static const uint8_t *find_start_code_bytewise(const uint8_t *p, const uint8_t *end) {
+    for (; p + 2 < end; p++) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            return p;
+        }
+    }
+    return end;
+}
+
+static int count_start_codes(const uint8_t *(*find)(const uint8_t *, const uint8_t *),
+                             const uint8_t *data, uint32_t size) {
+    const uint8_t *end = data + size;
+    const uint8_t *p = find(data, end);
+    int count = 0;
+    while (p < end) {
+        count++;
+        p = find(p + 3, end);
+    }
+    return count;
+}
+
+// 合成 H.265 I帧: VPS/SPS/PPS + 若干 IDR slice, 负载按防竞争规则插入 0x03
+static uint32_t build_iframe(uint8_t *buf, uint32_t size) {
+    static const uint8_t param_sets[] = {
+        0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0C, 0x01,     // VPS
+        0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,     // SPS
+        0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xC1, 0x72,     // PPS
+    };
+    const uint32_t slices = 4;
+    uint32_t slice_len = (size - sizeof(param_sets)) / slices;
+    uint32_t pos = sizeof(param_sets);
+    uint32_t rng = 12345;
+
+    memcpy(buf, param_sets, sizeof(param_sets));
+    for (uint32_t s = 0; s < slices; s++) {
+        uint32_t end = pos + slice_len;
+        buf[pos++] = 0x00;
+        buf[pos++] = 0x00;
+        buf[pos++] = 0x01;
+        buf[pos++] = 0x26;      // IDR_W_RADL
+        buf[pos++] = 0x01;
+        buf[pos++] = s == 0 ? 0xAF : 0x2F;
+        int zeros = 0;
+        while (pos < end) {
+            rng = rng * 1103515245u + 12345u;
+            uint8_t b = (uint8_t)(rng >> 16);
+            if (zeros >= 2 && b <= 3) {
+                buf[pos++] = 0x03;
+                zeros = 0;
+                if (pos >= end) break;
+            }
+            buf[pos++] = b;
+            zeros = b ? 0 : zeros + 1;
+        }
+        // slice 以非零字节结尾, 避免与下一个起始码相连
+        buf[end - 1] = 0x80;
+        pos = end;
+    }
+    return pos;
+}
+
+// 对照实现: 扫描整帧建立NAL索引(查找每个NAL的结尾), 按第一个图像 slice 判断帧类型
+static int frame_type_full_scan(const uint8_t *data, uint32_t size, uint8_t video_format, bool *is_keyframe) {
+    jtt1078_nal_t nals[64];
+    int n = jtt1078_nal_scan(data, size, video_format, nals, 64);
+    bool param_sets = false;
+
+    *is_keyframe = false;
+    for (int i = 0; i < n && i < 64; i++) {
+        switch (nals[i].kind) {
+        case JTT1078_NAL_IDR:
+        case JTT1078_NAL_CRA:
+            *is_keyframe = true;
+            return JTT1078_DATA_TYPE_VIDEO;
+        case JTT1078_NAL_SLICE:
+            return nals[i].slice_type == 0xFF ? JTT1078_DATA_TYPE_VIDEO_P : nals[i].slice_type;
+        case JTT1078_NAL_VPS:
+        case JTT1078_NAL_SPS:
+        case JTT1078_NAL_PPS:
+            param_sets = true;
+            break;
+        default:
+            break;
+        }
+    }
+    *is_keyframe = param_sets;
+    return param_sets ? JTT1078_DATA_TYPE_VIDEO : -1;
+}
+
+// jtt1078_nal_frame_type 与整帧扫描的结果一致(小样本: 单独的参数集、AUD/SEI、
+// 空NAL、3/4字节起始码、H.264)
+static bool check_frame_type(const uint8_t *iframe, uint32_t iframe_size) {
+    static const uint8_t h265_p[] = { 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xD0, 0x11, 0x80 };
+    static const uint8_t h265_params[] = {
+        0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0C, 0x01,
+        0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+    };
+    static const uint8_t h265_aud_sei_p[] = {
+        0x00, 0x00, 0x01, 0x46, 0x01, 0x50,                     // AUD
+        0x00, 0x00, 0x01, 0x00, 0x00, 0x01,                     // 空NAL
+        0x00, 0x00, 0x01, 0x4E, 0x01, 0x05, 0x01, 0x00, 0x80,   // SEI
+        0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xD0, 0x11, 0x80,   // TRAIL_R
+    };
+    static const uint8_t h265_cra[] = { 0x00, 0x00, 0x01, 0x2A, 0x01, 0xAF, 0x80 };
+    static const uint8_t h264_idr[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1F,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+        0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00,
+    };
+    static const uint8_t h264_p[] = { 0x00, 0x00, 0x00, 0x01, 0x41, 0x9A, 0x02, 0x80 };
+    static const uint8_t h264_b[] = { 0x00, 0x00, 0x01, 0x09, 0xF0, 0x00, 0x00, 0x01, 0x01, 0x9E, 0x80 };
+    static const uint8_t empty[] = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x00 };
+    const struct {
+        const uint8_t *data;
+        uint32_t size;
+        uint8_t video_format;
+    } cases[] = {
+        { iframe, iframe_size, JTT1078_VIDEO_H265 },
+        { h265_p, sizeof(h265_p), JTT1078_VIDEO_H265 },
+        { h265_params, sizeof(h265_params), JTT1078_VIDEO_H265 },
+        { h265_aud_sei_p, sizeof(h265_aud_sei_p), JTT1078_VIDEO_H265 },
+        { h265_cra, sizeof(h265_cra), JTT1078_VIDEO_H265 },
+        { h264_idr, sizeof(h264_idr), JTT1078_VIDEO_H264 },
+        { h264_p, sizeof(h264_p), JTT1078_VIDEO_H264 },
+        { h264_b, sizeof(h264_b), JTT1078_VIDEO_H264 },
+        { empty, sizeof(empty), JTT1078_VIDEO_H265 },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bool key = false, ref_key = false;
+        int type = jtt1078_nal_frame_type(cases[i].data, cases[i].size, cases[i].video_format, &key);
+        int ref = frame_type_full_scan(cases[i].data, cases[i].size, cases[i].video_format, &ref_key);
+        if (type != ref || key != ref_key) {
+            fprintf(stderr, "[BENCH] frame type mismatch in case %zu: %d/%d vs full scan %d/%d\n",
+                    i, type, key, ref, ref_key);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int bench_nal(int argc, char **argv) {
+    double seconds = 1.0;
+    uint32_t megabytes = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:m:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 'm': megabytes = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench nal [-s seconds] [-m megabytes]\n");
+            return 1;
+        }
+    }
+    if (megabytes == 0) {
+        megabytes = 1;
+    }
+
+    uint32_t size = megabytes * 1024 * 1024;
+    uint8_t *frame = malloc(size);
+    if (!frame) {
+        return 1;
+    }
+    size = build_iframe(frame, size);
+
+    // 校验: 两种实现找到的起始码数量一致, 且帧被识别为关键帧
+    int expect = count_start_codes(find_start_code_bytewise, frame, size);
+    int found = count_start_codes(jtt1078_find_start_code, frame, size);
+    bool key = false;
+    int type = jtt1078_nal_frame_type(frame, size, JTT1078_VIDEO_H265, &key);
+    if (expect != found || type != JTT1078_DATA_TYPE_VIDEO || !key) {
+        fprintf(stderr, "[BENCH] NAL scanner mismatch: bytewise=%d scanner=%d type=%d key=%d\n",
+                expect, found, type, key);
+        free(frame);
+        return 1;
+    }
+    if (!check_frame_type(frame, size)) {
+        free(frame);
+        return 1;
+    }
+
+    static const struct {
+        const char *name;
+        const uint8_t *(*find)(const uint8_t *, const uint8_t *);
+    } impls[] = {
+        { "bytewise", find_start_code_bytewise },
+        { "scanner", jtt1078_find_start_code },
+    };
+
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+        uint64_t iters = 0;
+        uint64_t start = now_ns(CLOCK_MONOTONIC);
+        uint64_t end = start + (uint64_t)(seconds * 1e9);
+        uint64_t now;
+        volatile int sink = 0;
+
+        do {
+            sink += count_start_codes(impls[i].find, frame, size);
+            iters++;
+            now = now_ns(CLOCK_MONOTONIC);
+        } while (now < end);
+        (void)sink;
+
+        double elapsed = (now - start) / 1e9;
+        fprintf(g_out,
+                "{\"bench\":\"nal\",\"impl\":\"%s\",\"simd\":\"%s\",\"frame_size\":%u,"
+                "\"start_codes\":%d,\"iterations\":%llu,\"seconds\":%.3f,\"mb_per_s\":%.1f}\n",
+                impls[i].name, jtt1078_nal_scanner_impl(), size, found,
+                (unsigned long long)iters, elapsed, iters * (size / 1e6) / elapsed);
+        fflush(g_out);
+    }
+
+    // 帧类型判断: 只读NAL头 vs 整帧扫描(每帧多一遍 slice 数据)
+    static const struct {
+        const char *name;
+        bool full_scan;
+    } classifiers[] = { { "frame_type", false }, { "full_scan", true } };
+    for (size_t i = 0; i < sizeof(classifiers) / sizeof(classifiers[0]); i++) {
+        uint64_t iters = 0;
+        uint64_t start = now_ns(CLOCK_MONOTONIC);
+        uint64_t end = start + (uint64_t)(seconds * 1e9);
+        uint64_t now;
+        volatile int sink = 0;
+
+        do {
+            for (int k = 0; k < 16; k++, iters++) {
+                sink += classifiers[i].full_scan ?
+                    frame_type_full_scan(frame, size, JTT1078_VIDEO_H265, &key) :
+                    jtt1078_nal_frame_type(frame, size, JTT1078_VIDEO_H265, &key);
+            }
+            now = now_ns(CLOCK_MONOTONIC);
+        } while (now < end);
+        (void)sink;
+
+        fprintf(g_out,
+                "{\"bench\":\"nal\",\"classify\":\"%s\",\"frame_size\":%u,\"iterations\":%llu,"
+                "\"ns_per_frame\":%.1f}\n",
+                classifiers[i].name, size, (unsigned long long)iters, (now - start) / (double)iters);
+        fflush(g_out);
+    }
+
+    free(frame);
+    return 0;
+}
+
+/*
+ * packetize: 打包微基准
+ */
+
+// CPU周期计数: 优先 perf_event(含内核态, 受限时只计用户态), 其次 x86 TSC
+typedef struct {
+    int fd;
+    const char *source;
+} cycle_counter_t;
+
+static void cycles_open(cycle_counter_t *cc) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_hv = 1;
+
+    cc->fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    cc->source = "perf";
+    if (cc->fd < 0) {
+        attr.exclude_kernel = 1;
+        cc->fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        cc->source = "perf_user";
+    }
+    if (cc->fd < 0) {
+#if defined(__x86_64__) || defined(__i386__)
+        cc->source = "tsc";
+#else
+        cc->source = "none";
+#endif
+    }
+}
+
+static uint64_t cycles_read(const cycle_counter_t *cc) {
+    uint64_t v = 0;
+    if (cc->fd >= 0) {
+        if (read(cc->fd, &v, sizeof(v)) != sizeof(v)) {
+            v = 0;
+        }
+        return v;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    v = __rdtsc();
+#endif
+    return v;
+}
+
+static void cycles_close(cycle_counter_t *cc) {
+    if (cc->fd >= 0) {
+        close(cc->fd);
+    }
+}
+
+enum { API_ENCODE_BATCH, API_ENCODE, API_CREATE, API_CREATE_SEND };
+enum { SEND_NONE, SEND_NULL, SEND_MEMCPY, SEND_TCP };
+
+static const char *const api_names[] = { "encode_batch", "encode", "create_packet", "create_send" };
+static const char *const sender_names[] = { "none", "null", "memcpy", "tcp" };
+
+static int null_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    (void)iov;
+    (void)iovcnt;
+    (void)user_data;
+    return 0;
+}
+
+// 内存拷贝发送: 写入环形缓冲区, 模拟用户态发送队列
+static int ring_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    membuf_t *mb = (membuf_t *)user_data;
+    for (int i = 0; i < iovcnt; i++) {
+        if (mb->len + iov[i].iov_len > mb->capacity) {
+            mb->len = 0;
+        }
+        memcpy(mb->data + mb->len, iov[i].iov_base, iov[i].iov_len);
+        mb->len += iov[i].iov_len;
+    }
+    return 0;
+}
+
+// 打包一帧, 返回包数
+static int packetize_frame(jtt1078_encoder_t *encoder, int api, jtt1078_packet_t *pkt,
+                           const uint8_t *data, uint32_t size, uint8_t type, uint64_t pts) {
+    if (api == API_ENCODE_BATCH || api == API_ENCODE) {
+        video_frame_t frame = {
+            .data = (uint8_t *)data,
+            .size = size,
+            .frame_type = type,
+            .pts = pts,
+            .is_keyframe = type == JTT1078_DATA_TYPE_VIDEO,
+        };
+        return jtt1078_encode_video_frame(encoder, &frame);
+    }
+
+    uint32_t payload_size = encoder->payload_size;
+    uint32_t total = (size + payload_size - 1) / payload_size;
+    for (uint32_t i = 0; i < total; i++) {
+        uint32_t off = i * payload_size;
+        uint32_t len = size - off < payload_size ? size - off : payload_size;
+        uint8_t sub = total == 1 ? JTT1078_PKT_ATOMIC :
+                      i == 0 ? JTT1078_PKT_FIRST :
+                      i == total - 1 ? JTT1078_PKT_LAST : JTT1078_PKT_MIDDLE;
+        if (jtt1078_create_packet(encoder, pkt, data + off, (uint16_t)len, type, sub) < 0) {
+            return -1;
+        }
+        if (api == API_CREATE_SEND && jtt1078_send_packet(encoder, pkt) < 0) {
+            return -1;
+        }
+    }
+    return (int)total;
+}
+
+static int bench_packetize(int argc, char **argv) {
+    double seconds = 0.5;
+    uint32_t payload_size = JTT1078_MAX_PAYLOAD_SIZE;
+    int cpu = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:P:c:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 'P': payload_size = (uint32_t)atoi(optarg); break;
+        case 'c': cpu = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench packetize [-s seconds] [-P payload_size] [-c cpu]\n");
+            return 1;
+        }
+    }
+    if (payload_size == 0 || payload_size > JTT1078_MAX_PAYLOAD_SIZE) {
+        // create_packet 使用定长包结构, 上限为 JTT1078_MAX_PAYLOAD_SIZE
+        fprintf(stderr, "[BENCH] payload_size must be 1-%d\n", JTT1078_MAX_PAYLOAD_SIZE);
+        return 1;
+    }
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+            perror("[BENCH] sched_setaffinity");
+        }
+    }
+
+    // 典型帧大小: 1080p@2Mbps 的 I/P 帧和 4K I帧
+    static const struct {
+        const char *name;
+        uint32_t size;
+        uint8_t type;
+    } frames[] = {
+        { "i_1080p", 64 * 1024,  JTT1078_DATA_TYPE_VIDEO },
+        { "p_1080p", 8 * 1024,   JTT1078_DATA_TYPE_VIDEO_P },
+        { "i_4k",    256 * 1024, JTT1078_DATA_TYPE_VIDEO },
+    };
+    static const struct {
+        int api;
+        int sender;
+    } cases[] = {
+        { API_ENCODE_BATCH, SEND_NULL }, { API_ENCODE_BATCH, SEND_MEMCPY }, { API_ENCODE_BATCH, SEND_TCP },
+        { API_ENCODE,       SEND_NULL }, { API_ENCODE,       SEND_MEMCPY }, { API_ENCODE,       SEND_TCP },
+        { API_CREATE,       SEND_NONE },
+        { API_CREATE_SEND,  SEND_NULL }, { API_CREATE_SEND,  SEND_MEMCPY }, { API_CREATE_SEND,  SEND_TCP },
+    };
+    const uint32_t warmup = 8;
+
+    cycle_counter_t cc;
+    cycles_open(&cc);
+
+    struct utsname un;
+    uname(&un);
+    fprintf(g_out,
+            "{\"bench\":\"env\",\"machine\":\"%s\",\"kernel\":\"%s\",\"compiler\":\"%s\","
+            "\"cpus\":%ld,\"cpu\":%d,\"nal_simd\":\"%s\",\"cycles_source\":\"%s\"}\n",
+            un.machine, un.release, __VERSION__, sysconf(_SC_NPROCESSORS_ONLN), cpu,
+            jtt1078_nal_scanner_impl(), cc.source);
+    fflush(g_out);
+
+    uint32_t max_size = frames[2].size;
+    uint8_t *data = malloc(max_size);
+    membuf_t ring = { .capacity = 4 * 1024 * 1024 };
+    ring.data = malloc(ring.capacity);
+    jtt1078_packet_t *pkt = malloc(sizeof(jtt1078_packet_t));
+    if (!data || !ring.data || !pkt) {
+        free(data);
+        free(ring.data);
+        free(pkt);
+        cycles_close(&cc);
+        return 1;
+    }
+    fill_pattern(data, max_size, 0);
+
+    int ret = 0;
+    for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+        for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+            int api = cases[c].api;
+            int sender = cases[c].sender;
+            sink_t sink = { 0 };
+            pthread_t tid;
+            sock_conn_t conn = { .fd = -1, .timeout_ms = -1 };
+
+            jtt1078_encoder_t encoder;
+            if (sender == SEND_TCP) {
+                conn.fd = loopback_open(&sink.listen_fd, sink_thread, &sink, NULL, &tid);
+                if (conn.fd < 0) {
+                    ret = 1;
+                    goto out;
+                }
+                jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, sock_sendv_cb, &conn);
+            } else if (sender == SEND_MEMCPY) {
+                jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, ring_sendv_cb, &ring);
+            } else {
+                jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, null_sendv_cb, NULL);
+            }
+            jtt1078_encoder_set_payload_size(&encoder, payload_size);
+            jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+            if (api == API_ENCODE_BATCH) {
+                jtt1078_encoder_enable_batch(&encoder, frames[f].size);
+            }
+
+            // 预热: 让批量区/发送缓冲区达到稳态, 之后的分配计入每帧开销
+            uint64_t n = 0;
+            for (; n < warmup; n++) {
+                packetize_frame(&encoder, api, pkt, data, frames[f].size, frames[f].type, n * 40);
+            }
+
+            uint64_t packets = 0, nframes = 0;
+            uint64_t allocs_start = alloc_count();
+            uint64_t cycles_start = cycles_read(&cc);
+            uint64_t start = now_ns(CLOCK_MONOTONIC);
+            uint64_t end = start + (uint64_t)(seconds * 1e9);
+            uint64_t now;
+            do {
+                // 每批若干帧读一次时钟, 小帧时计时开销不计入结果
+                for (int k = 0; k < 16; k++, n++) {
+                    int r = packetize_frame(&encoder, api, pkt, data, frames[f].size, frames[f].type, n * 40);
+                    if (r < 0) {
+                        ret = 1;
+                        break;
+                    }
+                    packets += r;
+                    nframes++;
+                }
+                now = now_ns(CLOCK_MONOTONIC);
+            } while (now < end && ret == 0);
+            uint64_t cycles = cycles_read(&cc) - cycles_start;
+            uint64_t allocs = alloc_count() - allocs_start;
+
+            jtt1078_encoder_deinit(&encoder);
+            if (sender == SEND_TCP) {
+                loopback_close(conn.fd, sink.listen_fd, tid);
+            }
+
+            double elapsed = (now - start) / 1e9;
+            uint64_t bytes = nframes * frames[f].size;
+            char cpb[32] = "null";
+            if (strcmp(cc.source, "none") != 0 && bytes > 0) {
+                snprintf(cpb, sizeof(cpb), "%.3f", (double)cycles / bytes);
+            }
+            fprintf(g_out,
+                    "{\"bench\":\"packetize\",\"api\":\"%s\",\"sender\":\"%s\",\"frame\":\"%s\","
+                    "\"frame_size\":%u,\"payload_size\":%u,\"frames\":%llu,\"packets\":%llu,"
+                    "\"seconds\":%.3f,\"ns_per_packet\":%.1f,\"packets_per_s\":%.0f,\"bytes_per_s\":%.0f,"
+                    "\"allocs_per_frame\":%.3f,\"cycles_per_byte\":%s}\n",
+                    api_names[api], sender_names[sender], frames[f].name, frames[f].size, payload_size,
+                    (unsigned long long)nframes, (unsigned long long)packets, elapsed,
+                    packets ? (now - start) / (double)packets : 0.0, packets / elapsed, bytes / elapsed,
+                    nframes ? (double)allocs / nframes : 0.0, cpb);
+            fflush(g_out);
+            if (ret != 0) {
+                goto out;
+            }
+        }
+    }
+
+out:
+    free(data);
+    free(ring.data);
+    free(pkt);
+    cycles_close(&cc);
+    return ret;
+}
+
+/*
+ * latency: TCP/UDP 端到端帧延迟
+ */
+
+#define LATENCY_STAMP_OFFSET    6       // 发送时刻(ns)在帧内的偏移, 位于NAL头之后
+
+typedef struct {
+    uint32_t *lat_us;
+    uint32_t count;
+    uint32_t capacity;
+} latency_rec_t;
+
+static void latency_frame_cb(const jtt1078_frame_t *frame, void *user_data) {
+    latency_rec_t *rec = (latency_rec_t *)user_data;
+    uint64_t sent;
+
+    if (frame->size < LATENCY_STAMP_OFFSET + sizeof(sent) || rec->count == rec->capacity) {
+        return;
+    }
+    memcpy(&sent, frame->data + LATENCY_STAMP_OFFSET, sizeof(sent));
+    uint64_t now = now_ns(CLOCK_MONOTONIC);
+    rec->lat_us[rec->count++] = now > sent ? (uint32_t)((now - sent) / 1000) : 0;
+}
+
+typedef struct {
+    int fd;
+    volatile bool stop;
+    jtt1078_depack_t *depack;
+    jtt1078_fec_decoder_t *fec;     // NULL 表示未启用FEC
+    uint32_t loss_ppm;              // 模拟丢包率(百万分之)
+    uint32_t rng;
+    uint64_t dropped;
+} udp_sink_t;
+
+static void udp_sink_deliver(const uint8_t *packet, uint32_t len, void *user_data) {
+    jtt1078_depack_feed((jtt1078_depack_t *)user_data, packet, len);
+}
+
+static void *udp_sink_thread(void *arg) {
+    udp_sink_t *sink = (udp_sink_t *)arg;
+    uint8_t buf[2048];
+
+    while (!sink->stop) {
+        ssize_t n = recv(sink->fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            continue;   // SO_RCVTIMEO 超时, 检查停止标志
+        }
+        if (sink->loss_ppm) {
+            sink->rng = sink->rng * 1103515245u + 12345u;
+            if ((sink->rng >> 8) % 1000000 < sink->loss_ppm) {
+                sink->dropped++;
+                continue;
+            }
+        }
+        // 每个数据报一个完整分包
+        jtt1078_header_t h;
+        if (jtt1078_parse_header(buf, n, &h) == 0 && n == JTT1078_HEADER_SIZE + h.data_length) {
+            if (sink->fec) {
+                jtt1078_fec_decoder_feed(sink->fec, buf, (uint32_t)n);
+            } else {
+                jtt1078_depack_feed(sink->depack, buf, n);
+            }
+        }
+    }
+    if (sink->fec) {
+        jtt1078_fec_decoder_flush(sink->fec);
+    }
+    return NULL;
+}
+
+static int udp_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    sock_conn_t *c = (sock_conn_t *)user_data;
+    c->calls++;
+    return jtt1078_udp_sendv(c->fd, iov, iovcnt) < 0 ? -1 : 0;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, double p) {
+    return n ? sorted[(uint32_t)(p * (n - 1) + 0.5)] : 0;
+}
+
+typedef struct {
+    double seconds;
+    uint32_t fps;
+    uint32_t gop;
+    uint8_t fec_i;              // FEC校验比例(%), 0:0 表示不启用
+    uint8_t fec_p;
+    double loss_pct;            // UDP 接收端模拟丢包率
+} latency_opts_t;
+
+static int run_latency(bool udp, const latency_opts_t *o, uint32_t i_size, uint32_t p_size) {
+    const uint32_t fps = o->fps, gop = o->gop;
+    const bool fec = udp && (o->fec_i || o->fec_p);
+    uint32_t nframes = (uint32_t)(o->seconds * fps);
+    latency_rec_t rec = { .capacity = nframes };
+    rec.lat_us = calloc(nframes ? nframes : 1, sizeof(uint32_t));
+    uint8_t *i_frame = malloc(i_size);
+    uint8_t *p_frame = malloc(p_size);
+    if (!rec.lat_us || !i_frame || !p_frame) {
+        free(rec.lat_us);
+        free(i_frame);
+        free(p_frame);
+        return 1;
+    }
+    static const uint8_t idr_hdr[] = { 0x00, 0x00, 0x01, 0x65, 0xB0, 0x00 };
+    static const uint8_t p_hdr[] = { 0x00, 0x00, 0x01, 0x41, 0xC0, 0x00 };
+    memset(i_frame, 0x5A, i_size);
+    memset(p_frame, 0xA5, p_size);
+    memcpy(i_frame, idr_hdr, sizeof(idr_hdr));
+    memcpy(p_frame, p_hdr, sizeof(p_hdr));
+
+    jtt1078_depack_t depack;
+    jtt1078_depack_init(&depack, 0, latency_frame_cb, &rec);
+
+    // 接收端
+    sink_t sink = { 0 };
+    udp_sink_t usink = { .fd = -1, .depack = &depack, .rng = 1 };
+    jtt1078_fec_decoder_t fec_dec;
+    if (fec) {
+        if (jtt1078_fec_decoder_init(&fec_dec, udp_sink_deliver, &depack) < 0) {
+            return 1;
+        }
+        usink.fec = &fec_dec;
+    }
+    pthread_t tid;
+    sock_conn_t conn = { .fd = -1, .timeout_ms = -1 };
+    if (udp) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        usink.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        int rcvbuf = 4 * 1024 * 1024;
+        struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+        setsockopt(usink.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        setsockopt(usink.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (usink.fd < 0 || bind(usink.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            getsockname(usink.fd, (struct sockaddr *)&addr, &len) < 0) {
+            perror("[BENCH] udp bind");
+            return 1;
+        }
+        usink.loss_ppm = (uint32_t)(o->loss_pct * 10000);
+        pthread_create(&tid, NULL, udp_sink_thread, &usink);
+        conn.fd = jtt1078_udp_connect("127.0.0.1", ntohs(addr.sin_port), 1024 * 1024);
+    } else {
+        sink.depack = &depack;
+        conn.fd = loopback_open(&sink.listen_fd, sink_thread, &sink, NULL, &tid);
+    }
+    if (conn.fd < 0) {
+        perror("[BENCH] connect");
+        return 1;
+    }
+
+    // 发送端: 按帧率定时发送, 帧内写入发送时刻
+    jtt1078_encoder_t encoder;
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H264,
+                             udp ? udp_sendv_cb : sock_sendv_cb, &conn);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    jtt1078_encoder_enable_batch(&encoder, i_size);
+    if (fec) {
+        jtt1078_encoder_enable_fec(&encoder, o->fec_i, o->fec_p, 32);
+    }
+
+    uint64_t interval = 1000000000ULL / fps;
+    uint64_t next = now_ns(CLOCK_MONOTONIC);
+    uint32_t sent = 0;
+    for (uint32_t n = 0; n < nframes; n++) {
+        struct timespec ts = { .tv_sec = next / 1000000000ULL, .tv_nsec = next % 1000000000ULL };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        next += interval;
+
+        bool key = n % gop == 0;
+        uint8_t *data = key ? i_frame : p_frame;
+        uint64_t stamp = now_ns(CLOCK_MONOTONIC);
+        memcpy(data + LATENCY_STAMP_OFFSET, &stamp, sizeof(stamp));
+        video_frame_t frame = {
+            .data = data,
+            .size = key ? i_size : p_size,
+            .frame_type = key ? JTT1078_DATA_TYPE_VIDEO : JTT1078_DATA_TYPE_VIDEO_P,
+            .pts = (uint64_t)n * 1000 / fps,
+            .is_keyframe = key,
+        };
+        if (jtt1078_encode_video_frame(&encoder, &frame) > 0) {
+            sent++;
+        }
+    }
+    jtt1078_encoder_deinit(&encoder);
+
+    if (udp) {
+        // 等待 netem 延迟中的数据报
+        usleep(1000000);
+        usink.stop = true;
+        pthread_join(tid, NULL);
+        close(conn.fd);
+        close(usink.fd);
+    } else {
+        loopback_close(conn.fd, sink.listen_fd, tid);
+    }
+
+    jtt1078_depack_channel_stats_t cs = { 0 };
+    jtt1078_depack_get_channel_stats(&depack, 0, &cs);
+    jtt1078_fec_decoder_stats_t fs = { 0 };
+    if (fec) {
+        fs = fec_dec.stats;
+        jtt1078_fec_decoder_deinit(&fec_dec);
+    }
+    qsort(rec.lat_us, rec.count, sizeof(uint32_t), cmp_u32);
+    fprintf(g_out,
+            "{\"bench\":\"latency\",\"transport\":\"%s\",\"fps\":%u,\"i_size\":%u,\"p_size\":%u,"
+            "\"fec\":\"%u:%u\",\"loss_pct\":%.2f,\"datagrams_dropped\":%llu,"
+            "\"fec_recovered\":%llu,\"fec_lost\":%llu,"
+            "\"frames_sent\":%u,\"frames_received\":%u,\"frames_lost\":%u,\"seq_gaps\":%llu,"
+            "\"lat_p50_us\":%u,\"lat_p90_us\":%u,\"lat_p99_us\":%u,\"lat_max_us\":%u}\n",
+            udp ? "udp" : "tcp", fps, i_size, p_size,
+            fec ? o->fec_i : 0, fec ? o->fec_p : 0, udp ? o->loss_pct : 0.0,
+            (unsigned long long)usink.dropped,
+            (unsigned long long)fs.recovered, (unsigned long long)fs.lost,
+            sent, rec.count, sent - rec.count, (unsigned long long)cs.seq_gaps,
+            percentile(rec.lat_us, rec.count, 0.50), percentile(rec.lat_us, rec.count, 0.90),
+            percentile(rec.lat_us, rec.count, 0.99), rec.count ? rec.lat_us[rec.count - 1] : 0);
+    fflush(g_out);
+
+    jtt1078_depack_deinit(&depack);
+    free(rec.lat_us);
+    free(i_frame);
+    free(p_frame);
+    return 0;
+}
+
+static int bench_latency(int argc, char **argv) {
+    latency_opts_t o = { .seconds = 5.0, .fps = 25, .gop = 50 };
+    uint32_t bitrate = 2000000;
+    const uint32_t i_ratio = 8;
+    const char *transport = NULL;
+    unsigned fec_i = 0, fec_p = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:r:g:t:f:L:")) != -1) {
+        switch (opt) {
+        case 's': o.seconds = atof(optarg); break;
+        case 'b': bitrate = (uint32_t)atoi(optarg); break;
+        case 'r': o.fps = (uint32_t)atoi(optarg); break;
+        case 'g': o.gop = (uint32_t)atoi(optarg); break;
+        case 't': transport = optarg; break;
+        case 'f':
+            if (sscanf(optarg, "%u:%u", &fec_i, &fec_p) != 2 || fec_i > 255 || fec_p > 255) {
+                fprintf(stderr, "[BENCH] -f expects i_ratio:p_ratio, e.g. 20:10\n");
+                return 1;
+            }
+            o.fec_i = (uint8_t)fec_i;
+            o.fec_p = (uint8_t)fec_p;
+            break;
+        case 'L': o.loss_pct = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench latency [-s seconds] [-b bitrate] [-r fps] [-g gop] [-t tcp|udp]\n"
+                            "                             [-f i_ratio:p_ratio] [-L loss_pct]\n");
+            return 1;
+        }
+    }
+    if (o.fps == 0 || o.gop == 0 || o.seconds <= 0) {
+        return 1;
+    }
+    const uint32_t fps = o.fps, gop = o.gop;
+
+    // 每GOP一个I帧, I帧为P帧的 i_ratio 倍, 平均码率为 bitrate
+    uint64_t gop_bytes = (uint64_t)bitrate / 8 * gop / fps;
+    uint32_t p_size = (uint32_t)(gop_bytes / (i_ratio + gop - 1));
+    if (p_size < 64) p_size = 64;
+    uint32_t i_size = p_size * i_ratio;
+
+    int ret = 0;
+    if (!transport || strcmp(transport, "tcp") == 0) {
+        ret |= run_latency(false, &o, i_size, p_size);
+    }
+    if (!transport || strcmp(transport, "udp") == 0) {
+        ret |= run_latency(true, &o, i_size, p_size);
+    }
+    return ret;
+}
+
+/*
+ * rate: 发送队列感知的码率自适应
+ */
+
+#define RATE_PHASES     3
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t phase_ns;
+    uint32_t capacity_kbps[RATE_PHASES];
+} rate_link_t;
+
+typedef struct {
+    int listen_fd;
+    const rate_link_t *link;
+    jtt1078_depack_t *depack;
+} rate_sink_t;
+
+// 接收端按当前阶段的容量限速读取(令牌桶, 最多积攒16KB)
+static void *rate_sink_thread(void *arg) {
+    rate_sink_t *sink = (rate_sink_t *)arg;
+    int fd = accept(sink->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    static uint8_t buf[16 * 1024];
+    double tokens = 0;
+    uint64_t last = now_ns(CLOCK_MONOTONIC);
+    for (;;) {
+        uint64_t now = now_ns(CLOCK_MONOTONIC);
+        uint64_t phase = (now - sink->link->start_ns) / sink->link->phase_ns;
+        uint32_t kbps = sink->link->capacity_kbps[phase < RATE_PHASES ? phase : RATE_PHASES - 1];
+        tokens += (now - last) / 1e9 * kbps * 1000 / 8;
+        if (tokens > sizeof(buf)) {
+            tokens = sizeof(buf);
+        }
+        last = now;
+        if (tokens < 1460) {
+            usleep(1000);
+            continue;
+        }
+        ssize_t n = read(fd, buf, (size_t)tokens);
+        if (n <= 0) {
+            break;
+        }
+        tokens -= n;
+        jtt1078_depack_feed(sink->depack, buf, n);
+    }
+    close(fd);
+    return NULL;
+}
+
+typedef struct {
+    const rate_link_t *link;
+    uint32_t *lat_us[RATE_PHASES];
+    uint32_t count[RATE_PHASES];
+    uint32_t capacity;
+} rate_rec_t;
+
+// 帧内携带计划采集时刻, 延迟包含发送端排队(固定码率时发送线程落后于采集)
+static void rate_frame_cb(const jtt1078_frame_t *frame, void *user_data) {
+    rate_rec_t *rec = (rate_rec_t *)user_data;
+    uint64_t stamp;
+
+    if (frame->size < LATENCY_STAMP_OFFSET + sizeof(stamp)) {
+        return;
+    }
+    memcpy(&stamp, frame->data + LATENCY_STAMP_OFFSET, sizeof(stamp));
+    uint64_t phase = (stamp - rec->link->start_ns) / rec->link->phase_ns;
+    if (phase >= RATE_PHASES) {
+        phase = RATE_PHASES - 1;
+    }
+    if (rec->count[phase] < rec->capacity) {
+        uint64_t now = now_ns(CLOCK_MONOTONIC);
+        rec->lat_us[phase][rec->count[phase]++] = now > stamp ? (uint32_t)((now - stamp) / 1000) : 0;
+    }
+}
+
+// 合成编码器: 码率钩子只记录目标码率, 每帧按目标码率计算帧大小
+typedef struct {
+    uint32_t bitrate;
+    uint32_t changes;
+    bool keyframe_requested;
+} synth_encoder_t;
+
+static void synth_set_bitrate(uint32_t bitrate, void *user_data) {
+    synth_encoder_t *enc = (synth_encoder_t *)user_data;
+    enc->bitrate = bitrate;
+    enc->changes++;
+}
+
+static void synth_request_keyframe(void *user_data) {
+    ((synth_encoder_t *)user_data)->keyframe_requested = true;
+}
+
+typedef struct {
+    double seconds;
+    uint32_t fps;
+    uint32_t gop;
+    uint32_t max_bitrate;
+    rate_link_t link;
+} rate_opts_t;
+
+static int run_rate(bool adaptive, rate_opts_t *o) {
+    const uint32_t fps = o->fps, gop = o->gop, i_ratio = 8;
+    uint32_t nframes = (uint32_t)(o->seconds * fps);
+    uint32_t max_i = (uint32_t)((uint64_t)o->max_bitrate / 8 * gop / fps / (i_ratio + gop - 1) * i_ratio) + 64;
+    rate_rec_t rec = { .link = &o->link, .capacity = nframes };
+    uint8_t *frame_buf = malloc(max_i);
+    bool ok = frame_buf != NULL;
+    for (int p = 0; p < RATE_PHASES; p++) {
+        rec.lat_us[p] = calloc(nframes ? nframes : 1, sizeof(uint32_t));
+        ok = ok && rec.lat_us[p];
+    }
+    if (!ok) {
+        free(frame_buf);
+        for (int p = 0; p < RATE_PHASES; p++) free(rec.lat_us[p]);
+        return 1;
+    }
+    static const uint8_t idr_hdr[] = { 0x00, 0x00, 0x01, 0x65, 0xB0, 0x00 };
+    static const uint8_t p_hdr[] = { 0x00, 0x00, 0x01, 0x41, 0xC0, 0x00 };
+    memset(frame_buf, 0x5A, max_i);
+
+    jtt1078_depack_t depack;
+    jtt1078_depack_init(&depack, 0, rate_frame_cb, &rec);
+
+    // 接收端 SO_RCVBUF 调小并关闭自动调整, 积压留在发送端 socket 中(SIOCOUTQ 可见)
+    rate_sink_t sink = { .link = &o->link, .depack = &depack };
+    const loopback_opts_t lo = { .rcvbuf = 16 * 1024, .sndbuf = 256 * 1024 };
+    o->link.start_ns = now_ns(CLOCK_MONOTONIC);
+    pthread_t tid;
+    sock_conn_t conn = { .fd = loopback_open(&sink.listen_fd, rate_sink_thread, &sink, &lo, &tid), .timeout_ms = -1 };
+    if (conn.fd < 0) {
+        return 1;
+    }
+
+    synth_encoder_t synth = { .bitrate = o->max_bitrate };
+    jtt1078_rate_t rc;
+    if (adaptive) {
+        jtt1078_rate_config_t cfg;
+        jtt1078_rate_default_config(&cfg);
+        cfg.max_bitrate = o->max_bitrate;
+        cfg.min_bitrate = o->max_bitrate / 8;
+        jtt1078_rate_hooks_t hooks = { synth_set_bitrate, synth_request_keyframe, &synth };
+        if (jtt1078_rate_init(&rc, &cfg, &hooks) < 0) {
+            return 1;
+        }
+    }
+
+    jtt1078_encoder_t encoder;
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H264, sock_sendv_cb, &conn);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    jtt1078_encoder_enable_batch(&encoder, max_i);
+
+    uint64_t bitrate_sum[RATE_PHASES] = { 0 };
+    uint32_t frames[RATE_PHASES] = { 0 }, skipped[RATE_PHASES] = { 0 };
+    uint64_t interval = 1000000000ULL / fps;
+    uint64_t next = o->link.start_ns;
+    uint32_t since_key = 0;
+    for (uint32_t n = 0; n < nframes; n++) {
+        struct timespec ts = { .tv_sec = next / 1000000000ULL, .tv_nsec = next % 1000000000ULL };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        uint64_t stamp = next;
+        next += interval;
+        uint32_t phase = (uint32_t)((stamp - o->link.start_ns) / o->link.phase_ns);
+        if (phase >= RATE_PHASES) phase = RATE_PHASES - 1;
+
+        // 合成帧: 按当前目标码率分配GOP字节, 请求关键帧时提前开始新GOP
+        bool key = since_key % gop == 0 || synth.keyframe_requested;
+        if (key) {
+            since_key = 0;
+            synth.keyframe_requested = false;
+        }
+        since_key++;
+        uint64_t gop_bytes = (uint64_t)synth.bitrate / 8 * gop / fps;
+        uint32_t p_size = (uint32_t)(gop_bytes / (i_ratio + gop - 1));
+        if (p_size < 64) p_size = 64;
+        uint32_t size = key ? p_size * i_ratio : p_size;
+        if (size > max_i) size = max_i;
+        memcpy(frame_buf, key ? idr_hdr : p_hdr, sizeof(idr_hdr));
+        memcpy(frame_buf + LATENCY_STAMP_OFFSET, &stamp, sizeof(stamp));
+        video_frame_t frame = {
+            .data = frame_buf,
+            .size = size,
+            .frame_type = key ? JTT1078_DATA_TYPE_VIDEO : JTT1078_DATA_TYPE_VIDEO_P,
+            .pts = (uint64_t)n * 1000 / fps,
+            .is_keyframe = key,
+        };
+
+        frames[phase]++;
+        bitrate_sum[phase] += synth.bitrate;
+        if (adaptive && !jtt1078_rate_admit(&rc, &frame)) {
+            jtt1078_encoder_skip_video_frame(&encoder, &frame);
+            skipped[phase]++;
+        } else if (jtt1078_encode_video_frame(&encoder, &frame) < 0) {
+            break;
+        }
+        if (adaptive) {
+            jtt1078_rate_update(&rc, conn.fd, conn.written, now_ns(CLOCK_MONOTONIC) / 1000000);
+        }
+    }
+    jtt1078_encoder_deinit(&encoder);
+    loopback_close(conn.fd, sink.listen_fd, tid);
+
+    jtt1078_rate_stats_t rs = { 0 };
+    if (adaptive) {
+        jtt1078_rate_get_stats(&rc, &rs);
+        jtt1078_rate_deinit(&rc);
+    }
+    for (int p = 0; p < RATE_PHASES; p++) {
+        uint32_t *lat = rec.lat_us[p];
+        uint32_t cnt = rec.count[p];
+        qsort(lat, cnt, sizeof(uint32_t), cmp_u32);
+        fprintf(g_out,
+                "{\"bench\":\"rate\",\"mode\":\"%s\",\"phase\":%d,\"capacity_kbps\":%u,"
+                "\"frames\":%u,\"received\":%u,\"skipped\":%u,\"avg_target_kbps\":%.0f,"
+                "\"lat_p50_ms\":%.1f,\"lat_p99_ms\":%.1f,\"lat_max_ms\":%.1f}\n",
+                adaptive ? "adaptive" : "static", p, o->link.capacity_kbps[p],
+                frames[p], cnt, skipped[p], frames[p] ? bitrate_sum[p] / 1000.0 / frames[p] : 0.0,
+                percentile(lat, cnt, 0.50) / 1000.0, percentile(lat, cnt, 0.99) / 1000.0,
+                cnt ? lat[cnt - 1] / 1000.0 : 0.0);
+    }
+    if (adaptive) {
+        fprintf(g_out,
+                "{\"bench\":\"rate\",\"mode\":\"adaptive\",\"samples\":%llu,\"decreases\":%llu,"
+                "\"increases\":%llu,\"bitrate_changes\":%u,\"skip_events\":%llu,\"final_kbps\":%u,"
+                "\"capacity_kbps\":%u}\n",
+                (unsigned long long)rs.samples, (unsigned long long)rs.decreases,
+                (unsigned long long)rs.increases, synth.changes, (unsigned long long)rs.skip_events,
+                rs.bitrate / 1000, rs.capacity / 1000);
+    }
+    fflush(g_out);
+
+    jtt1078_depack_deinit(&depack);
+    for (int p = 0; p < RATE_PHASES; p++) free(rec.lat_us[p]);
+    free(frame_buf);
+    return 0;
+}
+
+static int bench_rate(int argc, char **argv) {
+    rate_opts_t o = { .seconds = 15.0, .fps = 25, .gop = 50, .max_bitrate = 2048000 };
+    unsigned high = 3000, low = 1000;
+    const char *mode = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:c:b:m:")) != -1) {
+        switch (opt) {
+        case 's': o.seconds = atof(optarg); break;
+        case 'c':
+            if (sscanf(optarg, "%u:%u", &high, &low) != 2 || high == 0 || low == 0) {
+                fprintf(stderr, "[BENCH] -c expects high:low kbps, e.g. 3000:1000\n");
+                return 1;
+            }
+            break;
+        case 'b': o.max_bitrate = (uint32_t)atoi(optarg); break;
+        case 'm': mode = optarg; break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench rate [-s seconds] [-c high:low] [-b max_bitrate] "
+                            "[-m static|adaptive]\n");
+            return 1;
+        }
+    }
+    if (o.seconds <= 0 || o.max_bitrate < 64000) {
+        return 1;
+    }
+    o.link.phase_ns = (uint64_t)(o.seconds / RATE_PHASES * 1e9);
+    o.link.capacity_kbps[0] = high;
+    o.link.capacity_kbps[1] = low;
+    o.link.capacity_kbps[2] = high;
+
+    int ret = 0;
+    if (!mode || strcmp(mode, "static") == 0) {
+        ret |= run_rate(false, &o);
+    }
+    if (!mode || strcmp(mode, "adaptive") == 0) {
+        ret |= run_rate(true, &o);
+    }
+    return ret;
+}
+
+/*
+ * fec: 区域乘加, 校验包生成与恢复
+ */
+
+// 按 {包头, 负载} 成对的iovec逐包保存(批量模式的回调格式)
+typedef struct {
+    uint8_t *data;
+    uint32_t *len;
+    uint32_t count;
+    uint32_t capacity;
+} pktlog_t;
+
+static int pktlog_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    pktlog_t *log = (pktlog_t *)user_data;
+
+    for (int i = 0; i + 1 < iovcnt; i += 2) {
+        if (log->count == log->capacity) {
+            return -1;
+        }
+        if (iov[i].iov_len + iov[i + 1].iov_len > JTT1078_MAX_PACKET_SIZE) {
+            return -1;
+        }
+        uint8_t *p = log->data + (size_t)log->count * JTT1078_MAX_PACKET_SIZE;
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        memcpy(p + iov[i].iov_len, iov[i + 1].iov_base, iov[i + 1].iov_len);
+        log->len[log->count++] = (uint32_t)(iov[i].iov_len + iov[i + 1].iov_len);
+    }
+    return 0;
+}
+
+static int bench_fec(int argc, char **argv) {
+    double seconds = 0.5;
+    uint32_t group = 32;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:g:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 'g': group = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench fec [-s seconds] [-g group_size]\n");
+            return 1;
+        }
+    }
+    if (group == 0 || group > JTT1078_FEC_MAX_SOURCE) {
+        fprintf(stderr, "[BENCH] group_size must be 1-%d\n", JTT1078_FEC_MAX_SOURCE);
+        return 1;
+    }
+    jtt1078_fec_init();
+
+    // 区域乘加: 一个符号长度, 系数1(异或)与一般系数(查表乘法)
+    static uint8_t src[JTT1078_FEC_MAX_SYMBOL], dst[JTT1078_FEC_MAX_SYMBOL];
+    fill_pattern(src, sizeof(src), 7);
+    static const struct { const char *name; uint8_t c; } coefs[] = { { "xor", 1 }, { "gf_mul", 0x8E } };
+    for (size_t c = 0; c < sizeof(coefs) / sizeof(coefs[0]); c++) {
+        uint64_t iters = 0;
+        uint64_t start = now_ns(CLOCK_MONOTONIC);
+        uint64_t end = start + (uint64_t)(seconds * 1e9);
+        uint64_t now;
+        do {
+            for (int k = 0; k < 256; k++, iters++) {
+                jtt1078_fec_mul_add(dst, src, coefs[c].c, sizeof(src));
+            }
+            now = now_ns(CLOCK_MONOTONIC);
+        } while (now < end);
+        double elapsed = (now - start) / 1e9;
+        fprintf(g_out,
+                "{\"bench\":\"fec\",\"op\":\"mul_add\",\"coef\":\"%s\",\"simd\":\"%s\",\"len\":%zu,"
+                "\"ns_per_symbol\":%.1f,\"bytes_per_s\":%.0f,\"check\":%u}\n",
+                coefs[c].name, jtt1078_fec_simd(), sizeof(src),
+                (now - start) / (double)iters, iters * sizeof(src) / elapsed, dst[0]);
+        fflush(g_out);
+    }
+
+    static const struct {
+        const char *name;
+        uint32_t size;
+        uint8_t type;
+    } frames[] = {
+        { "i_1080p", 64 * 1024, JTT1078_DATA_TYPE_VIDEO },
+        { "p_1080p", 8 * 1024,  JTT1078_DATA_TYPE_VIDEO_P },
+    };
+    const uint8_t ratio_i = 20, ratio_p = 10;
+    uint8_t *data = malloc(frames[0].size);
+    pktlog_t log = { .capacity = 1024 };
+    log.data = malloc((size_t)log.capacity * JTT1078_MAX_PACKET_SIZE);
+    log.len = malloc(log.capacity * sizeof(uint32_t));
+    if (!data || !log.data || !log.len) {
+        free(data);
+        free(log.data);
+        free(log.len);
+        return 1;
+    }
+    fill_pattern(data, frames[0].size, 0);
+
+    // 顺序检查: 启用FEC后调大分包负载须被拒绝, 否则校验包符号越界写入且超过最大包长
+    int ret = 0;
+    {
+        const uint32_t idr_size = 200 * 1024;
+        uint8_t *idr = malloc(idr_size);
+        jtt1078_encoder_t encoder;
+        log.count = 0;
+        jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, pktlog_sendv_cb, &log);
+        jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+        jtt1078_encoder_enable_batch(&encoder, idr_size);
+        jtt1078_encoder_enable_fec(&encoder, 100, 100, (uint8_t)group);
+        bool rejected = jtt1078_encoder_set_payload_size(&encoder, 4000) < 0;
+        int sent = -1;
+        if (idr) {
+            fill_pattern(idr, idr_size, 1);
+            video_frame_t frame = {
+                .data = idr,
+                .size = idr_size,
+                .frame_type = JTT1078_DATA_TYPE_VIDEO,
+                .is_keyframe = true,
+            };
+            sent = jtt1078_encode_video_frame(&encoder, &frame);
+        }
+        bool ok = rejected && encoder.payload_size <= JTT1078_FEC_MAX_SYMBOL && sent > 0;
+        fprintf(g_out,
+                "{\"bench\":\"fec\",\"op\":\"payload_after_fec\",\"requested\":4000,\"rejected\":%s,"
+                "\"payload_size\":%u,\"frame_size\":%u,\"packets\":%d,\"ok\":%s}\n",
+                rejected ? "true" : "false", encoder.payload_size, idr_size, sent, ok ? "true" : "false");
+        fflush(g_out);
+        jtt1078_encoder_deinit(&encoder);
+        free(idr);
+        ret = ok ? 0 : 1;
+    }
+
+    for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]) && ret == 0; f++) {
+        // 生成: 整帧批量编码到空回调, 对比启用/不启用FEC的每帧耗时
+        double ns_per_frame[2] = { 0, 0 };
+        uint32_t packets_per_frame[2] = { 0, 0 };
+        for (int with_fec = 0; with_fec < 2; with_fec++) {
+            jtt1078_encoder_t encoder;
+            jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, null_sendv_cb, NULL);
+            jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+            jtt1078_encoder_set_payload_size(&encoder, JTT1078_FEC_MAX_SYMBOL);
+            jtt1078_encoder_enable_batch(&encoder, frames[f].size);
+            if (with_fec) {
+                jtt1078_encoder_enable_fec(&encoder, ratio_i, ratio_p, (uint8_t)group);
+            }
+            video_frame_t frame = {
+                .data = data,
+                .size = frames[f].size,
+                .frame_type = frames[f].type,
+                .is_keyframe = frames[f].type == JTT1078_DATA_TYPE_VIDEO,
+            };
+
+            uint64_t n = 0;
+            uint64_t start = now_ns(CLOCK_MONOTONIC);
+            uint64_t end = start + (uint64_t)(seconds * 1e9);
+            uint64_t now;
+            do {
+                for (int k = 0; k < 16; k++, n++) {
+                    frame.pts = n * 40;
+                    int r = jtt1078_encode_video_frame(&encoder, &frame);
+                    if (r < 0) {
+                        ret = 1;
+                        break;
+                    }
+                    packets_per_frame[with_fec] = (uint32_t)r;
+                }
+                now = now_ns(CLOCK_MONOTONIC);
+            } while (now < end && ret == 0);
+            ns_per_frame[with_fec] = (now - start) / (double)n;
+            jtt1078_encoder_deinit(&encoder);
+        }
+        uint32_t source = packets_per_frame[0];
+        uint32_t parity = packets_per_frame[1] - source;
+        fprintf(g_out,
+                "{\"bench\":\"fec\",\"op\":\"encode\",\"frame\":\"%s\",\"frame_size\":%u,\"group\":%u,"
+                "\"ratio\":%u,\"source_packets\":%u,\"parity_packets\":%u,"
+                "\"ns_per_frame\":%.0f,\"ns_per_frame_nofec\":%.0f,\"parity_bytes_per_s\":%.0f}\n",
+                frames[f].name, frames[f].size, group,
+                frames[f].type == JTT1078_DATA_TYPE_VIDEO ? ratio_i : ratio_p, source, parity,
+                ns_per_frame[1], ns_per_frame[0],
+                ns_per_frame[1] > ns_per_frame[0] ?
+                    (double)parity * JTT1078_FEC_MAX_SYMBOL * 1e9 / (ns_per_frame[1] - ns_per_frame[0]) : 0.0);
+        fflush(g_out);
+
+        // 恢复: 记录一帧的全部分包, 每组丢弃 m 个源包(最坏情况)后经解码器交付,
+        // 每轮改写包序号模拟连续的帧
+        jtt1078_encoder_t encoder;
+        log.count = 0;
+        jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, pktlog_sendv_cb, &log);
+        jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+        jtt1078_encoder_enable_batch(&encoder, frames[f].size);
+        jtt1078_encoder_enable_fec(&encoder, ratio_i, ratio_p, (uint8_t)group);
+        video_frame_t frame = {
+            .data = data,
+            .size = frames[f].size,
+            .frame_type = frames[f].type,
+            .is_keyframe = frames[f].type == JTT1078_DATA_TYPE_VIDEO,
+        };
+        if (jtt1078_encode_video_frame(&encoder, &frame) < 0) {
+            jtt1078_encoder_deinit(&encoder);
+            ret = 1;
+            break;
+        }
+        uint16_t span = encoder.packet_seq;
+        jtt1078_encoder_deinit(&encoder);
+
+        // 每组丢弃前 m 个源包
+        bool *drop = calloc(log.count, sizeof(bool));
+        uint32_t dropped = 0;
+        for (uint32_t i = 0; drop && i < log.count; ) {
+            uint32_t k = 0;
+            while (i + k < log.count && (log.data[(size_t)(i + k) * JTT1078_MAX_PACKET_SIZE + JTT1078_OFF_MPT] & 0x7F) != JTT1078_FEC_PT) {
+                k++;
+            }
+            uint32_t m = 0;
+            while (i + k + m < log.count && (log.data[(size_t)(i + k + m) * JTT1078_MAX_PACKET_SIZE + JTT1078_OFF_MPT] & 0x7F) == JTT1078_FEC_PT) {
+                m++;
+            }
+            for (uint32_t j = 0; j < m && j < k; j++) {
+                drop[i + j] = true;
+                dropped++;
+            }
+            i += k + m;
+        }
+
+        frame_check_t chk = { 0 };
+        jtt1078_depack_t depack;
+        jtt1078_fec_decoder_t dec;
+        jtt1078_depack_init(&depack, 0, check_frame_cb, &chk);
+        if (!drop || jtt1078_fec_decoder_init(&dec, udp_sink_deliver, &depack) < 0) {
+            free(drop);
+            jtt1078_depack_deinit(&depack);
+            ret = 1;
+            break;
+        }
+
+        uint64_t n = 0;
+        uint64_t start = now_ns(CLOCK_MONOTONIC);
+        uint64_t end = start + (uint64_t)(seconds * 1e9);
+        uint64_t now;
+        do {
+            for (int k = 0; k < 16; k++, n++) {
+                for (uint32_t i = 0; i < log.count; i++) {
+                    uint8_t *p = log.data + (size_t)i * JTT1078_MAX_PACKET_SIZE;
+                    uint16_t seq = (uint16_t)(((p[JTT1078_OFF_SEQ] << 8) | p[JTT1078_OFF_SEQ + 1]) + span);
+                    p[JTT1078_OFF_SEQ] = (uint8_t)(seq >> 8);
+                    p[JTT1078_OFF_SEQ + 1] = (uint8_t)seq;
+                    if (!drop[i]) {
+                        jtt1078_fec_decoder_feed(&dec, p, log.len[i]);
+                    }
+                }
+            }
+            now = now_ns(CLOCK_MONOTONIC);
+        } while (now < end);
+
+        fprintf(g_out,
+                "{\"bench\":\"fec\",\"op\":\"recover\",\"frame\":\"%s\",\"frame_size\":%u,\"group\":%u,"
+                "\"packets\":%u,\"dropped_per_frame\":%u,\"frames\":%llu,\"frames_ok\":%llu,\"corrupt\":%llu,"
+                "\"recovered\":%llu,\"lost\":%llu,\"ns_per_frame\":%.0f,\"ns_per_recovered_packet\":%.0f}\n",
+                frames[f].name, frames[f].size, group, log.count, dropped,
+                (unsigned long long)n, (unsigned long long)chk.frames, (unsigned long long)chk.corrupt,
+                (unsigned long long)dec.stats.recovered, (unsigned long long)dec.stats.lost,
+                (now - start) / (double)n,
+                dropped ? (now - start) / (double)(n * dropped) : 0.0);
+        fflush(g_out);
+
+        jtt1078_fec_decoder_deinit(&dec);
+        jtt1078_depack_deinit(&depack);
+        free(drop);
+    }
+
+    free(data);
+    free(log.data);
+    free(log.len);
+    return ret;
+}
+
+/*
+ * audio: G.711 编码与音频聚合
+ */
+
+// 统计发送调用与线上字节, 由包头时间戳计算聚合带来的额外时延
+typedef struct {
+    uint64_t now_ms;            // 当前帧的PTS
+    uint64_t calls;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t max_delay_ms;
+} audio_sink_t;
+
+static int audio_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    audio_sink_t *sink = (audio_sink_t *)user_data;
+
+    sink->calls++;
+    for (int i = 0; i + 1 < iovcnt; i += 2) {
+        const uint8_t *hdr = (const uint8_t *)iov[i].iov_base;
+        uint64_t ts = 0;
+        for (int b = 0; b < 8; b++) {
+            ts = (ts << 8) | hdr[JTT1078_OFF_TIMESTAMP + b];
+        }
+        if (sink->now_ms > ts && sink->now_ms - ts > sink->max_delay_ms) {
+            sink->max_delay_ms = sink->now_ms - ts;
+        }
+        sink->packets++;
+        sink->bytes += iov[i].iov_len + iov[i + 1].iov_len;
+    }
+    return 0;
+}
+
+static int bench_audio(int argc, char **argv) {
+    double seconds = 0.5;
+    uint32_t frame_samples = 160;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 'n': frame_samples = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench audio [-s seconds] [-n samples_per_frame]\n");
+            return 1;
+        }
+    }
+    if (frame_samples == 0 || frame_samples > JTT1078_MAX_PAYLOAD_SIZE) {
+        fprintf(stderr, "[BENCH] samples_per_frame must be 1-%d\n", JTT1078_MAX_PAYLOAD_SIZE);
+        return 1;
+    }
+
+    // 校验: 批量编码(含尾部查表)与参考实现逐值一致
+    const uint32_t count = 65536;
+    int16_t *pcm = malloc(count * sizeof(int16_t));
+    uint8_t *out = malloc(count);
+    if (!pcm || !out) {
+        free(pcm);
+        free(out);
+        return 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        pcm[i] = (int16_t)(uint16_t)(i * 40503u);       // 奇数步长, 遍历全部取值且打乱顺序
+    }
+
+    static const struct {
+        const char *name;
+        uint8_t format;
+        uint8_t (*sample)(int16_t);
+    } laws[] = {
+        { "alaw", JTT1078_AUDIO_G711A, jtt1078_g711_alaw_sample },
+        { "ulaw", JTT1078_AUDIO_G711U, jtt1078_g711_ulaw_sample },
+    };
+
+    for (size_t l = 0; l < sizeof(laws) / sizeof(laws[0]); l++) {
+        jtt1078_g711_encode(laws[l].format, pcm, out, count - 7);
+        uint32_t mismatch = 0;
+        for (uint32_t i = 0; i < count - 7; i++) {
+            mismatch += out[i] != laws[l].sample(pcm[i]);
+        }
+        if (mismatch) {
+            fprintf(stderr, "[BENCH] G.711 %s mismatch: %u of %u samples\n", laws[l].name, mismatch, count);
+            free(pcm);
+            free(out);
+            return 1;
+        }
+
+        for (int bulk = 0; bulk < 2; bulk++) {
+            uint64_t iters = 0;
+            uint64_t start = now_ns(CLOCK_MONOTONIC);
+            uint64_t end = start + (uint64_t)(seconds * 1e9);
+            uint64_t now;
+
+            do {
+                if (bulk) {
+                    jtt1078_g711_encode(laws[l].format, pcm, out, count);
+                } else {
+                    for (uint32_t i = 0; i < count; i++) {
+                        out[i] = laws[l].sample(pcm[i]);
+                    }
+                }
+                iters++;
+                now = now_ns(CLOCK_MONOTONIC);
+            } while (now < end);
+
+            double elapsed = (now - start) / 1e9;
+            fprintf(g_out,
+                    "{\"bench\":\"audio\",\"op\":\"g711\",\"law\":\"%s\",\"impl\":\"%s\",\"simd\":\"%s\","
+                    "\"samples_per_s\":%.0f,\"ns_per_20ms_frame\":%.1f,\"check\":%u}\n",
+                    laws[l].name, bulk ? "bulk" : "reference", bulk ? jtt1078_g711_simd() : "none",
+                    iters * (double)count / elapsed,
+                    elapsed * 1e9 / (iters * (double)count) * 160, out[count / 2]);
+            fflush(g_out);
+        }
+    }
+
+    // 聚合: 按实时节奏的PTS送入固定时长的音频, 0 表示不聚合
+    static const uint16_t agg_ms[] = { 0, 40, 60, 100 };
+    const uint32_t frame_ms = frame_samples / JTT1078_G711_SAMPLES_PER_MS;
+    const uint32_t frames = 60 * 1000 / (frame_ms ? frame_ms : 1);     // 一分钟音频
+    int ret = 0;
+
+    for (size_t a = 0; a < sizeof(agg_ms) / sizeof(agg_ms[0]) && ret == 0; a++) {
+        audio_sink_t sink = { 0 };
+        jtt1078_encoder_t encoder;
+        jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H265, audio_sendv_cb, &sink);
+        jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+        jtt1078_encoder_enable_batch(&encoder, JTT1078_MAX_PAYLOAD_SIZE);
+        if (agg_ms[a] && jtt1078_encoder_enable_audio_aggregation(&encoder, agg_ms[a]) < 0) {
+            jtt1078_encoder_deinit(&encoder);
+            ret = 1;
+            break;
+        }
+
+        uint64_t start = now_ns(CLOCK_MONOTONIC);
+        for (uint32_t f = 0; f < frames; f++) {
+            sink.now_ms = (uint64_t)f * frame_ms;
+            const int16_t *p = pcm + (f * frame_samples) % (count - frame_samples);
+            if (jtt1078_encode_audio_pcm(&encoder, p, frame_samples, sink.now_ms) < 0) {
+                ret = 1;
+                break;
+            }
+        }
+        jtt1078_encoder_flush_audio(&encoder);
+        uint64_t elapsed = now_ns(CLOCK_MONOTONIC) - start;
+        jtt1078_encoder_deinit(&encoder);
+
+        double audio_s = frames * (double)frame_ms / 1000.0;
+        uint64_t payload = (uint64_t)frames * frame_samples;
+        fprintf(g_out,
+                "{\"bench\":\"audio\",\"op\":\"aggregate\",\"max_ms\":%u,\"frame_ms\":%u,"
+                "\"frames_per_packet\":%.2f,\"packets_per_s\":%.1f,\"send_calls_per_s\":%.1f,"
+                "\"wire_bytes_per_s\":%.0f,\"header_overhead_pct\":%.2f,\"max_delay_ms\":%llu,"
+                "\"ns_per_frame\":%.0f}\n",
+                agg_ms[a], frame_ms, sink.packets ? frames / (double)sink.packets : 0.0,
+                sink.packets / audio_s, sink.calls / audio_s, sink.bytes / audio_s,
+                sink.bytes ? 100.0 * (sink.bytes - payload) / sink.bytes : 0.0,
+                (unsigned long long)sink.max_delay_ms, elapsed / (double)frames);
+        fflush(g_out);
+    }
+
+    free(pcm);
+    free(out);
+    return ret;
+}
+
+/*
+ * pace: 关键帧突发平滑
+ */
+
+typedef struct {
+    uint64_t t_ns;
+    uint32_t bytes;
+} pace_arrival_t;
+
+typedef struct {
+    int listen_fd;
+    pace_arrival_t *log;
+    uint32_t capacity;
+    uint32_t count;
+} pace_sink_t;
+
+// 接收端尽快读取, 记录每次读取的到达时刻(回环上即发送端写出/内核发出的节奏)
+static void *pace_sink_thread(void *arg) {
+    pace_sink_t *sink = (pace_sink_t *)arg;
+    int fd = accept(sink->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    static uint8_t buf[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        if (sink->count < sink->capacity) {
+            sink->log[sink->count].t_ns = now_ns(CLOCK_MONOTONIC);
+            sink->log[sink->count].bytes = (uint32_t)n;
+            sink->count++;
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+typedef struct {
+    double seconds;
+    uint32_t fps;
+    uint32_t gop;
+    uint32_t bitrate;
+    uint8_t fraction;
+    uint32_t link_kbps;
+    uint32_t max_kbps;              // 节奏控制速率上限, 0不限
+    uint32_t queue_bytes;
+} pace_opts_t;
+
+static const char *const pace_modes[] = { "off", "user", "kernel" };
+
+static int run_pace(int mode, const pace_opts_t *o) {
+    const uint32_t fps = o->fps, gop = o->gop, i_ratio = 8;
+    uint32_t nframes = (uint32_t)(o->seconds * fps);
+    uint64_t gop_bytes = (uint64_t)o->bitrate / 8 * gop / fps;
+    uint32_t p_size = (uint32_t)(gop_bytes / (i_ratio + gop - 1));
+    uint32_t i_size = p_size * i_ratio;
+    uint8_t *frame_buf = malloc(i_size);
+    uint64_t *frame_end = calloc(nframes + 1, sizeof(uint64_t));     // 每帧结束时的累计写出字节
+    bool *frame_key = calloc(nframes + 1, sizeof(bool));
+    pace_sink_t sink = { .capacity = 1 << 20 };
+    sink.log = malloc(sink.capacity * sizeof(pace_arrival_t));
+    if (!frame_buf || !frame_end || !frame_key || !sink.log) {
+        free(frame_buf);
+        free(frame_end);
+        free(frame_key);
+        free(sink.log);
+        return 1;
+    }
+    static const uint8_t idr_hdr[] = { 0x00, 0x00, 0x01, 0x65, 0xB0, 0x00 };
+    static const uint8_t p_hdr[] = { 0x00, 0x00, 0x01, 0x41, 0xC0, 0x00 };
+    memset(frame_buf, 0x5A, i_size);
+
+    // 回环 MTU 为64KB, 按蜂窝链路的MSS分段, 内核 pacing 的粒度与真实网卡相近
+    const loopback_opts_t lo = { .mss = 1400 };
+    pthread_t tid;
+    sock_conn_t conn = { .fd = loopback_open(&sink.listen_fd, pace_sink_thread, &sink, &lo, &tid), .timeout_ms = -1 };
+    if (conn.fd < 0) {
+        return 1;
+    }
+
+    jtt1078_encoder_t encoder;
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H264, sock_sendv_cb, &conn);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    jtt1078_encoder_enable_batch(&encoder, i_size);
+    bool kernel = false;
+    if (mode > 0) {
+        jtt1078_encoder_enable_pacing(&encoder, o->fraction, 0);
+        jtt1078_encoder_set_pacing_max_rate(&encoder, o->max_kbps * 1000 / 8);
+        if (mode == 2) {
+            kernel = jtt1078_encoder_set_pacing_socket(&encoder, conn.fd) == 1;
+            if (!kernel) {
+                fprintf(stderr, "[BENCH] SO_MAX_PACING_RATE unavailable, kernel mode uses userspace pacing\n");
+            }
+        }
+    }
+
+    uint64_t interval = 1000000000ULL / fps;
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    uint64_t next = start;
+    uint32_t sent = 0;
+    for (uint32_t n = 0; n < nframes; n++) {
+        struct timespec ts = { .tv_sec = next / 1000000000ULL, .tv_nsec = next % 1000000000ULL };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        next += interval;
+
+        bool key = n % gop == 0;
+        memcpy(frame_buf, key ? idr_hdr : p_hdr, sizeof(idr_hdr));
+        video_frame_t frame = {
+            .data = frame_buf,
+            .size = key ? i_size : p_size,
+            .frame_type = key ? JTT1078_DATA_TYPE_VIDEO : JTT1078_DATA_TYPE_VIDEO_P,
+            .pts = (uint64_t)n * 1000 / fps,
+            .is_keyframe = key,
+        };
+        if (jtt1078_encode_video_frame(&encoder, &frame) < 0) {
+            break;
+        }
+        frame_key[sent] = key;
+        frame_end[sent++] = conn.written;
+    }
+    jtt1078_encoder_stats_t es;
+    jtt1078_encoder_get_stats(&encoder, &es);
+    jtt1078_encoder_deinit(&encoder);
+    loopback_close(conn.fd, sink.listen_fd, tid);
+
+    // 调制解调器模型: 到达的字节进入队列, 按链路速率排空, 超出队列容量的字节丢弃
+    const double drain_per_ns = o->link_kbps * 1000.0 / 8 / 1e9;
+    double queue = 0, max_queue = 0;
+    uint64_t overflow = 0, offset = 0, last_t = sink.count ? sink.log[0].t_ns : 0;
+    uint32_t f = 0, damaged_i = 0, damaged_p = 0, frames_i = 0;
+    uint64_t i_spread_sum = 0, i_spread_max = 0;
+    uint64_t frame_first_t = 0;
+    bool frame_damaged = false, frame_started = false;
+    for (uint32_t i = 0; i < sink.count && f < sent; i++) {
+        const pace_arrival_t *a = &sink.log[i];
+        queue -= (a->t_ns - last_t) * drain_per_ns;
+        if (queue < 0) queue = 0;
+        last_t = a->t_ns;
+
+        // 一次读取可能跨越多帧, 按帧边界拆分
+        uint32_t left = a->bytes;
+        while (left > 0 && f < sent) {
+            if (!frame_started) {
+                frame_first_t = a->t_ns;
+                frame_started = true;
+            }
+            uint32_t take = left;
+            if (offset + take > frame_end[f]) {
+                take = (uint32_t)(frame_end[f] - offset);
+            }
+            queue += take;
+            if (queue > o->queue_bytes) {
+                overflow += (uint64_t)(queue - o->queue_bytes);
+                queue = o->queue_bytes;
+                frame_damaged = true;
+            }
+            if (queue > max_queue) max_queue = queue;
+            offset += take;
+            left -= take;
+            if (offset == frame_end[f]) {
+                if (frame_key[f]) {
+                    uint64_t spread = a->t_ns - frame_first_t;
+                    frames_i++;
+                    i_spread_sum += spread;
+                    if (spread > i_spread_max) i_spread_max = spread;
+                    damaged_i += frame_damaged;
+                } else {
+                    damaged_p += frame_damaged;
+                }
+                frame_damaged = false;
+                frame_started = false;
+                f++;
+            }
+        }
+    }
+
+    fprintf(g_out,
+            "{\"bench\":\"pace\",\"mode\":\"%s\",\"kernel\":%s,\"fraction_pct\":%u,\"bitrate\":%u,"
+            "\"i_frame_bytes\":%u,\"link_kbps\":%u,\"queue_bytes\":%u,\"frames\":%u,\"i_frames\":%u,"
+            "\"i_spread_avg_ms\":%.2f,\"i_spread_max_ms\":%.2f,\"max_queue_bytes\":%.0f,"
+            "\"overflow_bytes\":%llu,\"damaged_i\":%u,\"damaged_p\":%u,\"paced_frames\":%llu,"
+            "\"pacing_delay_avg_ms\":%.2f,\"pacing_delay_max_ms\":%.2f,\"pacing_rate_cap_kbps\":%u,"
+            "\"pacing_rate_max_kbps\":%u}\n",
+            pace_modes[mode], kernel ? "true" : "false", mode ? o->fraction : 0, o->bitrate,
+            i_size, o->link_kbps, o->queue_bytes, f, frames_i,
+            frames_i ? i_spread_sum / 1e6 / frames_i : 0.0, i_spread_max / 1e6, max_queue,
+            (unsigned long long)overflow, damaged_i, damaged_p,
+            (unsigned long long)es.pacing.paced_frames,
+            es.pacing.paced_frames ? es.pacing.total_delay_us / 1000.0 / es.pacing.paced_frames : 0.0,
+            es.pacing.max_delay_us / 1000.0, mode ? o->max_kbps : 0,
+            (unsigned)(es.pacing.max_rate * 8ULL / 1000));
+    fflush(g_out);
+
+    free(frame_buf);
+    free(frame_end);
+    free(frame_key);
+    free(sink.log);
+    return 0;
+}
+
+static int bench_pace(int argc, char **argv) {
+    pace_opts_t o = {
+        .seconds = 10.0, .fps = 25, .gop = 50, .bitrate = 2048000,
+        .fraction = 50, .link_kbps = 16000, .queue_bytes = 32 * 1024,
+    };
+    const char *mode = NULL;
+    int max_kbps = -1;              // 默认取链路速率
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:F:l:r:q:m:")) != -1) {
+        switch (opt) {
+        case 's': o.seconds = atof(optarg); break;
+        case 'b': o.bitrate = (uint32_t)atoi(optarg); break;
+        case 'F': o.fraction = (uint8_t)atoi(optarg); break;
+        case 'l': o.link_kbps = (uint32_t)atoi(optarg); break;
+        case 'r': max_kbps = atoi(optarg); break;
+        case 'q': o.queue_bytes = (uint32_t)atoi(optarg); break;
+        case 'm': mode = optarg; break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench pace [-s seconds] [-b bitrate] [-F fraction_pct] "
+                            "[-l link_kbps] [-r max_rate_kbps, 0=none, default link_kbps] "
+                            "[-q queue_bytes] [-m off|user|kernel]\n");
+            return 1;
+        }
+    }
+    o.max_kbps = max_kbps < 0 ? o.link_kbps : (uint32_t)max_kbps;
+    if (o.seconds <= 0 || o.bitrate < 64000 || o.fraction == 0 || o.fraction > 100 ||
+        o.link_kbps == 0 || o.queue_bytes == 0) {
+        fprintf(stderr, "[BENCH] Invalid pace options\n");
+        return 1;
+    }
+
+    int ret = 0;
+    for (int m = 0; m < 3; m++) {
+        if (!mode || strcmp(mode, pace_modes[m]) == 0) {
+            ret |= run_pace(m, &o);
+        }
+    }
+    return ret;
+}
+
+/*
+ * playback: SD卡录像回放上传
+ */
+
+// 随机slice数据, 按防竞争规则插入 0x03, 以非零字节结尾
+static void fill_slice(uint8_t *p, uint32_t len, uint32_t *rng) {
+    int zeros = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        *rng = *rng * 1103515245u + 12345u;
+        uint8_t b = (uint8_t)(*rng >> 16);
+        if (zeros >= 2 && b <= 3) {
+            b = 0x03;
+        }
+        p[i] = b;
+        zeros = b ? 0 : zeros + 1;
+    }
+    p[len - 1] = 0x80;
+}
+
+// 合成录像段(H.264, 与 video_stream_record 的写法一致): 关键帧为 SPS/PPS + 2个IDR slice,
+// 其余为1个P slice; with_index 时同时写出关键帧索引(采集时间按帧率)
+static int write_segment(const char *path, bool with_index, uint32_t seconds, uint32_t fps,
+                         uint32_t gop, uint32_t bitrate, uint64_t start_ms, uint32_t *nframes) {
+    const uint32_t i_ratio = 8;
+    uint64_t gop_bytes = (uint64_t)bitrate / 8 * gop / fps;
+    uint32_t p_size = (uint32_t)(gop_bytes / (i_ratio + gop - 1));
+    uint32_t i_size = p_size * i_ratio;
+    static const uint8_t sps_pps[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1F, 0xE9, 0x40, 0x28, 0x02, 0xDD, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+    };
+    // 第1个slice: first_mb_in_slice=0; 第2个: first_mb_in_slice=1
+    static const uint8_t idr0[] = { 0x00, 0x00, 0x00, 0x01, 0x65, 0xB8 };
+    static const uint8_t idr1[] = { 0x00, 0x00, 0x01, 0x65, 0x4D };
+    static const uint8_t p0[] = { 0x00, 0x00, 0x00, 0x01, 0x41, 0xC0 };
+
+    FILE *fp = fopen(path, "wb");
+    char idx_path[512];
+    snprintf(idx_path, sizeof(idx_path), "%s%s", path, JTT1078_PLAYBACK_INDEX_SUFFIX);
+    FILE *idx = with_index ? fopen(idx_path, "wb") : NULL;
+    uint8_t *buf = malloc(i_size + 64);
+    if (!fp || (with_index && !idx) || !buf) {
+        fprintf(stderr, "[BENCH] Cannot create %s: %s\n", path, strerror(errno));
+        if (fp) fclose(fp);
+        if (idx) fclose(idx);
+        free(buf);
+        return -1;
+    }
+    if (!with_index) {
+        unlink(idx_path);
+    }
+
+    uint32_t rng = 2024;
+    uint64_t offset = 0;
+    uint32_t total = seconds * fps;
+    for (uint32_t f = 0; f < total; f++) {
+        uint32_t len = 0;
+        if (f % gop == 0) {
+            if (idx) {
+                jtt1078_playback_key_t key = {
+                    .offset = offset, .time_ms = start_ms + (uint64_t)f * 1000 / fps, .frame = f,
+                };
+                fwrite(&key, sizeof(key), 1, idx);
+            }
+            uint32_t half = (i_size - sizeof(sps_pps)) / 2;
+            memcpy(buf, sps_pps, sizeof(sps_pps));
+            len = sizeof(sps_pps);
+            memcpy(buf + len, idr0, sizeof(idr0));
+            fill_slice(buf + len + sizeof(idr0), half - sizeof(idr0), &rng);
+            len += half;
+            memcpy(buf + len, idr1, sizeof(idr1));
+            fill_slice(buf + len + sizeof(idr1), half - sizeof(idr1), &rng);
+            len += half;
+        } else {
+            memcpy(buf, p0, sizeof(p0));
+            fill_slice(buf + sizeof(p0), p_size - sizeof(p0), &rng);
+            len = p_size;
+        }
+        if (fwrite(buf, 1, len, fp) != len) {
+            fclose(fp);
+            if (idx) fclose(idx);
+            free(buf);
+            return -1;
+        }
+        offset += len;
+    }
+
+    free(buf);
+    fflush(fp);
+    fsync(fileno(fp));
+    fclose(fp);
+    if (idx) {
+        fclose(idx);
+    }
+    *nframes = total;
+    return 0;
+}
+
+typedef struct {
+    const char *name;
+    uint8_t mode;
+    uint8_t speed;
+} playback_run_t;
+
+static const playback_run_t playback_runs[] = {
+    { "normal", JTT1078_PLAYBACK_NORMAL, 0 },
+    { "keyframe", JTT1078_PLAYBACK_KEYFRAME, 0 },
+    { "normal", JTT1078_PLAYBACK_NORMAL, 16 },
+    { "keyframe", JTT1078_PLAYBACK_KEYFRAME, 16 },
+};
+
+static int run_playback(const char *path, const playback_run_t *r, double max_seconds,
+                        uint32_t expect_frames, uint32_t fps) {
+    // 每次从SD卡(而非页缓存)读取
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    jtt1078_encoder_t encoder;
+    if (jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H264,
+                                 null_sendv_cb, NULL) < 0) {
+        return 1;
+    }
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_ABSOLUTE);
+    jtt1078_encoder_enable_batch(&encoder, 256 * 1024);
+
+    uint64_t cpu_start = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+
+    jtt1078_playback_t pb;
+    if (jtt1078_playback_open(&pb, path, JTT1078_VIDEO_H264, fps) < 0) {
+        jtt1078_encoder_deinit(&encoder);
+        return 1;
+    }
+    bool indexed = pb.indexed;
+    jtt1078_playback_set_mode(&pb, r->mode, r->speed);
+
+    // 逐帧读取(校验时间戳递增), 再按倍速交给编码器
+    uint64_t first_pts = 0, last_pts = 0;
+    bool monotonic = true;
+    int ret;
+    while ((ret = jtt1078_playback_step(&pb, &encoder)) > 0) {
+        uint64_t pts = encoder.frame_timestamp;
+        if (pb.stats.frames == 1) {
+            first_pts = pts;
+        } else if (pts <= last_pts) {
+            monotonic = false;
+        }
+        last_pts = pts;
+        if (r->speed && now_ns(CLOCK_MONOTONIC) - start > (uint64_t)(max_seconds * 1e9)) {
+            break;
+        }
+    }
+
+    double elapsed = (now_ns(CLOCK_MONOTONIC) - start) / 1e9;
+    double cpu = (now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) / 1e9;
+    jtt1078_playback_stats_t st = pb.stats;
+    uint32_t keys = jtt1078_playback_keyframes(&pb);
+    jtt1078_playback_close(&pb);
+    jtt1078_encoder_deinit(&encoder);
+
+    // 完整回放时校验帧数与最后一帧的时间
+    bool complete = ret == 0;
+    bool ok = ret >= 0 && monotonic;
+    if (complete && r->mode == JTT1078_PLAYBACK_NORMAL && expect_frames) {
+        ok = ok && st.frames == expect_frames &&
+             last_pts - first_pts == (uint64_t)(expect_frames - 1) * 1000 / fps;
+    }
+    if (complete && r->mode == JTT1078_PLAYBACK_KEYFRAME) {
+        ok = ok && st.frames == keys && st.keyframes == keys;
+    }
+    if (!ok) {
+        fprintf(stderr, "[BENCH] Playback %s check failed: frames=%llu keys=%u monotonic=%d ret=%d\n",
+                r->name, (unsigned long long)st.frames, keys, monotonic, ret);
+    }
+
+    double footage = (last_pts - first_pts) / 1000.0;
+    fprintf(g_out,
+            "{\"bench\":\"playback\",\"mode\":\"%s\",\"speed\":%u,\"index\":\"%s\",\"frames\":%llu,"
+            "\"keyframes\":%llu,\"skipped\":%llu,\"mb\":%.1f,\"seconds\":%.3f,\"cpu_s\":%.3f,"
+            "\"cpu_pct\":%.1f,\"mb_per_s\":%.1f,\"footage_s\":%.1f,\"footage_x\":%.1f,"
+            "\"released_mb\":%.1f,\"ok\":%s}\n",
+            r->name, r->speed, indexed ? "file" : "scan", (unsigned long long)st.frames,
+            (unsigned long long)st.keyframes, (unsigned long long)st.skipped, st.bytes / 1e6,
+            elapsed, cpu, elapsed > 0 ? 100.0 * cpu / elapsed : 0.0,
+            elapsed > 0 ? st.bytes / 1e6 / elapsed : 0.0, footage,
+            elapsed > 0 ? footage / elapsed : 0.0, st.released / 1e6, ok ? "true" : "false");
+    fflush(g_out);
+    return ok ? 0 : 1;
+}
+
+static int bench_playback(int argc, char **argv) {
+    double seconds = 2.0;
+    uint32_t footage = 180, bitrate = 2048000, fps = JTT1078_PLAYBACK_DEFAULT_FPS;
+    const char *dir = "/tmp";
+    const char *file = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:t:b:d:f:")) != -1) {
+        switch (opt) {
+        case 's': seconds = atof(optarg); break;
+        case 't': footage = (uint32_t)atoi(optarg); break;
+        case 'b': bitrate = (uint32_t)atoi(optarg); break;
+        case 'd': dir = optarg; break;
+        case 'f': file = optarg; break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench playback [-s seconds] [-t footage_seconds] "
+                            "[-b bitrate] [-d dir] [-f segment.h264]\n");
+            return 1;
+        }
+    }
+    if (seconds <= 0 || footage == 0 || bitrate < 64000) {
+        fprintf(stderr, "[BENCH] Invalid playback options\n");
+        return 1;
+    }
+
+    // 合成两个内容相同的录像段, 一个带索引文件, 一个需要扫描
+    char paths[2][256];
+    uint32_t frames = 0;
+    int nfiles = 1;
+    if (file) {
+        snprintf(paths[0], sizeof(paths[0]), "%s", file);
+    } else {
+        const uint64_t start_ms = 1767243600000ULL;     // 2026-01-01 05:00:00 UTC
+        nfiles = 2;
+        for (int i = 0; i < nfiles; i++) {
+            snprintf(paths[i], sizeof(paths[i]), "%s/video_20260101_120000_seg%03d.h264", dir, i);
+            if (write_segment(paths[i], i == 0, footage, fps, 2 * fps, bitrate, start_ms, &frames) < 0) {
+                return 1;
+            }
+        }
+    }
+
+    int ret = 0;
+    for (int i = 0; i < nfiles; i++) {
+        for (size_t r = 0; r < sizeof(playback_runs) / sizeof(playback_runs[0]); r++) {
+            ret |= run_playback(paths[i], &playback_runs[r], seconds, frames, fps);
+        }
+    }
+
+    if (!file) {
+        for (int i = 0; i < nfiles; i++) {
+            char idx_path[sizeof(paths) + sizeof(JTT1078_PLAYBACK_INDEX_SUFFIX)];
+            snprintf(idx_path, sizeof(idx_path), "%s%s", paths[i], JTT1078_PLAYBACK_INDEX_SUFFIX);
+            unlink(paths[i]);
+            unlink(idx_path);
+        }
+    }
+    return ret;
+}
+
+/*
+ * fanout: 一路码流推送到多个平台
+ */
+
+typedef struct {
+    int listen_fd;
+    bool stall;                 // 接受连接后不读取(模拟卡住的平台)
+    bool check;                 // 校验帧内容(fill_pattern)
+    volatile bool stop;
+    jtt1078_depack_t depack;
+    frame_check_t chk;
+} fanout_sink_t;
+
+static void *fanout_sink_thread(void *arg) {
+    fanout_sink_t *sink = (fanout_sink_t *)arg;
+    jtt1078_depack_init(&sink->depack, 0, sink->check ? check_frame_cb : count_frame_cb, &sink->chk);
+    int fd = accept(sink->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (sink->stall) {
+        while (!sink->stop) {
+            usleep(10000);
+        }
+        close(fd);
+        return NULL;
+    }
+
+    // 多个接收端并行, 各用独立的读缓冲区
+    uint8_t *buf = malloc(256 * 1024);
+    ssize_t n;
+    while (buf && (n = read(fd, buf, 256 * 1024)) > 0) {
+        jtt1078_depack_feed(&sink->depack, buf, n);
+    }
+    free(buf);
+    close(fd);
+    return NULL;
+}
+
+// 建立回环连接, 返回非阻塞的发送端socket; 卡住的接收端使用小缓冲区, 发送端很快写满
+static int fanout_sink_open(fanout_sink_t *sink, pthread_t *tid) {
+    const loopback_opts_t opts = {
+        .rcvbuf = sink->stall ? 64 * 1024 : 0,
+        .sndbuf = sink->stall ? 64 * 1024 : 0,
+        .nonblock = true,
+    };
+    return loopback_open(&sink->listen_fd, fanout_sink_thread, sink, &opts, tid);
+}
+
+static void fanout_sink_close(int fd, fanout_sink_t *sink, pthread_t tid) {
+    sink->stop = true;
+    loopback_close(fd, sink->listen_fd, tid);
+}
+
+typedef struct {
+    double seconds;
+    uint32_t frames;
+    uint32_t fps;
+    uint32_t gop;
+    uint32_t bitrate;
+    int max_dests;
+
+    // 合成码流(AUTO类型, 编码器扫描NAL头)
+    uint8_t *i_frame;
+    uint8_t *p_frame;
+    uint32_t i_size;
+    uint32_t p_size;
+} fanout_opts_t;
+
+static int fanout_encode(jtt1078_encoder_t *encoder, const fanout_opts_t *o, uint32_t n) {
+    bool key = n % o->gop == 0;
+    video_frame_t frame = {
+        .data = key ? o->i_frame : o->p_frame,
+        .size = key ? o->i_size : o->p_size,
+        .frame_type = JTT1078_FRAME_TYPE_AUTO,
+        .pts = (uint64_t)n * 1000 / o->fps,
+        .is_keyframe = key,
+    };
+    return jtt1078_encode_video_frame(encoder, &frame);
+}
+
+// 等待各目的地处理完 frames 帧(发送或丢弃), 最多 timeout_ms
+static void fanout_drain(jtt1078_fanout_t *fo, uint64_t frames, uint32_t timeout_ms) {
+    uint64_t deadline = now_ns(CLOCK_MONOTONIC) + (uint64_t)timeout_ms * 1000000;
+    for (int i = 0; i < fo->ndests; i++) {
+        jtt1078_fanout_stats_t st;
+        while (jtt1078_fanout_get_stats(fo, i, &st) == 0 &&
+               st.frames_sent + st.frames_dropped < frames &&
+               now_ns(CLOCK_MONOTONIC) < deadline) {
+            usleep(1000);
+        }
+    }
+}
+
+// 发送CPU: n 个独立编码器(每个平台各分包一次) vs 扇出到 n 个目的地
+// 各目的地不丢帧(BLOCK), 接收端校验帧数与包序号连续
+static int run_fanout_cpu(bool fanout, int ndests, const fanout_opts_t *o) {
+    fanout_sink_t sinks[JTT1078_FANOUT_MAX_DESTS];
+    sock_conn_t conns[JTT1078_FANOUT_MAX_DESTS];
+    pthread_t tids[JTT1078_FANOUT_MAX_DESTS];
+    jtt1078_encoder_t encoders[JTT1078_FANOUT_MAX_DESTS];
+    jtt1078_fanout_t fo;
+
+    memset(sinks, 0, sizeof(sinks));
+    for (int i = 0; i < ndests; i++) {
+        conns[i] = (sock_conn_t){ .fd = fanout_sink_open(&sinks[i], &tids[i]), .timeout_ms = -1 };
+        if (conns[i].fd < 0) {
+            return 1;
+        }
+    }
+
+    if (fanout) {
+        jtt1078_encoder_t *encoder = jtt1078_fanout_init(&fo, "013800138000", 1, JTT1078_VIDEO_H264);
+        if (!encoder) {
+            return 1;
+        }
+        jtt1078_encoder_set_timestamp_mode(encoder, JTT1078_TS_PTS);
+        for (int i = 0; i < ndests; i++) {
+            jtt1078_fanout_dest_config_t cfg;
+            jtt1078_fanout_default_config(&cfg);
+            cfg.send_packetv = sock_sendv_cb;
+            cfg.user_data = &conns[i];
+            cfg.policy = JTT1078_FANOUT_BLOCK;
+            cfg.block_ms = 10000;
+            jtt1078_fanout_add_dest(&fo, &cfg);
+        }
+        jtt1078_fanout_start(&fo);
+    } else {
+        for (int i = 0; i < ndests; i++) {
+            jtt1078_encoder_init_iov(&encoders[i], "013800138000", 1, JTT1078_VIDEO_H264,
+                                     sock_sendv_cb, &conns[i]);
+            jtt1078_encoder_set_timestamp_mode(&encoders[i], JTT1078_TS_PTS);
+            jtt1078_encoder_enable_batch(&encoders[i], 256 * 1024);
+        }
+    }
+
+    uint64_t cpu_start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    for (uint32_t n = 0; n < o->frames; n++) {
+        if (fanout) {
+            fanout_encode(&fo.encoder, o, n);
+        } else {
+            for (int i = 0; i < ndests; i++) {
+                fanout_encode(&encoders[i], o, n);
+            }
+        }
+    }
+    uint64_t producer_ns = now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    uint64_t cpu_ns = producer_ns;
+
+    // 扇出: 加上各发送线程的CPU时间(线程退出前读取)
+    if (fanout) {
+        fanout_drain(&fo, o->frames, 30000);
+        for (int i = 0; i < ndests; i++) {
+            clockid_t clk;
+            if (pthread_getcpuclockid(fo.dests[i].thread, &clk) == 0) {
+                cpu_ns += now_ns(clk);
+            }
+        }
+    }
+    double elapsed = (now_ns(CLOCK_MONOTONIC) - start) / 1e9;
+
+    uint64_t dropped = 0;
+    if (fanout) {
+        for (int i = 0; i < ndests; i++) {
+            jtt1078_fanout_stats_t st;
+            jtt1078_fanout_get_stats(&fo, i, &st);
+            dropped += st.frames_dropped;
+        }
+        jtt1078_fanout_destroy(&fo);
+    } else {
+        for (int i = 0; i < ndests; i++) {
+            jtt1078_encoder_deinit(&encoders[i]);
+        }
+    }
+
+    uint64_t min_frames = UINT64_MAX, seq_gaps = 0, bytes = 0;
+    for (int i = 0; i < ndests; i++) {
+        fanout_sink_close(conns[i].fd, &sinks[i], tids[i]);
+        jtt1078_depack_channel_stats_t cs = { 0 };
+        jtt1078_depack_get_channel_stats(&sinks[i].depack, 0, &cs);
+        jtt1078_depack_deinit(&sinks[i].depack);
+        if (sinks[i].chk.frames < min_frames) {
+            min_frames = sinks[i].chk.frames;
+        }
+        seq_gaps += cs.seq_gaps;
+        bytes += sinks[i].chk.bytes;
+    }
+
+    bool ok = min_frames == o->frames && seq_gaps == 0 && dropped == 0;
+    if (!ok) {
+        fprintf(stderr, "[BENCH] Fan-out cpu check failed: received=%llu/%u seq_gaps=%llu dropped=%llu\n",
+                (unsigned long long)min_frames, o->frames, (unsigned long long)seq_gaps,
+                (unsigned long long)dropped);
+    }
+    fprintf(g_out,
+            "{\"bench\":\"fanout\",\"test\":\"cpu\",\"mode\":\"%s\",\"dests\":%d,\"frames\":%u,"
+            "\"mb_per_dest\":%.1f,\"seconds\":%.3f,\"cpu_us_per_frame\":%.1f,"
+            "\"producer_us_per_frame\":%.1f,\"frames_received\":%llu,\"seq_gaps\":%llu,\"ok\":%s}\n",
+            fanout ? "fanout" : "encoders", ndests, o->frames, bytes / 1e6 / ndests, elapsed,
+            cpu_ns / 1e3 / o->frames, producer_ns / 1e3 / o->frames,
+            (unsigned long long)min_frames, (unsigned long long)seq_gaps, ok ? "true" : "false");
+    fflush(g_out);
+    return ok ? 0 : 1;
+}
+
+// 卡住的平台: 两个目的地, 第二个接收端不读取; 按帧率实时发送,
+// 报告正常平台收到的帧数与采集线程的最长阻塞时间
+static int run_fanout_stall(bool fanout, const fanout_opts_t *o) {
+    fanout_sink_t sinks[2];
+    sock_conn_t conns[2];
+    pthread_t tids[2];
+    jtt1078_encoder_t encoders[2];
+    jtt1078_fanout_t fo;
+
+    memset(sinks, 0, sizeof(sinks));
+    sinks[1].stall = true;
+    for (int i = 0; i < 2; i++) {
+        conns[i] = (sock_conn_t){ .fd = fanout_sink_open(&sinks[i], &tids[i]), .timeout_ms = 5000 };
+        if (conns[i].fd < 0) {
+            return 1;
+        }
+    }
+
+    if (fanout) {
+        jtt1078_encoder_t *encoder = jtt1078_fanout_init(&fo, "013800138000", 1, JTT1078_VIDEO_H264);
+        if (!encoder) {
+            return 1;
+        }
+        jtt1078_encoder_set_timestamp_mode(encoder, JTT1078_TS_PTS);
+        for (int i = 0; i < 2; i++) {
+            jtt1078_fanout_dest_config_t cfg;
+            jtt1078_fanout_default_config(&cfg);
+            cfg.send_packetv = sock_sendv_cb;
+            cfg.user_data = &conns[i];
+            jtt1078_fanout_add_dest(&fo, &cfg);
+        }
+        jtt1078_fanout_start(&fo);
+    } else {
+        for (int i = 0; i < 2; i++) {
+            jtt1078_encoder_init_iov(&encoders[i], "013800138000", 1, JTT1078_VIDEO_H264,
+                                     sock_sendv_cb, &conns[i]);
+            jtt1078_encoder_set_timestamp_mode(&encoders[i], JTT1078_TS_PTS);
+            jtt1078_encoder_enable_batch(&encoders[i], 256 * 1024);
+        }
+    }
+
+    // 采集时刻到达而上一帧仍在发送时, 该帧丢失(相机不等待)
+    uint32_t total = (uint32_t)(o->seconds * o->fps);
+    uint64_t interval = 1000000000ULL / o->fps;
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    uint64_t max_block_ns = 0;
+    uint32_t produced = 0, missed = 0;
+    for (uint32_t n = 0; n < total; n++) {
+        uint64_t due = start + n * interval;
+        uint64_t now = now_ns(CLOCK_MONOTONIC);
+        if (now > due + interval) {
+            missed++;
+            continue;
+        }
+        if (now < due) {
+            struct timespec ts = { .tv_sec = due / 1000000000ULL, .tv_nsec = due % 1000000000ULL };
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+
+        uint64_t t0 = now_ns(CLOCK_MONOTONIC);
+        if (fanout) {
+            fanout_encode(&fo.encoder, o, n);
+        } else {
+            for (int i = 0; i < 2; i++) {
+                fanout_encode(&encoders[i], o, n);
+            }
+        }
+        uint64_t block = now_ns(CLOCK_MONOTONIC) - t0;
+        if (block > max_block_ns) {
+            max_block_ns = block;
+        }
+        produced++;
+    }
+
+    jtt1078_fanout_stats_t st[2];
+    memset(st, 0, sizeof(st));
+    if (fanout) {
+        // 正常平台发完队列; 卡住的平台在接收端关闭后发送失败
+        fanout_drain(&fo, produced, 2000);
+        sinks[1].stop = true;
+        for (int i = 0; i < 2; i++) {
+            jtt1078_fanout_get_stats(&fo, i, &st[i]);
+        }
+        jtt1078_fanout_destroy(&fo);
+    } else {
+        sinks[1].stop = true;
+        for (int i = 0; i < 2; i++) {
+            jtt1078_encoder_deinit(&encoders[i]);
+        }
+    }
+
+    jtt1078_depack_channel_stats_t cs = { 0 };
+    for (int i = 0; i < 2; i++) {
+        fanout_sink_close(conns[i].fd, &sinks[i], tids[i]);
+        if (i == 0) {
+            jtt1078_depack_get_channel_stats(&sinks[i].depack, 0, &cs);
+        }
+        jtt1078_depack_deinit(&sinks[i].depack);
+    }
+
+    // 扇出时正常平台收到全部采集到的帧, 且包序号连续
+    bool ok = !fanout || (missed == 0 && sinks[0].chk.frames == produced && cs.seq_gaps == 0);
+    if (!ok) {
+        fprintf(stderr, "[BENCH] Fan-out stall check failed: received=%llu/%u missed=%u seq_gaps=%llu\n",
+                (unsigned long long)sinks[0].chk.frames, produced, missed,
+                (unsigned long long)cs.seq_gaps);
+    }
+    fprintf(g_out,
+            "{\"bench\":\"fanout\",\"test\":\"stall\",\"mode\":\"%s\",\"camera_frames\":%u,"
+            "\"frames_missed\":%u,\"producer_max_block_ms\":%.1f,\"healthy_frames\":%llu,"
+            "\"healthy_seq_gaps\":%llu,\"stalled_frames_sent\":%llu,\"stalled_frames_dropped\":%llu,"
+            "\"stalled_drop_events\":%llu,\"ok\":%s}\n",
+            fanout ? "fanout" : "encoders", total, missed, max_block_ns / 1e6,
+            (unsigned long long)sinks[0].chk.frames, (unsigned long long)cs.seq_gaps,
+            (unsigned long long)st[1].frames_sent, (unsigned long long)st[1].frames_dropped,
+            (unsigned long long)st[1].drop_events, ok ? "true" : "false");
+    fflush(g_out);
+    return ok ? 0 : 1;
+}
+
+static int bench_fanout(int argc, char **argv) {
+    fanout_opts_t o = {
+        .seconds = 10.0, .frames = 3000, .fps = 25, .gop = 50, .bitrate = 4096000,
+        .max_dests = JTT1078_FANOUT_MAX_DESTS,
+    };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:f:n:b:")) != -1) {
+        switch (opt) {
+        case 's': o.seconds = atof(optarg); break;
+        case 'f': o.frames = (uint32_t)atoi(optarg); break;
+        case 'n': o.max_dests = atoi(optarg); break;
+        case 'b': o.bitrate = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench fanout [-s seconds] [-f frames] [-n max_dests] "
+                            "[-b bitrate]\n");
+            return 1;
+        }
+    }
+    if (o.seconds <= 0 || o.frames == 0 || o.bitrate < 64000 ||
+        o.max_dests < 1 || o.max_dests > JTT1078_FANOUT_MAX_DESTS) {
+        fprintf(stderr, "[BENCH] Invalid fanout options\n");
+        return 1;
+    }
+
+    // GOP 内I帧为P帧的8倍
+    const uint32_t i_ratio = 8;
+    static const uint8_t sps_pps_idr[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1F, 0xE9, 0x40, 0x28, 0x02, 0xDD, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80,
+        0x00, 0x00, 0x00, 0x01, 0x65, 0xB8,
+    };
+    static const uint8_t p_hdr[] = { 0x00, 0x00, 0x00, 0x01, 0x41, 0xC0 };
+    uint64_t gop_bytes = (uint64_t)o.bitrate / 8 * o.gop / o.fps;
+    o.p_size = (uint32_t)(gop_bytes / (i_ratio + o.gop - 1));
+    o.i_size = o.p_size * i_ratio;
+    o.i_frame = malloc(o.i_size);
+    o.p_frame = malloc(o.p_size);
+    if (!o.i_frame || !o.p_frame) {
+        free(o.i_frame);
+        free(o.p_frame);
+        return 1;
+    }
+    uint32_t rng = 1078;
+    memcpy(o.i_frame, sps_pps_idr, sizeof(sps_pps_idr));
+    fill_slice(o.i_frame + sizeof(sps_pps_idr), o.i_size - sizeof(sps_pps_idr), &rng);
+    memcpy(o.p_frame, p_hdr, sizeof(p_hdr));
+    fill_slice(o.p_frame + sizeof(p_hdr), o.p_size - sizeof(p_hdr), &rng);
+
+    int ret = 0;
+    for (int n = 1; n <= o.max_dests; n++) {
+        ret |= run_fanout_cpu(false, n, &o);
+        ret |= run_fanout_cpu(true, n, &o);
+    }
+    ret |= run_fanout_stall(false, &o);
+    ret |= run_fanout_stall(true, &o);
+
+    free(o.i_frame);
+    free(o.p_frame);
+    return ret;
+}
+
+/*
+ * zerocopy: MSG_ZEROCOPY 与拷贝发送
+ */
+
+#define ZC_POOL_FRAMES  24          // 缓冲池帧数(模拟编码器码流缓冲区)
+
+typedef struct {
+    uint8_t *bufs[ZC_POOL_FRAMES];
+    uint8_t *free_list[ZC_POOL_FRAMES];
+    int nfree;
+} zc_pool_t;
+
+// 零拷贝完成: 缓冲区回到缓冲池
+static void zc_pool_release(void *user_data, void *buf) {
+    zc_pool_t *pool = (zc_pool_t *)user_data;
+    pool->free_list[pool->nfree++] = (uint8_t *)buf;
+}
+
+typedef struct {
+    double seconds;
+    uint32_t min_bytes;
+    const char *host;           // NULL: 本机回环接收端(校验帧内容)
+    uint16_t port;
+} zc_opts_t;
+
+static uint64_t thread_rusage_us(bool sys) {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    const struct timeval *tv = sys ? &ru.ru_stime : &ru.ru_utime;
+    return (uint64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+static int run_zerocopy(bool zerocopy, uint32_t frame_bytes, const zc_opts_t *o) {
+    fanout_sink_t sink;
+    pthread_t tid;
+    int port = o->port;
+
+    memset(&sink, 0, sizeof(sink));
+    sink.check = true;
+    if (!o->host) {
+        port = loopback_listen(&sink.listen_fd, fanout_sink_thread, &sink, 0, &tid);
+        if (port < 0) {
+            return 1;
+        }
+    }
+
+    zc_pool_t pool = { .nfree = 0 };
+    for (int i = 0; i < ZC_POOL_FRAMES; i++) {
+        pool.bufs[i] = malloc(frame_bytes);
+        if (!pool.bufs[i]) {
+            return 1;
+        }
+        pool.free_list[pool.nfree++] = pool.bufs[i];
+    }
+
+    jtt1078_conn_t conn;
+    jtt1078_encoder_t encoder;
+    jtt1078_conn_init(&conn, o->host ? o->host : "127.0.0.1", (uint16_t)port, NULL);
+    if (jtt1078_conn_poll(&conn, 3000) != 1) {
+        fprintf(stderr, "[BENCH] Cannot connect to %s:%d\n", o->host ? o->host : "127.0.0.1", port);
+        return 1;
+    }
+    if (zerocopy) {
+        jtt1078_conn_enable_zerocopy(&conn, o->min_bytes, zc_pool_release, &pool);
+    }
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H264, jtt1078_conn_sendv, &conn);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    jtt1078_encoder_enable_batch(&encoder, frame_bytes);
+
+    // 只计发送(含收割完成通知)的CPU, 不计填充帧内容
+    uint64_t cpu_ns = 0, user_us = 0, sys_us = 0;
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    uint64_t frames = 0, failed = 0;
+    while (now_ns(CLOCK_MONOTONIC) - start < (uint64_t)(o->seconds * 1e9)) {
+        uint64_t c0 = now_ns(CLOCK_THREAD_CPUTIME_ID);
+        uint64_t u0 = thread_rusage_us(false), s0 = thread_rusage_us(true);
+        while (pool.nfree == 0) {
+            if (jtt1078_conn_reap(&conn, 1000) == 0 && pool.nfree == 0) {
+                fprintf(stderr, "[BENCH] No zero-copy completion within 1 s\n");
+                break;
+            }
+        }
+        cpu_ns += now_ns(CLOCK_THREAD_CPUTIME_ID) - c0;
+        user_us += thread_rusage_us(false) - u0;
+        sys_us += thread_rusage_us(true) - s0;
+        if (pool.nfree == 0) {
+            break;
+        }
+
+        // 缓冲区在完成前被复用时, 接收端校验失败
+        uint8_t *buf = pool.free_list[--pool.nfree];
+        fill_pattern(buf, frame_bytes, frames);
+        video_frame_t frame = {
+            .data = buf,
+            .size = frame_bytes,
+            .frame_type = JTT1078_DATA_TYPE_VIDEO,
+            .pts = frames * 40,
+            .is_keyframe = true,
+        };
+
+        c0 = now_ns(CLOCK_THREAD_CPUTIME_ID);
+        u0 = thread_rusage_us(false);
+        s0 = thread_rusage_us(true);
+        int ret = jtt1078_conn_send_video_zc(&conn, &encoder, &frame, buf);
+        cpu_ns += now_ns(CLOCK_THREAD_CPUTIME_ID) - c0;
+        user_us += thread_rusage_us(false) - u0;
+        sys_us += thread_rusage_us(true) - s0;
+        if (!conn.zc) {
+            zc_pool_release(&pool, buf);
+        }
+        if (ret <= 0) {
+            failed++;
+            break;
+        }
+        frames++;
+    }
+    double elapsed = (now_ns(CLOCK_MONOTONIC) - start) / 1e9;
+
+    // 等待全部缓冲区归还
+    uint64_t wait_start = now_ns(CLOCK_MONOTONIC);
+    while (pool.nfree < ZC_POOL_FRAMES && now_ns(CLOCK_MONOTONIC) - wait_start < 2000000000ULL) {
+        jtt1078_conn_reap(&conn, 100);
+    }
+    int outstanding = ZC_POOL_FRAMES - pool.nfree;
+
+    jtt1078_zc_stats_t zs = { 0 };
+    if (conn.zc) {
+        jtt1078_zc_get_stats(conn.zc, &zs);
+    }
+    jtt1078_encoder_deinit(&encoder);
+    jtt1078_conn_deinit(&conn);
+
+    uint64_t received = frames, corrupt = 0;
+    if (!o->host) {
+        pthread_join(tid, NULL);
+        close(sink.listen_fd);
+        jtt1078_depack_deinit(&sink.depack);
+        received = sink.chk.frames;
+        corrupt = sink.chk.corrupt;
+    }
+    for (int i = 0; i < ZC_POOL_FRAMES; i++) {
+        free(pool.bufs[i]);
+    }
+
+    double mb = (double)frames * frame_bytes / 1e6;
+    bool ok = failed == 0 && outstanding == 0 && corrupt == 0 && received == frames;
+    if (!ok) {
+        fprintf(stderr, "[BENCH] Zero-copy check failed: frames=%llu received=%llu corrupt=%llu "
+                        "outstanding=%d failed=%llu\n",
+                (unsigned long long)frames, (unsigned long long)received,
+                (unsigned long long)corrupt, outstanding, (unsigned long long)failed);
+    }
+    fprintf(g_out,
+            "{\"bench\":\"zerocopy\",\"mode\":\"%s\",\"target\":\"%s\",\"frame_bytes\":%u,"
+            "\"frames\":%llu,\"mb_per_s\":%.1f,\"cpu_us_per_mb\":%.1f,\"user_us_per_mb\":%.1f,"
+            "\"sys_us_per_mb\":%.1f,\"zc_frames\":%llu,\"zc_sends\":%llu,\"completions\":%llu,"
+            "\"kernel_copied_pct\":%.1f,\"fallbacks\":%llu,\"max_pending\":%u,\"max_hold_us\":%u,"
+            "\"avg_hold_us\":%.0f,\"corrupt\":%llu,\"ok\":%s}\n",
+            zerocopy ? "zerocopy" : "copy", o->host ? o->host : "loopback", frame_bytes,
+            (unsigned long long)frames, elapsed > 0 ? mb / elapsed : 0.0,
+            mb > 0 ? cpu_ns / 1e3 / mb : 0.0, mb > 0 ? user_us / mb : 0.0, mb > 0 ? sys_us / mb : 0.0,
+            (unsigned long long)zs.frames, (unsigned long long)zs.sends,
+            (unsigned long long)zs.completions,
+            zs.completions ? 100.0 * zs.copied / zs.completions : 0.0,
+            (unsigned long long)zs.fallbacks, zs.max_pending, zs.max_hold_us,
+            zs.frames ? (double)zs.total_hold_us / zs.frames : 0.0,
+            (unsigned long long)corrupt, ok ? "true" : "false");
+    fflush(g_out);
+    return ok ? 0 : 1;
+}
+
+static int bench_zerocopy(int argc, char **argv) {
+    zc_opts_t o = { .seconds = 2.0, .min_bytes = 1 };
+    static char host[64];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:m:H:")) != -1) {
+        switch (opt) {
+        case 's': o.seconds = atof(optarg); break;
+        case 'm': o.min_bytes = (uint32_t)atoi(optarg); break;
+        case 'H': {
+            const char *colon = strrchr(optarg, ':');
+            if (!colon || (size_t)(colon - optarg) >= sizeof(host)) {
+                fprintf(stderr, "[BENCH] -H expects host:port\n");
+                return 1;
+            }
+            memcpy(host, optarg, colon - optarg);
+            host[colon - optarg] = '\0';
+            o.host = host;
+            o.port = (uint16_t)atoi(colon + 1);
+            break;
+        }
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench zerocopy [-s seconds] [-m min_bytes] [-H host:port] "
+                            "[frame_bytes ...]\n");
+            return 1;
+        }
+    }
+    if (o.seconds <= 0 || (o.host && o.port == 0)) {
+        fprintf(stderr, "[BENCH] Invalid zerocopy options\n");
+        return 1;
+    }
+
+    static const uint32_t default_sizes[] = { 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+    uint32_t sizes[16];
+    int nsizes = 0;
+    for (int i = optind; i < argc && nsizes < 16; i++) {
+        sizes[nsizes++] = (uint32_t)atoi(argv[i]);
+    }
+    if (nsizes == 0) {
+        memcpy(sizes, default_sizes, sizeof(default_sizes));
+        nsizes = sizeof(default_sizes) / sizeof(default_sizes[0]);
+    }
+
+    int ret = 0;
+    for (int i = 0; i < nsizes; i++) {
+        if (sizes[i] < 1024 || sizes[i] > 4 * 1024 * 1024) {
+            fprintf(stderr, "[BENCH] Frame size out of range: %u\n", sizes[i]);
+            return 1;
+        }
+        ret |= run_zerocopy(false, sizes[i], &o);
+        ret |= run_zerocopy(true, sizes[i], &o);
+    }
+    return ret;
+}
+
+/*
+ * aio: 一个事件循环为多路编码器发送
+ */
+
+#define AIO_BENCH_MAX_STREAMS   64
+
+typedef struct {
+    int streams;
+    uint32_t frames;
+    uint32_t gop;
+    uint32_t i_size;
+    uint32_t p_size;
+} aio_opts_t;
+
+// mode: 0 阻塞回调, 1 epoll, 2 io_uring
+static int run_aio(int mode, const aio_opts_t *o) {
+    static const char *const names[] = { "blocking", "epoll", "io_uring" };
+    fanout_sink_t sinks[AIO_BENCH_MAX_STREAMS];
+    pthread_t tids[AIO_BENCH_MAX_STREAMS];
+    sock_conn_t conns[AIO_BENCH_MAX_STREAMS];        // 阻塞基线: 回调中直接 sendmsg
+    jtt1078_aio_stream_t *streams[AIO_BENCH_MAX_STREAMS];
+    jtt1078_encoder_t *encoders = calloc(o->streams, sizeof(jtt1078_encoder_t));
+    uint8_t *buf = malloc(o->i_size);
+    jtt1078_aio_t aio;
+
+    if (!encoders || !buf) {
+        return 1;
+    }
+    if (mode > 0 && jtt1078_aio_init(&aio, o->streams, 5000, mode == 1 ? JTT1078_AIO_FORCE_EPOLL : 0) < 0) {
+        fprintf(stderr, "[BENCH] jtt1078_aio_init failed\n");
+        return 1;
+    }
+    if (mode == 2 && aio.backend != JTT1078_AIO_URING) {
+        fprintf(stderr, "[BENCH] io_uring unavailable on this kernel, skipped\n");
+        jtt1078_aio_deinit(&aio);
+        free(encoders);
+        free(buf);
+        return 0;
+    }
+
+    memset(sinks, 0, sizeof(sinks));
+    for (int i = 0; i < o->streams; i++) {
+        sinks[i].check = true;
+        // 阻塞socket; jtt1078_aio_add 自行改为非阻塞
+        conns[i] = (sock_conn_t){
+            .fd = loopback_open(&sinks[i].listen_fd, fanout_sink_thread, &sinks[i], NULL, &tids[i]),
+            .timeout_ms = -1,
+        };
+        if (conns[i].fd < 0) {
+            return 1;
+        }
+        if (mode == 0) {
+            jtt1078_encoder_init_iov(&encoders[i], "013800138000", (uint8_t)(i + 1), JTT1078_VIDEO_H264,
+                                     sock_sendv_cb, &conns[i]);
+        } else {
+            streams[i] = jtt1078_aio_add(&aio, conns[i].fd, 0);
+            jtt1078_encoder_init_iov(&encoders[i], "013800138000", (uint8_t)(i + 1), JTT1078_VIDEO_H264,
+                                     jtt1078_aio_sendv, streams[i]);
+        }
+        jtt1078_encoder_set_timestamp_mode(&encoders[i], JTT1078_TS_PTS);
+        jtt1078_encoder_enable_batch(&encoders[i], o->i_size);
+    }
+
+    // 每轮各流编码一帧(同一内容), 然后运行一次循环; 待发送积压超过 1MB 时等待
+    uint64_t rejected = 0;
+    uint64_t cpu_start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t start = now_ns(CLOCK_MONOTONIC);
+    for (uint32_t n = 0; n < o->frames; n++) {
+        bool key = n % o->gop == 0;
+        video_frame_t frame = {
+            .data = buf,
+            .size = key ? o->i_size : o->p_size,
+            .frame_type = key ? JTT1078_DATA_TYPE_VIDEO : JTT1078_DATA_TYPE_VIDEO_P,
+            .pts = (uint64_t)n * 40,
+            .is_keyframe = key,
+        };
+        fill_pattern(buf, frame.size, n);
+        for (int i = 0; i < o->streams; i++) {
+            if (jtt1078_encode_video_frame(&encoders[i], &frame) < 0) {
+                rejected++;
+            }
+        }
+        if (mode == 0) {
+            continue;
+        }
+        jtt1078_aio_run(&aio, 0);
+        for (int i = 0; i < o->streams; i++) {
+            while (JTT1078_STAT_LOAD(streams[i]->stats.backlog) > 1024 * 1024 &&
+                   !streams[i]->stats.failed) {
+                jtt1078_aio_run(&aio, 100);
+            }
+        }
+    }
+    if (mode > 0 && jtt1078_aio_flush(&aio, 10000) != 0) {
+        fprintf(stderr, "[BENCH] AIO flush timed out\n");
+    }
+    uint64_t cpu_ns = now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    double elapsed = (now_ns(CLOCK_MONOTONIC) - start) / 1e9;
+
+    jtt1078_aio_stats_t as = { 0 };
+    uint64_t syscalls = 0, failed = 0;
+    if (mode > 0) {
+        jtt1078_aio_get_stats(&aio, &as);
+        syscalls = as.syscalls;
+        for (int i = 0; i < o->streams; i++) {
+            failed += streams[i]->stats.failed;
+        }
+        jtt1078_aio_deinit(&aio);
+    } else {
+        for (int i = 0; i < o->streams; i++) {
+            syscalls += conns[i].calls;
+        }
+    }
+
+    uint64_t min_frames = UINT64_MAX, corrupt = 0, bytes = 0;
+    for (int i = 0; i < o->streams; i++) {
+        jtt1078_encoder_deinit(&encoders[i]);
+        fanout_sink_close(conns[i].fd, &sinks[i], tids[i]);
+        jtt1078_depack_deinit(&sinks[i].depack);
+        if (sinks[i].chk.frames < min_frames) {
+            min_frames = sinks[i].chk.frames;
+        }
+        corrupt += sinks[i].chk.corrupt;
+        bytes += sinks[i].chk.bytes;
+    }
+    free(encoders);
+    free(buf);
+
+    uint64_t total_frames = (uint64_t)o->frames * o->streams;
+    bool ok = min_frames == o->frames && corrupt == 0 && rejected == 0 && failed == 0;
+    if (!ok) {
+        fprintf(stderr, "[BENCH] AIO check failed: received=%llu/%u corrupt=%llu rejected=%llu failed=%llu\n",
+                (unsigned long long)min_frames, o->frames, (unsigned long long)corrupt,
+                (unsigned long long)rejected, (unsigned long long)failed);
+    }
+    fprintf(g_out,
+            "{\"bench\":\"aio\",\"backend\":\"%s\",\"streams\":%d,\"frames\":%u,\"mb\":%.1f,"
+            "\"seconds\":%.3f,\"mb_per_s\":%.1f,\"cpu_us_per_frame\":%.2f,\"syscalls_per_frame\":%.2f,"
+            "\"rounds\":%llu,\"submitted\":%llu,\"completions\":%llu,\"max_batch\":%u,"
+            "\"frames_received\":%llu,\"corrupt\":%llu,\"ok\":%s}\n",
+            names[mode], o->streams, o->frames, bytes / 1e6, elapsed,
+            elapsed > 0 ? bytes / 1e6 / elapsed : 0.0, cpu_ns / 1e3 / total_frames,
+            (double)syscalls / total_frames, (unsigned long long)as.rounds,
+            (unsigned long long)as.submitted, (unsigned long long)as.completions, as.max_batch,
+            (unsigned long long)min_frames, (unsigned long long)corrupt, ok ? "true" : "false");
+    fflush(g_out);
+    return ok ? 0 : 1;
+}
+
+static int bench_aio(int argc, char **argv) {
+    aio_opts_t o = { .streams = 16, .frames = 500, .gop = 25, .i_size = 64 * 1024, .p_size = 8 * 1024 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:g:i:p:")) != -1) {
+        switch (opt) {
+        case 'n': o.streams = atoi(optarg); break;
+        case 'f': o.frames = (uint32_t)atoi(optarg); break;
+        case 'g': o.gop = (uint32_t)atoi(optarg); break;
+        case 'i': o.i_size = (uint32_t)atoi(optarg); break;
+        case 'p': o.p_size = (uint32_t)atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench aio [-n streams] [-f frames] [-g gop] "
+                            "[-i i_bytes] [-p p_bytes]\n");
+            return 1;
+        }
+    }
+    if (o.streams < 1 || o.streams > AIO_BENCH_MAX_STREAMS || o.frames == 0 || o.gop == 0 ||
+        o.p_size == 0 || o.i_size < o.p_size || o.i_size > 1024 * 1024) {
+        fprintf(stderr, "[BENCH] Invalid aio options\n");
+        return 1;
+    }
+
+    int ret = 0;
+    for (int mode = 0; mode < 3; mode++) {
+        ret |= run_aio(mode, &o);
+    }
+    return ret;
+}
+
+/*
+ * concurrent: 音频线程与视频线程共用一个编码器
+ */
+
+typedef struct {
+    uint32_t frames;            // 视频帧数
+    uint32_t gop;
+    uint32_t i_size;
+    uint32_t p_size;
+    uint32_t delay_us;          // 每次回调的模拟发送耗时
+    bool     per_packet;
+} conc_opts_t;
+
+// 回调中逐包检查线上顺序; 编码器保证回调不并发, 检查器本身不加锁
+typedef struct {
+    uint32_t inside;            // 回调重入检测(原子)
+    uint64_t overlaps;
+    uint32_t delay_us;
+    uint64_t packets;
+    uint64_t frames[2];         // 视频/音频完整帧数
+    bool     have_seq;
+    uint16_t next_seq;
+    uint64_t seq_errors;        // 包序号不是逐包加1
+    int      open_type;         // 未结束的分包帧的数据类型, -1为无
+    uint64_t frame_ts;          // 未结束的分包帧的时间戳
+    uint64_t interleaved;       // 分包帧中间插入了其他帧
+    bool     have_ts[2];
+    uint64_t last_ts[2];
+    uint64_t ts_errors;         // 时间戳回退、帧内不一致或间隔字段错误
+} conc_check_t;
+
+static void conc_check_packet(conc_check_t *c, const uint8_t *hdr) {
+    jtt1078_header_t h;
+    if (jtt1078_parse_header(hdr, JTT1078_HEADER_SIZE, &h) < 0) {
+        c->seq_errors++;
+        return;
+    }
+    c->packets++;
+    if (c->have_seq && h.packet_seq != c->next_seq) {
+        c->seq_errors++;
+    }
+    c->have_seq = true;
+    c->next_seq = (uint16_t)(h.packet_seq + 1);
+
+    // 分包帧必须连续: 第一包/原子包之前不能有未结束的帧, 中间包/最后一包属于同一帧
+    bool starts = h.subpackage == JTT1078_PKT_ATOMIC || h.subpackage == JTT1078_PKT_FIRST;
+    if (starts == (c->open_type >= 0) || (!starts && (h.data_type != c->open_type ||
+                                                      h.timestamp != c->frame_ts))) {
+        c->interleaved++;
+    }
+    if (h.subpackage == JTT1078_PKT_FIRST) {
+        c->open_type = h.data_type;
+        c->frame_ts = h.timestamp;
+    } else if (h.subpackage == JTT1078_PKT_ATOMIC || h.subpackage == JTT1078_PKT_LAST) {
+        c->open_type = -1;
+    }
+    if (!starts) {
+        return;
+    }
+
+    // 每帧第一包: 各媒体时间戳单调, 视频帧间隔40ms, 音频间隔字段为0且按20ms对齐
+    int media = h.data_type == JTT1078_DATA_TYPE_AUDIO;
+    if (c->have_ts[media] && h.timestamp < c->last_ts[media]) {
+        c->ts_errors++;
+    }
+    if (media ? (h.last_frame_interval != 0 || h.last_i_frame_interval != 0 || h.timestamp % 20 != 0)
+              : (c->have_ts[0] && h.last_frame_interval != 40)) {
+        c->ts_errors++;
+    }
+    c->have_ts[media] = true;
+    c->last_ts[media] = h.timestamp;
+    c->frames[media]++;
+}
+
+static int conc_sendv_cb(const struct iovec *iov, int iovcnt, void *user_data) {
+    conc_check_t *c = (conc_check_t *)user_data;
+
+    if (__atomic_exchange_n(&c->inside, 1, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&c->overlaps, 1, __ATOMIC_RELAXED);
+    }
+    // 编码器以 {包头, 负载} 成对回调
+    for (int i = 0; i < iovcnt; i += 2) {
+        conc_check_packet(c, iov[i].iov_base);
+    }
+    if (c->delay_us) {
+        uint64_t end = now_ns(CLOCK_MONOTONIC) + c->delay_us * 1000ULL;
+        while (now_ns(CLOCK_MONOTONIC) < end) {
+        }
+    }
+    __atomic_store_n(&c->inside, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+typedef struct {
+    jtt1078_encoder_t *encoder;
+    const conc_opts_t *o;
+    pthread_mutex_t *lock;      // 基线: 每次编码调用持有的全局锁, NULL为不加锁
+    pthread_barrier_t *start;
+    uint32_t frames;
+    uint32_t *call_us;          // 每次调用耗时(音频线程)
+    uint64_t failures;
+} conc_worker_t;
+
+static void *conc_video_thread(void *arg) {
+    conc_worker_t *w = (conc_worker_t *)arg;
+    uint8_t *buf = malloc(w->o->i_size);
+
+    if (buf) {
+        memset(buf, 0x5A, w->o->i_size);
+    }
+    pthread_barrier_wait(w->start);
+    for (uint32_t n = 0; buf && n < w->frames; n++) {
+        bool key = n % w->o->gop == 0;
+        video_frame_t frame = {
+            .data = buf,
+            .size = key ? w->o->i_size : w->o->p_size,
+            .frame_type = key ? JTT1078_DATA_TYPE_VIDEO : JTT1078_DATA_TYPE_VIDEO_P,
+            .pts = (uint64_t)n * 40,
+            .is_keyframe = key,
+        };
+        if (w->lock) {
+            pthread_mutex_lock(w->lock);
+        }
+        int ret = jtt1078_encode_video_frame(w->encoder, &frame);
+        if (w->lock) {
+            pthread_mutex_unlock(w->lock);
+        }
+        if (ret <= 0) {
+            w->failures++;
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+static void *conc_audio_thread(void *arg) {
+    conc_worker_t *w = (conc_worker_t *)arg;
+    uint8_t g711[160];              // 20ms G.711A
+
+    memset(g711, 0xD5, sizeof(g711));
+    pthread_barrier_wait(w->start);
+    for (uint32_t n = 0; n < w->frames; n++) {
+        audio_frame_t frame = { .data = g711, .size = sizeof(g711), .pts = (uint64_t)n * 20 };
+        uint64_t t0 = now_ns(CLOCK_MONOTONIC);
+        if (w->lock) {
+            pthread_mutex_lock(w->lock);
+        }
+        int ret = jtt1078_encode_audio_frame(w->encoder, &frame);
+        if (w->lock) {
+            pthread_mutex_unlock(w->lock);
+        }
+        w->call_us[n] = (uint32_t)((now_ns(CLOCK_MONOTONIC) - t0) / 1000);
+        if (ret <= 0) {
+            w->failures++;
+        }
+    }
+    return NULL;
+}
+
+// locked: 基线, 两个线程的每次编码调用都持有同一把锁(调用方加锁的常见做法)
+static int run_concurrent(bool locked, const conc_opts_t *o) {
+    jtt1078_encoder_t encoder;
+    conc_check_t chk = { .delay_us = o->delay_us, .open_type = -1 };
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_barrier_t start;
+    uint32_t audio_frames = o->frames * 2;
+    uint32_t *call_us = calloc(audio_frames, sizeof(uint32_t));
+
+    if (!call_us) {
+        return 1;
+    }
+    jtt1078_encoder_init_iov(&encoder, "013800138000", 1, JTT1078_VIDEO_H264, conc_sendv_cb, &chk);
+    jtt1078_encoder_set_timestamp_mode(&encoder, JTT1078_TS_PTS);
+    if (!o->per_packet) {
+        jtt1078_encoder_enable_batch(&encoder, o->i_size);
+    }
+
+    conc_worker_t video = { .encoder = &encoder, .o = o, .lock = locked ? &lock : NULL,
+                            .start = &start, .frames = o->frames };
+    conc_worker_t audio = video;
+    audio.frames = audio_frames;
+    audio.call_us = call_us;
+
+    pthread_t vt, at;
+    pthread_barrier_init(&start, NULL, 3);
+    pthread_create(&vt, NULL, conc_video_thread, &video);
+    pthread_create(&at, NULL, conc_audio_thread, &audio);
+    pthread_barrier_wait(&start);
+    uint64_t t0 = now_ns(CLOCK_MONOTONIC);
+    pthread_join(vt, NULL);
+    pthread_join(at, NULL);
+    double elapsed = (now_ns(CLOCK_MONOTONIC) - t0) / 1e9;
+    pthread_barrier_destroy(&start);
+
+    jtt1078_encoder_stats_t st;
+    jtt1078_encoder_get_stats(&encoder, &st);
+    jtt1078_encoder_deinit(&encoder);
+
+    qsort(call_us, audio_frames, sizeof(uint32_t), cmp_u32);
+    uint32_t p50 = percentile(call_us, audio_frames, 0.50);
+    uint32_t p99 = percentile(call_us, audio_frames, 0.99);
+    uint32_t max = call_us[audio_frames - 1];
+    free(call_us);
+
+    bool ok = chk.frames[0] == o->frames && chk.frames[1] == audio_frames && chk.seq_errors == 0 &&
+              chk.interleaved == 0 && chk.overlaps == 0 && chk.ts_errors == 0 &&
+              video.failures == 0 && audio.failures == 0;
+    if (!ok) {
+        fprintf(stderr, "[BENCH] Concurrent check failed: video=%llu/%u audio=%llu/%u seq_errors=%llu "
+                        "interleaved=%llu overlaps=%llu ts_errors=%llu\n",
+                (unsigned long long)chk.frames[0], o->frames, (unsigned long long)chk.frames[1],
+                audio_frames, (unsigned long long)chk.seq_errors, (unsigned long long)chk.interleaved,
+                (unsigned long long)chk.overlaps, (unsigned long long)chk.ts_errors);
+    }
+    fprintf(g_out,
+            "{\"bench\":\"concurrent\",\"mode\":\"%s\",\"send\":\"%s\",\"delay_us\":%u,"
+            "\"video_frames\":%llu,\"audio_frames\":%llu,\"packets\":%llu,\"seconds\":%.3f,"
+            "\"packets_per_s\":%.0f,\"order_waits\":%llu,\"audio_call_us_p50\":%u,"
+            "\"audio_call_us_p99\":%u,\"audio_call_us_max\":%u,\"seq_errors\":%llu,"
+            "\"interleaved\":%llu,\"overlaps\":%llu,\"ts_errors\":%llu,\"ok\":%s}\n",
+            locked ? "global_lock" : "ordered", o->per_packet ? "packet" : "batch", o->delay_us,
+            (unsigned long long)chk.frames[0], (unsigned long long)chk.frames[1],
+            (unsigned long long)chk.packets, elapsed, elapsed > 0 ? chk.packets / elapsed : 0.0,
+            (unsigned long long)st.order_waits, p50, p99, max, (unsigned long long)chk.seq_errors,
+            (unsigned long long)chk.interleaved, (unsigned long long)chk.overlaps,
+            (unsigned long long)chk.ts_errors, ok ? "true" : "false");
+    fflush(g_out);
+    return ok ? 0 : 1;
+}
+
+static int bench_concurrent(int argc, char **argv) {
+    conc_opts_t o = { .frames = 50000, .gop = 25, .i_size = 64 * 1024, .p_size = 8 * 1024 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:g:i:p:d:P")) != -1) {
+        switch (opt) {
+        case 'f': o.frames = (uint32_t)atoi(optarg); break;
+        case 'g': o.gop = (uint32_t)atoi(optarg); break;
+        case 'i': o.i_size = (uint32_t)atoi(optarg); break;
+        case 'p': o.p_size = (uint32_t)atoi(optarg); break;
+        case 'd': o.delay_us = (uint32_t)atoi(optarg); break;
+        case 'P': o.per_packet = true; break;
+        default:
+            fprintf(stderr, "Usage: jtt1078_bench concurrent [-f frames] [-g gop] [-i i_bytes] "
+                            "[-p p_bytes] [-d delay_us] [-P]\n");
+            return 1;
+        }
+    }
+    if (o.frames == 0 || o.gop == 0 || o.p_size == 0 || o.i_size < o.p_size ||
+        o.i_size > 4 * 1024 * 1024) {
+        fprintf(stderr, "[BENCH] Invalid concurrent options\n");
+        return 1;
+    }
+
+    return run_concurrent(false, &o) | run_concurrent(true, &o);
+}
+
+/*
+ * sendq: 发送队列丢帧策略
+ */
+
+// H.265 分包输出的一个GOP开头: 参数集各自成包, 然后是IDR; 其余为P帧
+static const uint8_t sendq_vps[] = { 0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0C };
+static const uint8_t sendq_sps[] = { 0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01 };
+static const uint8_t sendq_pps[] = { 0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xC1 };
+static const uint8_t sendq_idr[] = { 0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xAF };
+static const uint8_t sendq_p[]   = { 0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0xD0 };
+
+// 与 rkipc 相同按码流判断帧类型后入队
+static int sendq_push_pack(jtt1078_sendq_t *q, const uint8_t *pack, uint32_t size) {
+    video_frame_t frame = { .data = (uint8_t *)pack, .size = size };
+    int type = jtt1078_nal_frame_type(pack, size, JTT1078_VIDEO_H265, &frame.is_keyframe);
+    frame.frame_type = type < 0 ? JTT1078_DATA_TYPE_VIDEO_P : (uint8_t)type;
+    return jtt1078_sendq_push(q, &frame);
+}
+
+// 队列已有 queued 个P帧(busy 时队首正在发送), 依次入队 VPS/SPS/PPS/IDR,
+// 检查出队顺序: 正在发送的队首, 然后是完整的 VPS, SPS, PPS, IDR
+static bool run_sendq_param_sets(uint32_t capacity, uint32_t queued, bool busy) {
+    static const struct { const uint8_t *data; uint32_t size; } gop[] = {
+        { sendq_vps, sizeof(sendq_vps) }, { sendq_sps, sizeof(sendq_sps) },
+        { sendq_pps, sizeof(sendq_pps) }, { sendq_idr, sizeof(sendq_idr) },
+    };
+    jtt1078_sendq_t q;
+    video_frame_t out;
+    bool ok = true;
+    uint32_t expect = 0, got = 0;
+
+    if (jtt1078_sendq_init(&q, capacity) < 0) {
+        return false;
+    }
+    // 队首移到槽位数组末尾附近, 后续入队环绕
+    for (uint32_t i = 0; i + 2 < capacity; i++) {
+        sendq_push_pack(&q, sendq_p, sizeof(sendq_p));
+        jtt1078_sendq_peek(&q, &out, 0);
+        jtt1078_sendq_release(&q);
+    }
+    for (uint32_t i = 0; i < queued; i++) {
+        sendq_push_pack(&q, sendq_p, sizeof(sendq_p));
+    }
+    if (busy && jtt1078_sendq_peek(&q, &out, 0) != 0) {
+        ok = false;
+    }
+    for (size_t i = 0; i < sizeof(gop) / sizeof(gop[0]); i++) {
+        ok = ok && sendq_push_pack(&q, gop[i].data, gop[i].size) == 0;
+    }
+
+    if (busy) {
+        jtt1078_sendq_release(&q);
+    }
+    while (jtt1078_sendq_peek(&q, &out, 0) == 0) {
+        if (expect < sizeof(gop) / sizeof(gop[0]) && out.size == gop[expect].size &&
+            memcmp(out.data, gop[expect].data, out.size) == 0) {
+            expect++;
+        } else {
+            ok = false;
+        }
+        got++;
+        jtt1078_sendq_release(&q);
+    }
+    ok = ok && expect == sizeof(gop) / sizeof(gop[0]);
+
+    jtt1078_sendq_stats_t st;
+    jtt1078_sendq_get_stats(&q, &st);
+    fprintf(g_out,
+            "{\"bench\":\"sendq\",\"test\":\"param_sets_on_full\",\"capacity\":%u,\"queued_p\":%u,"
+            "\"head_busy\":%s,\"frames_after_head\":%u,\"gop_in_order\":%u,\"dropped\":%llu,\"ok\":%s}\n",
+            capacity, queued, busy ? "true" : "false", got, expect,
+            (unsigned long long)st.dropped_frames, ok ? "true" : "false");
+    fflush(g_out);
+    jtt1078_sendq_destroy(&q);
+    return ok;
+}
+
+static int bench_sendq(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    // 队列在 VPS 入队后恰好满: SPS/PPS/IDR 入队时不得挤掉已排队的参数集;
+    // 起始位置不同, 覆盖槽位环绕
+    bool ok = true;
+    for (uint32_t cap = 5; cap <= 8; cap++) {
+        ok &= run_sendq_param_sets(cap, cap - 1, false);
+        ok &= run_sendq_param_sets(cap, cap - 1, true);
+        ok &= run_sendq_param_sets(cap, cap, true);
+    }
+    return ok ? 0 : 1;
+}
+
+typedef struct {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+} bench_cmd_t;
+
+static const bench_cmd_t g_cmds[] = {
+    { "sweep", bench_sweep, "payload size sweep over loopback TCP" },
+    { "depack", bench_depack, "receive-side parse throughput and loopback round trip" },
+    { "nal",   bench_nal,   "Annex-B start code scanner vs byte loop" },
+    { "packetize", bench_packetize, "encode/create/send packetizer microbenchmarks" },
+    { "latency", bench_latency, "end-to-end frame latency, TCP vs UDP over loopback" },
+    { "fec",     bench_fec,     "FEC region multiply, parity generation and recovery" },
+    { "audio",   bench_audio,   "G.711 encode throughput and audio aggregation" },
+    { "rate",    bench_rate,    "send-queue-aware bitrate adaptation vs static bitrate" },
+    { "pace",    bench_pace,    "keyframe burst pacing: userspace token bucket vs SO_MAX_PACING_RATE" },
+    { "playback", bench_playback, "SD recording playback upload: frame walk, keyframe-only, speed" },
+    { "fanout",  bench_fanout,  "packetize-once fan-out vs one encoder per server, stalled server" },
+    { "zerocopy", bench_zerocopy, "MSG_ZEROCOPY vs copying send: CPU per MB, completion and buffer hold" },
+    { "aio",     bench_aio,     "one io_uring/epoll loop for many encoders vs blocking send: syscalls per frame" },
+    { "concurrent", bench_concurrent, "audio and video threads on one encoder: wire order checks, audio call latency" },
+    { "sendq",   bench_sendq,   "send queue drop policy: VPS/SPS/PPS/IDR pushed onto a full queue" },
+};
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <command> [options]\n", argv[0]);
+        for (size_t i = 0; i < sizeof(g_cmds) / sizeof(g_cmds[0]); i++) {
+            fprintf(stderr, "  %-10s %s\n", g_cmds[i].name, g_cmds[i].help);
+        }
+        return 1;
+    }
+
+    // 结果写入原标准输出, 库内调试打印丢弃
+    g_out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!g_out || !freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(g_cmds) / sizeof(g_cmds[0]); i++) {
+        if (strcmp(argv[1], g_cmds[i].name) == 0) {
+            return g_cmds[i].run(argc - 1, argv + 1);
+        }
+    }
+
+    fprintf(stderr, "Unknown command: %s\n", argv[1]);
+    return 1;
+}
@@ -0,0 +1,682 @@
+/*
+ * JT/T 1078 Ingest Server
+ * 多终端接入服务器: 边沿触发 epoll, 每连接环形接收缓冲区 + jtt1078_depack 重组
+ *
+ * Usage:
+ *   jtt1078_ingest [-p port] [-w workers] [-i interval_s] [-d dump_dir] [-r ring_kb] [-u]
+ *       -p  监听端口(默认 6605)
+ *       -w  工作线程数, 每个线程独立的 epoll 和 SO_REUSEPORT 监听socket(默认 1)
+ *       -i  统计输出间隔(秒, 默认 1)
+ *       -d  按 SIM/通道把重组后的帧写入 <dump_dir>/<sim>_ch<n>.<h264|h265|audio|bin>
+ *       -r  每连接环形缓冲区大小(KB, 默认 64)
+ *       -u  同时在同一端口接收UDP: recvmmsg 批量收取数据报, 按源地址区分终端,
+ *           每个数据报必须恰好是一个完整分包(否则计入 bad_datagrams 并丢弃);
+ *           终端发来FEC校验包后改经 jtt1078_fec_decoder 按序交付, 恢复丢失的分包
+ *           (fec_recovered / fec_lost)
+ *
+ * 统计以 JSON Lines 输出到标准输出: 连接数, packets/s, bytes/s, frames/s,
+ * 以及累计的序号间隔/估算丢包/重新同步次数。
+ * UDP 终端不会断开, 在服务器退出前一直保留(udp_peers)。
+ */
+
+#define _GNU_SOURCE
+#include "jtt1078_protocol.h"
+#include "jtt1078_depack.h"
+#include "jtt1078_fec.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INGEST_MAX_EVENTS       256
+#define INGEST_MAX_WORKERS      64
+#define INGEST_DUMP_FILES       (JTT1078_DEPACK_MAX_CHANNELS * JTT1078_DEPACK_STREAMS)
+#define INGEST_UDP_BATCH        64          // 每次 recvmmsg 的数据报数
+#define INGEST_UDP_BUCKETS      4096        // UDP 终端哈希表桶数(2的幂)
+
+static volatile sig_atomic_t g_running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+/*
+ * 环形接收缓冲区(容量为2的幂, 读写位置单调递增)
+ */
+
+typedef struct {
+    uint8_t *data;
+    uint32_t mask;
+    uint32_t head;      // 读位置
+    uint32_t tail;      // 写位置
+} ring_t;
+
+static int ring_init(ring_t *r, uint32_t capacity) {
+    uint32_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    r->data = malloc(cap);
+    if (!r->data) {
+        return -1;
+    }
+    r->mask = cap - 1;
+    r->head = r->tail = 0;
+    return 0;
+}
+
+static inline uint32_t ring_used(const ring_t *r) {
+    return r->tail - r->head;
+}
+
+static inline uint32_t ring_free(const ring_t *r) {
+    return r->mask + 1 - ring_used(r);
+}
+
+// 空闲区域(最多两段)
+static int ring_write_iov(const ring_t *r, struct iovec iov[2]) {
+    uint32_t free_bytes = ring_free(r);
+    uint32_t pos = r->tail & r->mask;
+    uint32_t first = r->mask + 1 - pos;
+
+    if (first >= free_bytes) {
+        iov[0].iov_base = r->data + pos;
+        iov[0].iov_len = free_bytes;
+        return 1;
+    }
+    iov[0].iov_base = r->data + pos;
+    iov[0].iov_len = first;
+    iov[1].iov_base = r->data;
+    iov[1].iov_len = free_bytes - first;
+    return 2;
+}
+
+/*
+ * 连接与工作线程
+ */
+
+typedef struct worker worker_t;
+
+typedef struct conn conn_t;
+
+struct conn {
+    int fd;                             // UDP 终端为 -1
+    worker_t *worker;
+    ring_t ring;
+    jtt1078_depack_t depack;
+    uint64_t gaps;                      // 已计入工作线程统计的间隔/丢包
+    uint64_t lost;
+    FILE *dump[INGEST_DUMP_FILES];      // 按 通道索引*流 打开的转储文件
+    struct sockaddr_in peer;            // UDP 终端源地址
+    jtt1078_fec_decoder_t *fec;         // UDP 终端收到校验包后创建
+    conn_t *next;                       // UDP 终端哈希链
+};
+
+typedef struct {
+    uint64_t connections;               // 当前连接数
+    uint64_t accepted;
+    uint64_t bytes;
+    uint64_t packets;
+    uint64_t frames;
+    uint64_t seq_gaps;
+    uint64_t packets_lost;
+    uint64_t resyncs;
+    uint64_t udp_peers;
+    uint64_t datagrams;
+    uint64_t bad_datagrams;
+    uint64_t fec_recovered;
+    uint64_t fec_lost;
+} ingest_stats_t;
+
+struct worker {
+    pthread_t thread;
+    int epfd;
+    int listen_fd;
+    int udp_fd;                         // -1 表示未启用UDP
+    conn_t **peers;                     // UDP 终端哈希表
+    uint8_t *udp_buf;                   // recvmmsg 接收区
+    ingest_stats_t stats;               // 本线程写, 统计线程以 relaxed 原子读
+};
+
+static const char *g_dump_dir;
+static uint32_t g_ring_size = 64 * 1024;
+
+#define STAT_ADD(w, field, n) __atomic_fetch_add(&(w)->stats.field, (n), __ATOMIC_RELAXED)
+
+static int listen_socket(int type, uint16_t port, bool reuseport) {
+    int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[INGEST] socket");
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reuseport) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (type == SOCK_DGRAM) {
+        // 关键帧突发约数百个数据报, 接收缓冲区过小会在内核丢包
+        int rcvbuf = 4 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (type == SOCK_STREAM && listen(fd, 4096) < 0)) {
+        perror("[INGEST] bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 转储文件: <dir>/<sim>_ch<n>.<ext>
+static FILE *dump_file(conn_t *c, const jtt1078_header_t *h) {
+    int ch_index = -1;
+    for (int i = 0; i < c->depack.nchannels; i++) {
+        if (c->depack.channels[i].stats.channel == h->channel) {
+            ch_index = i;
+            break;
+        }
+    }
+    if (ch_index < 0) {
+        return NULL;
+    }
+
+    int stream;
+    const char *ext;
+    if (h->data_type <= JTT1078_DATA_TYPE_VIDEO_B) {
+        stream = JTT1078_DEPACK_STREAM_VIDEO;
+        ext = h->pt == 98 ? "h265" : "h264";
+    } else if (h->data_type == JTT1078_DATA_TYPE_AUDIO) {
+        stream = JTT1078_DEPACK_STREAM_AUDIO;
+        ext = "audio";
+    } else {
+        stream = JTT1078_DEPACK_STREAM_TRANS;
+        ext = "bin";
+    }
+
+    FILE **fp = &c->dump[ch_index * JTT1078_DEPACK_STREAMS + stream];
+    if (!*fp) {
+        char sim[13];
+        for (int i = 0; i < 6; i++) {
+            sim[i * 2] = '0' + (h->sim[i] >> 4);
+            sim[i * 2 + 1] = '0' + (h->sim[i] & 0x0F);
+        }
+        sim[12] = '\0';
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s_ch%u.%s", g_dump_dir, sim, h->channel, ext);
+        *fp = fopen(path, "ab");
+        if (!*fp) {
+            fprintf(stderr, "[INGEST] Failed to open %s: %s\n", path, strerror(errno));
+        }
+    }
+    return *fp;
+}
+
+static void on_frame(const jtt1078_frame_t *frame, void *user_data) {
+    conn_t *c = (conn_t *)user_data;
+
+    if (g_dump_dir) {
+        FILE *fp = dump_file(c, &frame->header);
+        if (fp) {
+            fwrite(frame->data, 1, frame->size, fp);
+        }
+    }
+}
+
+static void conn_close(conn_t *c) {
+    worker_t *w = c->worker;
+
+    epoll_ctl(w->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    for (int i = 0; i < INGEST_DUMP_FILES; i++) {
+        if (c->dump[i]) fclose(c->dump[i]);
+    }
+    jtt1078_depack_deinit(&c->depack);
+    free(c->ring.data);
+    free(c);
+    STAT_ADD(w, connections, (uint64_t)-1);
+}
+
+// 把解析器统计的增量计入工作线程
+static void conn_account(conn_t *c, uint64_t packets, uint64_t resyncs) {
+    worker_t *w = c->worker;
+
+    STAT_ADD(w, packets, c->depack.stats.packets - packets);
+    STAT_ADD(w, resyncs, c->depack.stats.resyncs - resyncs);
+
+    uint64_t gaps = 0, lost = 0;
+    for (int i = 0; i < c->depack.nchannels; i++) {
+        gaps += c->depack.channels[i].stats.seq_gaps;
+        lost += c->depack.channels[i].stats.packets_lost;
+    }
+    if (gaps != c->gaps) {
+        STAT_ADD(w, seq_gaps, gaps - c->gaps);
+        STAT_ADD(w, packets_lost, lost - c->lost);
+        c->gaps = gaps;
+        c->lost = lost;
+    }
+}
+
+// 解析环形缓冲区中的全部数据, 更新工作线程统计
+static void conn_parse(conn_t *c) {
+    worker_t *w = c->worker;
+    ring_t *r = &c->ring;
+    uint64_t packets = c->depack.stats.packets;
+    uint64_t resyncs = c->depack.stats.resyncs;
+
+    while (ring_used(r) > 0) {
+        uint32_t pos = r->head & r->mask;
+        uint32_t n = ring_used(r);
+        if (n > r->mask + 1 - pos) {
+            n = r->mask + 1 - pos;
+        }
+        int frames = jtt1078_depack_feed(&c->depack, r->data + pos, n);
+        r->head += n;
+        if (frames > 0) {
+            STAT_ADD(w, frames, (uint64_t)frames);
+        }
+    }
+
+    conn_account(c, packets, resyncs);
+}
+
+// 边沿触发: 读到 EAGAIN 为止, 缓冲区满时先解析再继续读
+static void conn_readable(conn_t *c) {
+    worker_t *w = c->worker;
+
+    for (;;) {
+        struct iovec iov[2];
+        int cnt = ring_write_iov(&c->ring, iov);
+        ssize_t n = readv(c->fd, iov, cnt);
+        int err = n < 0 ? errno : 0;        // 解析回调(-d 写文件)可能改写 errno
+
+        if (n > 0) {
+            c->ring.tail += (uint32_t)n;
+            STAT_ADD(w, bytes, (uint64_t)n);
+            if (ring_free(&c->ring) == 0) {
+                conn_parse(c);
+            }
+            continue;
+        }
+        if (err == EINTR) {
+            continue;
+        }
+
+        conn_parse(c);
+        if (err == EAGAIN || err == EWOULDBLOCK) {
+            return;
+        }
+        // 对端关闭或出错
+        conn_close(c);
+        return;
+    }
+}
+
+static void accept_all(worker_t *w) {
+    for (;;) {
+        int fd = accept4(w->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("[INGEST] accept");
+            }
+            return;
+        }
+
+        conn_t *c = calloc(1, sizeof(conn_t));
+        if (!c || ring_init(&c->ring, g_ring_size) < 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->worker = w;
+        jtt1078_depack_init(&c->depack, 0, on_frame, c);
+
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | EPOLLET, .data.ptr = c };
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("[INGEST] epoll_ctl");
+            jtt1078_depack_deinit(&c->depack);
+            free(c->ring.data);
+            free(c);
+            close(fd);
+            continue;
+        }
+        STAT_ADD(w, connections, 1);
+        STAT_ADD(w, accepted, 1);
+    }
+}
+
+/*
+ * UDP: 每个数据报一个分包, 按源地址找到终端的解析器
+ */
+
+static conn_t *udp_peer(worker_t *w, const struct sockaddr_in *addr) {
+    uint32_t h = (addr->sin_addr.s_addr * 2654435761u) ^ addr->sin_port;
+    conn_t **bucket = &w->peers[(h ^ (h >> 16)) & (INGEST_UDP_BUCKETS - 1)];
+
+    for (conn_t *c = *bucket; c; c = c->next) {
+        if (c->peer.sin_addr.s_addr == addr->sin_addr.s_addr && c->peer.sin_port == addr->sin_port) {
+            return c;
+        }
+    }
+
+    conn_t *c = calloc(1, sizeof(conn_t));
+    if (!c) {
+        return NULL;
+    }
+    c->fd = -1;
+    c->worker = w;
+    c->peer = *addr;
+    jtt1078_depack_init(&c->depack, 0, on_frame, c);
+    c->next = *bucket;
+    *bucket = c;
+    STAT_ADD(w, udp_peers, 1);
+    return c;
+}
+
+// 一个完整分包交给终端的解析器
+static void udp_deliver(const uint8_t *packet, uint32_t len, void *user_data) {
+    conn_t *c = (conn_t *)user_data;
+    worker_t *w = c->worker;
+
+    uint64_t packets = c->depack.stats.packets;
+    uint64_t resyncs = c->depack.stats.resyncs;
+    int frames = jtt1078_depack_feed(&c->depack, packet, len);
+    if (frames > 0) {
+        STAT_ADD(w, frames, (uint64_t)frames);
+    }
+    if (c->depack.hdr_len != 0 || c->depack.payload_left != 0) {
+        // 包头字段非法, 解析器停在包中间: 丢弃重组状态, 下一个数据报重新开始
+        STAT_ADD(w, bad_datagrams, 1);
+        jtt1078_depack_reset(&c->depack);
+    }
+    conn_account(c, packets, resyncs);
+}
+
+static void udp_datagram(worker_t *w, const struct sockaddr_in *addr, const uint8_t *data, uint32_t len) {
+    // 只接受恰好一个完整分包的数据报, 保证解析器始终停在包边界
+    jtt1078_header_t h;
+    if (jtt1078_parse_header(data, len, &h) < 0 || len != (uint32_t)JTT1078_HEADER_SIZE + h.data_length) {
+        STAT_ADD(w, bad_datagrams, 1);
+        return;
+    }
+
+    conn_t *c = udp_peer(w, addr);
+    if (!c) {
+        return;
+    }
+
+    // 收到校验包后, 该终端的分包经FEC解码器按序号重排并恢复丢包
+    if (!c->fec && h.pt == JTT1078_FEC_PT) {
+        c->fec = malloc(sizeof(jtt1078_fec_decoder_t));
+        if (c->fec && jtt1078_fec_decoder_init(c->fec, udp_deliver, c) < 0) {
+            free(c->fec);
+            c->fec = NULL;
+        }
+    }
+    if (!c->fec) {
+        udp_deliver(data, len, c);
+        return;
+    }
+
+    uint64_t recovered = c->fec->stats.recovered;
+    uint64_t lost = c->fec->stats.lost;
+    jtt1078_fec_decoder_feed(c->fec, data, len);
+    STAT_ADD(w, fec_recovered, c->fec->stats.recovered - recovered);
+    STAT_ADD(w, fec_lost, c->fec->stats.lost - lost);
+}
+
+// 边沿触发: recvmmsg 批量收取直到 EAGAIN
+static void udp_readable(worker_t *w) {
+    struct mmsghdr msgs[INGEST_UDP_BATCH];
+    struct iovec iov[INGEST_UDP_BATCH];
+    struct sockaddr_in addrs[INGEST_UDP_BATCH];
+
+    for (;;) {
+        for (int i = 0; i < INGEST_UDP_BATCH; i++) {
+            iov[i].iov_base = w->udp_buf + i * JTT1078_MAX_PACKET_SIZE;
+            iov[i].iov_len = JTT1078_MAX_PACKET_SIZE;
+            memset(&msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+
+        int n = recvmmsg(w->udp_fd, msgs, INGEST_UDP_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("[INGEST] recvmmsg");
+            }
+            return;
+        }
+
+        uint64_t bytes = 0;
+        for (int i = 0; i < n; i++) {
+            // 超过 JTT1078_MAX_PACKET_SIZE 的数据报被截断, 按非法数据报丢弃
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                STAT_ADD(w, bad_datagrams, 1);
+                continue;
+            }
+            bytes += msgs[i].msg_len;
+            udp_datagram(w, &addrs[i], iov[i].iov_base, msgs[i].msg_len);
+        }
+        STAT_ADD(w, datagrams, (uint64_t)n);
+        STAT_ADD(w, bytes, bytes);
+    }
+}
+
+static void udp_free_peers(worker_t *w) {
+    if (!w->peers) {
+        return;
+    }
+    for (int b = 0; b < INGEST_UDP_BUCKETS; b++) {
+        conn_t *c = w->peers[b];
+        while (c) {
+            conn_t *next = c->next;
+            for (int i = 0; i < INGEST_DUMP_FILES; i++) {
+                if (c->dump[i]) fclose(c->dump[i]);
+            }
+            if (c->fec) {
+                jtt1078_fec_decoder_deinit(c->fec);
+                free(c->fec);
+            }
+            jtt1078_depack_deinit(&c->depack);
+            free(c);
+            c = next;
+        }
+    }
+    free(w->peers);
+    free(w->udp_buf);
+}
+
+static void *worker_thread(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    struct epoll_event events[INGEST_MAX_EVENTS];
+
+    while (g_running) {
+        int n = epoll_wait(w->epfd, events, INGEST_MAX_EVENTS, 500);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                accept_all(w);
+            } else if (events[i].data.ptr == w) {
+                udp_readable(w);
+            } else {
+                conn_readable((conn_t *)events[i].data.ptr);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void sum_stats(worker_t *workers, int nworkers, ingest_stats_t *out) {
+    memset(out, 0, sizeof(ingest_stats_t));
+    for (int i = 0; i < nworkers; i++) {
+        ingest_stats_t *s = &workers[i].stats;
+        out->connections += __atomic_load_n(&s->connections, __ATOMIC_RELAXED);
+        out->accepted += __atomic_load_n(&s->accepted, __ATOMIC_RELAXED);
+        out->bytes += __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+        out->packets += __atomic_load_n(&s->packets, __ATOMIC_RELAXED);
+        out->frames += __atomic_load_n(&s->frames, __ATOMIC_RELAXED);
+        out->seq_gaps += __atomic_load_n(&s->seq_gaps, __ATOMIC_RELAXED);
+        out->packets_lost += __atomic_load_n(&s->packets_lost, __ATOMIC_RELAXED);
+        out->resyncs += __atomic_load_n(&s->resyncs, __ATOMIC_RELAXED);
+        out->udp_peers += __atomic_load_n(&s->udp_peers, __ATOMIC_RELAXED);
+        out->datagrams += __atomic_load_n(&s->datagrams, __ATOMIC_RELAXED);
+        out->bad_datagrams += __atomic_load_n(&s->bad_datagrams, __ATOMIC_RELAXED);
+        out->fec_recovered += __atomic_load_n(&s->fec_recovered, __ATOMIC_RELAXED);
+        out->fec_lost += __atomic_load_n(&s->fec_lost, __ATOMIC_RELAXED);
+    }
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 提高文件描述符上限到硬限制(数千连接 + 转储文件)
+static void raise_nofile(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint16_t port = 6605;
+    int nworkers = 1;
+    int interval = 1;
+    bool udp = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:w:i:d:r:u")) != -1) {
+        switch (opt) {
+        case 'p': port = (uint16_t)atoi(optarg); break;
+        case 'w': nworkers = atoi(optarg); break;
+        case 'i': interval = atoi(optarg); break;
+        case 'd': g_dump_dir = optarg; break;
+        case 'r': g_ring_size = (uint32_t)atoi(optarg) * 1024; break;
+        case 'u': udp = true; break;
+        default:
+            fprintf(stderr, "Usage: %s [-p port] [-w workers] [-i interval_s] [-d dump_dir] [-r ring_kb] [-u]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (nworkers < 1) nworkers = 1;
+    if (nworkers > INGEST_MAX_WORKERS) nworkers = INGEST_MAX_WORKERS;
+    if (interval < 1) interval = 1;
+    if (g_ring_size < 4096) g_ring_size = 4096;
+
+    if (g_dump_dir && mkdir(g_dump_dir, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "[INGEST] Cannot create %s: %s\n", g_dump_dir, strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    raise_nofile();
+
+    static worker_t workers[INGEST_MAX_WORKERS];
+    for (int i = 0; i < nworkers; i++) {
+        worker_t *w = &workers[i];
+        w->listen_fd = listen_socket(SOCK_STREAM, port, nworkers > 1);
+        w->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (w->listen_fd < 0 || w->epfd < 0) {
+            return 1;
+        }
+        // 监听socket以 data.ptr == NULL 区分, UDP socket 为 data.ptr == w
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLET, .data.ptr = NULL };
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->listen_fd, &ev);
+
+        w->udp_fd = -1;
+        if (udp) {
+            // SO_REUSEPORT 按源地址哈希, 同一终端的数据报总由同一线程处理
+            w->udp_fd = listen_socket(SOCK_DGRAM, port, nworkers > 1);
+            w->peers = calloc(INGEST_UDP_BUCKETS, sizeof(conn_t *));
+            w->udp_buf = malloc(INGEST_UDP_BATCH * JTT1078_MAX_PACKET_SIZE);
+            if (w->udp_fd < 0 || !w->peers || !w->udp_buf) {
+                return 1;
+            }
+            struct epoll_event uev = { .events = EPOLLIN | EPOLLET, .data.ptr = w };
+            epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->udp_fd, &uev);
+        }
+    }
+    for (int i = 0; i < nworkers; i++) {
+        pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]);
+    }
+
+    fprintf(stderr, "[INGEST] Listening on port %u (TCP%s), %d worker(s)%s%s\n", port,
+            udp ? "+UDP" : "", nworkers,
+            g_dump_dir ? ", dumping to " : "", g_dump_dir ? g_dump_dir : "");
+
+    ingest_stats_t prev, cur;
+    sum_stats(workers, nworkers, &prev);
+    uint64_t prev_ms = now_ms();
+
+    while (g_running) {
+        for (int i = 0; i < interval * 10 && g_running; i++) {
+            usleep(100000);
+        }
+
+        sum_stats(workers, nworkers, &cur);
+        uint64_t t = now_ms();
+        double dt = (t - prev_ms) / 1000.0;
+
+        printf("{\"connections\":%llu,\"accepted\":%llu,\"packets_per_s\":%.0f,\"bytes_per_s\":%.0f,"
+               "\"frames_per_s\":%.0f,\"seq_gaps\":%llu,\"packets_lost\":%llu,\"resyncs\":%llu,"
+               "\"udp_peers\":%llu,\"datagrams\":%llu,\"bad_datagrams\":%llu,"
+               "\"fec_recovered\":%llu,\"fec_lost\":%llu}\n",
+               (unsigned long long)cur.connections, (unsigned long long)cur.accepted,
+               (cur.packets - prev.packets) / dt, (cur.bytes - prev.bytes) / dt,
+               (cur.frames - prev.frames) / dt,
+               (unsigned long long)cur.seq_gaps, (unsigned long long)cur.packets_lost,
+               (unsigned long long)cur.resyncs,
+               (unsigned long long)cur.udp_peers, (unsigned long long)cur.datagrams,
+               (unsigned long long)cur.bad_datagrams,
+               (unsigned long long)cur.fec_recovered, (unsigned long long)cur.fec_lost);
+        fflush(stdout);
+
+        prev = cur;
+        prev_ms = t;
+    }
+
+    for (int i = 0; i < nworkers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        close(workers[i].listen_fd);
+        if (workers[i].udp_fd >= 0) {
+            close(workers[i].udp_fd);
+        }
+        udp_free_peers(&workers[i]);
+        close(workers[i].epfd);
+    }
+
+    fprintf(stderr, "[INGEST] Stopped\n");
+    return 0;
+}
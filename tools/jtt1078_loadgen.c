@@ -0,0 +1,778 @@
+/*
+ * JT/T 1078 Load Generator
+ * 虚拟终端压测工具: N 个终端各自持有 jtt1078_encoder_t(不同 SIM/通道),
+ * 由少量工作线程通过 epoll 复用, 不为每个终端创建线程
+ *
+ * Usage:
+ *   jtt1078_loadgen [-h host] [-p port] [-n terminals] [-C channels_per_sim] [-t threads]
+ *                   [-d seconds] [-b bitrate] [-r fps] [-g gop] [-k i_ratio]
+ *                   [-F file.h264|file.h265] [-m] [-P payload] [-S base_sim] [-q]
+ *       -n  虚拟终端(连接)数, 默认 10
+ *       -C  每个 SIM 的通道数, 终端 i 使用 SIM base+i/C, 通道 i%C+1(默认 1)
+ *       -t  工作线程数(默认 1)
+ *       -d  压测时长(秒, 默认 10)
+ *       -b/-r/-g/-k  合成码流: 码率(bps, 默认 2000000), 帧率(默认 25),
+ *                    GOP长度(默认 50), I帧与P帧大小之比(默认 8)
+ *       -F  回放 Annex-B 文件(按访问单元切帧, 扩展名决定 H.264/H.265), 替代合成码流
+ *       -m  最大速率: 不按帧率节流, socket 可写就继续发送
+ *       -P  分包负载大小(默认 JTT1078_MAX_PAYLOAD_SIZE)
+ *       -q  只输出汇总, 不输出每个终端
+ *
+ * 发送延迟 = 帧的计划发送时刻到该帧最后一个字节写入 socket 的时间,
+ * 实时模式下包含 epoll_wait 毫秒级超时带来的调度误差(<1ms)。
+ * 输出 JSON Lines: 每个终端一行(帧数/字节/吞吐/p50/p90/p99/最大延迟), 最后一行汇总。
+ */
+
+#define _GNU_SOURCE
+#include "jtt1078_protocol.h"
+#include "jtt1078_nal.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOADGEN_MAX_EVENTS      256
+#define LOADGEN_MAX_THREADS     64
+#define LOADGEN_MAX_BACKLOG     (8 * 1024 * 1024)   // 单终端待发送数据上限, 超出后丢帧
+#define LOADGEN_PENDING_FRAMES  256                 // 待确认发送完成的帧记录(2的幂)
+
+static volatile sig_atomic_t g_running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * 帧来源: 合成 GOP 或 Annex-B 文件
+ */
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t size;
+    bool key;
+} src_frame_t;
+
+typedef struct {
+    src_frame_t *frames;
+    uint32_t count;
+    uint8_t video_format;
+    uint8_t *storage;
+} frame_source_t;
+
+// 合成码流: 每个GOP一个I帧, 其余为P帧, 平均码率为 bitrate
+static int source_synthetic(frame_source_t *src, uint32_t bitrate, uint32_t fps,
+                            uint32_t gop, uint32_t i_ratio) {
+    uint64_t gop_bytes = (uint64_t)bitrate / 8 * gop / fps;
+    uint32_t p_size = (uint32_t)(gop_bytes / (i_ratio + gop - 1));
+    uint32_t i_size = p_size * i_ratio;
+    if (p_size < 16) p_size = 16;
+    if (i_size < 16) i_size = 16;
+
+    src->storage = malloc(i_size + p_size);
+    src->frames = calloc(gop, sizeof(src_frame_t));
+    if (!src->storage || !src->frames) {
+        return -1;
+    }
+
+    // Annex-B H.264: IDR(I slice) / 非IDR(P slice), 其余为不含起始码的填充
+    uint8_t *i_frame = src->storage;
+    uint8_t *p_frame = src->storage + i_size;
+    memset(i_frame, 0x5A, i_size);
+    memset(p_frame, 0xA5, p_size);
+    static const uint8_t idr_hdr[] = { 0x00, 0x00, 0x00, 0x01, 0x65, 0xB0 };
+    static const uint8_t p_hdr[] = { 0x00, 0x00, 0x00, 0x01, 0x41, 0xC0 };
+    memcpy(i_frame, idr_hdr, sizeof(idr_hdr));
+    memcpy(p_frame, p_hdr, sizeof(p_hdr));
+
+    for (uint32_t i = 0; i < gop; i++) {
+        src->frames[i].data = i == 0 ? i_frame : p_frame;
+        src->frames[i].size = i == 0 ? i_size : p_size;
+        src->frames[i].key = i == 0;
+    }
+    src->count = gop;
+    src->video_format = JTT1078_VIDEO_H264;
+    return 0;
+}
+
+// 是否为图像的第一个slice(新访问单元开始)
+static bool first_slice_in_picture(const uint8_t *nal, uint32_t size, uint8_t video_format) {
+    if (video_format == JTT1078_VIDEO_H265) {
+        return size > 2 && (nal[2] & 0x80);        // first_slice_segment_in_pic_flag
+    }
+    return size > 1 && (nal[1] & 0x80);            // first_mb_in_slice == 0
+}
+
+// 读取 Annex-B 文件并按访问单元切帧
+static int source_file(frame_source_t *src, const char *path) {
+    const char *ext = strrchr(path, '.');
+    src->video_format = (ext && (strcmp(ext, ".h265") == 0 || strcmp(ext, ".hevc") == 0)) ?
+                        JTT1078_VIDEO_H265 : JTT1078_VIDEO_H264;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "[LOADGEN] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    src->storage = malloc(len > 0 ? len : 1);
+    if (!src->storage || fread(src->storage, 1, len, fp) != (size_t)len) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    int nnal = jtt1078_nal_scan(src->storage, (uint32_t)len, src->video_format, NULL, 0);
+    jtt1078_nal_t *nals = calloc(nnal > 0 ? nnal : 1, sizeof(jtt1078_nal_t));
+    src->frames = calloc(nnal > 0 ? nnal : 1, sizeof(src_frame_t));
+    if (!nals || !src->frames) {
+        free(nals);
+        return -1;
+    }
+    jtt1078_nal_scan(src->storage, (uint32_t)len, src->video_format, nals, nnal);
+
+    // 访问单元边界: 图像的第一个slice, 或slice之后出现的非VCL单元(参数集/SEI/AUD)
+    uint32_t start = 0;
+    bool have_vcl = false;
+    bool key = false;
+    for (int i = 0; i < nnal; i++) {
+        const jtt1078_nal_t *n = &nals[i];
+        const uint8_t *nal = src->storage + n->offset;
+        bool vcl = n->kind == JTT1078_NAL_SLICE || n->kind == JTT1078_NAL_IDR ||
+                   n->kind == JTT1078_NAL_CRA;
+        uint32_t nal_start = n->offset - n->start_code_len;
+
+        bool boundary = have_vcl &&
+            (!vcl || first_slice_in_picture(nal, n->size, src->video_format));
+        if (boundary) {
+            src_frame_t *f = &src->frames[src->count++];
+            f->data = src->storage + start;
+            f->size = nal_start - start;
+            f->key = key;
+            start = nal_start;
+            have_vcl = false;
+            key = false;
+        }
+        if (vcl) {
+            have_vcl = true;
+        }
+        if (n->kind == JTT1078_NAL_IDR || n->kind == JTT1078_NAL_CRA) {
+            key = true;
+        }
+    }
+    if (have_vcl) {
+        src_frame_t *f = &src->frames[src->count++];
+        f->data = src->storage + start;
+        f->size = (uint32_t)len - start;
+        f->key = key;
+    }
+    free(nals);
+
+    if (src->count == 0) {
+        fprintf(stderr, "[LOADGEN] No access units found in %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * 虚拟终端
+ */
+
+typedef struct {
+    uint64_t end;           // 帧最后一个字节在发送流中的位置
+    uint64_t sched_ns;      // 计划发送时刻
+} pending_t;
+
+typedef struct {
+    int fd;
+    int index;
+    bool connected;
+    bool failed;
+    char sim[13];
+    uint8_t channel;
+    jtt1078_encoder_t encoder;
+
+    // 待发送数据
+    uint8_t *out;
+    uint32_t out_off;       // 已发送位置
+    uint32_t out_len;       // 数据末尾
+    uint32_t out_cap;
+    uint64_t enq_total;     // 累计写入发送缓冲区的字节数
+    uint64_t sent_total;    // 累计写入socket的字节数
+
+    pending_t pending[LOADGEN_PENDING_FRAMES];
+    uint32_t pend_head;
+    uint32_t pend_count;
+
+    // 调度
+    uint64_t next_due;      // 下一帧计划时刻(ns)
+    uint32_t frame_index;   // 帧来源中的位置
+    uint64_t frame_no;
+    int heap_pos;
+
+    // 统计
+    uint64_t frames;
+    uint64_t frames_dropped;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t *lat_us;       // 每帧发送延迟(微秒)
+    uint32_t lat_count;
+    uint32_t lat_cap;
+} terminal_t;
+
+typedef struct {
+    pthread_t thread;
+    int epfd;
+    terminal_t **terms;
+    int nterms;
+    terminal_t **heap;      // 按 next_due 的最小堆
+    int heap_size;
+} worker_t;
+
+static const frame_source_t *g_src;
+static uint32_t g_fps = 25;
+static bool g_max_rate;
+static uint64_t g_end_ns;
+
+// 编码器iovec回调: 拷入终端发送缓冲区
+static int term_sendv(const struct iovec *iov, int iovcnt, void *user_data) {
+    terminal_t *t = (terminal_t *)user_data;
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        len += iov[i].iov_len;
+    }
+
+    if (t->out_off > 0 && t->out_len + len > t->out_cap) {
+        memmove(t->out, t->out + t->out_off, t->out_len - t->out_off);
+        t->out_len -= t->out_off;
+        t->out_off = 0;
+    }
+    if (t->out_len + len > t->out_cap) {
+        uint32_t cap = t->out_cap ? t->out_cap : 64 * 1024;
+        while (cap < t->out_len + len) cap *= 2;
+        uint8_t *buf = realloc(t->out, cap);
+        if (!buf) {
+            return -1;
+        }
+        t->out = buf;
+        t->out_cap = cap;
+    }
+
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(t->out + t->out_len, iov[i].iov_base, iov[i].iov_len);
+        t->out_len += iov[i].iov_len;
+    }
+    t->enq_total += len;
+    return 0;
+}
+
+static void record_latency(terminal_t *t, uint64_t lat_ns) {
+    if (t->lat_count == t->lat_cap) {
+        uint32_t cap = t->lat_cap ? t->lat_cap * 2 : 1024;
+        uint32_t *buf = realloc(t->lat_us, cap * sizeof(uint32_t));
+        if (!buf) {
+            return;
+        }
+        t->lat_us = buf;
+        t->lat_cap = cap;
+    }
+    uint64_t us = lat_ns / 1000;
+    t->lat_us[t->lat_count++] = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+// 写socket直到缓冲区空或EAGAIN, 返回是否已全部发出
+static bool term_flush(terminal_t *t) {
+    while (t->out_off < t->out_len) {
+        ssize_t n = send(t->fd, t->out + t->out_off, t->out_len - t->out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                t->failed = true;
+            }
+            break;
+        }
+        t->out_off += n;
+        t->sent_total += n;
+    }
+
+    // 发送完成的帧计入延迟
+    uint64_t now = now_ns();
+    while (t->pend_count > 0) {
+        pending_t *p = &t->pending[t->pend_head];
+        if (p->end > t->sent_total) {
+            break;
+        }
+        record_latency(t, now > p->sched_ns ? now - p->sched_ns : 0);
+        t->pend_head = (t->pend_head + 1) & (LOADGEN_PENDING_FRAMES - 1);
+        t->pend_count--;
+    }
+
+    if (t->out_off == t->out_len) {
+        t->out_off = t->out_len = 0;
+        return true;
+    }
+    return false;
+}
+
+// 生成并编码下一帧
+static void term_produce(terminal_t *t, uint64_t sched_ns) {
+    const src_frame_t *sf = &g_src->frames[t->frame_index];
+    t->frame_index = (t->frame_index + 1) % g_src->count;
+
+    if (t->enq_total - t->sent_total > LOADGEN_MAX_BACKLOG ||
+        t->pend_count == LOADGEN_PENDING_FRAMES) {
+        t->frames_dropped++;
+        t->frame_no++;
+        return;
+    }
+
+    video_frame_t frame = {
+        .data = (uint8_t *)sf->data,
+        .size = sf->size,
+        .frame_type = sf->key ? JTT1078_DATA_TYPE_VIDEO : JTT1078_DATA_TYPE_VIDEO_P,
+        .pts = t->frame_no * 1000 / g_fps,
+        .is_keyframe = sf->key,
+    };
+    t->frame_no++;
+
+    if (jtt1078_encode_video_frame(&t->encoder, &frame) < 0) {
+        t->failed = true;
+        return;
+    }
+    t->frames++;
+
+    uint32_t slot = (t->pend_head + t->pend_count) & (LOADGEN_PENDING_FRAMES - 1);
+    t->pending[slot].end = t->enq_total;
+    t->pending[slot].sched_ns = sched_ns;
+    t->pend_count++;
+}
+
+/*
+ * 最小堆(按 next_due)
+ */
+
+static void heap_swap(worker_t *w, int a, int b) {
+    terminal_t *t = w->heap[a];
+    w->heap[a] = w->heap[b];
+    w->heap[b] = t;
+    w->heap[a]->heap_pos = a;
+    w->heap[b]->heap_pos = b;
+}
+
+static void heap_down(worker_t *w, int i) {
+    for (;;) {
+        int l = i * 2 + 1, r = l + 1, m = i;
+        if (l < w->heap_size && w->heap[l]->next_due < w->heap[m]->next_due) m = l;
+        if (r < w->heap_size && w->heap[r]->next_due < w->heap[m]->next_due) m = r;
+        if (m == i) break;
+        heap_swap(w, i, m);
+        i = m;
+    }
+}
+
+static void heap_push(worker_t *w, terminal_t *t) {
+    int i = w->heap_size++;
+    w->heap[i] = t;
+    t->heap_pos = i;
+    while (i > 0 && w->heap[(i - 1) / 2]->next_due > w->heap[i]->next_due) {
+        heap_swap(w, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heap_pop(worker_t *w) {
+    heap_swap(w, 0, --w->heap_size);
+    heap_down(w, 0);
+}
+
+static void term_close(worker_t *w, terminal_t *t) {
+    if (t->fd >= 0) {
+        epoll_ctl(w->epfd, EPOLL_CTL_DEL, t->fd, NULL);
+        close(t->fd);
+        t->fd = -1;
+    }
+    if (!t->end_ns) {
+        t->end_ns = now_ns();
+    }
+}
+
+// 连接建立后开始调度
+static void term_start(worker_t *w, terminal_t *t, uint64_t now) {
+    t->connected = true;
+    t->start_ns = now;
+    if (g_max_rate) {
+        // 最大速率: 发送缓冲区一空就生成下一帧
+        while (!t->failed && now < g_end_ns) {
+            term_produce(t, now_ns());
+            if (!term_flush(t)) break;
+        }
+    } else {
+        // 各终端起始时刻在一个帧间隔内错开, 避免同时突发
+        uint64_t interval = 1000000000ULL / g_fps;
+        t->next_due = now + interval * (uint64_t)(t->index % 64) / 64;
+        heap_push(w, t);
+    }
+}
+
+static void term_writable(worker_t *w, terminal_t *t) {
+    uint64_t now = now_ns();
+
+    if (!t->connected) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(t->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            fprintf(stderr, "[LOADGEN] Terminal %d connect failed: %s\n", t->index, strerror(err));
+            t->failed = true;
+            term_close(w, t);
+            return;
+        }
+        term_start(w, t, now);
+        return;
+    }
+
+    bool drained = term_flush(t);
+    while (g_max_rate && drained && !t->failed && now_ns() < g_end_ns) {
+        term_produce(t, now_ns());
+        drained = term_flush(t);
+    }
+    if (t->failed) {
+        term_close(w, t);
+    }
+}
+
+static void *worker_thread(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    struct epoll_event events[LOADGEN_MAX_EVENTS];
+    const uint64_t interval = 1000000000ULL / g_fps;
+    static uint8_t discard[4096];
+
+    for (;;) {
+        uint64_t now = now_ns();
+        if (!g_running || now >= g_end_ns) {
+            break;
+        }
+
+        // 到期终端生成帧
+        while (w->heap_size > 0 && w->heap[0]->next_due <= now) {
+            terminal_t *t = w->heap[0];
+            if (t->failed) {
+                heap_pop(w);
+                continue;
+            }
+            term_produce(t, t->next_due);
+            t->next_due += interval;
+            heap_down(w, 0);
+            term_flush(t);
+            if (t->failed) {
+                heap_pop(w);
+                term_close(w, t);
+            }
+        }
+
+        int timeout = 100;
+        if (w->heap_size > 0) {
+            uint64_t due = w->heap[0]->next_due;
+            timeout = due > now ? (int)((due - now + 999999) / 1000000) : 0;
+            if (timeout > 100) timeout = 100;
+        }
+
+        int n = epoll_wait(w->epfd, events, LOADGEN_MAX_EVENTS, timeout);
+        for (int i = 0; i < n; i++) {
+            terminal_t *t = (terminal_t *)events[i].data.ptr;
+            if (t->fd < 0) continue;
+            if (events[i].events & EPOLLIN) {
+                // 平台下行数据(如有)丢弃
+                while (recv(t->fd, discard, sizeof(discard), MSG_DONTWAIT) > 0) {}
+            }
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) && t->connected) {
+                // 已在堆中的终端到期时按 failed 标记移出
+                t->failed = true;
+                term_close(w, t);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                term_writable(w, t);
+            }
+        }
+    }
+
+    uint64_t end = now_ns();
+    for (int i = 0; i < w->nterms; i++) {
+        terminal_t *t = w->terms[i];
+        if (t->fd >= 0) {
+            term_flush(t);
+            t->end_ns = end;
+            term_close(w, t);
+        }
+    }
+    return NULL;
+}
+
+static int resolve(const char *host, uint16_t port, struct sockaddr_in *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr->sin_addr) == 1) {
+        return 0;
+    }
+
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0) {
+        fprintf(stderr, "[LOADGEN] Cannot resolve %s\n", host);
+        return -1;
+    }
+    addr->sin_addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, double p) {
+    if (n == 0) {
+        return 0;
+    }
+    uint32_t idx = (uint32_t)(p * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+static void raise_nofile(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *host = "127.0.0.1";
+    uint16_t port = 6605;
+    int nterms = 10;
+    int channels = 1;
+    int nthreads = 1;
+    double seconds = 10;
+    uint32_t bitrate = 2000000, gop = 50, i_ratio = 8;
+    uint32_t payload_size = JTT1078_MAX_PAYLOAD_SIZE;
+    const char *file = NULL;
+    unsigned long long base_sim = 13800000000ULL;
+    bool quiet = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:p:n:C:t:d:b:r:g:k:F:mP:S:q")) != -1) {
+        switch (opt) {
+        case 'h': host = optarg; break;
+        case 'p': port = (uint16_t)atoi(optarg); break;
+        case 'n': nterms = atoi(optarg); break;
+        case 'C': channels = atoi(optarg); break;
+        case 't': nthreads = atoi(optarg); break;
+        case 'd': seconds = atof(optarg); break;
+        case 'b': bitrate = (uint32_t)atoi(optarg); break;
+        case 'r': g_fps = (uint32_t)atoi(optarg); break;
+        case 'g': gop = (uint32_t)atoi(optarg); break;
+        case 'k': i_ratio = (uint32_t)atoi(optarg); break;
+        case 'F': file = optarg; break;
+        case 'm': g_max_rate = true; break;
+        case 'P': payload_size = (uint32_t)atoi(optarg); break;
+        case 'S': base_sim = strtoull(optarg, NULL, 10); break;
+        case 'q': quiet = true; break;
+        default:
+            fprintf(stderr, "Usage: %s [-h host] [-p port] [-n terminals] [-C channels_per_sim] [-t threads]\n"
+                            "       [-d seconds] [-b bitrate] [-r fps] [-g gop] [-k i_ratio]\n"
+                            "       [-F file.h264|file.h265] [-m] [-P payload] [-S base_sim] [-q]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nterms < 1 || channels < 1 || nthreads < 1 || g_fps == 0 || gop == 0 || i_ratio == 0) {
+        fprintf(stderr, "[LOADGEN] Invalid arguments\n");
+        return 1;
+    }
+    if (nthreads > LOADGEN_MAX_THREADS) nthreads = LOADGEN_MAX_THREADS;
+    if (nthreads > nterms) nthreads = nterms;
+
+    static frame_source_t src;
+    if ((file ? source_file(&src, file) : source_synthetic(&src, bitrate, g_fps, gop, i_ratio)) < 0) {
+        fprintf(stderr, "[LOADGEN] Failed to prepare frame source\n");
+        return 1;
+    }
+    g_src = &src;
+    uint32_t max_frame = 0;
+    for (uint32_t i = 0; i < src.count; i++) {
+        if (src.frames[i].size > max_frame) max_frame = src.frames[i].size;
+    }
+
+    struct sockaddr_in addr;
+    if (resolve(host, port, &addr) < 0) {
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    raise_nofile();
+
+    // 库内每帧的调试打印不进入结果输出
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || !freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+
+    terminal_t *terms = calloc(nterms, sizeof(terminal_t));
+    worker_t *workers = calloc(nthreads, sizeof(worker_t));
+    if (!terms || !workers) {
+        return 1;
+    }
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].epfd = epoll_create1(EPOLL_CLOEXEC);
+        workers[i].terms = calloc(nterms / nthreads + 1, sizeof(terminal_t *));
+        workers[i].heap = calloc(nterms / nthreads + 1, sizeof(terminal_t *));
+    }
+
+    for (int i = 0; i < nterms; i++) {
+        terminal_t *t = &terms[i];
+        worker_t *w = &workers[i % nthreads];
+        t->index = i;
+        t->channel = (uint8_t)(i % channels + 1);
+        snprintf(t->sim, sizeof(t->sim), "%012llu", base_sim + (unsigned long long)(i / channels));
+        // 各终端从帧序列的不同位置开始, GOP 边界不对齐
+        t->frame_index = (uint32_t)((uint64_t)i * 7919 % src.count);
+        while (!src.frames[t->frame_index].key && t->frame_index > 0 && file) {
+            t->frame_index--;
+        }
+        if (!file) {
+            t->frame_index = 0;
+        }
+
+        jtt1078_encoder_init_iov(&t->encoder, t->sim, t->channel, src.video_format, term_sendv, t);
+        jtt1078_encoder_set_payload_size(&t->encoder, payload_size);
+        jtt1078_encoder_set_timestamp_mode(&t->encoder, JTT1078_TS_PTS);
+        jtt1078_encoder_enable_batch(&t->encoder, max_frame);
+
+        t->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (t->fd < 0) {
+            perror("[LOADGEN] socket");
+            return 1;
+        }
+        int one = 1;
+        setsockopt(t->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(t->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+            fprintf(stderr, "[LOADGEN] Terminal %d connect: %s\n", i, strerror(errno));
+            close(t->fd);
+            t->fd = -1;
+            t->failed = true;
+            continue;
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT | EPOLLET, .data.ptr = t };
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, t->fd, &ev);
+        w->terms[w->nterms++] = t;
+    }
+
+    uint64_t start = now_ns();
+    g_end_ns = start + (uint64_t)(seconds * 1e9);
+    for (int i = 0; i < nthreads; i++) {
+        pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    // 结果
+    uint64_t total_lat = 0;
+    for (int i = 0; i < nterms; i++) {
+        total_lat += terms[i].lat_count;
+    }
+    uint32_t *all_lat = malloc((total_lat ? total_lat : 1) * sizeof(uint32_t));
+    uint64_t all_count = 0, all_frames = 0, all_dropped = 0, all_bytes = 0;
+    int connected = 0, failed = 0;
+
+    for (int i = 0; i < nterms; i++) {
+        terminal_t *t = &terms[i];
+        double elapsed = t->end_ns > t->start_ns ? (t->end_ns - t->start_ns) / 1e9 : 0;
+        qsort(t->lat_us, t->lat_count, sizeof(uint32_t), cmp_u32);
+
+        if (!quiet) {
+            fprintf(out,
+                    "{\"terminal\":%d,\"sim\":\"%s\",\"channel\":%u,\"connected\":%s,\"failed\":%s,"
+                    "\"frames\":%llu,\"dropped\":%llu,\"bytes\":%llu,\"bps\":%.0f,"
+                    "\"lat_p50_us\":%u,\"lat_p90_us\":%u,\"lat_p99_us\":%u,\"lat_max_us\":%u}\n",
+                    i, t->sim, t->channel, t->connected ? "true" : "false", t->failed ? "true" : "false",
+                    (unsigned long long)t->frames, (unsigned long long)t->frames_dropped,
+                    (unsigned long long)t->sent_total, elapsed > 0 ? t->sent_total * 8 / elapsed : 0.0,
+                    percentile(t->lat_us, t->lat_count, 0.50), percentile(t->lat_us, t->lat_count, 0.90),
+                    percentile(t->lat_us, t->lat_count, 0.99),
+                    t->lat_count ? t->lat_us[t->lat_count - 1] : 0);
+        }
+
+        if (all_lat) {
+            memcpy(all_lat + all_count, t->lat_us, t->lat_count * sizeof(uint32_t));
+            all_count += t->lat_count;
+        }
+        all_frames += t->frames;
+        all_dropped += t->frames_dropped;
+        all_bytes += t->sent_total;
+        connected += t->connected;
+        failed += t->failed;
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    if (all_lat) {
+        qsort(all_lat, all_count, sizeof(uint32_t), cmp_u32);
+    }
+    fprintf(out,
+            "{\"summary\":true,\"terminals\":%d,\"connected\":%d,\"failed\":%d,\"threads\":%d,"
+            "\"mode\":\"%s\",\"source\":\"%s\",\"seconds\":%.3f,\"frames\":%llu,\"dropped\":%llu,"
+            "\"bytes\":%llu,\"bps\":%.0f,\"frames_per_s\":%.0f,"
+            "\"lat_p50_us\":%u,\"lat_p90_us\":%u,\"lat_p99_us\":%u,\"lat_max_us\":%u}\n",
+            nterms, connected, failed, nthreads, g_max_rate ? "max" : "realtime",
+            file ? file : "synthetic", elapsed,
+            (unsigned long long)all_frames, (unsigned long long)all_dropped,
+            (unsigned long long)all_bytes, all_bytes * 8 / elapsed, all_frames / elapsed,
+            percentile(all_lat, (uint32_t)all_count, 0.50), percentile(all_lat, (uint32_t)all_count, 0.90),
+            percentile(all_lat, (uint32_t)all_count, 0.99),
+            all_count ? all_lat[all_count - 1] : 0);
+    fclose(out);
+
+    for (int i = 0; i < nterms; i++) {
+        jtt1078_encoder_deinit(&terms[i].encoder);
+        free(terms[i].out);
+        free(terms[i].lat_us);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        close(workers[i].epfd);
+        free(workers[i].terms);
+        free(workers[i].heap);
+    }
+    free(all_lat);
+    free(terms);
+    free(workers);
+    free(src.frames);
+    free(src.storage);
+    return 0;
+}
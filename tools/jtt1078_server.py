@@ -65,25 +65,25 @@ class JTT1078Packet:
         self.packet_seq = struct.unpack('>H', self.raw_data[6:8])[0]
         
         # Extended header
-        self.sim_bcd = self.raw_data[12:18]
+        self.sim_bcd = self.raw_data[8:14]
         self.sim = self.bcd_to_sim(self.sim_bcd)
-        self.channel = self.raw_data[18]
+        self.channel = self.raw_data[14]
         
-        data_type_byte = self.raw_data[19]
-        self.data_type = data_type_byte & 0x0F
-        self.subpackage = (data_type_byte >> 4) & 0x03
+        data_type_byte = self.raw_data[15]
+        self.data_type = (data_type_byte >> 4) & 0x0F
+        self.subpackage = data_type_byte & 0x0F
         
-        self.timestamp = struct.unpack('>Q', self.raw_data[20:28])[0]
+        self.timestamp = struct.unpack('>Q', self.raw_data[16:24])[0]
         
         # Frame intervals
-        self.last_i_interval = struct.unpack('>H', self.raw_data[28:30])[0]
-        self.last_interval = struct.unpack('>H', self.raw_data[30:32])[0]
+        self.last_i_interval = struct.unpack('>H', self.raw_data[24:26])[0]
+        self.last_interval = struct.unpack('>H', self.raw_data[26:28])[0]
         
         # Data length
-        self.data_length = struct.unpack('>H', self.raw_data[32:34])[0]
+        self.data_length = struct.unpack('>H', self.raw_data[28:30])[0]
         
         # Payload
-        self.payload = self.raw_data[34:]
+        self.payload = self.raw_data[30:]
         
         if len(self.payload) != self.data_length:
             print(f"⚠️  Warning: Payload size mismatch. Expected {self.data_length}, got {len(self.payload)}")
@@ -197,7 +197,7 @@ class JTT1078Server:
                 buffer += data
                 
                 # Try to parse complete packets
-                while len(buffer) >= 34:  # Minimum header size
+                while len(buffer) >= 30:  # Minimum header size
                     try:
                         # Check header
                         header_flag = struct.unpack('>I', buffer[0:4])[0]
@@ -207,8 +207,8 @@ class JTT1078Server:
                             break
                         
                         # Get data length
-                        data_length = struct.unpack('>H', buffer[32:34])[0]
-                        packet_size = 34 + data_length
+                        data_length = struct.unpack('>H', buffer[28:30])[0]
+                        packet_size = 30 + data_length
                         
                         # Check if we have complete packet
                         if len(buffer) < packet_size: